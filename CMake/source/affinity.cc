@@ -0,0 +1,22 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE 1
+#endif
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+
+int
+main()
+{
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	if (sched_getaffinity(0, sizeof(set), &set))
+		return 1;
+	if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set))
+		return 1;
+	return (sched_getcpu() >= 0 && SYS_mbind != 0 &&
+	    MAP_ANONYMOUS != 0 ? 0 : 1);
+}
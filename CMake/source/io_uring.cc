@@ -0,0 +1,12 @@
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+
+
+int
+main()
+{
+	io_uring_getevents_arg arg{};
+	io_uring_sqe sqe{};
+	sqe.cancel_flags = IORING_ASYNC_CANCEL_ANY;
+	return (__NR_io_uring_setup != 0 && arg.ts == 0 ? 0 : 1);
+}
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2015 Ariane van der Steldt <ariane@stack.nl>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef ILIAS_BENCH_H
+#define ILIAS_BENCH_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace bench {
+
+
+using clock = std::chrono::steady_clock;
+
+/*
+ * Throughput benchmarks take a latency sample per batch of operations,
+ * so reading the clock does not dominate the measurement.
+ * Such samples hold the average time per operation in the batch.
+ */
+constexpr unsigned int BATCH = 64U;
+
+/* Outcome of a single run of a benchmark. */
+struct result
+{
+	std::uint64_t ops = 0;			/* Operations performed. */
+	clock::duration elapsed{};		/* Wall clock time. */
+	std::vector<std::uint64_t> latency_ns;	/* Latency samples. */
+};
+
+/*
+ * Benchmark body.
+ *
+ * Runs the benchmark using the given number of threads,
+ * performing (approximately) the given number of operations.
+ */
+using body = result (*)(unsigned int threads, std::uint64_t ops);
+
+/*
+ * Registers a benchmark at static initialization time.
+ *
+ * Ops is the number of operations per run, at scale 1.
+ */
+class registration
+{
+public:
+	registration(const char* name, std::uint64_t ops, body fn);
+};
+
+/* Convert a duration to nanoseconds. */
+inline std::uint64_t
+to_ns(clock::duration d) noexcept
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+}
+
+/*
+ * Run fn(idx) on n threads.
+ *
+ * All threads are created before any of them starts running fn,
+ * so thread creation is not part of the measured time.
+ * Returns the time between the start of the first and the completion
+ * of the last invocation.
+ */
+template<typename Fn>
+clock::duration
+run_threads(unsigned int n, Fn fn)
+{
+	std::atomic<unsigned int> ready{ 0U };
+	std::atomic<bool> go{ false };
+	std::vector<std::thread> threads;
+
+	threads.reserve(n);
+	for (unsigned int i = 0; i < n; ++i) {
+		threads.emplace_back([&, i]() {
+			ready.fetch_add(1U, std::memory_order_release);
+			while (!go.load(std::memory_order_acquire))
+				std::this_thread::yield();
+			fn(i);
+		    });
+	}
+
+	while (ready.load(std::memory_order_acquire) != n)
+		std::this_thread::yield();
+	const auto start = clock::now();
+	go.store(true, std::memory_order_release);
+	for (auto& t : threads)
+		t.join();
+	return clock::now() - start;
+}
+
+/* Collects batch samples: call once after each operation. */
+class batch_sampler
+{
+private:
+	std::vector<std::uint64_t>& m_out;
+	clock::time_point m_start;
+	unsigned int m_n = 0;
+
+public:
+	explicit batch_sampler(std::vector<std::uint64_t>& out)
+	:	m_out(out),
+		m_start(clock::now())
+	{
+		/* Empty body. */
+	}
+
+	void
+	tick()
+	{
+		if (++m_n == BATCH) {
+			const auto now = clock::now();
+			m_out.push_back(to_ns(now - m_start) / BATCH);
+			m_start = now;
+			m_n = 0;
+		}
+	}
+};
+
+/* Append per-thread samples to the result. */
+inline void
+merge_samples(result& r, std::vector<std::vector<std::uint64_t>>& samples)
+{
+	for (auto& s : samples) {
+		r.latency_ns.insert(r.latency_ns.end(), s.begin(), s.end());
+		s.clear();
+	}
+}
+
+
+} /* namespace bench */
+
+#endif /* ILIAS_BENCH_H */
@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2015 Ariane van der Steldt <ariane@stack.nl>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "bench.h"
+#include <ilias/ll_list.h>
+#include <ilias/llptr.h>
+#include <ilias/refcnt.h>
+
+namespace bench {
+namespace {
+
+
+class node
+:	public ilias::ll_list_hook<>,
+	public ilias::refcount_base<node>
+{
+public:
+	std::uint64_t value = 0;
+};
+
+class biased_node
+:	public ilias::biased_refcount_base<biased_node>
+{
+public:
+	std::uint64_t value = 0;
+};
+
+using node_ptr = ilias::refpointer<node>;
+using list = ilias::ll_smartptr_list<node>;
+
+/* Number of elements each thread keeps in flight in ll_list_push_pop. */
+constexpr unsigned int PUSH_POP_DEPTH = 16U;
+/* Number of elements traversed by ll_list_iterate. */
+constexpr unsigned int ITERATE_SIZE = 1024U;
+
+
+/*
+ * Pop elements from the front of a shared list, push them on the back.
+ *
+ * Each thread adds PUSH_POP_DEPTH elements to the list, then repeatedly
+ * moves an element from the front to the back.
+ * Each operation is one pop and one push.
+ */
+result
+ll_list_push_pop(unsigned int threads, std::uint64_t ops)
+{
+	const std::uint64_t per_thread = ops / threads;
+	list lst;
+	std::vector<std::vector<std::uint64_t>> samples(threads);
+
+	result r;
+	r.ops = per_thread * threads;
+	r.elapsed = run_threads(threads, [&](unsigned int idx) {
+		for (unsigned int i = 0; i < PUSH_POP_DEPTH; ++i)
+			lst.link_back(new node{});
+		batch_sampler bs{ samples[idx] };
+
+		for (std::uint64_t i = 0; i < per_thread; ++i) {
+			node_ptr n = lst.pop_front();
+			while (!n) {
+				std::this_thread::yield();
+				n = lst.pop_front();
+			}
+			lst.link_back(std::move(n));
+			bs.tick();
+		}
+	    });
+	lst.clear();
+	merge_samples(r, samples);
+	return r;
+}
+
+/*
+ * Concurrently traverse a list.
+ *
+ * Each operation is a visited element,
+ * latency samples measure a full traversal.
+ */
+result
+ll_list_iterate(unsigned int threads, std::uint64_t ops)
+{
+	const std::uint64_t rounds =
+	    std::max<std::uint64_t>(ops / threads / ITERATE_SIZE, 1U);
+	list lst;
+	std::vector<std::vector<std::uint64_t>> samples(threads);
+	for (unsigned int i = 0; i < ITERATE_SIZE; ++i) {
+		node_ptr n = new node{};
+		n->value = i;
+		lst.link_back(n);
+	}
+
+	result r;
+	r.ops = rounds * ITERATE_SIZE * threads;
+	r.elapsed = run_threads(threads, [&](unsigned int idx) {
+		std::uint64_t sink = 0;
+
+		for (std::uint64_t i = 0; i < rounds; ++i) {
+			const auto start = clock::now();
+			for (const node& n : lst)
+				sink += n.value;
+			samples[idx].push_back(to_ns(clock::now() - start));
+		}
+		if (sink != rounds * ITERATE_SIZE * (ITERATE_SIZE - 1U) / 2U)
+			std::abort();
+	    });
+	lst.clear();
+	merge_samples(r, samples);
+	return r;
+}
+
+using epoch_llptr = ilias::llptr<node, ilias::default_refcount_mgr<node>, 0U,
+    ilias::epoch_reclaim>;
+
+/* Concurrently load a shared llptr. */
+template<typename Ptr>
+result
+llptr_load(unsigned int threads, std::uint64_t ops)
+{
+	const std::uint64_t per_thread = ops / threads;
+	Ptr ptr{ std::make_tuple(node_ptr{ new node{} }, std::bitset<0>()) };
+	std::vector<std::vector<std::uint64_t>> samples(threads);
+
+	result r;
+	r.ops = per_thread * threads;
+	r.elapsed = run_threads(threads, [&](unsigned int idx) {
+		batch_sampler bs{ samples[idx] };
+
+		for (std::uint64_t i = 0; i < per_thread; ++i) {
+			if (!std::get<0>(ptr.load(std::memory_order_acquire)))
+				std::abort();
+			bs.tick();
+		}
+	    });
+	merge_samples(r, samples);
+	return r;
+}
+
+/* Concurrently store to a shared llptr. */
+template<typename Ptr>
+result
+llptr_store(unsigned int threads, std::uint64_t ops)
+{
+	const std::uint64_t per_thread = ops / threads;
+	Ptr ptr;
+	std::vector<std::vector<std::uint64_t>> samples(threads);
+
+	result r;
+	r.ops = per_thread * threads;
+	r.elapsed = run_threads(threads, [&](unsigned int idx) {
+		const node_ptr nodes[2] = { new node{}, new node{} };
+		batch_sampler bs{ samples[idx] };
+
+		for (std::uint64_t i = 0; i < per_thread; ++i) {
+			ptr.store(std::make_tuple(nodes[i & 1U],
+			    std::bitset<0>()), std::memory_order_release);
+			bs.tick();
+		}
+	    });
+	merge_samples(r, samples);
+	return r;
+}
+
+/* Stand-in for refcnt_bias_guard, for unbiased objects. */
+template<typename Node>
+struct no_bias
+{
+	explicit no_bias(const Node&) noexcept {}
+};
+
+/*
+ * Copy and destroy a reference to an object owned by the calling thread.
+ *
+ * The Guard is held by the thread during the run.
+ */
+template<typename Node, template<typename> class Guard>
+result
+refpointer_copy(unsigned int threads, std::uint64_t ops)
+{
+	const std::uint64_t per_thread = ops / threads;
+	std::vector<std::vector<std::uint64_t>> samples(threads);
+
+	result r;
+	r.ops = per_thread * threads;
+	r.elapsed = run_threads(threads, [&](unsigned int idx) {
+		const ilias::refpointer<Node> p{ new Node{} };
+		const Guard<Node> guard{ *p };
+		batch_sampler bs{ samples[idx] };
+
+		for (std::uint64_t i = 0; i < per_thread; ++i) {
+			ilias::refpointer<Node> copy = p;
+			if (copy->value != 0)
+				std::abort();
+			bs.tick();
+		}
+	    });
+	merge_samples(r, samples);
+	return r;
+}
+
+
+const registration reg_ll_list_push_pop{ "ll_list_push_pop", 100000U,
+    &ll_list_push_pop };
+const registration reg_ll_list_iterate{ "ll_list_iterate", 200000U,
+    &ll_list_iterate };
+const registration reg_llptr_load{ "llptr_load", 1000000U,
+    &llptr_load<ilias::llptr<node>> };
+const registration reg_llptr_store{ "llptr_store", 1000000U,
+    &llptr_store<ilias::llptr<node>> };
+const registration reg_llptr_load_epoch{ "llptr_load_epoch", 1000000U,
+    &llptr_load<epoch_llptr> };
+const registration reg_llptr_store_epoch{ "llptr_store_epoch", 1000000U,
+    &llptr_store<epoch_llptr> };
+const registration reg_refpointer_copy{ "refpointer_copy", 10000000U,
+    &refpointer_copy<node, no_bias> };
+const registration reg_refpointer_copy_biased{ "refpointer_copy_biased",
+    10000000U, &refpointer_copy<biased_node, ilias::refcnt_bias_guard> };
+
+
+}} /* namespace bench::<unnamed> */
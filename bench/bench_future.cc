@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2015 Ariane van der Steldt <ariane@stack.nl>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "bench.h"
+#include <ilias/future.h>
+
+namespace bench {
+namespace {
+
+
+/* Create a promise, assign it and read the value via its future. */
+result
+future_set_get(unsigned int threads, std::uint64_t ops)
+{
+	const std::uint64_t per_thread = ops / threads;
+	std::vector<std::vector<std::uint64_t>> samples(threads);
+
+	result r;
+	r.ops = per_thread * threads;
+	r.elapsed = run_threads(threads, [&](unsigned int idx) {
+		std::uint64_t sink = 0;
+
+		for (std::uint64_t i = 0; i < per_thread; ++i) {
+			const auto start = clock::now();
+			ilias::cb_promise<std::uint64_t> p;
+			auto f = p.get_future();
+			p.set_value(i);
+			sink += f.get();
+			samples[idx].push_back(to_ns(clock::now() - start));
+		}
+		if (sink != per_thread * (per_thread - 1U) / 2U)
+			std::abort();
+	    });
+	merge_samples(r, samples);
+	return r;
+}
+
+/* Install a callback on a future, then assign its promise. */
+result
+future_callback(unsigned int threads, std::uint64_t ops)
+{
+	const std::uint64_t per_thread = ops / threads;
+	std::vector<std::vector<std::uint64_t>> samples(threads);
+
+	result r;
+	r.ops = per_thread * threads;
+	r.elapsed = run_threads(threads, [&](unsigned int idx) {
+		std::uint64_t sink = 0;
+
+		for (std::uint64_t i = 0; i < per_thread; ++i) {
+			const auto start = clock::now();
+			ilias::cb_promise<std::uint64_t> p;
+			callback(p.get_future(),
+			    [&sink](ilias::cb_future<std::uint64_t> f) {
+				sink += f.get();
+			    });
+			p.set_value(i);
+			samples[idx].push_back(to_ns(clock::now() - start));
+		}
+		if (sink != per_thread * (per_thread - 1U) / 2U)
+			std::abort();
+	    });
+	merge_samples(r, samples);
+	return r;
+}
+
+
+const registration reg_future_set_get{ "future_set_get", 200000U,
+    &future_set_get };
+const registration reg_future_callback{ "future_callback", 200000U,
+    &future_callback };
+
+
+}} /* namespace bench::<unnamed> */
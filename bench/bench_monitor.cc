@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2015 Ariane van der Steldt <ariane@stack.nl>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "bench.h"
+#include <ilias/monitor.h>
+
+namespace bench {
+namespace {
+
+
+/*
+ * Hand a monitor between threads, using the blocking interface.
+ *
+ * Latency samples measure the time to acquire the monitor.
+ */
+result
+monitor_lock(unsigned int threads, std::uint64_t ops)
+{
+	const std::uint64_t per_thread = ops / threads;
+	ilias::monitor m;
+	std::uint64_t counter = 0;
+	std::vector<std::vector<std::uint64_t>> samples(threads);
+
+	result r;
+	r.ops = per_thread * threads;
+	r.elapsed = run_threads(threads, [&](unsigned int idx) {
+		for (std::uint64_t i = 0; i < per_thread; ++i) {
+			const auto start = clock::now();
+			m.lock();
+			samples[idx].push_back(to_ns(clock::now() - start));
+			++counter;
+			m.unlock();
+		}
+	    });
+	if (counter != r.ops)
+		std::abort();
+	merge_samples(r, samples);
+	return r;
+}
+
+/*
+ * Hand a monitor between threads, using queued tokens.
+ *
+ * Latency samples measure the time until the token is granted.
+ */
+result
+monitor_queue(unsigned int threads, std::uint64_t ops)
+{
+	const std::uint64_t per_thread = ops / threads;
+	ilias::monitor m;
+	std::uint64_t counter = 0;
+	std::vector<std::vector<std::uint64_t>> samples(threads);
+
+	result r;
+	r.ops = per_thread * threads;
+	r.elapsed = run_threads(threads, [&](unsigned int idx) {
+		for (std::uint64_t i = 0; i < per_thread; ++i) {
+			const auto start = clock::now();
+			ilias::monitor_token tok = m.queue().get();
+			samples[idx].push_back(to_ns(clock::now() - start));
+			++counter;
+		}
+	    });
+	if (counter != r.ops)
+		std::abort();
+	merge_samples(r, samples);
+	return r;
+}
+
+
+const registration reg_monitor_lock{ "monitor_lock", 200000U,
+    &monitor_lock };
+const registration reg_monitor_queue{ "monitor_queue", 100000U,
+    &monitor_queue };
+
+
+}} /* namespace bench::<unnamed> */
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2015 Ariane van der Steldt <ariane@stack.nl>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "bench.h"
+#include <ilias/msg_queue.h>
+
+namespace bench {
+namespace {
+
+
+/*
+ * Multi-producer, multi-consumer throughput of msg_queue.
+ *
+ * Runs threads producers and threads consumers on a single queue.
+ * Latency samples measure enqueue.
+ */
+result
+msg_queue_mpmc(unsigned int threads, std::uint64_t ops)
+{
+	const std::uint64_t per_thread = ops / threads;
+	const std::uint64_t total = per_thread * threads;
+	ilias::msg_queue<std::uint64_t> q;
+	std::atomic<std::uint64_t> consumed{ 0U };
+	std::vector<std::vector<std::uint64_t>> samples(threads);
+
+	result r;
+	r.ops = total;
+	r.elapsed = run_threads(2U * threads, [&](unsigned int idx) {
+		if (idx < threads) {
+			batch_sampler bs{ samples[idx] };
+
+			for (std::uint64_t i = 0; i < per_thread; ++i) {
+				q.enqueue(i);
+				bs.tick();
+			}
+			return;
+		}
+
+		while (consumed.load(std::memory_order_relaxed) != total) {
+			std::uint64_t n = 0;
+			q.dequeue([&n](std::uint64_t) { ++n; }, BATCH);
+			if (n == 0)
+				std::this_thread::yield();
+			else
+				consumed.fetch_add(n, std::memory_order_relaxed);
+		}
+	    });
+	merge_samples(r, samples);
+	return r;
+}
+
+
+const registration reg_msg_queue_mpmc{ "msg_queue_mpmc", 100000U,
+    &msg_queue_mpmc };
+
+
+}} /* namespace bench::<unnamed> */
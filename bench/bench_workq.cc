@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2015 Ariane van der Steldt <ariane@stack.nl>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "bench.h"
+#include <ilias/threadpool.h>
+#include <ilias/workq.h>
+#include <vector>
+
+namespace bench {
+namespace {
+
+
+/*
+ * Throughput of workq::once().
+ *
+ * Each thread posts its share of the operations to its own workq,
+ * a threadpool of the same size runs them.
+ * The run completes once every posted function has run.
+ */
+result
+workq_once(unsigned int threads, std::uint64_t ops)
+{
+	ilias::threadpool tp{ threads };
+	auto wqs = ilias::new_workq_service();
+	threadpool_attach(*wqs, tp);
+
+	const std::uint64_t per_thread = ops / threads;
+	const std::uint64_t total = per_thread * threads;
+	std::atomic<std::uint64_t> done{ 0U };
+	std::vector<ilias::workq_ptr> wqs_vec;
+	std::vector<std::vector<std::uint64_t>> samples(threads);
+	for (unsigned int i = 0; i < threads; ++i)
+		wqs_vec.push_back(wqs->new_workq());
+
+	result r;
+	r.ops = total;
+	r.elapsed = run_threads(threads, [&](unsigned int idx) {
+		batch_sampler bs{ samples[idx] };
+
+		for (std::uint64_t i = 0; i < per_thread; ++i) {
+			wqs_vec[idx]->once([&done]() {
+				done.fetch_add(1U, std::memory_order_relaxed);
+			    });
+			bs.tick();
+		}
+		while (done.load(std::memory_order_relaxed) != total)
+			std::this_thread::yield();
+	    });
+	merge_samples(r, samples);
+	return r;
+}
+
+/*
+ * Latency between job activation and the job starting to run.
+ *
+ * Each thread repeatedly activates its own job and waits for it to run.
+ */
+result
+workq_activate_latency(unsigned int threads, std::uint64_t ops)
+{
+	/* Padding keeps the slots of different threads on separate lines. */
+	struct slot
+	{
+		char pad[64];
+		std::atomic<bool> ran{ false };
+		clock::time_point ran_at;
+	};
+
+	ilias::threadpool tp{ threads };
+	auto wqs = ilias::new_workq_service();
+	threadpool_attach(*wqs, tp);
+
+	const std::uint64_t per_thread = ops / threads;
+	std::vector<slot> slots(threads);
+	std::vector<ilias::workq_job_ptr> jobs;
+	std::vector<std::vector<std::uint64_t>> samples(threads);
+	for (unsigned int i = 0; i < threads; ++i) {
+		slot& s = slots[i];
+		jobs.push_back(wqs->new_workq()->new_job([&s]() {
+			s.ran_at = clock::now();
+			s.ran.store(true, std::memory_order_release);
+		    }));
+	}
+
+	result r;
+	r.ops = per_thread * threads;
+	r.elapsed = run_threads(threads, [&](unsigned int idx) {
+		slot& s = slots[idx];
+
+		for (std::uint64_t i = 0; i < per_thread; ++i) {
+			const auto start = clock::now();
+			jobs[idx]->activate();
+			while (!s.ran.load(std::memory_order_acquire))
+				std::this_thread::yield();
+			s.ran.store(false, std::memory_order_relaxed);
+			samples[idx].push_back(to_ns(s.ran_at - start));
+		}
+	    });
+	jobs.clear();
+	merge_samples(r, samples);
+	return r;
+}
+
+
+const registration reg_workq_once{ "workq_once", 50000U, &workq_once };
+const registration reg_workq_activate_latency{ "workq_activate_latency",
+    5000U, &workq_activate_latency };
+
+
+}} /* namespace bench::<unnamed> */
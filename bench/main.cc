@@ -0,0 +1,261 @@
+/*
+ * Copyright (c) 2015 Ariane van der Steldt <ariane@stack.nl>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "bench.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace bench {
+namespace {
+
+
+struct entry
+{
+	const char* name;
+	std::uint64_t ops;
+	body fn;
+};
+
+std::vector<entry>&
+registry()
+{
+	static std::vector<entry> r;
+	return r;
+}
+
+enum class format { csv, json };
+
+struct options
+{
+	unsigned int max_threads = std::max(std::thread::hardware_concurrency(),
+	    1U);
+	unsigned int repeat = 5U;
+	double scale = 1.0;
+	format fmt = format::csv;
+	std::vector<std::string> filter;
+};
+
+/* Aggregated results of all runs for a benchmark and thread count. */
+struct summary
+{
+	const char* name;
+	unsigned int threads;
+	unsigned int runs;
+	std::uint64_t ops;		/* Per run. */
+	double ops_per_sec_median;
+	double ops_per_sec_min;
+	double ops_per_sec_max;
+	std::uint64_t samples;
+	std::uint64_t p50, p90, p99, p999, max;
+};
+
+void
+usage(const char* argv0)
+{
+	std::cerr << "usage: " << argv0 <<
+	    " [--threads N] [--repeat N] [--scale F] [--format csv|json]"
+	    " [--list] [benchmark ...]" << std::endl;
+	std::exit(2);
+}
+
+/* Nearest rank percentile of sorted samples. */
+std::uint64_t
+percentile(const std::vector<std::uint64_t>& sorted, double p) noexcept
+{
+	if (sorted.empty())
+		return 0;
+	std::size_t idx = static_cast<std::size_t>(p * sorted.size());
+	return sorted[std::min(idx, sorted.size() - 1U)];
+}
+
+/* Thread counts to sweep: powers of two up to max, and max itself. */
+std::vector<unsigned int>
+thread_counts(unsigned int max)
+{
+	std::vector<unsigned int> rv;
+	for (unsigned int n = 1; n < max; n *= 2U)
+		rv.push_back(n);
+	rv.push_back(max);
+	return rv;
+}
+
+summary
+run(const entry& e, unsigned int threads, const options& opts)
+{
+	const std::uint64_t ops = std::max<std::uint64_t>(
+	    static_cast<std::uint64_t>(e.ops * opts.scale), threads);
+	std::vector<double> throughput;
+	std::vector<std::uint64_t> latency;
+
+	/* Warm up: caches, allocator, thread creation. */
+	e.fn(threads, std::max<std::uint64_t>(ops / 10U, threads));
+
+	for (unsigned int i = 0; i < opts.repeat; ++i) {
+		result r = e.fn(threads, ops);
+		const double sec = std::chrono::duration<double>(
+		    r.elapsed).count();
+		throughput.push_back(sec > 0.0 ? r.ops / sec : 0.0);
+		latency.insert(latency.end(),
+		    r.latency_ns.begin(), r.latency_ns.end());
+	}
+
+	std::sort(throughput.begin(), throughput.end());
+	std::sort(latency.begin(), latency.end());
+
+	summary s;
+	s.name = e.name;
+	s.threads = threads;
+	s.runs = opts.repeat;
+	s.ops = ops;
+	s.ops_per_sec_median = throughput[throughput.size() / 2U];
+	s.ops_per_sec_min = throughput.front();
+	s.ops_per_sec_max = throughput.back();
+	s.samples = latency.size();
+	s.p50 = percentile(latency, 0.50);
+	s.p90 = percentile(latency, 0.90);
+	s.p99 = percentile(latency, 0.99);
+	s.p999 = percentile(latency, 0.999);
+	s.max = (latency.empty() ? 0 : latency.back());
+	return s;
+}
+
+void
+print_csv_header()
+{
+	std::cout << "benchmark,threads,runs,ops,"
+	    "ops_per_sec_median,ops_per_sec_min,ops_per_sec_max,"
+	    "samples,p50_ns,p90_ns,p99_ns,p999_ns,max_ns" << std::endl;
+}
+
+void
+print_csv(const summary& s)
+{
+	std::cout << s.name << ',' << s.threads << ',' << s.runs << ',' <<
+	    s.ops << ',' << s.ops_per_sec_median << ',' <<
+	    s.ops_per_sec_min << ',' << s.ops_per_sec_max << ',' <<
+	    s.samples << ',' << s.p50 << ',' << s.p90 << ',' << s.p99 <<
+	    ',' << s.p999 << ',' << s.max << std::endl;
+}
+
+void
+print_json(const summary& s, bool first)
+{
+	std::cout << (first ? "  " : ",\n  ") <<
+	    "{\"benchmark\": \"" << s.name << "\"" <<
+	    ", \"threads\": " << s.threads <<
+	    ", \"runs\": " << s.runs <<
+	    ", \"ops\": " << s.ops <<
+	    ", \"ops_per_sec\": {\"median\": " << s.ops_per_sec_median <<
+	    ", \"min\": " << s.ops_per_sec_min <<
+	    ", \"max\": " << s.ops_per_sec_max << "}" <<
+	    ", \"latency_ns\": {\"samples\": " << s.samples <<
+	    ", \"p50\": " << s.p50 <<
+	    ", \"p90\": " << s.p90 <<
+	    ", \"p99\": " << s.p99 <<
+	    ", \"p999\": " << s.p999 <<
+	    ", \"max\": " << s.max << "}}" << std::flush;
+}
+
+bool
+selected(const entry& e, const options& opts)
+{
+	if (opts.filter.empty())
+		return true;
+	return std::any_of(opts.filter.begin(), opts.filter.end(),
+	    [&e](const std::string& f) {
+		return std::strstr(e.name, f.c_str()) != nullptr;
+	    });
+}
+
+
+} /* namespace bench::<unnamed> */
+
+
+registration::registration(const char* name, std::uint64_t ops, body fn)
+{
+	registry().push_back(entry{ name, ops, fn });
+}
+
+
+} /* namespace bench */
+
+
+int
+main(int argc, char** argv)
+{
+	using namespace bench;
+
+	options opts;
+	for (int i = 1; i < argc; ++i) {
+		const std::string arg = argv[i];
+		const bool has_val = (i + 1 < argc);
+
+		if (arg == "--threads" && has_val)
+			opts.max_threads = std::max(std::atoi(argv[++i]), 1);
+		else if (arg == "--repeat" && has_val)
+			opts.repeat = std::max(std::atoi(argv[++i]), 1);
+		else if (arg == "--scale" && has_val)
+			opts.scale = std::atof(argv[++i]);
+		else if (arg == "--format" && has_val) {
+			const std::string f = argv[++i];
+			if (f == "csv")
+				opts.fmt = format::csv;
+			else if (f == "json")
+				opts.fmt = format::json;
+			else
+				usage(argv[0]);
+		} else if (arg == "--list") {
+			for (const auto& e : registry())
+				std::cout << e.name << std::endl;
+			return 0;
+		} else if (arg.compare(0, 2, "--") == 0)
+			usage(argv[0]);
+		else
+			opts.filter.push_back(arg);
+	}
+	if (!(opts.scale > 0.0))
+		usage(argv[0]);
+
+	/* Registration order depends on link order: sort for repeatability. */
+	std::sort(registry().begin(), registry().end(),
+	    [](const entry& x, const entry& y) {
+		return std::strcmp(x.name, y.name) < 0;
+	    });
+
+	bool first = true;
+	if (opts.fmt == format::csv)
+		print_csv_header();
+	else
+		std::cout << "[\n";
+	for (const auto& e : registry()) {
+		if (!selected(e, opts))
+			continue;
+		for (unsigned int n : thread_counts(opts.max_threads)) {
+			const summary s = run(e, n, opts);
+			if (opts.fmt == format::csv)
+				print_csv(s);
+			else
+				print_json(s, first);
+			first = false;
+		}
+	}
+	if (opts.fmt == format::json)
+		std::cout << "\n]" << std::endl;
+	return 0;
+}
@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2015 Ariane van der Steldt <ariane@stack.nl>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef _ILIAS_COROUTINE_H_
+#define _ILIAS_COROUTINE_H_
+
+#if !defined(__cpp_impl_coroutine)
+#error "<ilias/coroutine.h> requires C++20 coroutine support."
+#endif
+
+#include <ilias/future.h>
+#include <ilias/workq.h>
+#include <coroutine>
+#include <exception>
+#include <utility>
+
+namespace ilias {
+namespace impl {
+
+
+/*
+ * Promise type for coroutines returning cb_future<T>.
+ *
+ * The coroutine starts eagerly and runs until its first suspension;
+ * its result is delivered through the returned future.
+ */
+template<typename T>
+class coroutine_promise_base {
+ public:
+  auto get_return_object() -> cb_future<T> { return prom_.get_future(); }
+  auto initial_suspend() const noexcept -> std::suspend_never { return {}; }
+  auto final_suspend() const noexcept -> std::suspend_never { return {}; }
+
+  auto unhandled_exception() noexcept -> void {
+    prom_.set_exception(std::current_exception());
+  }
+
+ protected:
+  cb_promise<T> prom_;
+};
+
+template<typename T>
+class coroutine_promise
+: public coroutine_promise_base<T>
+{
+ public:
+  template<typename U>
+  auto return_value(U&& v) -> void {
+    this->prom_.set_value(std::forward<U>(v));
+  }
+};
+
+template<>
+class coroutine_promise<void>
+: public coroutine_promise_base<void>
+{
+ public:
+  auto return_void() -> void { this->prom_.set_value(); }
+};
+
+/*
+ * Awaiter for cb_future and shared_cb_future.
+ *
+ * The awaiter is installed as a callback on the shared state directly.
+ * It lives in the coroutine frame, so awaiting does not allocate.
+ * Once the future completes, invoke() resumes the coroutine in the
+ * thread completing the future.
+ */
+template<typename Fut>
+class future_awaiter
+: public callback_node
+{
+ public:
+  explicit future_awaiter(Fut f) noexcept : f_(std::move(f)) {}
+
+  auto await_ready() const -> bool {
+    using state_t = shared_state_base::state_t;
+
+    f_.start();  // Throws no_state if f_ is not valid.
+    const state_t s = f_.state_->get_state();
+    return s == state_t::ready_value || s == state_t::ready_exc;
+  }
+
+  /*
+   * Returns false if the future completed in the meantime,
+   * in which case the coroutine continues immediately.
+   *
+   * Once the node is pushed, the coroutine may be resumed (and this
+   * awaiter destroyed) by another thread, so it must not be touched.
+   */
+  auto await_suspend(std::coroutine_handle<> h) noexcept -> bool {
+    h_ = h;
+    return f_.state_->push_callback(this);
+  }
+
+  auto await_resume() -> decltype(std::declval<Fut&>().get()) {
+    return f_.get();
+  }
+
+  void invoke(shared_state_base&) noexcept override { h_.resume(); }
+  void destroy() noexcept override {}
+
+ private:
+  Fut f_;
+  std::coroutine_handle<> h_;
+};
+
+/*
+ * Awaiter for workq_ptr.
+ *
+ * Resumes the coroutine as a one-shot job on the workq.
+ */
+class workq_awaiter {
+ public:
+  explicit workq_awaiter(workq_ptr wq) noexcept : wq_(std::move(wq)) {}
+
+  auto await_ready() const noexcept -> bool { return !wq_; }
+
+  auto await_suspend(std::coroutine_handle<> h) -> void {
+    wq_->once([h]() { h.resume(); });
+  }
+
+  auto await_resume() const noexcept -> void {}
+
+ private:
+  workq_ptr wq_;
+};
+
+
+} /* namespace ilias::impl */
+
+
+/*
+ * co_await f: suspend until the future completes,
+ * then yield the value of f.get().
+ */
+template<typename T>
+auto operator co_await(cb_future<T>&& f) noexcept ->
+    impl::future_awaiter<cb_future<T>> {
+  return impl::future_awaiter<cb_future<T>>(std::move(f));
+}
+
+template<typename T>
+auto operator co_await(shared_cb_future<T> f) noexcept ->
+    impl::future_awaiter<shared_cb_future<T>> {
+  return impl::future_awaiter<shared_cb_future<T>>(std::move(f));
+}
+
+/*
+ * co_await wq: continue the coroutine on the given workq.
+ *
+ * Awaiting a null workq continues immediately.
+ */
+inline auto operator co_await(workq_ptr wq) noexcept -> impl::workq_awaiter {
+  return impl::workq_awaiter(std::move(wq));
+}
+
+
+} /* namespace ilias */
+
+
+/* Allow coroutines to return cb_future<T>. */
+template<typename T, typename... Args>
+struct std::coroutine_traits<ilias::cb_future<T>, Args...> {
+  using promise_type = ilias::impl::coroutine_promise<T>;
+};
+
+#endif /* _ILIAS_COROUTINE_H_ */
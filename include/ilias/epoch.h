@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2013 Ariane van der Steldt <ariane@stack.nl>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef ILIAS_EPOCH_H
+#define ILIAS_EPOCH_H
+
+#include <ilias/ilias_async_export.h>
+#include <cstddef>
+
+namespace ilias {
+namespace epoch_detail {
+
+
+/* Deferred release of nrefs references to ptr. */
+struct retired {
+  void (*fn)(void*, std::size_t);
+  void* ptr;
+  std::size_t nrefs;
+};
+
+ILIAS_ASYNC_EXPORT void enter() noexcept;
+ILIAS_ASYNC_EXPORT void leave() noexcept;
+ILIAS_ASYNC_EXPORT void retire(const retired&) noexcept;
+
+
+} /* namespace ilias::epoch_detail */
+
+
+/*
+ * Epoch based reclamation.
+ *
+ * A reader holds an epoch_guard while it dereferences shared pointers.
+ * Entering a guard only writes the epoch of the calling thread,
+ * instead of claiming a shared hazard slot.
+ *
+ * A writer retires the pointers it unlinked.
+ * Retired pointers are released once every thread that was inside a
+ * guard at the time of retirement has left it.
+ * Retired pointers are kept per thread and released in batches.
+ *
+ * A thread that stays inside a guard delays all reclamation,
+ * so guards should only be held for short operations.
+ * Guards may be nested.
+ */
+class epoch_guard {
+ public:
+  epoch_guard() noexcept;
+  epoch_guard(const epoch_guard&) = delete;
+  epoch_guard& operator=(const epoch_guard&) = delete;
+  ~epoch_guard() noexcept;
+};
+
+/*
+ * Wait until everything the calling thread retired has been released.
+ *
+ * May not be called from inside an epoch_guard.
+ */
+ILIAS_ASYNC_EXPORT void epoch_synchronize() noexcept;
+
+/* Reclamation policy for llptr: epoch based reclamation. */
+struct epoch_reclaim {};
+
+
+inline epoch_guard::epoch_guard() noexcept {
+  epoch_detail::enter();
+}
+
+inline epoch_guard::~epoch_guard() noexcept {
+  epoch_detail::leave();
+}
+
+
+} /* namespace ilias */
+
+#endif /* ILIAS_EPOCH_H */
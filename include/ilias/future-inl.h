@@ -78,39 +78,61 @@ template<typename> struct shared_state_fn_invoke_and_assign;
 template<> struct shared_state_fn_invoke_and_assign<void>;
 
 
+class shared_state_base;
+
+/*
+ * Node in the callback list of a shared state.
+ *
+ * Nodes are pushed onto a lock-free stack in the shared state.
+ * Once the shared state becomes ready, each node is invoked.
+ * Invoking a node also releases it: the shared state does not touch the
+ * node after invoking it.  Nodes that are never invoked (because the
+ * shared state never became ready) are destroyed instead.
+ */
+class callback_node {
+  friend shared_state_base;
+
+ public:
+  callback_node() noexcept = default;
+  callback_node(const callback_node&) = delete;
+  callback_node& operator=(const callback_node&) = delete;
+
+  virtual void invoke(shared_state_base&) noexcept = 0;
+  virtual void destroy() noexcept = 0;
+
+ protected:
+  ~callback_node() noexcept = default;
+
+ private:
+  callback_node* next_ = nullptr;
+};
+
 template<typename> class future_callback_functor;
 
 template<typename T>
-class future_callback_functor<cb_future<T>> {
+class future_callback_functor<cb_future<T>>
+: public callback_node
+{
  public:
   future_callback_functor() noexcept {}
   virtual ~future_callback_functor() noexcept {}
   virtual void operator()(cb_future<T>&& f) noexcept = 0;
+
+  void invoke(shared_state_base&) noexcept override final;
+  void destroy() noexcept override final { delete this; }
 };
 
 template<typename T>
-class future_callback_functor<shared_cb_future<T>> {
- private:
-  void clear_chain_() noexcept {
-    future_callback_functor<shared_cb_future<T>>* p =
-        std::exchange(chain, nullptr);
-    while (p) {
-      auto pp = p;
-      p = std::exchange(pp->chain, nullptr);
-      delete pp;
-    }
-  }
-
+class future_callback_functor<shared_cb_future<T>>
+: public callback_node
+{
  public:
   future_callback_functor() noexcept {}
-  virtual ~future_callback_functor() noexcept { clear_chain_(); }
+  virtual ~future_callback_functor() noexcept {}
   virtual void operator()(shared_cb_future<T>&& f) noexcept = 0;
 
-  /*
-   * This should be a unique_ptr, but the type is incomplete at this
-   * point, preventing us from instantiating it.
-   */
-  future_callback_functor<shared_cb_future<T>>* chain;
+  void invoke(shared_state_base&) noexcept override final;
+  void destroy() noexcept override final { delete this; }
 };
 
 template<typename Fut, typename Impl>
@@ -144,6 +166,45 @@ void future_callback_functor_impl<Fut, Impl>::operator()(Fut&& f) noexcept {
 
 ILIAS_ASYNC_EXPORT void noop_dependant(std::weak_ptr<void>) noexcept;
 
+/*
+ * Callback node notifying a dependant.
+ *
+ * Each shared state embeds one of these, so the common case of a single
+ * dependant does not allocate.
+ */
+class ILIAS_ASYNC_EXPORT dependant_node
+: public callback_node
+{
+ public:
+  void invoke(shared_state_base&) noexcept override;
+  void destroy() noexcept override;
+
+  void (*fn)(std::weak_ptr<void>) = &noop_dependant;
+  std::weak_ptr<void> arg;
+};
+
+/*
+ * Dependant node, allocated using the allocator of the shared state.
+ */
+template<typename Alloc>
+class alloc_dependant_node final
+: public dependant_node
+{
+ private:
+  using alloc_type = typename std::allocator_traits<Alloc>::template
+                     rebind_alloc<alloc_dependant_node>;
+  using alloc_traits = std::allocator_traits<alloc_type>;
+
+ public:
+  explicit alloc_dependant_node(const alloc_type& alloc) : alloc_(alloc) {}
+
+  static alloc_dependant_node* create(const Alloc&);
+  void destroy() noexcept override;
+
+ private:
+  alloc_type alloc_;
+};
+
 
 class ILIAS_ASYNC_EXPORT shared_state_base {
   template<typename> friend class promise_refptr;
@@ -171,7 +232,7 @@ class ILIAS_ASYNC_EXPORT shared_state_base {
   shared_state_base(shared_state_base&&) = delete;
   shared_state_base& operator=(const shared_state_base&) = delete;
   shared_state_base& operator=(shared_state_base&&) = delete;
-  ~shared_state_base() noexcept = default;
+  ~shared_state_base() noexcept;
 
  public:
   virtual void set_exc(std::exception_ptr) = 0;
@@ -193,18 +254,15 @@ class ILIAS_ASYNC_EXPORT shared_state_base {
   void ensure_uninitialized() const;
 
   register_dependant_tx register_dependant_begin();
+  void register_dependant(void (*)(std::weak_ptr<void>),
+                          std::weak_ptr<void>);
+  bool push_callback(callback_node*) noexcept;
 
  private:
-  virtual size_t register_dependant_begin_() = 0;
-  virtual void register_dependant_commit_(size_t,
-                                          void (*)(std::weak_ptr<void>),
-                                          std::weak_ptr<void>) noexcept = 0;
-
- public:
-  virtual void register_dependant(void (*)(std::weak_ptr<void>),
-                                  std::weak_ptr<void>);
+  virtual dependant_node* new_dependant_() = 0;
 
  protected:
+  void add_callback_(callback_node*) noexcept;
   void set_ready_val(std::unique_lock<shared_state_base>) noexcept;
   void set_ready_exc(std::unique_lock<shared_state_base>) noexcept;
   bool clear_deferred() noexcept;
@@ -212,16 +270,43 @@ class ILIAS_ASYNC_EXPORT shared_state_base {
   void mark_convert_present() noexcept;
 
  private:
-  virtual void invoke_ready_cb() noexcept = 0;
+  /*
+   * Blocking wait support.
+   *
+   * Waiters spin for a while, then park until the state changes.
+   * Parked threads are counted in waiters_, so completion only needs
+   * to issue a wakeup if a thread actually parked.
+   */
+  static constexpr unsigned int WAIT_SPIN = 100U;
+
+  static bool is_ready_(state_t) noexcept;
+  state_t wait_slow_() noexcept;
+  void park_(state_t, const std::chrono::nanoseconds*) noexcept;
+  void unpark_() noexcept;
+
+  /*
+   * Callback list.
+   *
+   * Callbacks are pushed onto a lock-free stack.  Once the state becomes
+   * ready, the stack is swapped for a sentinel, after which new callbacks
+   * are invoked immediately.
+   */
+  callback_node* callbacks_closed_() noexcept;
+  void invoke_ready_cb() noexcept;
+
   void add_promise_reference_() noexcept;
   void remove_promise_reference_() noexcept;
 
   std::atomic<state_t> state_{ state_t::uninitialized };
+  std::atomic<unsigned int> waiters_{ 0U };
   std::atomic<bool> lck_{ false };
   std::atomic<bool> shared_{ false };
   std::atomic<bool> start_deferred_called_{ false };
   std::atomic<bool> start_deferred_value_{ false };
   std::atomic<uintptr_t> promise_refcnt_{ 0U };
+  std::atomic<callback_node*> callbacks_{ nullptr };
+  std::atomic<bool> embedded_used_{ false };
+  dependant_node embedded_;
 };
 
 template<typename T>
@@ -233,6 +318,8 @@ class shared_state
   friend shared_state_converter<T>;
   template<typename, typename, typename>
       friend class shared_state_converter_impl;
+  friend future_callback_functor<cb_future<T>>;
+  friend future_callback_functor<shared_cb_future<T>>;
 
  public:
   using fut_callback_fn = future_callback_functor<cb_future<T>>;
@@ -276,6 +363,8 @@ class shared_state<T&>
   friend shared_state_converter<T&>;
   template<typename, typename, typename>
       friend class shared_state_converter_impl;
+  friend future_callback_functor<cb_future<T&>>;
+  friend future_callback_functor<shared_cb_future<T&>>;
 
  public:
   using fut_callback_fn = future_callback_functor<cb_future<T&>>;
@@ -319,6 +408,8 @@ class ILIAS_ASYNC_EXPORT shared_state<void>
   friend shared_state_fn_invoke_and_assign<void>;
   template<typename, typename, typename>
       friend class shared_state_converter_impl;
+  friend future_callback_functor<cb_future<void>>;
+  friend future_callback_functor<shared_cb_future<void>>;
 
  public:
   using fut_callback_fn = future_callback_functor<cb_future<void>>;
@@ -444,14 +535,6 @@ class shared_state_nofn
       typename shared_state<T>::shared_fut_callback_fn;
   using state_t = typename shared_state<T>::state_t;
 
- private:
-  using callback_element = std::pair<void (*)(std::weak_ptr<void>),
-                                     std::weak_ptr<void>>;
-  using callback_elem_alloc =
-      typename
-      std::allocator_traits<Alloc>::template rebind_alloc<callback_element>;
-
- public:
   shared_state_nofn() = delete;
   shared_state_nofn(const shared_state_nofn&) = delete;
   shared_state_nofn(shared_state_nofn&&) = delete;
@@ -460,28 +543,14 @@ class shared_state_nofn
 
   explicit shared_state_nofn(const Alloc&, bool = false);
 
- private:
-  size_t register_dependant_begin_() override final;
-  virtual void register_dependant_commit_(size_t,
-                                          void (*)(std::weak_ptr<void>),
-                                          std::weak_ptr<void>)
-      noexcept override final;
-
- public:
-  void register_dependant(void (*)(std::weak_ptr<void>),
-                          std::weak_ptr<void>) override final;
-
   void install_callback(std::unique_ptr<fut_callback_fn>) override final;
   void install_callback(std::unique_ptr<shared_fut_callback_fn>)
       override final;
 
  private:
-  void invoke_ready_cb() noexcept override final;
+  dependant_node* new_dependant_() override final;
 
-  std::mutex ready_cb_mtx_;
-  std::unique_ptr<fut_callback_fn> ready_cb_;
-  std::unique_ptr<shared_fut_callback_fn> shared_ready_cb_;
-  std::vector<callback_element, callback_elem_alloc> dependants_;
+  const Alloc alloc_;
 };
 
 
@@ -498,16 +567,17 @@ class shared_state_base::register_dependant_tx {
   register_dependant_tx(register_dependant_tx&&) noexcept;
   register_dependant_tx& operator=(register_dependant_tx&&)
       noexcept;
+  ~register_dependant_tx() noexcept;
 
  private:
-  register_dependant_tx(shared_state_base&, size_t) noexcept;
+  register_dependant_tx(shared_state_base&, dependant_node*) noexcept;
 
  public:
   void commit(void (*)(std::weak_ptr<void>), std::weak_ptr<void>) noexcept;
 
  private:
   shared_state_base* self_ = nullptr;
-  size_t idx_;
+  dependant_node* node_ = nullptr;  // Null if the state was ready.
 };
 
 
@@ -672,22 +742,15 @@ class shared_state_task_impl<T(Args...), Alloc, Fn> final
 
   void operator()(Args...) noexcept override final;
 
-  void register_dependant(void (*)(std::weak_ptr<void>),
-                          std::weak_ptr<void>) override final;
   void install_callback(std::unique_ptr<fut_callback_fn>) override final;
   void install_callback(std::unique_ptr<shared_fut_callback_fn>)
       override final;
 
  private:
-  void invoke_ready_cb() noexcept override final;
+  dependant_node* new_dependant_() override final;
 
   std::decay_t<Fn> fn_;
-
-  std::mutex ready_cb_mtx_;
-  std::unique_ptr<fut_callback_fn> ready_cb_;
-  std::unique_ptr<shared_fut_callback_fn> shared_ready_cb_;
-  std::vector<std::pair<void (*)(std::weak_ptr<void>), std::weak_ptr<void>>,
-              Alloc> dependants_;
+  const Alloc alloc_;
 };
 
 
@@ -702,34 +765,42 @@ inline auto shared_state_base::mark_shared() noexcept -> bool {
                                          std::memory_order_relaxed);
 }
 
+inline auto shared_state_base::is_ready_(state_t s) noexcept -> bool {
+  return s == state_t::ready_exc || s == state_t::ready_value;
+}
+
 inline auto shared_state_base::wait() -> state_t {
   start_deferred(false);
 
-  state_t s;
-  for (s = get_state();
-       _predict_false(s != state_t::ready_exc &&
-                      s != state_t::ready_value);
-       s = get_state()) {
-    std::this_thread::yield();
-  }
-  return s;
+  const state_t s = get_state();
+  if (_predict_true(is_ready_(s))) return s;
+  return wait_slow_();
 }
 
 template<typename Clock, typename Duration>
 auto shared_state_base::wait_until(
     const std::chrono::time_point<Clock, Duration>& tp) -> state_t {
   using clock = typename std::chrono::time_point<Clock, Duration>::clock;
+  using std::chrono::duration_cast;
+  using std::chrono::nanoseconds;
 
   start_deferred(true);
 
+  unsigned int spin = WAIT_SPIN;
   state_t s;
   for (s = get_state();
-       _predict_false(s != state_t::ready_exc &&
-                      s != state_t::ready_value &&
-                      s != state_t::uninitialized_deferred &&
-                      clock::now() < tp);
-       s = get_state()) {
-    std::this_thread::yield();
+       _predict_false(!is_ready_(s) && s != state_t::uninitialized_deferred);
+       s = state_.load(std::memory_order_acquire)) {
+    const auto now = clock::now();
+    if (now >= tp) break;
+
+    if (spin != 0U) {
+      --spin;
+      std::this_thread::yield();
+    } else {
+      const nanoseconds timeout = duration_cast<nanoseconds>(tp - now);
+      park_(s, &timeout);
+    }
   }
   return s;
 }
@@ -982,7 +1053,7 @@ auto shared_state_converter<T>::install_exc(std::exception_ptr e) -> void {
   prom_.reset();
   if (prom) {
     prom->clear_convert();
-    prom->set_exc(move(e));
+    prom->set_exc(std::move(e));
   }
 }
 
@@ -1073,154 +1144,93 @@ auto shared_state_converter_impl<T, U, Fn>::dependant_cb_shared_(
 }
 
 
-template<typename T, typename Alloc>
-shared_state_nofn<T, Alloc>::shared_state_nofn(const Alloc& alloc,
-                                               bool deferred)
-: shared_state<T>(deferred),
-  dependants_(alloc)
-{}
-
-template<typename T, typename Alloc>
-auto shared_state_nofn<T, Alloc>::register_dependant_begin_() ->
-    size_t {
-  std::unique_lock<std::mutex> lck{ ready_cb_mtx_ };
+template<typename T>
+auto future_callback_functor<cb_future<T>>::invoke(shared_state_base& s)
+    noexcept -> void {
+  (*this)(static_cast<shared_state<T>&>(s).as_future());
+  delete this;
+}
 
-  switch (this->get_state()) {
-  default:
-    dependants_.emplace_back(&noop_dependant, std::weak_ptr<void>());
-    return dependants_.size() - 1U;;
-  case state_t::ready_value:
-  case state_t::ready_exc:
-    return 0;
-  }
+template<typename T>
+auto future_callback_functor<shared_cb_future<T>>::invoke(
+    shared_state_base& s) noexcept -> void {
+  (*this)(static_cast<shared_state<T>&>(s).as_shared_future());
+  delete this;
 }
 
-template<typename T, typename Alloc>
-auto shared_state_nofn<T, Alloc>::register_dependant_commit_(
-    size_t idx,
-    void (*fn)(std::weak_ptr<void>), std::weak_ptr<void> arg) noexcept ->
-    void {
-  std::unique_lock<std::mutex> lck{ ready_cb_mtx_ };
 
-  switch (this->get_state()) {
-  default:
-    dependants_[idx] = std::make_pair(std::move(fn), std::move(arg));
-    break;
-  case state_t::ready_value:
-  case state_t::ready_exc:
-    ready_cb_mtx_.unlock();
-    (*fn)(std::move(arg));
-    break;
+template<typename Alloc>
+auto alloc_dependant_node<Alloc>::create(const Alloc& alloc) ->
+    alloc_dependant_node* {
+  alloc_type node_alloc = alloc_type(alloc);
+  alloc_dependant_node* node = alloc_traits::allocate(node_alloc, 1);
+  try {
+    alloc_traits::construct(node_alloc, node, node_alloc);
+  } catch (...) {
+    alloc_traits::deallocate(node_alloc, node, 1);
+    throw;
   }
+  return node;
 }
 
-template<typename T, typename Alloc>
-auto shared_state_nofn<T, Alloc>::register_dependant(
-    void (*fn)(std::weak_ptr<void>), std::weak_ptr<void> arg) -> void {
-  std::unique_lock<std::mutex> lck{ ready_cb_mtx_ };
-
-  switch (this->get_state()) {
-  default:
-    dependants_.emplace_back(std::move(fn), std::move(arg));
-    break;
-  case state_t::ready_value:
-  case state_t::ready_exc:
-    ready_cb_mtx_.unlock();
-    (*fn)(std::move(arg));
-    break;
-  }
+template<typename Alloc>
+auto alloc_dependant_node<Alloc>::destroy() noexcept -> void {
+  alloc_type node_alloc = std::move(alloc_);
+  alloc_traits::destroy(node_alloc, this);
+  alloc_traits::deallocate(node_alloc, this, 1);
 }
 
+
+template<typename T, typename Alloc>
+shared_state_nofn<T, Alloc>::shared_state_nofn(const Alloc& alloc,
+                                               bool deferred)
+: shared_state<T>(deferred),
+  alloc_(alloc)
+{}
+
 template<typename T, typename Alloc>
 auto shared_state_nofn<T, Alloc>::install_callback(
     std::unique_ptr<fut_callback_fn> cb) -> void {
-  std::unique_lock<std::mutex> lck{ ready_cb_mtx_ };
-
-  switch (this->get_state()) {
-  default:
-    assert(!ready_cb_);
-    ready_cb_ = std::move(cb);
-    break;
-  case state_t::ready_value:
-  case state_t::ready_exc:
-    lck.unlock();
-    (*cb)(this->as_future());
-    break;
-  }
+  this->add_callback_(cb.release());
 }
 
 template<typename T, typename Alloc>
 auto shared_state_nofn<T, Alloc>::install_callback(
     std::unique_ptr<shared_fut_callback_fn> cb) -> void {
-  std::unique_lock<std::mutex> lck{ ready_cb_mtx_ };
-
-  switch (this->get_state()) {
-  default:
-    cb->chain = shared_ready_cb_.release();
-    shared_ready_cb_ = move(cb);
-    break;
-  case state_t::ready_value:
-  case state_t::ready_exc:
-    lck.unlock();
-    (*cb)(this->as_shared_future());
-    break;
-  }
+  this->add_callback_(cb.release());
 }
 
 template<typename T, typename Alloc>
-auto shared_state_nofn<T, Alloc>::invoke_ready_cb() noexcept -> void {
-  std::unique_ptr<fut_callback_fn> ready_cb;
-  std::unique_ptr<shared_fut_callback_fn> shared_ready_cb;
-  std::vector<callback_element, callback_elem_alloc> dependants;
-
-  /*
-   * Copy all callbacks into local variables,
-   * so we can operate on them without holding the lock.
-   *
-   * Releasing the lock is important, for instance if the callback
-   * wants to install other callbacks.
-   *
-   * This also ensures multiple calls of invoke_ready_cb are idempotent
-   * (i.e. they'll invoke each callback exactly once).
-   */
-  {
-    std::lock_guard<std::mutex> lck{ ready_cb_mtx_ };
-    std::swap(ready_cb, ready_cb_);
-    std::swap(shared_ready_cb, shared_ready_cb_);
-    std::swap(dependants, dependants_);
-  }
-
-  /* Callback for (unshared) future. */
-  if (ready_cb)
-    (*ready_cb)(this->as_future());
-  /* Callback for shared future. */
-  for (auto fn = shared_ready_cb.get(); fn != nullptr; fn = fn->chain)
-    (*fn)(this->as_shared_future());
-  /* Notification of dependants. */
-  for (auto& dep : dependants)
-    (*std::get<0>(std::move(dep)))(std::get<1>(std::move(dep)));
+auto shared_state_nofn<T, Alloc>::new_dependant_() -> dependant_node* {
+  return alloc_dependant_node<Alloc>::create(alloc_);
 }
 
 
 inline shared_state_base::register_dependant_tx::register_dependant_tx(
     register_dependant_tx&& o) noexcept
 : self_(std::exchange(o.self_, nullptr)),
-  idx_(o.idx_)
+  node_(std::exchange(o.node_, nullptr))
 {}
 
 inline auto shared_state_base::register_dependant_tx::operator=(
     register_dependant_tx&& o) noexcept -> register_dependant_tx& {
+  if (node_ != nullptr) node_->destroy();
   self_ = std::exchange(o.self_, nullptr);
-  idx_ = o.idx_;
+  node_ = std::exchange(o.node_, nullptr);
   return *this;
 }
 
 inline shared_state_base::register_dependant_tx::register_dependant_tx(
-    shared_state_base& self, size_t idx) noexcept
+    shared_state_base& self, dependant_node* node) noexcept
 : self_(&self),
-  idx_(idx)
+  node_(node)
 {}
 
+inline shared_state_base::register_dependant_tx::~register_dependant_tx()
+    noexcept {
+  if (node_ != nullptr) node_->destroy();
+}
+
 
 template<typename T>
 template<typename Fn, typename... Args>
@@ -1386,8 +1396,12 @@ shared_state_wqjob<T, Alloc, Fn, Args...>::shared_state_wqjob(
 template<typename T, typename Alloc, typename Fn, typename... Args>
 auto shared_state_wqjob<T, Alloc, Fn, Args...>::do_start_deferred(bool async)
     noexcept -> void {
-  assert(self_ == nullptr);
+  /*
+   * Only the first start may find self_ unset: a later wait() on a
+   * started, but not yet run, job lands in the else branch.
+   */
   if (this->get_state() == state_t::uninitialized_deferred) {
+    assert(self_ == nullptr);
     self_ = this->shared_from_this();
     this->shared_state_fn<T, Alloc, Fn, Args...>::do_start_deferred(false);
   } else {
@@ -1420,8 +1434,7 @@ template<typename T, typename... Args, typename Alloc, typename Fn>
 shared_state_task_impl<T(Args...), Alloc, Fn>::shared_state_task_impl(
     const Alloc& alloc, std::decay_t<Fn> fn)
 : fn_(std::move(fn)),
-  shared_ready_cb_(alloc),
-  dependants_(alloc)
+  alloc_(alloc)
 {}
 
 template<typename T, typename... Args, typename Alloc, typename Fn>
@@ -1435,98 +1448,22 @@ auto shared_state_task_impl<T(Args...), Alloc, Fn>::operator()(Args... args)
   }
 }
 
-template<typename T, typename... Args, typename Alloc, typename Fn>
-auto shared_state_task_impl<T(Args...), Alloc, Fn>::register_dependant(
-    void (*fn)(std::weak_ptr<void>), std::weak_ptr<void> arg) -> void {
-  std::unique_lock<std::mutex> lck{ ready_cb_mtx_ };
-
-  switch (this->get_state()) {
-  default:
-    dependants_.emplace_back(std::move(fn), std::move(arg));
-    break;
-  case state_t::ready_value:
-  case state_t::ready_exc:
-    lck.unlock();
-    (*fn)(std::move(arg));
-    break;
-  }
-}
-
 template<typename T, typename... Args, typename Alloc, typename Fn>
 auto shared_state_task_impl<T(Args...), Alloc, Fn>::install_callback(
     std::unique_ptr<fut_callback_fn> cb) -> void {
-  std::unique_lock<std::mutex> lck{ ready_cb_mtx_ };
-
-  switch (this->get_state()) {
-  default:
-    assert(!ready_cb_);
-    ready_cb_ = std::move(cb);
-    break;
-  case state_t::ready_value:
-  case state_t::ready_exc:
-    lck.unlock();
-    (*cb)(this->as_future());
-    break;
-  }
+  this->add_callback_(cb.release());
 }
 
 template<typename T, typename... Args, typename Alloc, typename Fn>
 auto shared_state_task_impl<T(Args...), Alloc, Fn>::install_callback(
     std::unique_ptr<shared_fut_callback_fn> cb) -> void {
-  std::unique_lock<std::mutex> lck{ ready_cb_mtx_ };
-
-  switch (this->get_state()) {
-  default:
-    cb->chain = move(shared_ready_cb_);
-    shared_ready_cb_ = move(cb);
-    break;
-  case state_t::ready_value:
-  case state_t::ready_exc:
-    lck.unlock();
-    (*cb)(this->as_shared_future());
-    break;
-  }
+  this->add_callback_(cb.release());
 }
 
 template<typename T, typename... Args, typename Alloc, typename Fn>
-auto shared_state_task_impl<T(Args...), Alloc, Fn>::invoke_ready_cb()
-    noexcept -> void {
-  std::unique_ptr<fut_callback_fn> ready_cb;
-  std::unique_ptr<shared_fut_callback_fn> shared_ready_cb;
-  std::vector<std::pair<void (*)(std::weak_ptr<void>), std::weak_ptr<void>>,
-              Alloc> dependants;
-
-  /*
-   * Copy all callbacks into local variables,
-   * so we can operate on them without holding the lock.
-   *
-   * Releasing the lock is important, for instance if the callback
-   * wants to install other callbacks.
-   *
-   * This also ensures multiple calls of invoke_ready_cb are idempotent
-   * (i.e. they'll invoke each callback exactly once).
-   */
-  {
-    std::lock_guard<std::mutex> lck{ ready_cb_mtx_ };
-    std::swap(ready_cb, ready_cb_);
-    std::swap(shared_ready_cb, shared_ready_cb_);
-    std::swap(dependants, dependants_);
-  }
-
-  /* Callback for (unshared) future. */
-  if (ready_cb)
-    (*ready_cb)(this->as_future());
-  /* Callback for shared future. */
-  while (shared_ready_cb) {
-    std::unique_ptr<shared_fut_callback_fn> fn;
-    swap(fn, shared_ready_cb);
-    shared_ready_cb = std::unique_ptr<shared_fut_callback_fn>(
-	std::exchange(fn->chain, nullptr));
-    (*fn)(this->as_shared_future());
-  }
-  /* Notification of dependants. */
-  for (auto& dep : dependants)
-    (*std::get<0>(std::move(dep)))(std::get<1>(std::move(dep)));
+auto shared_state_task_impl<T(Args...), Alloc, Fn>::new_dependant_() ->
+    dependant_node* {
+  return alloc_dependant_node<Alloc>::create(alloc_);
 }
 
 
@@ -1701,6 +1638,8 @@ auto async(workq_ptr wq, launch l, F&& f, Args&&... args) ->
     flags |= workq_job::TYPE_PARALLEL;
   if ((l & launch::aid) != launch::aid)
     flags |= workq_job::TYPE_NO_AID;
+  if ((l & launch::blocking) == launch::blocking)
+    flags |= workq_job::TYPE_BLOCKING;
 
   future_type rv =
       future_type(new_workq_job<job_type>(wq, flags, alloc_type(),
@@ -1713,10 +1652,26 @@ auto async(workq_ptr wq, launch l, F&& f, Args&&... args) ->
 template<typename F, typename... Args>
 auto async(workq_service_ptr wqs, launch l, F&& f, Args&&... args) ->
     cb_future<impl::future_result_type<F, Args...>> {
-  return async(wqs->new_workq(), l, std::forward<F>(f),
+  /*
+   * Use a pooled workq instead of creating one for this call.
+   * The job must be parallel, so it does not serialize with other jobs
+   * on the pooled workq.
+   */
+  return async(wqs->anon_workq(), l | launch::parallel, std::forward<F>(f),
                std::forward<Args>(args)...);
 }
 
+template<typename F, typename... Args>
+auto workq_switch_async(const workq_pop_state& dst, F&& f, Args&&... args) ->
+    cb_future<impl::future_result_type<F, Args...>> {
+  if (!dst.get_workq())
+    throw std::invalid_argument("workq_switch_async: no destination workq");
+
+  return async(dst.get_workq(),
+               (dst.is_single() ? launch::dfl : launch::parallel),
+               std::forward<F>(f), std::forward<Args>(args)...);
+}
+
 template<typename T, typename U, typename Fn>
 auto convert(cb_promise<T> prom, cb_future<U> src, Fn&& fn) -> void {
   using impl_t = impl::shared_state_converter_impl<T, U,
@@ -1788,7 +1743,7 @@ auto cb_promise_exceptor<T>::set_current_exception() noexcept -> bool {
   std::exception_ptr p = std::current_exception();
   if (!p) return false;
 
-  state_->set_exc(move(p));
+  state_->set_exc(std::move(p));
   state_.reset();
   return true;
 }
@@ -74,6 +74,7 @@ template<typename> class shared_state_task;
 template<typename, typename, typename> class shared_state_task_impl;
 template<typename T, typename... Args, typename Alloc, typename Fn>
 class shared_state_task_impl<T(Args...), Alloc, Fn>;
+template<typename> class future_awaiter;  // Defined in coroutine.h.
 
 template<typename T, typename Alloc>
 std::shared_ptr<shared_state<T>> allocate_shared_state(const Alloc&);
@@ -125,7 +126,8 @@ enum class launch {
   dfl = 0x0,
   defer = 0x1,
   aid = 0x2,
-  parallel = 0x4
+  parallel = 0x4,
+  blocking = 0x8
 };
 
 constexpr launch operator&(launch, launch) noexcept;
@@ -209,6 +211,18 @@ template<typename F, typename... Args>
 auto async(workq_service_ptr, launch, F&&, Args&&...) ->
     cb_future<impl::future_result_type<F, Args...>>;
 
+/*
+ * Continue on the workq of dst, without waiting for its lock.
+ *
+ * Unlike workq_switch(), the calling thread does not block:
+ * the functor is queued as a job on the workq
+ * (a parallel job, unless dst is run-single)
+ * and the returned future completes once it has run.
+ */
+template<typename F, typename... Args>
+auto workq_switch_async(const workq_pop_state&, F&&, Args&&...) ->
+    cb_future<impl::future_result_type<F, Args...>>;
+
 template<typename T, typename U, typename Fn>
 auto convert(cb_promise<T>, cb_future<U>, Fn&&) -> void;
 
@@ -376,6 +390,7 @@ class cb_future {
   template<typename> friend class impl::shared_state;
   template<typename, typename, typename, typename...>
       friend class impl::shared_state_fn;
+  template<typename> friend class impl::future_awaiter;
   template<typename> friend class packaged_task;  // Not implemented.
 
   template<typename F, typename... Args>
@@ -431,6 +446,7 @@ class cb_future<R&> {
   template<typename> friend class impl::shared_state;
   template<typename, typename, typename, typename...>
       friend class impl::shared_state_fn;
+  template<typename> friend class impl::future_awaiter;
   template<typename> friend class packaged_task;  // Not implemented.
 
   template<typename F, typename... Args>
@@ -486,6 +502,7 @@ class cb_future<void> {
   template<typename> friend class impl::shared_state;
   template<typename, typename, typename, typename...>
       friend class impl::shared_state_fn;
+  template<typename> friend class impl::future_awaiter;
   template<typename> friend class packaged_task;  // Not implemented.
 
   template<typename F, typename... Args>
@@ -542,6 +559,7 @@ class shared_cb_future {
   template<typename> friend class impl::shared_state;
   template<typename, typename, typename, typename...>
       friend class impl::shared_state_fn;
+  template<typename> friend class impl::future_awaiter;
 
   template<typename S, typename Fn> friend void callback(
       shared_cb_future<S>, Fn&&, promise_start);
@@ -587,6 +605,7 @@ class shared_cb_future<R&> {
   template<typename> friend class impl::shared_state;
   template<typename, typename, typename, typename...>
       friend class impl::shared_state_fn;
+  template<typename> friend class impl::future_awaiter;
 
   template<typename S, typename Fn> friend void callback(
       shared_cb_future<S>, Fn&&, promise_start);
@@ -632,6 +651,7 @@ class shared_cb_future<void> {
   template<typename> friend class impl::shared_state;
   template<typename, typename, typename, typename...>
       friend class impl::shared_state_fn;
+  template<typename> friend class impl::future_awaiter;
 
   template<typename S, typename Fn> friend void callback(
       shared_cb_future<S>, Fn&&, promise_start);
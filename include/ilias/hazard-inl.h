@@ -58,14 +58,14 @@ auto basic_hazard::grant(AcquireFn&& acquire, ReleaseFn&& release,
   validate_owner(owner);
 
   do_noexcept([&]() {
-                const auto hzc = hazard_count;
+                const auto hzc = hazard_count();
 
                 if (nrefs < hzc) {
                   acquire(hzc - nrefs);
                   nrefs = hzc;
                 }
 
-                nrefs -= hazard_grant(owner, value);
+                nrefs -= hazard_grant(owner, value, hzc);
                 if (nrefs > 0U)
                   release(nrefs);
               });
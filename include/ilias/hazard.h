@@ -35,12 +35,16 @@ struct alignas(64) hazard_t {
 
   std::atomic<std::uintptr_t> owner;
   std::atomic<std::uintptr_t> value;
+  hazard_t* next_local;  // Next slot claimed by the same thread.
 };
 
 
 } /* namespace ilias::hazard_detail */
 
 
+/* Reclamation policy for llptr: hazard pointers. */
+struct hazard_reclaim {};
+
 /*
  * Basic hazard-pointer implementation.
  */
@@ -73,9 +77,10 @@ class basic_hazard {
   ILIAS_ASYNC_EXPORT static std::uintptr_t validate_owner(std::uintptr_t p);
 
   ILIAS_ASYNC_EXPORT static hazard_t& allocate_hazard(std::uintptr_t) noexcept;
-  ILIAS_ASYNC_EXPORT static const std::size_t hazard_count;
+  ILIAS_ASYNC_EXPORT static std::size_t hazard_count() noexcept;
   ILIAS_ASYNC_EXPORT static std::size_t hazard_grant(std::uintptr_t,
-                                                     std::uintptr_t) noexcept;
+                                                     std::uintptr_t,
+                                                     std::size_t) noexcept;
   ILIAS_ASYNC_EXPORT static void hazard_wait(std::uintptr_t, std::uintptr_t)
       noexcept;
   ILIAS_ASYNC_EXPORT static std::size_t hazard_grant_n(std::uintptr_t,
@@ -37,5 +37,16 @@
 #define ILIAS_ASYNC_LOCAL	/* nothing */
 #endif
 
+/*
+ * Dynamic exception specifications were removed in C++17.
+ * Keep them for older dialects, so code compiled against this library
+ * using C++17 or later sees the same declarations minus the specification.
+ */
+#if __cplusplus >= 201703L
+#define ILIAS_ASYNC_THROWS(...)	/* nothing */
+#else
+#define ILIAS_ASYNC_THROWS(...)	throw (__VA_ARGS__)
+#endif
+
 
 #endif /* ILIAS_ILIAS_ASYNC_EXPORT_H */
@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2013 Ariane van der Steldt <ariane@stack.nl>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef ILIAS_IO_SERVICE_H
+#define ILIAS_IO_SERVICE_H
+
+#include <ilias/ilias_async_export.h>
+#include <ilias/future.h>
+#include <ilias/threadpool_intf.h>
+#include <ilias/workq.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace ilias {
+
+
+/*
+ * I/O readiness service.
+ *
+ * Watches file descriptors (using epoll) and, when a file descriptor
+ * becomes ready, activates a workq job or completes a future.
+ *
+ * The io_service is a threadpool client:
+ * idle threadpool workers poll it without blocking,
+ * and one idle worker blocks waiting for I/O,
+ * instead of sleeping on its condition variable.
+ * To share a threadpool with a workq_service,
+ * attach both through a tp_service_multiplexer.
+ *
+ * A file descriptor can only be watched once at a time,
+ * and must not be closed while it is being watched.
+ */
+class ILIAS_ASYNC_EXPORT io_service
+{
+public:
+	/* Readiness events. */
+	static const unsigned int READ = 0x1;
+	static const unsigned int WRITE = 0x2;
+	static const unsigned int EVENT_MASK = READ | WRITE;
+
+	class ILIAS_ASYNC_EXPORT threadpool_client
+	:	public virtual threadpool_client_intf
+	{
+	friend class io_service;
+
+	private:
+		io_service& m_self;
+
+	public:
+		threadpool_client(io_service& self)
+		:	m_self(self)
+		{
+			/* Empty body. */
+		}
+
+		~threadpool_client() noexcept;
+
+	protected:
+		bool do_work() noexcept;
+		bool has_work() noexcept;
+		bool wait_work(std::chrono::steady_clock::time_point) noexcept;
+		void wait_interrupt() noexcept;
+	};
+
+	io_service&
+	threadpool_client_arg() noexcept
+	{
+		return *this;
+	}
+
+	void attach(threadpool_client_ptr<threadpool_client>);
+
+private:
+	/* Watched fd: either a job, or a promise for a one-shot wait. */
+	struct registration
+	{
+		std::uint32_t gen;
+		unsigned int events;
+		std::weak_ptr<workq_job> job;
+		std::unique_ptr<cb_promise<unsigned int>> prom;
+	};
+
+	int m_epfd;	/* Watched fds. */
+	int m_wfd;	/* Blocking wait: m_epfd and m_evfd. */
+	int m_evfd;	/* Interrupts the blocking wait. */
+	std::atomic<bool> m_stopping{ false };
+	std::mutex m_mtx;
+	std::unordered_map<int, registration> m_regs;
+	std::uint32_t m_gen{ 0U };
+	threadpool_client_ptr<threadpool_client> m_tp;
+
+	ILIAS_ASYNC_LOCAL void add_(int, unsigned int, registration&&);
+	ILIAS_ASYNC_LOCAL bool dispatch(std::uint64_t, std::uint32_t)
+	    noexcept;
+	ILIAS_ASYNC_LOCAL unsigned int poll(unsigned int) noexcept;
+	ILIAS_ASYNC_LOCAL void interrupt() noexcept;
+
+public:
+	io_service();
+	~io_service() noexcept;
+
+	io_service(const io_service&) = delete;
+	io_service& operator=(const io_service&) = delete;
+
+	/*
+	 * Activate job each time fd becomes ready for any of the events.
+	 *
+	 * Readiness is edge triggered: after activation, the job must
+	 * read or write until the operation would block.
+	 * The registration ends when the job is destroyed,
+	 * or when remove() is called.
+	 */
+	void add(int fd, unsigned int events, const workq_job_ptr& job);
+	/*
+	 * Wait until fd is ready for any of the events.
+	 *
+	 * The future is completed with the events that fd is ready for,
+	 * after which fd is no longer watched.
+	 */
+	cb_future<unsigned int> wait(int fd, unsigned int events);
+	/*
+	 * Stop watching fd.
+	 * A pending wait() on fd is completed with a broken promise.
+	 */
+	bool remove(int fd) noexcept;
+
+	/*
+	 * Dispatch up to count ready events, without blocking.
+	 * Returns true if any event was dispatched.
+	 */
+	bool aid(unsigned int count = 64U) noexcept;
+};
+
+
+} /* namespace ilias */
+
+#endif /* ILIAS_IO_SERVICE_H */
@@ -221,73 +221,89 @@ auto ll_list_transformations<T, Tag, no_acqrel>::release_pointer_(
 } /* namespace ilias::ll_list_detail */
 
 
-template<typename T, typename Tag, typename AcqRel>
-ll_smartptr_list<T, Tag, AcqRel>::~ll_smartptr_list() noexcept {
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::~ll_smartptr_list() noexcept {
   clear();
 }
 
-template<typename T, typename Tag, typename AcqRel>
-auto ll_smartptr_list<T, Tag, AcqRel>::empty() const noexcept -> bool {
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::empty() const noexcept ->
+    bool {
   return data_.empty();
 }
 
-template<typename T, typename Tag, typename AcqRel>
-auto ll_smartptr_list<T, Tag, AcqRel>::size() const noexcept -> size_type {
-  return data_.size();
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::size() const noexcept ->
+    size_type {
+  return this->size_(data_);
 }
 
-template<typename T, typename Tag, typename AcqRel>
-auto ll_smartptr_list<T, Tag, AcqRel>::pop_front() noexcept -> pointer {
-  return this->as_type_unlinked_(data_.pop_front());
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::pop_front() noexcept ->
+    pointer {
+  pointer rv = this->as_type_unlinked_(data_.pop_front());
+  if (rv != nullptr) this->size_sub_();
+  return rv;
 }
 
-template<typename T, typename Tag, typename AcqRel>
-auto ll_smartptr_list<T, Tag, AcqRel>::pop_back() noexcept -> pointer {
-  return this->as_type_unlinked_(data_.pop_back());
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::pop_back() noexcept ->
+    pointer {
+  pointer rv = this->as_type_unlinked_(data_.pop_back());
+  if (rv != nullptr) this->size_sub_();
+  return rv;
 }
 
-template<typename T, typename Tag, typename AcqRel>
-auto ll_smartptr_list<T, Tag, AcqRel>::iterator_to(reference r)
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::iterator_to(reference r)
     noexcept -> iterator {
   iterator rv;
 
   rv.ptr_ = &r;
-  ll_list_detail::elem_ptr e_ptr = this->as_elem_(r);
-  if (!ll_list_detail::list::iterator_to(*e_ptr, &rv.pos_))
+  /*
+   * Don't hold a reference to the element while linking the iterator:
+   * a concurrent unlink of the element waits for its references to go,
+   * while releasing a partially linked iterator waits for that unlink.
+   * The caller keeps the element valid.
+   */
+  ll_list_detail::elem& e = *this->as_elem_(r);
+  if (!ll_list_detail::list::iterator_to(e, &rv.pos_))
     data_.init_end(rv.pos_);
 
   return rv;
 }
 
-template<typename T, typename Tag, typename AcqRel>
-auto ll_smartptr_list<T, Tag, AcqRel>::iterator_to(const_reference r)
-    noexcept -> const_iterator {
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::iterator_to(
+    const_reference r) noexcept -> const_iterator {
   const_iterator rv;
 
   rv.ptr_ = &r;
-  ll_list_detail::elem_ptr e_ptr = this->as_elem_(r);
-  if (!ll_list_detail::list::iterator_to(*e_ptr, &rv.pos_))
+  /* Don't hold a reference to the element, see above. */
+  ll_list_detail::elem& e = *this->as_elem_(r);
+  if (!ll_list_detail::list::iterator_to(e, &rv.pos_))
     data_.init_end(rv.pos_);
 
   return rv;
 }
 
-template<typename T, typename Tag, typename AcqRel>
-auto ll_smartptr_list<T, Tag, AcqRel>::iterator_to(const pointer& p) ->
-    iterator {
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::iterator_to(
+    const pointer& p) -> iterator {
   if (p == nullptr) throw std::invalid_argument("null pointer");
   return iterator_to(*p);
 }
 
-template<typename T, typename Tag, typename AcqRel>
-auto ll_smartptr_list<T, Tag, AcqRel>::iterator_to(const const_pointer& p) ->
-    const_iterator {
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::iterator_to(
+    const const_pointer& p) -> const_iterator {
   if (p == nullptr) throw std::invalid_argument("null pointer");
   return iterator_to(*p);
 }
 
-template<typename T, typename Tag, typename AcqRel>
-auto ll_smartptr_list<T, Tag, AcqRel>::begin() noexcept -> iterator {
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::begin() noexcept ->
+    iterator {
   iterator rv;
   auto first = data_.init_begin(rv.pos_);
   if (ll_list_detail::list::get_elem_type(*first) !=
@@ -296,8 +312,8 @@ auto ll_smartptr_list<T, Tag, AcqRel>::begin() noexcept -> iterator {
   return rv;
 }
 
-template<typename T, typename Tag, typename AcqRel>
-auto ll_smartptr_list<T, Tag, AcqRel>::end() noexcept -> iterator {
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::end() noexcept -> iterator {
   iterator rv;
   auto head = data_.init_end(rv.pos_);
   assert(ll_list_detail::list::get_elem_type(*head) ==
@@ -305,16 +321,20 @@ auto ll_smartptr_list<T, Tag, AcqRel>::end() noexcept -> iterator {
   return rv;
 }
 
-template<typename T, typename Tag, typename AcqRel>
-auto ll_smartptr_list<T, Tag, AcqRel>::begin() const noexcept ->
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::begin() const noexcept ->
     const_iterator {
   const_iterator rv;
-  rv.ptr_ = this->as_type_(data_.init_begin(rv.pos_));
+  auto first = data_.init_begin(rv.pos_);
+  if (ll_list_detail::list::get_elem_type(*first) !=
+      ll_list_detail::elem_type::head)
+    rv.ptr_ = this->as_type_(first);
   return rv;
 }
 
-template<typename T, typename Tag, typename AcqRel>
-auto ll_smartptr_list<T, Tag, AcqRel>::end() const noexcept -> const_iterator {
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::end() const noexcept ->
+    const_iterator {
   const_iterator rv;
   auto head = data_.init_end(rv.pos_);
   assert(ll_list_detail::list::get_elem_type(*head) ==
@@ -322,109 +342,130 @@ auto ll_smartptr_list<T, Tag, AcqRel>::end() const noexcept -> const_iterator {
   return rv;
 }
 
-template<typename T, typename Tag, typename AcqRel>
-auto ll_smartptr_list<T, Tag, AcqRel>::link_front(pointer p) ->
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::link_front(pointer p) ->
     bool {
   if (p == nullptr) throw std::invalid_argument("null element");
   bool rv = data_.link_front(*this->as_elem_(p));
-  if (rv) this->release_pointer_(std::move(p));
+  if (rv) {
+    this->size_add_();
+    this->release_pointer_(std::move(p));
+  }
   return rv;
 }
 
-template<typename T, typename Tag, typename AcqRel>
-auto ll_smartptr_list<T, Tag, AcqRel>::link_back(pointer p) ->
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::link_back(pointer p) ->
     bool {
   if (p == nullptr) throw std::invalid_argument("null element");
   bool rv = data_.link_back(*this->as_elem_(p));
-  if (rv) this->release_pointer_(std::move(p));
+  if (rv) {
+    this->size_add_();
+    this->release_pointer_(std::move(p));
+  }
   return rv;
 }
 
-template<typename T, typename Tag, typename AcqRel>
-auto ll_smartptr_list<T, Tag, AcqRel>::link_after(const const_iterator& i,
-                                                  pointer p) ->
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::link_after(
+    const const_iterator& i, pointer p) ->
     std::pair<iterator, bool> {
   using std::get;
   std::pair<iterator, bool> result;
 
   if (p == nullptr) throw std::invalid_argument("null element");
   auto link_result =
-      data_.link_after(i.pos_, this->as_elem_(p), &result.first.pos_);
+      data_.link_after(i.pos_, *this->as_elem_(p), &get<0>(result).pos_);
 
-  result.first = this->as_type_(get<0>(link_result));
+  result.first.ptr_ = this->as_type_(get<0>(link_result));
   result.second = get<1>(link_result);
-  if (get<1>(link_result)) this->release_pointer_(std::move(p));
+  if (get<1>(link_result)) {
+    this->size_add_();
+    this->release_pointer_(std::move(p));
+  }
   return result;
 }
 
-template<typename T, typename Tag, typename AcqRel>
-auto ll_smartptr_list<T, Tag, AcqRel>::link_after(const iterator& i,
-                                                  pointer p) ->
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::link_after(
+    const iterator& i, pointer p) ->
     std::pair<iterator, bool> {
   using std::get;
   std::pair<iterator, bool> result;
 
   if (p == nullptr) throw std::invalid_argument("null element");
   auto link_result =
-      data_.link_after(i.pos_, this->as_elem_(p), &get<0>(result).pos_);
+      data_.link_after(i.pos_, *this->as_elem_(p), &get<0>(result).pos_);
 
-  result.first = this->as_type_(get<0>(link_result));
+  result.first.ptr_ = this->as_type_(get<0>(link_result));
   result.second = get<1>(link_result);
-  if (get<1>(link_result)) this->release_pointer_(std::move(p));
+  if (get<1>(link_result)) {
+    this->size_add_();
+    this->release_pointer_(std::move(p));
+  }
   return result;
 }
 
-template<typename T, typename Tag, typename AcqRel>
-auto ll_smartptr_list<T, Tag, AcqRel>::link_before(const const_iterator& i,
-                                                   pointer p) ->
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::link_before(
+    const const_iterator& i, pointer p) ->
     std::pair<iterator, bool> {
   using std::get;
   std::pair<iterator, bool> result;
 
   if (p == nullptr) throw std::invalid_argument("null element");
   auto link_result =
-      data_.link_before(i.pos_, this->as_elem_(p), &get<0>(result).pos_);
+      data_.link_before(i.pos_, *this->as_elem_(p), &get<0>(result).pos_);
 
-  result.first = this->as_type_(get<0>(link_result));
+  result.first.ptr_ = this->as_type_(get<0>(link_result));
   result.second = get<1>(link_result);
-  if (get<1>(link_result)) this->release_pointer_(std::move(p));
+  if (get<1>(link_result)) {
+    this->size_add_();
+    this->release_pointer_(std::move(p));
+  }
   return result;
 }
 
-template<typename T, typename Tag, typename AcqRel>
-auto ll_smartptr_list<T, Tag, AcqRel>::link_before(const iterator& i,
-                                                   pointer p) ->
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::link_before(
+    const iterator& i, pointer p) ->
     std::pair<iterator, bool> {
   using std::get;
   std::pair<iterator, bool> result;
 
   if (p == nullptr) throw std::invalid_argument("null element");
   auto link_result =
-      data_.link_before(i.pos_, this->as_elem_(p), &get<0>(result).pos_);
+      data_.link_before(i.pos_, *this->as_elem_(p), &get<0>(result).pos_);
 
-  result.first = this->as_type_(get<0>(link_result));
+  result.first.ptr_ = this->as_type_(get<0>(link_result));
   result.second = get<1>(link_result);
-  if (get<1>(link_result)) this->release_pointer_(std::move(p));
+  if (get<1>(link_result)) {
+    this->size_add_();
+    this->release_pointer_(std::move(p));
+  }
   return result;
 }
 
-template<typename T, typename Tag, typename AcqRel>
-auto ll_smartptr_list<T, Tag, AcqRel>::link(const const_iterator& i,
-                                            pointer p) -> iterator {
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::link(
+    const const_iterator& i, pointer p) -> iterator {
   iterator rv;
   rv.pos_ = i.pos_;
   rv.ptr_ = i.ptr_;
 
   bool link_success;
   tie(std::ignore, link_success) =
-      data_.link_before(i.pos_, this->as_elem_(p), nullptr);
-  if (link_success) this->release_pointer_(std::move(p));
+      data_.link_before(i.pos_, *this->as_elem_(p), nullptr);
+  if (link_success) {
+    this->size_add_();
+    this->release_pointer_(std::move(p));
+  }
   return rv;
 }
 
-template<typename T, typename Tag, typename AcqRel>
-auto ll_smartptr_list<T, Tag, AcqRel>::link(const iterator& i,
-                                            pointer p) -> iterator {
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::link(
+    const iterator& i, pointer p) -> iterator {
   iterator rv;
   rv.pos_ = i.pos_;
   rv.ptr_ = i.ptr_;
@@ -432,28 +473,32 @@ auto ll_smartptr_list<T, Tag, AcqRel>::link(const iterator& i,
   bool link_success;
   tie(std::ignore, link_success) =
       data_.link_before(i.pos_, *this->as_elem_(p), nullptr);
-  if (link_success) this->release_pointer_(std::move(p));
+  if (link_success) {
+    this->size_add_();
+    this->release_pointer_(std::move(p));
+  }
   return rv;
 }
 
-template<typename T, typename Tag, typename AcqRel>
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
 template<typename Disposer>
-auto ll_smartptr_list<T, Tag, AcqRel>::clear_and_dispose(Disposer disp)
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::clear_and_dispose(
+    Disposer disp)
     noexcept(noexcept(std::declval<Disposer&>()(std::declval<pointer>()))) ->
     void {
   while (pointer p = pop_front())
     disp(std::move(p));
 }
 
-template<typename T, typename Tag, typename AcqRel>
-auto ll_smartptr_list<T, Tag, AcqRel>::clear()
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::clear()
     noexcept -> void {
   clear_and_dispose([](const pointer&) {});
 }
 
-template<typename T, typename Tag, typename AcqRel>
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
 template<typename Disposer>
-auto ll_smartptr_list<T, Tag, AcqRel>::erase_and_dispose(
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::erase_and_dispose(
     const const_iterator& i, Disposer disp)
     noexcept(noexcept(std::declval<Disposer&>()(std::declval<pointer>()))) ->
     iterator {
@@ -467,17 +512,19 @@ auto ll_smartptr_list<T, Tag, AcqRel>::erase_and_dispose(
   ll_list_detail::elem_ptr ep;
   bool unlink_success;
   tie(ep, unlink_success) = data_.unlink(e, &out.pos_, 0);
-  if (unlink_success)
+  if (unlink_success) {
+    this->size_sub_();
     disp(this->as_type_unlinked_(ep));
-  else
+  } else {
     out.pos_ = i.pos_;
+  }
   ++out;
   return out;
 }
 
-template<typename T, typename Tag, typename AcqRel>
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
 template<typename Disposer>
-auto ll_smartptr_list<T, Tag, AcqRel>::erase_and_dispose(
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::erase_and_dispose(
     const iterator& i, Disposer disp)
     noexcept(noexcept(std::declval<Disposer&>()(std::declval<pointer>()))) ->
     iterator {
@@ -491,29 +538,31 @@ auto ll_smartptr_list<T, Tag, AcqRel>::erase_and_dispose(
   ll_list_detail::elem_ptr ep;
   bool unlink_success;
   tie(ep, unlink_success) = data_.unlink(e, &out.pos_, 0);
-  if (unlink_success)
+  if (unlink_success) {
+    this->size_sub_();
     disp(this->as_type_unlinked_(ep));
-  else
+  } else {
     out.pos_ = i.pos_;
+  }
   ++out;
   return out;
 }
 
-template<typename T, typename Tag, typename AcqRel>
-auto ll_smartptr_list<T, Tag, AcqRel>::erase(const const_iterator& i)
-    noexcept -> iterator {
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::erase(
+    const const_iterator& i) noexcept -> iterator {
   return erase_and_dispose(i, [](const pointer&) {});
 }
 
-template<typename T, typename Tag, typename AcqRel>
-auto ll_smartptr_list<T, Tag, AcqRel>::erase(const iterator& i)
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::erase(const iterator& i)
     noexcept-> iterator {
   return erase_and_dispose(i, [](const pointer&) {});
 }
 
-template<typename T, typename Tag, typename AcqRel>
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
 template<typename Disposer>
-auto ll_smartptr_list<T, Tag, AcqRel>::erase_and_dispose(
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::erase_and_dispose(
     const const_iterator& b, const const_iterator& e, Disposer disp)
     noexcept(noexcept(std::declval<Disposer&>()(std::declval<pointer>()))) ->
     iterator {
@@ -532,9 +581,9 @@ auto ll_smartptr_list<T, Tag, AcqRel>::erase_and_dispose(
   return i;
 }
 
-template<typename T, typename Tag, typename AcqRel>
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
 template<typename Disposer>
-auto ll_smartptr_list<T, Tag, AcqRel>::erase_and_dispose(
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::erase_and_dispose(
     const iterator& b, const iterator& e, Disposer disp)
     noexcept(noexcept(std::declval<Disposer&>()(std::declval<pointer>()))) ->
     iterator {
@@ -553,22 +602,22 @@ auto ll_smartptr_list<T, Tag, AcqRel>::erase_and_dispose(
   return i;
 }
 
-template<typename T, typename Tag, typename AcqRel>
-auto ll_smartptr_list<T, Tag, AcqRel>::erase(
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::erase(
     const const_iterator& b, const const_iterator& e) noexcept -> iterator {
   return erase_and_dispose(b, e, [](const pointer&) {});
 }
 
-template<typename T, typename Tag, typename AcqRel>
-auto ll_smartptr_list<T, Tag, AcqRel>::erase(
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::erase(
     const iterator& b, const iterator& e) noexcept -> iterator {
   return erase_and_dispose(b, e, [](const pointer&) {});
 }
 
-template<typename T, typename Tag, typename AcqRel>
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
 template<typename Predicate, typename Disposer>
-auto ll_smartptr_list<T, Tag, AcqRel>::remove_and_dispose_if(Predicate pred,
-                                                             Disposer disp)
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::remove_and_dispose_if(
+    Predicate pred, Disposer disp)
     noexcept(noexcept(std::declval<Predicate&>()(
                           std::declval<const_reference>())) &&
              noexcept(std::declval<Disposer&>()(std::declval<pointer>()))) ->
@@ -586,10 +635,10 @@ auto ll_smartptr_list<T, Tag, AcqRel>::remove_and_dispose_if(Predicate pred,
   }
 }
 
-template<typename T, typename Tag, typename AcqRel>
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
 template<typename Disposer>
-auto ll_smartptr_list<T, Tag, AcqRel>::remove_and_dispose(const_reference v,
-                                                          Disposer disp)
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::remove_and_dispose(
+    const_reference v, Disposer disp)
     noexcept(noexcept(std::declval<const_reference>() ==
                           std::declval<const_reference>()) &&
              noexcept(std::declval<Disposer&>()(std::declval<pointer>()))) ->
@@ -598,91 +647,95 @@ auto ll_smartptr_list<T, Tag, AcqRel>::remove_and_dispose(const_reference v,
                                std::move(disp));
 }
 
-template<typename T, typename Tag, typename AcqRel>
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
 template<typename Predicate>
-auto ll_smartptr_list<T, Tag, AcqRel>::remove_if(Predicate pred)
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::remove_if(Predicate pred)
     noexcept(noexcept(std::declval<Predicate&>()(
                           std::declval<const_reference>()))) ->
     void {
   return remove_and_dispose_if(std::move(pred), [](const pointer&) {});
 }
 
-template<typename T, typename Tag, typename AcqRel>
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
 template<typename Predicate>
-auto ll_smartptr_list<T, Tag, AcqRel>::remove(const_reference v)
-    noexcept(noexcept(std::declval<Predicate&>()(
-                          std::declval<const_reference>()))) ->
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::remove(const_reference v)
+    noexcept(noexcept(std::declval<const_reference>() ==
+                          std::declval<const_reference>())) ->
     void {
   return remove_and_dispose_if([&v](const_reference& x) { return x == v; },
                                [](const pointer&) {});
 }
 
-template<typename T, typename Tag, typename AcqRel>
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
 template<typename Functor>
-auto ll_smartptr_list<T, Tag, AcqRel>::visit(Functor fn)
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::visit(Functor fn)
     noexcept(noexcept(std::declval<Functor&>()(std::declval<reference>()))) ->
     Functor {
   for (reference i : *this) fn(i);
   return fn;
 }
 
-template<typename T, typename Tag, typename AcqRel>
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
 template<typename Functor>
-auto ll_smartptr_list<T, Tag, AcqRel>::visit(Functor fn)
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::visit(Functor fn)
     const
-    noexcept(noexcept(std::declval<Functor&>()(std::declval<reference>()))) ->
+    noexcept(noexcept(std::declval<Functor&>()(
+                          std::declval<const_reference>()))) ->
     Functor {
   for (const_reference i : *this) fn(i);
   return fn;
 }
 
 
-template<typename T, typename Tag, typename AcqRel>
-auto ll_smartptr_list<T, Tag, AcqRel>::iterator::operator==(
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::iterator::operator==(
     const iterator& o) const noexcept -> bool {
   return pos_ == o.pos_;
 }
 
-template<typename T, typename Tag, typename AcqRel>
-auto ll_smartptr_list<T, Tag, AcqRel>::iterator::operator!=(
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::iterator::operator!=(
     const iterator& o) const noexcept -> bool {
   return !(*this == o);
 }
 
-template<typename T, typename Tag, typename AcqRel>
-auto ll_smartptr_list<T, Tag, AcqRel>::iterator::get() const noexcept ->
-    pointer {
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::iterator::get()
+    const noexcept -> pointer {
   return ptr_;
 }
 
-template<typename T, typename Tag, typename AcqRel>
-auto ll_smartptr_list<T, Tag, AcqRel>::iterator::operator->() const noexcept ->
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::iterator::operator->()
+    const noexcept ->
     value_type* {
   assert(ptr_ != nullptr);
   return &*ptr_;
 }
 
-template<typename T, typename Tag, typename AcqRel>
-auto ll_smartptr_list<T, Tag, AcqRel>::iterator::operator*() const noexcept ->
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::iterator::operator*()
+    const noexcept ->
     reference {
   assert(ptr_ != nullptr);
   return *ptr_;
 }
 
-template<typename T, typename Tag, typename AcqRel>
-ll_smartptr_list<T, Tag, AcqRel>::iterator::operator pointer() const noexcept {
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::iterator::operator pointer()
+    const noexcept {
   return *ptr_;
 }
 
-template<typename T, typename Tag, typename AcqRel>
-auto ll_smartptr_list<T, Tag, AcqRel>::iterator::release() noexcept ->
-    pointer {
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::iterator::release()
+    noexcept -> pointer {
   pointer rv = std::move(ptr_);
   return rv;
 }
 
-template<typename T, typename Tag, typename AcqRel>
-auto ll_smartptr_list<T, Tag, AcqRel>::iterator::operator++()
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::iterator::operator++()
     noexcept -> iterator& {
   auto e = pos_.step_forward();
   if (e == nullptr ||
@@ -695,16 +748,16 @@ auto ll_smartptr_list<T, Tag, AcqRel>::iterator::operator++()
   return *this;
 }
 
-template<typename T, typename Tag, typename AcqRel>
-auto ll_smartptr_list<T, Tag, AcqRel>::iterator::operator++(int)
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::iterator::operator++(int)
     noexcept -> iterator {
   iterator clone = *this;
   ++clone;
   return clone;
 }
 
-template<typename T, typename Tag, typename AcqRel>
-auto ll_smartptr_list<T, Tag, AcqRel>::iterator::operator--()
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::iterator::operator--()
     noexcept -> iterator& {
   auto e = pos_.step_backward();
   if (e == nullptr ||
@@ -717,8 +770,8 @@ auto ll_smartptr_list<T, Tag, AcqRel>::iterator::operator--()
   return *this;
 }
 
-template<typename T, typename Tag, typename AcqRel>
-auto ll_smartptr_list<T, Tag, AcqRel>::iterator::operator--(int)
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::iterator::operator--(int)
     noexcept -> iterator {
   iterator clone = *this;
   --clone;
@@ -726,60 +779,60 @@ auto ll_smartptr_list<T, Tag, AcqRel>::iterator::operator--(int)
 }
 
 
-template<typename T, typename Tag, typename AcqRel>
-auto ll_smartptr_list<T, Tag, AcqRel>::const_iterator::operator==(
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::const_iterator::operator==(
     const const_iterator& o) const noexcept -> bool {
   return pos_ == o.pos_;
 }
 
-template<typename T, typename Tag, typename AcqRel>
-auto ll_smartptr_list<T, Tag, AcqRel>::const_iterator::operator!=(
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::const_iterator::operator!=(
     const const_iterator& o) const noexcept -> bool {
   return !(*this == o);
 }
 
-template<typename T, typename Tag, typename AcqRel>
-ll_smartptr_list<T, Tag, AcqRel>::const_iterator::const_iterator(
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::const_iterator::const_iterator(
     const iterator& o) noexcept
 : pos_(o.pos_),
   ptr_(o.ptr_)
 {}
 
-template<typename T, typename Tag, typename AcqRel>
-auto ll_smartptr_list<T, Tag, AcqRel>::const_iterator::get() const noexcept ->
-    pointer {
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::const_iterator::get()
+    const noexcept -> pointer {
   return ptr_;
 }
 
-template<typename T, typename Tag, typename AcqRel>
-auto ll_smartptr_list<T, Tag, AcqRel>::const_iterator::operator->()
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::const_iterator::operator->()
     const noexcept -> value_type* {
   assert(ptr_ != nullptr);
   return &*ptr_;
 }
 
-template<typename T, typename Tag, typename AcqRel>
-auto ll_smartptr_list<T, Tag, AcqRel>::const_iterator::operator*()
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::const_iterator::operator*()
     const noexcept -> reference {
   assert(ptr_ != nullptr);
   return *ptr_;
 }
 
-template<typename T, typename Tag, typename AcqRel>
-ll_smartptr_list<T, Tag, AcqRel>::const_iterator::operator pointer()
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::const_iterator::operator pointer()
     const noexcept {
   return *ptr_;
 }
 
-template<typename T, typename Tag, typename AcqRel>
-auto ll_smartptr_list<T, Tag, AcqRel>::const_iterator::release()
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::const_iterator::release()
     noexcept -> pointer {
   pointer rv = std::move(ptr_);
   return rv;
 }
 
-template<typename T, typename Tag, typename AcqRel>
-auto ll_smartptr_list<T, Tag, AcqRel>::const_iterator::operator++()
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::const_iterator::operator++()
     noexcept -> const_iterator& {
   auto e = pos_.step_forward();
   if (e == nullptr ||
@@ -792,16 +845,16 @@ auto ll_smartptr_list<T, Tag, AcqRel>::const_iterator::operator++()
   return *this;
 }
 
-template<typename T, typename Tag, typename AcqRel>
-auto ll_smartptr_list<T, Tag, AcqRel>::const_iterator::operator++(int)
-    noexcept -> const_iterator {
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::const_iterator::operator++(
+    int) noexcept -> const_iterator {
   const_iterator clone = *this;
   ++clone;
   return clone;
 }
 
-template<typename T, typename Tag, typename AcqRel>
-auto ll_smartptr_list<T, Tag, AcqRel>::const_iterator::operator--()
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::const_iterator::operator--()
     noexcept -> const_iterator& {
   auto e = pos_.step_backward();
   if (e == nullptr ||
@@ -814,9 +867,9 @@ auto ll_smartptr_list<T, Tag, AcqRel>::const_iterator::operator--()
   return *this;
 }
 
-template<typename T, typename Tag, typename AcqRel>
-auto ll_smartptr_list<T, Tag, AcqRel>::const_iterator::operator--(int)
-    noexcept -> const_iterator {
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::const_iterator::operator--(
+    int) noexcept -> const_iterator {
   const_iterator clone = *this;
   --clone;
   return clone;
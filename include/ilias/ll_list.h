@@ -31,6 +31,17 @@ namespace ilias {
 struct no_acqrel {};
 template<typename = void> class ll_list_hook;
 
+/*
+ * Size policies for lock-free lists and queues.
+ *
+ * ll_size_walk: size() walks the list, O(n).
+ * ll_size_counted: size() reads a counter that is maintained by each
+ *   link and unlink, O(1).  Under concurrent modification the count
+ *   is approximate.
+ */
+struct ll_size_walk {};
+struct ll_size_counted {};
+
 
 namespace ll_list_detail {
 
@@ -234,6 +245,48 @@ class list::position {
 };
 
 
+template<typename SizePolicy> class size_counter;
+
+/* Walking size policy: no bookkeeping. */
+template<>
+class size_counter<ll_size_walk> {
+ protected:
+  void size_add_() noexcept {}
+  void size_sub_() noexcept {}
+
+  template<typename Container>
+  static size_t size_(const Container& c) noexcept { return c.size(); }
+};
+
+/*
+ * Counted size policy.
+ *
+ * The counter is updated after each successful link or unlink,
+ * so it may briefly drop below zero if an element is unlinked before
+ * its linker counted it.
+ */
+template<>
+class size_counter<ll_size_counted> {
+ protected:
+  void size_add_() noexcept {
+    count_.fetch_add(1, memory_order_relaxed);
+  }
+
+  void size_sub_() noexcept {
+    count_.fetch_sub(1, memory_order_relaxed);
+  }
+
+  template<typename Container>
+  size_t size_(const Container&) const noexcept {
+    const ptrdiff_t n = count_.load(memory_order_relaxed);
+    return (n < 0 ? 0U : size_t(n));
+  }
+
+ private:
+  atomic<ptrdiff_t> count_{ 0 };
+};
+
+
 template<typename T, typename Tag, typename AcqRel>
 class ll_list_transformations {
  public:
@@ -298,9 +351,11 @@ class ll_list_hook
 };
 
 template<typename T, typename Tag = void,
-         typename AcqRel = default_refcount_mgr<T>>
+         typename AcqRel = default_refcount_mgr<T>,
+         typename SizePolicy = ll_size_walk>
 class ll_smartptr_list
-: private ll_list_detail::ll_list_transformations<T, Tag, AcqRel>
+: private ll_list_detail::ll_list_transformations<T, Tag, AcqRel>,
+  private ll_list_detail::size_counter<SizePolicy>
 {
  private:
   using transformations_type =
@@ -405,8 +460,8 @@ class ll_smartptr_list
 };
 
 
-template<typename T, typename Tag, typename AcqRel>
-class ll_smartptr_list<T, Tag, AcqRel>::iterator
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+class ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::iterator
 : private ll_list_detail::ll_list_transformations<T, Tag, AcqRel>,
   public std::iterator<
       std::bidirectional_iterator_tag,
@@ -452,8 +507,8 @@ class ll_smartptr_list<T, Tag, AcqRel>::iterator
 };
 
 
-template<typename T, typename Tag, typename AcqRel>
-class ll_smartptr_list<T, Tag, AcqRel>::const_iterator
+template<typename T, typename Tag, typename AcqRel, typename SizePolicy>
+class ll_smartptr_list<T, Tag, AcqRel, SizePolicy>::const_iterator
 : private ll_list_detail::ll_list_transformations<T, Tag, AcqRel>,
   public std::iterator<
       std::bidirectional_iterator_tag,
@@ -500,8 +555,9 @@ class ll_smartptr_list<T, Tag, AcqRel>::const_iterator
 };
 
 
-template<typename T, typename Tag = void> using ll_list =
-    ll_smartptr_list<T, Tag, no_acqrel>;
+template<typename T, typename Tag = void,
+         typename SizePolicy = ll_size_walk> using ll_list =
+    ll_smartptr_list<T, Tag, no_acqrel, SizePolicy>;
 
 
 } /* namespace ilias */
@@ -55,14 +55,16 @@ inline auto atomic_is_lock_free(const ll_qhead* h) noexcept -> bool {
 namespace {
 
 
-template<typename Type, typename Tag>
-auto atomic_is_lock_free(const ll_queue<Type, Tag>* q) noexcept -> bool {
+template<typename Type, typename Tag, typename SizePolicy>
+auto atomic_is_lock_free(const ll_queue<Type, Tag, SizePolicy>* q) noexcept ->
+    bool {
   return q && q->is_lock_free();
 }
 
-template<typename Type, typename AcqRel, typename Tag>
-auto atomic_is_lock_free(const ll_smartptr_queue<Type, AcqRel, Tag>* q)
-    noexcept -> bool {
+template<typename Type, typename AcqRel, typename Tag, typename SizePolicy>
+auto atomic_is_lock_free(
+    const ll_smartptr_queue<Type, AcqRel, Tag, SizePolicy>* q) noexcept ->
+    bool {
   return q && q->is_lock_free();
 }
 
@@ -70,86 +72,90 @@ auto atomic_is_lock_free(const ll_smartptr_queue<Type, AcqRel, Tag>* q)
 } /* namespace ilias::<unnamed> */
 
 
-template<typename Type, typename Tag>
-auto ll_queue<Type, Tag>::link_convert(pointer p) noexcept ->
+template<typename Type, typename Tag, typename SizePolicy>
+auto ll_queue<Type, Tag, SizePolicy>::link_convert(pointer p) noexcept ->
     ll_queue_hook<Tag>* {
   using rv_type = ll_queue_hook<Tag>*;
   return (p ? rv_type{ p } : nullptr);
 }
 
-template<typename Type, typename Tag>
-auto ll_queue<Type, Tag>::unlink_convert(ll_queue_hook<Tag>* p) noexcept ->
-    pointer {
+template<typename Type, typename Tag, typename SizePolicy>
+auto ll_queue<Type, Tag, SizePolicy>::unlink_convert(
+    ll_queue_hook<Tag>* p) noexcept -> pointer {
   return (p ? &static_cast<reference>(*p) : nullptr);
 }
 
-template<typename Type, typename Tag>
-auto ll_queue<Type, Tag>::unlink_convert(ll_queue_detail::ll_qhead::elem* e)
-    noexcept -> pointer {
+template<typename Type, typename Tag, typename SizePolicy>
+auto ll_queue<Type, Tag, SizePolicy>::unlink_convert(
+    ll_queue_detail::ll_qhead::elem* e) noexcept -> pointer {
   return (e ?
           unlink_convert(&static_cast<ll_queue_hook<Tag>&>(*e)) :
           nullptr);
 }
 
-template<typename Type, typename Tag>
-auto ll_queue<Type, Tag>::empty() const noexcept -> bool {
+template<typename Type, typename Tag, typename SizePolicy>
+auto ll_queue<Type, Tag, SizePolicy>::empty() const noexcept -> bool {
   return m_impl.empty();
 }
 
-template<typename Type, typename Tag>
-auto ll_queue<Type, Tag>::size() const noexcept -> size_type {
-  return m_impl.size();
+template<typename Type, typename Tag, typename SizePolicy>
+auto ll_queue<Type, Tag, SizePolicy>::size() const noexcept -> size_type {
+  return this->size_(m_impl);
 }
 
-template<typename Type, typename Tag>
-auto ll_queue<Type, Tag>::push_back(pointer p) -> void {
+template<typename Type, typename Tag, typename SizePolicy>
+auto ll_queue<Type, Tag, SizePolicy>::push_back(pointer p) -> void {
   m_impl.push_back(link_convert(p));
+  this->size_add_();
 }
 
-template<typename Type, typename Tag>
-auto ll_queue<Type, Tag>::pop_front() noexcept -> pointer {
-  return unlink_convert(m_impl.pop_front());
+template<typename Type, typename Tag, typename SizePolicy>
+auto ll_queue<Type, Tag, SizePolicy>::pop_front() noexcept -> pointer {
+  pointer rv = unlink_convert(m_impl.pop_front());
+  if (rv != nullptr) this->size_sub_();
+  return rv;
 }
 
-template<typename Type, typename Tag>
-auto ll_queue<Type, Tag>::push_front(pointer p) -> void {
+template<typename Type, typename Tag, typename SizePolicy>
+auto ll_queue<Type, Tag, SizePolicy>::push_front(pointer p) -> void {
   m_impl.push_front(link_convert(p));
+  this->size_add_();
 }
 
-template<typename Type, typename Tag>
-auto ll_queue<Type, Tag>::is_lock_free() const noexcept -> bool {
+template<typename Type, typename Tag, typename SizePolicy>
+auto ll_queue<Type, Tag, SizePolicy>::is_lock_free() const noexcept -> bool {
   return m_impl.is_lock_free();
 }
 
 
-template<typename Type>
-ll_queue<Type, no_intrusive_tag>::elem::elem(const_reference v)
+template<typename Type, typename SizePolicy>
+ll_queue<Type, no_intrusive_tag, SizePolicy>::elem::elem(const_reference v)
     noexcept(std::is_nothrow_copy_constructible<value_type>::value)
 : m_value(v)
 {}
 
-template<typename Type>
-ll_queue<Type, no_intrusive_tag>::elem::elem(rvalue_reference v)
+template<typename Type, typename SizePolicy>
+ll_queue<Type, no_intrusive_tag, SizePolicy>::elem::elem(rvalue_reference v)
     noexcept(std::is_nothrow_move_constructible<value_type>::value)
 : m_value(v)
 {}
 
-template<typename Type>
+template<typename Type, typename SizePolicy>
 template<typename... Args>
-ll_queue<Type, no_intrusive_tag>::elem::elem(Args&&... args)
+ll_queue<Type, no_intrusive_tag, SizePolicy>::elem::elem(Args&&... args)
     noexcept(std::is_nothrow_constructible<value_t, Args...>::value)
 : m_value(std::forward<Args>(args)...)
 {}
 
 
-template<typename Type>
-ll_queue<Type, no_intrusive_tag>::~ll_queue()
+template<typename Type, typename SizePolicy>
+ll_queue<Type, no_intrusive_tag, SizePolicy>::~ll_queue()
     noexcept(std::is_nothrow_destructible<elem>::value) {
   while (pop_front());
 }
 
-template<typename Type>
-auto ll_queue<Type, no_intrusive_tag>::pop_front()
+template<typename Type, typename SizePolicy>
+auto ll_queue<Type, no_intrusive_tag, SizePolicy>::pop_front()
     noexcept(std::is_nothrow_move_constructible<value_type>::value ||
              std::is_nothrow_copy_constructible<value_type>::value) ->
     pointer {
@@ -159,127 +165,141 @@ auto ll_queue<Type, no_intrusive_tag>::pop_front()
   return rv;
 }
 
-template<typename Type>
-auto ll_queue<Type, no_intrusive_tag>::push_back(const_reference e) -> void {
+template<typename Type, typename SizePolicy>
+auto ll_queue<Type, no_intrusive_tag, SizePolicy>::push_back(
+    const_reference e) -> void {
   m_impl.push_back(new elem(e));
 }
 
-template<typename Type>
-auto ll_queue<Type, no_intrusive_tag>::push_back(rvalue_reference e) -> void {
+template<typename Type, typename SizePolicy>
+auto ll_queue<Type, no_intrusive_tag, SizePolicy>::push_back(
+    rvalue_reference e) -> void {
   m_impl.push_back(new elem(std::move(e)));
 }
 
-template<typename Type>
-auto ll_queue<Type, no_intrusive_tag>::push_front(const_reference e) -> void {
+template<typename Type, typename SizePolicy>
+auto ll_queue<Type, no_intrusive_tag, SizePolicy>::push_front(
+    const_reference e) -> void {
   m_impl.push_front(new elem(e));
 }
 
-template<typename Type>
-auto ll_queue<Type, no_intrusive_tag>::push_front(rvalue_reference e) -> void {
+template<typename Type, typename SizePolicy>
+auto ll_queue<Type, no_intrusive_tag, SizePolicy>::push_front(
+    rvalue_reference e) -> void {
   m_impl.push_front(new elem(std::move(e)));
 }
 
-template<typename Type>
+template<typename Type, typename SizePolicy>
 template<typename... Args>
-auto ll_queue<Type, no_intrusive_tag>::emplace_back(Args&&... args) -> void {
+auto ll_queue<Type, no_intrusive_tag, SizePolicy>::emplace_back(
+    Args&&... args) -> void {
   m_impl.push_back(new elem(std::forward<Args>(args)...));
 }
 
-template<typename Type>
+template<typename Type, typename SizePolicy>
 template<typename... Args>
-auto ll_queue<Type, no_intrusive_tag>::emplace_front(Args&&... args) -> void {
+auto ll_queue<Type, no_intrusive_tag, SizePolicy>::emplace_front(
+    Args&&... args) -> void {
   m_impl.push_front(new elem(std::forward<Args>(args)...));
 }
 
-template<typename Type>
-auto ll_queue<Type, no_intrusive_tag>::size() const noexcept -> size_type {
+template<typename Type, typename SizePolicy>
+auto ll_queue<Type, no_intrusive_tag, SizePolicy>::size()
+    const noexcept -> size_type {
   return m_impl.size();
 }
 
-template<typename Type>
-auto ll_queue<Type, no_intrusive_tag>::empty() const noexcept -> bool {
+template<typename Type, typename SizePolicy>
+auto ll_queue<Type, no_intrusive_tag, SizePolicy>::empty()
+    const noexcept -> bool {
   return m_impl.empty();
 }
 
-template<typename Type>
-auto ll_queue<Type, no_intrusive_tag>::is_lock_free() const noexcept -> bool {
+template<typename Type, typename SizePolicy>
+auto ll_queue<Type, no_intrusive_tag, SizePolicy>::is_lock_free()
+    const noexcept -> bool {
   return m_impl.is_lock_free();
 }
 
 
-template<typename Type, typename AcqRel, typename Tag>
-ll_smartptr_queue<Type, AcqRel, Tag>::~ll_smartptr_queue()
+template<typename Type, typename AcqRel, typename Tag, typename SizePolicy>
+ll_smartptr_queue<Type, AcqRel, Tag, SizePolicy>::~ll_smartptr_queue()
     noexcept(std::is_nothrow_destructible<pointer>::value) {
   while (pop_front());
 }
 
-template<typename Type, typename AcqRel, typename Tag>
-auto ll_smartptr_queue<Type, AcqRel, Tag>::empty() const noexcept -> bool {
+template<typename Type, typename AcqRel, typename Tag, typename SizePolicy>
+auto ll_smartptr_queue<Type, AcqRel, Tag, SizePolicy>::empty()
+    const noexcept -> bool {
   return m_impl.empty();
 }
 
-template<typename Type, typename AcqRel, typename Tag>
-auto ll_smartptr_queue<Type, AcqRel, Tag>::size() const noexcept -> size_type {
+template<typename Type, typename AcqRel, typename Tag, typename SizePolicy>
+auto ll_smartptr_queue<Type, AcqRel, Tag, SizePolicy>::size()
+    const noexcept -> size_type {
   return m_impl.size();
 }
 
-template<typename Type, typename AcqRel, typename Tag>
-auto ll_smartptr_queue<Type, AcqRel, Tag>::push_back(pointer p) -> void {
+template<typename Type, typename AcqRel, typename Tag, typename SizePolicy>
+auto ll_smartptr_queue<Type, AcqRel, Tag, SizePolicy>::push_back(
+    pointer p) -> void {
   m_impl.push_back(p.release());
 }
 
-template<typename Type, typename AcqRel, typename Tag>
-auto ll_smartptr_queue<Type, AcqRel, Tag>::pop_front() noexcept -> pointer {
+template<typename Type, typename AcqRel, typename Tag, typename SizePolicy>
+auto ll_smartptr_queue<Type, AcqRel, Tag, SizePolicy>::pop_front()
+    noexcept -> pointer {
   return pointer(m_impl.pop_front(), false);
 }
 
-template<typename Type, typename AcqRel, typename Tag>
-auto ll_smartptr_queue<Type, AcqRel, Tag>::push_front(pointer p) -> void {
+template<typename Type, typename AcqRel, typename Tag, typename SizePolicy>
+auto ll_smartptr_queue<Type, AcqRel, Tag, SizePolicy>::push_front(
+    pointer p) -> void {
   m_impl.push_front(p.release());
 }
 
-template<typename Type, typename AcqRel, typename Tag>
-auto ll_smartptr_queue<Type, AcqRel, Tag>::is_lock_free() const noexcept ->
-    bool {
+template<typename Type, typename AcqRel, typename Tag, typename SizePolicy>
+auto ll_smartptr_queue<Type, AcqRel, Tag, SizePolicy>::is_lock_free()
+    const noexcept -> bool {
   return this->m_impl.is_lock_free();
 }
 
 
-template<typename Type, typename AcqRel>
-auto ll_smartptr_queue<Type, AcqRel, no_intrusive_tag>::empty()
+template<typename Type, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_queue<Type, AcqRel, no_intrusive_tag, SizePolicy>::empty()
     const noexcept -> bool {
   return this->m_impl.empty();
 }
 
-template<typename Type, typename AcqRel>
-auto ll_smartptr_queue<Type, AcqRel, no_intrusive_tag>::size()
+template<typename Type, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_queue<Type, AcqRel, no_intrusive_tag, SizePolicy>::size()
     const noexcept -> size_type {
   return this->m_impl.size();
 }
 
-template<typename Type, typename AcqRel>
-auto ll_smartptr_queue<Type, AcqRel, no_intrusive_tag>::push_back(pointer p) ->
-    void {
+template<typename Type, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_queue<Type, AcqRel, no_intrusive_tag, SizePolicy>::push_back(
+    pointer p) -> void {
   m_impl.push_back(std::move(p));
 }
 
-template<typename Type, typename AcqRel>
-auto ll_smartptr_queue<Type, AcqRel, no_intrusive_tag>::pop_front() noexcept ->
-    pointer {
+template<typename Type, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_queue<Type, AcqRel, no_intrusive_tag, SizePolicy>::pop_front()
+    noexcept -> pointer {
   auto pp = m_impl.pop_front();
   pointer p = (pp ? std::move(*pp) : nullptr);
   return p;
 }
 
-template<typename Type, typename AcqRel>
-auto ll_smartptr_queue<Type, AcqRel, no_intrusive_tag>::push_front(
+template<typename Type, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_queue<Type, AcqRel, no_intrusive_tag, SizePolicy>::push_front(
     pointer p) -> void {
   m_impl.push_front(std::move(p));
 }
 
-template<typename Type, typename AcqRel>
-auto ll_smartptr_queue<Type, AcqRel, no_intrusive_tag>::is_lock_free()
-    const noexcept -> bool {
+template<typename Type, typename AcqRel, typename SizePolicy>
+auto ll_smartptr_queue<Type, AcqRel, no_intrusive_tag,
+                       SizePolicy>::is_lock_free() const noexcept -> bool {
   return this->m_impl.is_lock_free();
 }
 
@@ -67,19 +67,22 @@ class ll_qhead {
 } /* namespace ilias::ll_queue_detail */
 
 
-template<typename Type, typename Tag = void> class ll_queue;
+template<typename Type, typename Tag = void,
+         typename SizePolicy = ll_size_walk> class ll_queue;
 template<typename Type, typename AcqRel = default_refcount_mgr<Type>,
-         typename Tag = void> class ll_smartptr_queue;
+         typename Tag = void, typename SizePolicy = ll_size_walk>
+class ll_smartptr_queue;
 
 
 namespace {
 
 
-template<typename Type, typename Tag>
-bool atomic_is_lock_free(const ll_queue<Type, Tag>*) noexcept;
+template<typename Type, typename Tag, typename SizePolicy>
+bool atomic_is_lock_free(const ll_queue<Type, Tag, SizePolicy>*) noexcept;
 
-template<typename Type, typename AcqRel, typename Tag>
-bool atomic_is_lock_free(const ll_smartptr_queue<Type, AcqRel, Tag>*) noexcept;
+template<typename Type, typename AcqRel, typename Tag, typename SizePolicy>
+bool atomic_is_lock_free(
+    const ll_smartptr_queue<Type, AcqRel, Tag, SizePolicy>*) noexcept;
 
 
 } /* namespace ilias::<unnamed> */
@@ -89,11 +92,12 @@ template<typename Tag = void>
 class ll_queue_hook
 : protected ll_queue_detail::ll_qhead::elem
 {
-  template<typename, typename> friend class ll_queue;
+  template<typename, typename, typename> friend class ll_queue;
 };
 
-template<typename Type, typename Tag>
+template<typename Type, typename Tag, typename SizePolicy>
 class ll_queue
+: private ll_list_detail::size_counter<SizePolicy>
 {
  private:
   ll_queue_detail::ll_qhead m_impl;
@@ -120,8 +124,8 @@ class ll_queue
   bool is_lock_free() const noexcept;
 };
 
-template<typename Type>
-class ll_queue<Type, no_intrusive_tag>
+template<typename Type, typename SizePolicy>
+class ll_queue<Type, no_intrusive_tag, SizePolicy>
 {
  public:
   using value_type = Type;
@@ -149,7 +153,7 @@ class ll_queue<Type, no_intrusive_tag>
     elem& operator=(const elem&) = delete;
   };
 
-  using impl_type = ll_queue<elem>;
+  using impl_type = ll_queue<elem, void, SizePolicy>;
 
  public:
   using size_type = typename impl_type::size_type;
@@ -178,11 +182,11 @@ class ll_queue<Type, no_intrusive_tag>
   bool is_lock_free() const noexcept;
 };
 
-template<typename Type, typename AcqRel, typename Tag>
+template<typename Type, typename AcqRel, typename Tag, typename SizePolicy>
 class ll_smartptr_queue
 {
  private:
-  using impl_type = ll_queue<Type, Tag>;
+  using impl_type = ll_queue<Type, Tag, SizePolicy>;
 
  public:
   using value_type = typename impl_type::value_type;
@@ -208,11 +212,12 @@ class ll_smartptr_queue
   bool is_lock_free() const noexcept;
 };
 
-template<typename Type, typename AcqRel>
-class ll_smartptr_queue<Type, AcqRel, no_intrusive_tag>
+template<typename Type, typename AcqRel, typename SizePolicy>
+class ll_smartptr_queue<Type, AcqRel, no_intrusive_tag, SizePolicy>
 {
  private:
-  using impl_type = ll_queue<refpointer<Type, AcqRel>, no_intrusive_tag>;
+  using impl_type = ll_queue<refpointer<Type, AcqRel>, no_intrusive_tag,
+                             SizePolicy>;
 
  public:
   using value_type = Type;
@@ -17,6 +17,7 @@
 #define ILIAS_LLPTR_H
 
 #include <ilias/ilias_async_export.h>
+#include <ilias/epoch.h>
 #include <ilias/hazard.h>
 #include <ilias/refcnt.h>
 #include <atomic>
@@ -294,9 +295,17 @@ public:
  * Atomic pointer for reference counted type with flags.
  *
  * Interfaces as std::atomic<std::tuple<refpointer<Type>, std::bitset<Flags>>>.
+ *
+ * Reclaim selects how readers are protected against the pointer being
+ * released while they acquire a reference:
+ * - hazard_reclaim: readers publish the pointer in a hazard slot,
+ *   writers hand references to readers that published it.
+ * - epoch_reclaim: readers enter an epoch_guard,
+ *   writers defer releasing their reference until no reader can see it.
+ *   Reads are cheaper, but a released pointer lives a little longer.
  */
 template<typename Type, typename AcqRel = default_refcount_mgr<Type>,
-    unsigned int Flags = 0U>
+    unsigned int Flags = 0U, typename Reclaim = hazard_reclaim>
 class llptr
 :	private llptr_detail::acqrel_helper<Type, AcqRel>
 {
@@ -347,6 +356,12 @@ private:
 	 */
 	void
 	grant(ptr_t p, std::size_t nrefs) const noexcept
+	{
+		this->grant(p, nrefs, Reclaim());
+	}
+
+	void
+	grant(ptr_t p, std::size_t nrefs, hazard_reclaim) const noexcept
 	{
 		if (p == nullptr)
 			return;
@@ -364,6 +379,31 @@ private:
 		    *this, *p, nrefs);
 	}
 
+	/*
+	 * Keep a single reference until readers in progress are done,
+	 * release the others immediately.
+	 */
+	void
+	grant(ptr_t p, std::size_t nrefs, epoch_reclaim) const noexcept
+	{
+		if (p == nullptr)
+			return;
+
+		if (nrefs == 0U)
+			this->acquire(*p, 1U);
+		else if (nrefs > 1U)
+			this->release(*p, nrefs - 1U);
+		epoch_detail::retire({ &release_retired,
+		    const_cast<void*>(static_cast<const void*>(p)), 1U });
+	}
+
+	static void
+	release_retired(void* p, std::size_t nrefs) noexcept
+	{
+		llptr_detail::acqrel_helper<Type, AcqRel>().release(
+		    *static_cast<ptr_t>(p), nrefs);
+	}
+
 	/*
 	 * Perform hazard part of acquisition algorithm.
 	 */
@@ -388,6 +428,55 @@ private:
 		return rv;
 	}
 
+	/*
+	 * Acquire a reference to the pointer in v.
+	 *
+	 * If the pointer is replaced before the reference is acquired,
+	 * v is reloaded.
+	 * If the reloaded value equals *retry, no reference is acquired
+	 * and false is returned.
+	 */
+	bool
+	acquire_loaded(no_acquire_t& v, std::memory_order mo,
+	    const no_acquire_t* retry = nullptr) const noexcept
+	{
+		return this->acquire_loaded(v, mo, retry, Reclaim());
+	}
+
+	bool
+	acquire_loaded(no_acquire_t& v, std::memory_order mo,
+	    const no_acquire_t* retry, hazard_reclaim) const noexcept
+	{
+		hazard_t hz{ *this };
+		for (;;) {
+			const auto acq = this->do_hazard(hz, std::get<0>(v));
+			if (acq != 0U || std::get<0>(v) == nullptr) {
+				if (acq > 1U)
+					this->release(*std::get<0>(v), acq - 1U);
+				return true;
+			}
+
+			v = this->m_impl.load(mo);
+			if (retry && v == *retry)
+				return false;
+		}
+	}
+
+	bool
+	acquire_loaded(no_acquire_t& v, std::memory_order mo,
+	    const no_acquire_t* retry, epoch_reclaim) const noexcept
+	{
+		epoch_guard guard;
+
+		/* Only a pointer loaded inside the guard is safe to use. */
+		v = this->m_impl.load(mo);
+		if (retry && v == *retry)
+			return false;
+		if (std::get<0>(v) != nullptr)
+			this->acquire(*std::get<0>(v), 1U);
+		return true;
+	}
+
 public:
 	llptr() = default;
 	llptr(const llptr&) = delete;
@@ -417,17 +506,7 @@ public:
 		if (std::get<0>(v) == nullptr)
 			return std::make_tuple(nullptr, std::get<1>(v));
 
-		hazard_t hz{ *this };
-
-		auto acq = this->do_hazard(hz, std::get<0>(v));
-		while (acq == 0 && std::get<0>(v) != nullptr) {
-			v = this->m_impl.load(mo);
-			acq = this->do_hazard(hz, std::get<0>(v));
-		}
-
-		if (acq > 1U)
-			this->release(*std::get<0>(v), acq - 1U);
-
+		this->acquire_loaded(v, mo);
 		return convert_acquire(v, false);
 	}
 
@@ -503,16 +582,7 @@ public:
 			return false;
 		}
 
-		hazard_t hz{ *this };
-		std::size_t acq;
-		do {
-			acq = this->do_hazard(hz, std::get<0>(expect_));
-		} while (acq == 0 &&
-		    std::get<0>(expect_ = this->m_impl.load(mo_fail)) !=
-		    nullptr);
-
-		if (acq > 1)
-			this->release(*std::get<0>(expect_), acq - 1U);
+		this->acquire_loaded(expect_, mo_fail);
 		expect = convert_acquire(expect_, false);
 		return false;
 	}
@@ -585,27 +655,14 @@ public:
 			}
 
 			/*
-			 * Use hazard logic to obtain reference to
-			 * expect_ pointer
+			 * Obtain reference to expect_ pointer
 			 * (iff expect_ differs from expect).
 			 */
-			hazard_t hz{ *this };
-			do {
-				auto acq = this->do_hazard(hz,
-				    std::get<0>(expect_));
-				if (acq != 0 ||
-				    std::get<0>(expect_) == nullptr) {
-					if (acq > 1U) {
-						this->release(
-						    *std::get<0>(expect_),
-						    acq - 1U);
-					}
-					expect = convert_acquire(expect_,
-					    false);
-					return false;
-				}
-			} while (convert_get(expect) !=
-			    (expect_ = this->m_impl.load(mo_fail)));
+			const no_acquire_t retry = convert_get(expect);
+			if (this->acquire_loaded(expect_, mo_fail, &retry)) {
+				expect = convert_acquire(expect_, false);
+				return false;
+			}
 		}
 
 		std::get<0>(set).release();
@@ -655,12 +712,26 @@ public:
 
 	bool
 	is_lock_free() const noexcept
+	{
+		return this->is_lock_free(Reclaim());
+	}
+
+private:
+	bool
+	is_lock_free(hazard_reclaim) const noexcept
 	{
 		hazard_t hz{ *this };
 		return atomic_is_lock_free(&this->m_impl) &&
 		    atomic_is_lock_free(&hz);
 	}
 
+	bool
+	is_lock_free(epoch_reclaim) const noexcept
+	{
+		return atomic_is_lock_free(&this->m_impl);
+	}
+
+public:
 	friend bool
 	atomic_is_lock_free(const llptr* p) noexcept
 	{
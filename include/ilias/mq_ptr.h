@@ -7,9 +7,11 @@
 namespace ilias {
 
 
-template<typename Type, typename Allocator = std::allocator<Type>>
+template<typename Type, typename Allocator = std::allocator<Type>,
+    typename Policy = mq_list_policy>
     class mq_in_ptr;
-template<typename Type, typename Allocator = std::allocator<Type>>
+template<typename Type, typename Allocator = std::allocator<Type>,
+    typename Policy = mq_list_policy>
     class mq_out_ptr;
 
 
@@ -19,8 +21,8 @@ namespace mq_ptr_detail {
 class refcount
 {
 private:
-	mutable std::atomic<std::uintptr_t> count;
-	mutable std::atomic<std::uintptr_t> in;
+	mutable std::atomic<std::uintptr_t> count{ 0U };
+	mutable std::atomic<std::uintptr_t> in{ 0U };
 
 public:
 	bool
@@ -75,7 +77,8 @@ public:
 			    std::memory_order_acquire);
 			assert(old + n > old);
 
-			if (old == n)
+			/* Input references share a single reference. */
+			if (old == 0)
 				base::acquire(v_, 1);
 		}
 
@@ -98,20 +101,21 @@ public:
 	};
 };
 
-template<typename Type, typename Allocator = std::allocator<Type>>
+template<typename Type, typename Allocator = std::allocator<Type>,
+    typename Policy = mq_list_policy>
 class refcounted_mq final
 :	public refcount,
-	protected mq_detail::data_msg_queue<Type, Allocator>,
-	public mq_detail::msg_queue_events<mq_out_ptr<Type, Allocator>>
+	protected mq_detail::mq_storage_t<Type, Allocator, Policy>,
+	public mq_detail::msg_queue_events<mq_out_ptr<Type, Allocator, Policy>>
 {
 friend class refcount::in_refcount_mgr;
 
 private:
-	using data = mq_detail::data_msg_queue<Type, Allocator>;
+	using data = mq_detail::mq_storage_t<Type, Allocator, Policy>;
 
 public:
-	using out_pointer = mq_out_ptr<Type, Allocator>;
-	using in_pointer = mq_in_ptr<Type, Allocator>;
+	using out_pointer = mq_out_ptr<Type, Allocator, Policy>;
+	using in_pointer = mq_in_ptr<Type, Allocator, Policy>;
 
 private:
 	using events = mq_detail::msg_queue_events<out_pointer>;
@@ -135,7 +139,7 @@ public:
 	refcounted_mq& operator=(refcounted_mq&& o) = delete;
 
 	using data::empty;
-	using data::dequeue;
+	using data::capacity;
 
 	template<typename... Args>
 	void
@@ -147,13 +151,87 @@ public:
 		this->data::enqueue(std::forward<Args>(args)...);
 		this->_fire(this);
 	}
+
+	template<typename... Args>
+	bool
+	try_enqueue(Args&&... args)
+	{
+		return this->data::_try_enqueue([this]() { this->_fire(this); },
+		    std::forward<Args>(args)...);
+	}
+
+	template<typename... Args>
+	cb_future<void>
+	enqueue_async(Args&&... args)
+	{
+		cb_promise<void> prom;
+		cb_future<void> f = prom.get_future();
+		this->data::_enqueue_async(std::move(prom),
+		    [this]() { this->_fire(this); },
+		    std::forward<Args>(args)...);
+		return f;
+	}
+
+	template<typename Functor>
+	Functor
+	dequeue(Functor f, size_t n = 1)
+	    noexcept(
+		noexcept(f(std::declval<Type>())) &&
+		data::noexcept_destructible)
+	{
+		return this->data::_dequeue(std::move(f), n,
+		    [this]() noexcept { this->_fire(this); });
+	}
+
+	template<typename InputIt>
+	void
+	enqueue_bulk(InputIt first, InputIt last)
+	{
+		bool any = false;
+
+		try {
+			for (; first != last; ++first) {
+				this->data::enqueue(*first);
+				any = true;
+			}
+		} catch (...) {
+			if (any)
+				this->_fire(this);
+			throw;
+		}
+		if (any)
+			this->_fire(this);
+	}
+
+	template<typename OutputIt>
+	std::size_t
+	dequeue_bulk(OutputIt out, size_t max)
+	{
+		return this->dequeue(
+		    mq_detail::mq_bulk_out<Type, OutputIt>{ out, 0U },
+		    max).m_count;
+	}
+
+	template<typename BatchFn>
+	std::size_t
+	dequeue_batch(BatchFn fn, size_t max)
+	{
+		mq_detail::mq_batch<Type, BatchFn> batch{ fn };
+
+		this->data::_dequeue(
+		    typename mq_detail::mq_batch<Type, BatchFn>::pusher{ &batch },
+		    max,
+		    [this]() noexcept { this->_fire(this); });
+		batch.flush();
+		return batch.total();
+	}
 };
 
-template<typename Allocator>
-class refcounted_mq<void, Allocator> final
+template<typename Allocator, typename Policy>
+class refcounted_mq<void, Allocator, Policy> final
 :	public refcount,
 	protected mq_detail::void_msg_queue,
-	public mq_detail::msg_queue_events<mq_out_ptr<void, Allocator>>
+	public mq_detail::msg_queue_events<mq_out_ptr<void, Allocator, Policy>>
 {
 friend class refcount::in_refcount_mgr;
 
@@ -161,8 +239,8 @@ private:
 	using data = mq_detail::void_msg_queue;
 
 public:
-	using out_pointer = mq_out_ptr<void, Allocator>;
-	using in_pointer = mq_in_ptr<void, Allocator>;
+	using out_pointer = mq_out_ptr<void, Allocator, Policy>;
+	using in_pointer = mq_in_ptr<void, Allocator, Policy>;
 
 private:
 	using events = mq_detail::msg_queue_events<out_pointer>;
@@ -200,15 +278,15 @@ public:
 } /* namespace ilias::mq_ptr_detail */
 
 
-template<typename Type, typename Allocator>
+template<typename Type, typename Allocator, typename Policy>
 class mq_in_ptr
 {
-friend class mq_ptr_detail::refcounted_mq<Type, Allocator>;
-friend class mq_out_ptr<Type, Allocator>;
+friend class mq_ptr_detail::refcounted_mq<Type, Allocator, Policy>;
+friend class mq_out_ptr<Type, Allocator, Policy>;
 
 private:
 	using pointer = refpointer<
-	    mq_ptr_detail::refcounted_mq<Type, Allocator>,
+	    mq_ptr_detail::refcounted_mq<Type, Allocator, Policy>,
 	    typename mq_ptr_detail::refcount::in_refcount_mgr>;
 
 	pointer m_ptr;
@@ -250,6 +328,46 @@ public:
 		this->m_ptr->enqueue(std::forward<Args>(args)...);
 	}
 
+	template<typename... Args>
+	bool
+	try_enqueue(Args&&... args)
+	{
+		if (!this->m_ptr)
+			throw std::runtime_error("mq_in_ptr: null");
+
+		return this->m_ptr->try_enqueue(std::forward<Args>(args)...);
+	}
+
+	template<typename... Args>
+	cb_future<void>
+	enqueue_async(Args&&... args)
+	{
+		if (!this->m_ptr)
+			throw std::runtime_error("mq_in_ptr: null");
+
+		return this->m_ptr->enqueue_async(std::forward<Args>(args)...);
+	}
+
+	template<typename InputIt>
+	void
+	enqueue_bulk(InputIt first, InputIt last)
+	{
+		if (!this->m_ptr)
+			throw std::runtime_error("mq_in_ptr: null");
+
+		this->m_ptr->enqueue_bulk(first, last);
+	}
+
+	template<typename Range>
+	void
+	enqueue_bulk(Range&& r)
+	{
+		using std::begin;
+		using std::end;
+
+		this->enqueue_bulk(begin(r), end(r));
+	}
+
 	template<typename... Args>
 	static mq_in_ptr
 	create(Args&&... args)
@@ -259,15 +377,15 @@ public:
 	}
 };
 
-template<typename Allocator>
-class mq_in_ptr<void, Allocator>
+template<typename Allocator, typename Policy>
+class mq_in_ptr<void, Allocator, Policy>
 {
-friend class mq_ptr_detail::refcounted_mq<void, Allocator>;
-friend class mq_out_ptr<void, Allocator>;
+friend class mq_ptr_detail::refcounted_mq<void, Allocator, Policy>;
+friend class mq_out_ptr<void, Allocator, Policy>;
 
 private:
 	using pointer = refpointer<
-	    mq_ptr_detail::refcounted_mq<void, Allocator>,
+	    mq_ptr_detail::refcounted_mq<void, Allocator, Policy>,
 	    typename mq_ptr_detail::refcount::in_refcount_mgr>;
 
 	pointer m_ptr;
@@ -332,20 +450,20 @@ public:
 	}
 };
 
-template<typename Type, typename Allocator>
+template<typename Type, typename Allocator, typename Policy>
 class mq_out_ptr
 {
-friend class mq_ptr_detail::refcounted_mq<Type, Allocator>;
+friend class mq_ptr_detail::refcounted_mq<Type, Allocator, Policy>;
 friend class mq_ptr_detail::refcount::in_refcount_mgr;
 
 public:
 	using callback_arg_type =
-	    typename mq_ptr_detail::refcounted_mq<Type, Allocator>::callback_arg_type;
+	    typename mq_ptr_detail::refcounted_mq<Type, Allocator, Policy>::callback_arg_type;
 
 private:
 	using pointer = refpointer<
-	    mq_ptr_detail::refcounted_mq<Type, Allocator>,
-	    typename mq_ptr_detail::refcount::in_refcount_mgr>;
+	    mq_ptr_detail::refcounted_mq<Type, Allocator, Policy>,
+	    typename mq_ptr_detail::refcount::out_refcount_mgr>;
 
 	pointer m_ptr;
 
@@ -391,7 +509,7 @@ public:
 	mq_out_ptr& operator=(const mq_out_ptr&) = default;
 	mq_out_ptr& operator=(mq_out_ptr&&) = default;
 
-	mq_out_ptr(const mq_in_ptr<Type, Allocator>& in) noexcept
+	mq_out_ptr(const mq_in_ptr<Type, Allocator, Policy>& in) noexcept
 	:	m_ptr(in.m_ptr)
 	{
 		/* Empty body. */
@@ -412,7 +530,7 @@ public:
 	}
 
 	mq_out_ptr&
-	operator=(const mq_in_ptr<Type, Allocator>& in) noexcept
+	operator=(const mq_in_ptr<Type, Allocator, Policy>& in) noexcept
 	{
 		mq_out_ptr temporary{ in };
 		this->swap(temporary);
@@ -433,6 +551,28 @@ public:
 		return this->m_ptr->dequeue(std::move(f), n);
 	}
 
+	template<typename OutputIt>
+	std::size_t
+	dequeue_bulk(OutputIt out, size_t max)
+	{
+		if (!this->m_ptr)
+			throw std::runtime_error("mq_out_ptr: uninitialized");
+
+		post_check pc{ *this };
+		return this->m_ptr->dequeue_bulk(out, max);
+	}
+
+	template<typename BatchFn>
+	std::size_t
+	dequeue_batch(BatchFn fn, size_t max = SIZE_MAX)
+	{
+		if (!this->m_ptr)
+			throw std::runtime_error("mq_out_ptr: uninitialized");
+
+		post_check pc{ *this };
+		return this->m_ptr->dequeue_batch(std::move(fn), max);
+	}
+
 	bool
 	empty() const noexcept
 	{
@@ -0,0 +1,423 @@
+/*
+ * Copyright (c) 2013 Ariane van der Steldt <ariane@stack.nl>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef ILIAS_MQ_RING_H
+#define ILIAS_MQ_RING_H
+
+#include <ilias/future.h>
+#include <ilias/hazard.h>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+
+namespace ilias {
+namespace mq_detail {
+
+
+/*
+ * Message queue storage, in a ring of fixed size segments.
+ *
+ * Messages are stored in the contiguous slots of a segment.
+ * Once a segment is full, a new segment is linked after it.
+ * The consumer releases segments it has emptied, keeping one around
+ * for reuse, so a queue in a steady state does not allocate.
+ *
+ * Only a single thread may dequeue at a time.
+ * Unless MultiProducer is set, only a single thread may enqueue at a time.
+ *
+ * With multiple producers, a slot is claimed before its message is
+ * written.  The consumer stops at a claimed slot that has not been written
+ * yet; the producer fires the event once the message is written.
+ */
+template<typename Type, typename Allocator, bool MultiProducer>
+class ring_msg_queue
+{
+	static_assert(std::is_nothrow_move_constructible<Type>::value,
+	    "ring_msg_queue: element type must be nothrow move constructible");
+
+public:
+	typedef Type element_type;
+
+private:
+	static constexpr std::size_t CACHELINE = 64U;
+
+	struct slot
+	{
+		std::atomic<bool> m_full{ false };
+		typename std::aligned_storage<sizeof(Type), alignof(Type)>::type
+		    m_data;
+
+		Type*
+		get() noexcept
+		{
+			return reinterpret_cast<Type*>(&this->m_data);
+		}
+	};
+
+public:
+	/* Number of messages per segment. */
+	static constexpr std::size_t SEGMENT_SLOTS =
+	    (4096U / sizeof(slot) < 16U ? 16U : 4096U / sizeof(slot));
+
+private:
+	struct segment
+	{
+		std::atomic<std::size_t> m_claim{ 0U };	/* Next free slot. */
+		std::atomic<segment*> m_next{ nullptr };
+		char m_pad[CACHELINE];	/* Keep producers off the first slots. */
+		slot m_slots[SEGMENT_SLOTS];
+	};
+
+	typedef typename std::allocator_traits<Allocator>::
+	    template rebind_alloc<segment> allocator_type;
+	typedef std::allocator_traits<allocator_type> alloc_traits;
+	typedef hazard<ring_msg_queue, segment> hazard_t;
+
+	allocator_type m_alloc;
+
+	/* Producer side. */
+	std::atomic<segment*> m_tail{ nullptr };
+	char m_pad[CACHELINE];
+
+	/* Consumer side. */
+	segment* m_head{ nullptr };
+	std::size_t m_head_idx{ 0U };
+	std::atomic<segment*> m_spare{ nullptr };
+
+protected:
+	static constexpr bool noexcept_destructible =
+	    std::is_nothrow_destructible<Type>::value;
+
+private:
+	/* Take the spare segment, or allocate a new one. */
+	segment*
+	_new_segment()
+	{
+		segment* seg = this->m_spare.exchange(nullptr,
+		    std::memory_order_acquire);
+		if (seg)
+			return seg;
+
+		seg = alloc_traits::allocate(this->m_alloc, 1);
+		alloc_traits::construct(this->m_alloc, seg);
+		return seg;
+	}
+
+	void
+	_free_segment(segment* seg) noexcept
+	{
+		alloc_traits::destroy(this->m_alloc, seg);
+		alloc_traits::deallocate(this->m_alloc, seg, 1);
+	}
+
+	/* Keep an unused segment as the spare. */
+	void
+	_recycle(segment* seg) noexcept
+	{
+		seg->m_claim.store(0U, std::memory_order_relaxed);
+		seg->m_next.store(nullptr, std::memory_order_relaxed);
+
+		segment* old = this->m_spare.exchange(seg,
+		    std::memory_order_acq_rel);
+		if (old)
+			this->_free_segment(old);
+	}
+
+	/* Release an emptied segment, once producers no longer use it. */
+	void
+	_retire(segment* seg, segment* next) noexcept
+	{
+		if (MultiProducer) {
+			segment* expect = seg;
+			this->m_tail.compare_exchange_strong(expect, next,
+			    std::memory_order_acq_rel,
+			    std::memory_order_relaxed);
+			hazard_t::wait_unused(*this, *seg);
+		}
+		this->_recycle(seg);
+	}
+
+	static void
+	_store(segment* seg, std::size_t idx, Type&& v) noexcept
+	{
+		slot& s = seg->m_slots[idx];
+
+		::new (s.get()) Type(std::move(v));
+		s.m_full.store(true, std::memory_order_release);
+	}
+
+	/* Single producer enqueue. */
+	void
+	_push(Type&& v, std::false_type)
+	{
+		segment* seg = this->m_tail.load(std::memory_order_relaxed);
+		std::size_t idx = seg->m_claim.load(std::memory_order_relaxed);
+
+		if (idx == SEGMENT_SLOTS) {
+			segment* next = this->_new_segment();
+
+			seg->m_next.store(next, std::memory_order_release);
+			this->m_tail.store(next, std::memory_order_relaxed);
+			seg = next;
+			idx = 0U;
+		}
+
+		seg->m_claim.store(idx + 1U, std::memory_order_relaxed);
+		_store(seg, idx, std::move(v));
+	}
+
+	/* Multi producer enqueue. */
+	void
+	_push(Type&& v, std::true_type)
+	{
+		hazard_t hz{ *this };
+		segment* fresh = nullptr;
+		bool done = false;
+
+		while (!done) {
+			segment* seg = this->m_tail.load(
+			    std::memory_order_acquire);
+			bool need_segment = false;
+
+			hz.do_hazard(*seg,
+			    [&]() {
+				/* Validate seg, now that it is protected. */
+				if (this->m_tail.load(
+				    std::memory_order_acquire) != seg)
+					return;
+
+				const std::size_t idx = seg->m_claim.fetch_add(
+				    1U, std::memory_order_relaxed);
+				if (idx < SEGMENT_SLOTS) {
+					_store(seg, idx, std::move(v));
+					done = true;
+					return;
+				}
+
+				/* Segment is full: link a new segment. */
+				segment* next = seg->m_next.load(
+				    std::memory_order_acquire);
+				if (!next) {
+					if (!fresh) {
+						need_segment = true;
+						return;
+					}
+					if (seg->m_next.compare_exchange_strong(
+					    next, fresh,
+					    std::memory_order_acq_rel,
+					    std::memory_order_acquire)) {
+						next = fresh;
+						fresh = nullptr;
+					}
+				}
+				this->m_tail.compare_exchange_strong(seg, next,
+				    std::memory_order_acq_rel,
+				    std::memory_order_relaxed);
+			    },
+			    []() {});
+
+			/* Allocate outside the hazard, since it may throw. */
+			if (need_segment)
+				fresh = this->_new_segment();
+		}
+
+		if (fresh)
+			this->_recycle(fresh);
+	}
+
+	void
+	_push(Type&& v)
+	{
+		this->_push(std::move(v),
+		    std::integral_constant<bool, MultiProducer>());
+	}
+
+public:
+	ring_msg_queue()
+	:	ring_msg_queue(allocator_type())
+	{
+		/* Empty body. */
+	}
+
+	template<typename... Args>
+	explicit ring_msg_queue(Args&&... args)
+	:	m_alloc(std::forward<Args>(args)...)
+	{
+		segment* seg = this->_new_segment();
+
+		this->m_head = seg;
+		this->m_tail.store(seg, std::memory_order_release);
+	}
+
+	ring_msg_queue(const ring_msg_queue&) = delete;
+	ring_msg_queue& operator=(const ring_msg_queue&) = delete;
+
+	/* Move constructor. */
+	ring_msg_queue(ring_msg_queue&& mq) noexcept
+	:	m_alloc(mq.m_alloc),
+		m_head(mq.m_head),
+		m_head_idx(mq.m_head_idx)
+	{
+		this->m_tail.store(mq.m_tail.exchange(nullptr,
+		    std::memory_order_relaxed), std::memory_order_relaxed);
+		this->m_spare.store(mq.m_spare.exchange(nullptr,
+		    std::memory_order_relaxed), std::memory_order_relaxed);
+		mq.m_head = nullptr;
+	}
+
+	/* Destructor. */
+	~ring_msg_queue() noexcept
+	{
+		if (!this->m_head)
+			return;
+
+		/* Destroy remaining messages. */
+		segment* seg = this->m_head;
+		std::size_t idx = this->m_head_idx;
+		while (seg) {
+			for (; idx != SEGMENT_SLOTS; ++idx) {
+				slot& s = seg->m_slots[idx];
+				if (s.m_full.load(std::memory_order_acquire))
+					s.get()->~Type();
+			}
+
+			segment* next = seg->m_next.load(
+			    std::memory_order_acquire);
+			this->_free_segment(seg);
+			seg = next;
+			idx = 0U;
+		}
+
+		if ((seg = this->m_spare.load(std::memory_order_acquire)))
+			this->_free_segment(seg);
+	}
+
+	/*
+	 * Test if the message queue is empty.
+	 * Must be called from the consumer.
+	 */
+	bool
+	empty() const noexcept
+	{
+		const segment* seg = this->m_head;
+		std::size_t idx = this->m_head_idx;
+
+		if (!seg)
+			return true;
+		if (idx == SEGMENT_SLOTS) {
+			seg = seg->m_next.load(std::memory_order_acquire);
+			if (!seg)
+				return true;
+			idx = 0U;
+		}
+		return !seg->m_slots[idx].m_full.load(
+		    std::memory_order_acquire);
+	}
+
+	/* Ring queues are unbounded. */
+	std::size_t
+	capacity() const noexcept
+	{
+		return 0U;
+	}
+
+	/* Enqueue message. */
+	template<typename... Args>
+	void
+	enqueue(Args&&... args)
+	{
+		this->_push(Type(std::forward<Args>(args)...));
+	}
+
+protected:
+	template<typename Fire, typename... Args>
+	bool
+	_try_enqueue(Fire fire, Args&&... args)
+	{
+		this->enqueue(std::forward<Args>(args)...);
+		fire();
+		return true;
+	}
+
+	template<typename Fire, typename... Args>
+	void
+	_enqueue_async(cb_promise<void> prom, Fire fire, Args&&... args)
+	{
+		this->enqueue(std::forward<Args>(args)...);
+		fire();
+		prom.set_value();
+	}
+
+	/*
+	 * Apply functor on at most N elements in the message queue.
+	 *
+	 * If the functor throws an exception, the message is still consumed.
+	 */
+	template<typename Functor, typename Fire>
+	Functor
+	_dequeue(Functor f, size_t n, Fire)
+	    noexcept(
+		noexcept(f(std::declval<element_type>())) &&
+		noexcept_destructible)
+	{
+		while (n > 0U) {
+			segment* seg = this->m_head;
+
+			if (this->m_head_idx == SEGMENT_SLOTS) {
+				segment* next = seg->m_next.load(
+				    std::memory_order_acquire);
+				if (!next)
+					break;
+
+				this->m_head = next;
+				this->m_head_idx = 0U;
+				this->_retire(seg, next);
+				continue;
+			}
+
+			slot& s = seg->m_slots[this->m_head_idx];
+			if (!s.m_full.load(std::memory_order_acquire))
+				break;
+
+			Type v = std::move(*s.get());
+			s.get()->~Type();
+			s.m_full.store(false, std::memory_order_relaxed);
+			++this->m_head_idx;
+			--n;
+
+			f(std::move(v));
+		}
+		return f;
+	}
+};
+
+template<typename Type, typename Allocator, bool MultiProducer>
+constexpr std::size_t
+    ring_msg_queue<Type, Allocator, MultiProducer>::CACHELINE;
+template<typename Type, typename Allocator, bool MultiProducer>
+constexpr std::size_t
+    ring_msg_queue<Type, Allocator, MultiProducer>::SEGMENT_SLOTS;
+template<typename Type, typename Allocator, bool MultiProducer>
+constexpr bool
+    ring_msg_queue<Type, Allocator, MultiProducer>::noexcept_destructible;
+
+
+}} /* namespace ilias::mq_detail */
+
+#endif /* ILIAS_MQ_RING_H */
@@ -17,12 +17,20 @@
 #define ILIAS_MSG_QUEUE_H
 
 #include <ilias/ilias_async_export.h>
+#include <ilias/future.h>
+#include <ilias/llptr.h>
 #include <ilias/ll_queue.h>
+#include <ilias/mq_ring.h>
 #include <ilias/util.h>
 #include <cassert>
 #include <algorithm>
 #include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <functional>
+#include <iterator>
+#include <stdexcept>
 #include <type_traits>
 #include <memory>
 #include <mutex>
@@ -30,6 +38,39 @@
 
 
 namespace ilias {
+
+
+/*
+ * Capacity argument for message queue construction.
+ *
+ * A message queue constructed with a capacity is bounded:
+ * try_enqueue() and enqueue_async() will not exceed the capacity.
+ */
+struct mq_capacity
+{
+	std::size_t n;
+
+	explicit mq_capacity(std::size_t n)
+	:	n(n)
+	{
+		if (n == 0)
+			throw std::invalid_argument("mq_capacity: zero");
+	}
+};
+
+
+/*
+ * Message queue storage policies.
+ *
+ * mq_list_policy: linked list, any number of producers and consumers.
+ * mq_spsc_policy: ring buffer, a single producer and a single consumer.
+ * mq_mpsc_policy: ring buffer, multiple producers and a single consumer.
+ */
+struct mq_list_policy {};
+struct mq_spsc_policy {};
+struct mq_mpsc_policy {};
+
+
 namespace mq_detail {
 
 
@@ -125,6 +166,131 @@ public:
 };
 
 
+/*
+ * Collects dequeued messages into a contiguous buffer.
+ *
+ * The batch functor is invoked with [first, last) each time the buffer
+ * fills up and once more by flush().  Messages in the buffer are destroyed
+ * after the batch functor returns, even if it throws.
+ */
+template<typename Type, typename BatchFn>
+class mq_batch
+{
+public:
+	/* Number of messages passed to the batch functor at a time. */
+	static constexpr std::size_t SIZE =
+	    (4096U / sizeof(Type) < 1U ? 1U : 4096U / sizeof(Type));
+
+private:
+	typename std::aligned_storage<sizeof(Type), alignof(Type)>::type
+	    m_buf[SIZE];
+	std::size_t m_len{ 0U };
+	std::size_t m_total{ 0U };
+	BatchFn& m_fn;
+
+	Type*
+	_data() noexcept
+	{
+		return reinterpret_cast<Type*>(&this->m_buf[0]);
+	}
+
+	void
+	_destroy() noexcept
+	{
+		Type* p = this->_data();
+		for (std::size_t i = 0; i != this->m_len; ++i)
+			p[i].~Type();
+		this->m_len = 0U;
+	}
+
+public:
+	explicit mq_batch(BatchFn& fn) noexcept
+	:	m_fn(fn)
+	{
+		/* Empty body. */
+	}
+
+	mq_batch(const mq_batch&) = delete;
+	mq_batch& operator=(const mq_batch&) = delete;
+
+	~mq_batch() noexcept
+	{
+		this->_destroy();
+	}
+
+	/* Add a message, passing the buffer on if it is full. */
+	void
+	push(Type&& v)
+	{
+		::new (&this->m_buf[this->m_len]) Type(std::move(v));
+		++this->m_len;
+		++this->m_total;
+		if (this->m_len == SIZE)
+			this->flush();
+	}
+
+	/* Pass buffered messages to the batch functor. */
+	void
+	flush()
+	{
+		if (this->m_len == 0U)
+			return;
+
+		struct destroy_guard
+		{
+			mq_batch& self;
+
+			~destroy_guard() noexcept
+			{
+				this->self._destroy();
+			}
+		};
+
+		destroy_guard g{ *this };
+		Type* p = this->_data();
+		this->m_fn(p, p + this->m_len);
+	}
+
+	/* Number of messages pushed into the batch. */
+	std::size_t
+	total() const noexcept
+	{
+		return this->m_total;
+	}
+
+	/* Functor for dequeue, pushing each message into the batch. */
+	struct pusher
+	{
+		mq_batch* m_self;
+
+		void
+		operator()(Type&& v) const
+		{
+			this->m_self->push(std::move(v));
+		}
+	};
+};
+
+template<typename Type, typename BatchFn>
+constexpr std::size_t mq_batch<Type, BatchFn>::SIZE;
+
+/* Functor for dequeue, storing each message via an output iterator. */
+template<typename Type, typename OutputIt>
+struct mq_bulk_out
+{
+	OutputIt m_out;
+	std::size_t m_count;
+
+	void
+	operator()(Type&& v)
+	{
+		*this->m_out = std::move(v);
+		++this->m_out;
+		++this->m_count;
+	}
+};
+
+
 /*
  * Message queue events.
  */
@@ -147,40 +313,70 @@ private:
 
 	std::atomic<state> m_state{ state::IDLE };
 
-	std::mutex m_evmtx;
-	bool m_ev_restore{ false };	/* Protected by m_evmtx. */
-	std::function<void (callback_arg_type)> m_ev;	/* Protected by m_evmtx. */
+	/* Published callback, shared with invocations in progress. */
+	struct ev_fn
+	:	public refcount_base<ev_fn>
+	{
+		const std::function<void (callback_arg_type)> m_fn;
+
+		explicit ev_fn(std::function<void (callback_arg_type)>&& fn)
+		:	m_fn(std::move(fn))
+		{
+			/* Empty body. */
+		}
+	};
+
+	using ev_pointer = refpointer<ev_fn>;
+
+	llptr<ev_fn> m_ev;
+
+	/* Create published callback, nil for an empty function. */
+	static ev_pointer
+	_make_ev(std::function<void (callback_arg_type)>&& fn)
+	{
+		if (!fn)
+			return nullptr;
+		return make_refpointer<ev_fn>(std::move(fn));
+	}
 
 	/*
 	 * Inner function: fires m_ev.
 	 * Not safe against concurrent invocations.
 	 * Safe against recursive invocations.
+	 *
+	 * The invocation holds a reference to the callback,
+	 * so the callback may be replaced from within its invocation.
 	 */
 	void
 	_fire_event(callback_arg_type ev_arg) noexcept
 	{
-		std::function<void (callback_arg_type)> tmp;
-		std::unique_lock<std::mutex> guard{ this->m_evmtx };
-
-		swap(tmp, this->m_ev);
-		if (tmp) {
-			this->m_ev_restore = true;
+		const ev_pointer ev =
+		    std::get<0>(this->m_ev.load(std::memory_order_acquire));
 
-			/*
-			 * Invoke function (which is temporarily copied to tmp,
-			 * to prevent it from being deleted from within its
-			 * invocation.
-			 */
-			do_unlocked(guard, tmp,
+		if (ev) {
+			do_noexcept(ev->m_fn,
 			    std::forward<callback_arg_type>(ev_arg));
-
-			if (this->m_ev_restore) {
-				swap(this->m_ev, tmp);
-				this->m_ev_restore = false;
-			}
 		}
 	}
 
+	/*
+	 * Publish new callback.
+	 *
+	 * If an event is running, make sure it runs again,
+	 * so the new callback observes any pending messages.
+	 */
+	void
+	_set_ev(ev_pointer ev) noexcept
+	{
+		this->m_ev.store(std::make_tuple(std::move(ev),
+		    typename llptr<ev_fn>::flags_type()),
+		    std::memory_order_release);
+
+		state s = state::BUSY;
+		this->m_state.compare_exchange_strong(s, state::AGAIN,
+		    std::memory_order_acq_rel, std::memory_order_relaxed);
+	}
+
 protected:
 	msg_queue_events() = default;
 
@@ -189,7 +385,9 @@ protected:
 
 	/* Move constructor. */
 	msg_queue_events(msg_queue_events&& mqe) noexcept
-	:	m_ev(std::move(mqe.m_ev))
+	:	m_ev(mqe.m_ev.exchange(std::make_tuple(nullptr,
+		    typename llptr<ev_fn>::flags_type()),
+		    std::memory_order_acq_rel))
 	{
 		assert(mqe.m_state == state::IDLE);
 	}
@@ -249,36 +447,24 @@ protected:
 	}
 
 public:
-	/* Set output event callback. */
+	/*
+	 * Set output event callback.
+	 *
+	 * If the event is running, the new callback will be invoked
+	 * once the running event completes.
+	 */
 	friend void
 	callback(msg_queue_events& mqev,
 	    std::function<void (callback_arg_type)> fn)
-	    noexcept
 	{
-		do_locked(mqev.m_evmtx, [&]() {
-			swap(mqev.m_ev, fn);
-
-			if (mqev.m_ev_restore) {
-				/*
-				 * Make new event fire
-				 * after old event completes.
-				 */
-				mqev.m_ev_restore = false;
-				mqev.m_state.store(state::AGAIN,
-				    std::memory_order_release);
-			}
-		    });
+		mqev._set_ev(_make_ev(std::move(fn)));
 	}
 
 	/* Clear output event callback. */
 	friend void
 	callback(msg_queue_events& mqev, std::nullptr_t) noexcept
 	{
-		std::function<void (callback_arg_type)> tmp;
-		do_locked(mqev.m_evmtx, [&]() {
-			swap(mqev.m_ev, tmp);
-			mqev.m_ev_restore = false;
-		    });
+		mqev._set_ev(nullptr);
 	}
 };
 
@@ -397,6 +583,7 @@ private:
 	allocator_type m_alloc;
 	list_type m_list;
 
+protected:
 	static constexpr bool noexcept_destructible =
 	    noexcept(alloc_traits::destroy(m_alloc,
 	      typename alloc_traits::pointer())) &&
@@ -404,6 +591,7 @@ private:
 	      typename alloc_traits::pointer(),
 	      typename alloc_traits::size_type()));
 
+private:
 	/* Destructor implementation. */
 	struct _destroy
 	{
@@ -487,13 +675,137 @@ private:
 		while (make_pointer(this->m_list.pop_front()));
 	}
 
+	/*
+	 * Capacity bookkeeping of a bounded message queue.
+	 *
+	 * m_avail counts free slots.  Producers that could not claim a slot
+	 * wait in m_wait, with their message already constructed.
+	 * Released slots are handed to waiting producers in FIFO order.
+	 */
+	struct bound
+	{
+		struct waiter
+		{
+			typename list_type::value_type* elem;
+			cb_promise<void> prom;
+		};
+
+		const std::size_t m_capacity;
+		std::atomic<std::ptrdiff_t> m_avail;
+		std::atomic<std::size_t> m_nwait{ 0 };
+		std::mutex m_mtx;
+		std::deque<waiter> m_wait;	/* Protected by m_mtx. */
+
+		explicit bound(std::size_t capacity) noexcept
+		:	m_capacity(capacity),
+			m_avail(static_cast<std::ptrdiff_t>(capacity))
+		{
+			/* Empty body. */
+		}
+	};
+
+	std::unique_ptr<bound> m_bound;	/* Null if unbounded. */
+
+	/* Claim a free slot. */
+	static bool
+	_claim(bound& b) noexcept
+	{
+		auto avail = b.m_avail.load(std::memory_order_relaxed);
+		do {
+			if (avail <= 0)
+				return false;
+		} while (!b.m_avail.compare_exchange_weak(avail, avail - 1,
+		    std::memory_order_acquire, std::memory_order_relaxed));
+		return true;
+	}
+
+	/*
+	 * Claim a slot for a new message.
+	 * Fails if the queue is full, or if producers are waiting for a slot
+	 * (which would otherwise be overtaken).
+	 */
+	bool
+	_reserve() noexcept
+	{
+		bound* b = this->m_bound.get();
+		if (!b)
+			return true;
+		if (b->m_nwait.load(std::memory_order_seq_cst) != 0)
+			return false;
+		return _claim(*b);
+	}
+
+	/*
+	 * Hand free slots to waiting producers.
+	 * Returns true if any message was enqueued.
+	 */
+	bool
+	_grant() noexcept
+	{
+		bound& b = *this->m_bound;
+		bool rv = false;
+
+		std::unique_lock<std::mutex> guard{ b.m_mtx };
+		while (!b.m_wait.empty() && _claim(b)) {
+			typename bound::waiter w = std::move(b.m_wait.front());
+			b.m_wait.pop_front();
+			b.m_nwait.fetch_sub(1, std::memory_order_seq_cst);
+
+			this->m_list.push_back(w.elem);
+			rv = true;
+			do_unlocked(guard, [&w]() {
+				do_noexcept([&w]() { w.prom.set_value(); });
+			    });
+		}
+		return rv;
+	}
+
+	/*
+	 * Return n slots to the queue.
+	 * Returns true if any waiting message was enqueued.
+	 */
+	bool
+	_release(std::size_t n) noexcept
+	{
+		bound* b = this->m_bound.get();
+		if (!b || n == 0)
+			return false;
+
+		/*
+		 * Pairs with the m_nwait increment in _enqueue_async():
+		 * either we see the waiter, or the waiter sees the slot.
+		 */
+		b->m_avail.fetch_add(static_cast<std::ptrdiff_t>(n),
+		    std::memory_order_seq_cst);
+		if (b->m_nwait.load(std::memory_order_seq_cst) == 0)
+			return false;
+		return this->_grant();
+	}
+
+	/* Enqueue without claiming a slot (may exceed the capacity). */
 	void
 	_enqueue(managed_pointer&& ptr) noexcept
 	{
 		assert(ptr && ptr.get_deleter().m_call_destructor);
+		if (this->m_bound) {
+			this->m_bound->m_avail.fetch_sub(1,
+			    std::memory_order_relaxed);
+		}
 		this->m_list.push_back(ptr.release());
 	}
 
+	/* Clear messages of waiting producers, breaking their promises. */
+	void
+	_clear_waiters() noexcept
+	{
+		if (!this->m_bound)
+			return;
+		for (auto& w : this->m_bound->m_wait)
+			make_pointer(w.elem);
+		this->m_bound->m_wait.clear();
+		this->m_bound->m_nwait.store(0, std::memory_order_relaxed);
+	}
+
 public:
 	data_msg_queue() = default;
 
@@ -507,6 +819,15 @@ public:
 		/* Empty body. */
 	}
 
+	/* Create a bounded message queue. */
+	template<typename... Args>
+	data_msg_queue(mq_capacity capacity, Args&&... args)
+	:	m_alloc(std::forward<Args>(args)...),
+		m_bound(new bound(capacity.n))
+	{
+		/* Empty body. */
+	}
+
 	data_msg_queue(const data_msg_queue&) = delete;
 	data_msg_queue& operator=(const data_msg_queue&) = delete;
 
@@ -520,11 +841,13 @@ public:
 		/* Move elements between queues. */
 		while (auto elem = this->m_list.pop_front())
 			this->m_list.push_back(elem);
+		this->m_bound = std::move(mq.m_bound);
 	}
 
 	/* Destructor. */
 	~data_msg_queue() noexcept
 	{
+		this->_clear_waiters();
 		this->_clear();
 	}
 
@@ -535,7 +858,19 @@ public:
 		return this->m_list.empty();
 	}
 
-	/* Enqueue message. */
+	/* Returns the capacity of the queue, 0 if the queue is unbounded. */
+	std::size_t
+	capacity() const noexcept
+	{
+		return (this->m_bound ? this->m_bound->m_capacity : 0U);
+	}
+
+	/*
+	 * Enqueue message.
+	 *
+	 * On a bounded queue, the message is enqueued even if
+	 * this exceeds the capacity.
+	 */
 	template<typename... Args>
 	void
 	enqueue(Args&&... args)
@@ -544,22 +879,99 @@ public:
 		    std::forward<Args>(args)...));
 	}
 
+protected:
+	/*
+	 * Enqueue message, if a slot is available.
+	 *
+	 * Returns false without constructing the message if the queue is full.
+	 */
+	template<typename Fire, typename... Args>
+	bool
+	_try_enqueue(Fire fire, Args&&... args)
+	{
+		if (!this->_reserve())
+			return false;
+
+		managed_pointer ptr;
+		try {
+			ptr = this->_create(this->_allocate(),
+			    std::forward<Args>(args)...);
+		} catch (...) {
+			if (this->_release(1))
+				fire();
+			throw;
+		}
+		this->m_list.push_back(ptr.release());
+		fire();
+		return true;
+	}
+
+	/*
+	 * Enqueue message once a slot is available.
+	 *
+	 * The message is constructed immediately and the promise completes
+	 * once the message is on the queue.
+	 */
+	template<typename Fire, typename... Args>
+	void
+	_enqueue_async(cb_promise<void> prom, Fire fire, Args&&... args)
+	{
+		auto ptr = this->_create(this->_allocate(),
+		    std::forward<Args>(args)...);
+
+		if (this->_reserve()) {
+			this->m_list.push_back(ptr.release());
+			fire();
+			prom.set_value();
+			return;
+		}
+
+		bound& b = *this->m_bound;
+		do_locked(b.m_mtx, [&]() {
+			b.m_wait.push_back(typename bound::waiter{
+			    ptr.get(), std::move(prom) });
+			ptr.release();
+			b.m_nwait.fetch_add(1, std::memory_order_seq_cst);
+		    });
+
+		/* Slots may have been released before we started waiting. */
+		if (this->_grant())
+			fire();
+	}
+
 	/*
 	 * Apply functor on at most N elements in the message queue.
 	 *
 	 * If the functor throws an exception, the message is still consumed.
+	 * Slots released on a bounded queue are handed to waiting producers,
+	 * fire is invoked if that enqueued messages.
 	 */
-	template<typename Functor>
+	template<typename Functor, typename Fire>
 	Functor
-	dequeue(Functor f, size_t n = 1)
+	_dequeue(Functor f, size_t n, Fire fire)
 	    noexcept(
 		noexcept(f(std::declval<element_type>())) &&
 		noexcept_destructible)
 	{
+		struct release_guard
+		{
+			data_msg_queue& self;
+			Fire& fire;
+			std::size_t count;
+
+			~release_guard() noexcept
+			{
+				if (this->self._release(this->count))
+					this->fire();
+			}
+		};
+
+		release_guard rg{ *this, fire, 0U };
 		for (size_t i = n; i != 0; --i) {
 			auto elem = make_pointer(this->m_list.pop_front());
 			if (!elem)
 				break;
+			++rg.count;
 			f(elem->move());
 		}
 		return f;
@@ -567,24 +979,52 @@ public:
 };
 
 
+/* Select message queue storage for a policy. */
+template<typename Type, typename Allocator, typename Policy>
+struct mq_storage;
+
+template<typename Type, typename Allocator>
+struct mq_storage<Type, Allocator, mq_list_policy>
+{
+	using type = data_msg_queue<Type, Allocator>;
+};
+
+template<typename Type, typename Allocator>
+struct mq_storage<Type, Allocator, mq_spsc_policy>
+{
+	using type = ring_msg_queue<Type, Allocator, false>;
+};
+
+template<typename Type, typename Allocator>
+struct mq_storage<Type, Allocator, mq_mpsc_policy>
+{
+	using type = ring_msg_queue<Type, Allocator, true>;
+};
+
+template<typename Type, typename Allocator, typename Policy>
+using mq_storage_t = typename mq_storage<Type, Allocator, Policy>::type;
+
+
 } /* namespace ilias::mq_detail */
 
 
 template<typename MQ> class prepare_enqueue;
 
 
-template<typename Type, typename Allocator = std::allocator<Type>>
+template<typename Type, typename Allocator = std::allocator<Type>,
+    typename Policy = mq_list_policy>
 class msg_queue
-:	protected mq_detail::msg_queue_events<msg_queue<Type, Allocator>&>,
-	protected mq_detail::data_msg_queue<Type, Allocator>
+:	protected mq_detail::msg_queue_events<
+	    msg_queue<Type, Allocator, Policy>&>,
+	protected mq_detail::mq_storage_t<Type, Allocator, Policy>
 {
-friend class prepare_enqueue<msg_queue<Type, Allocator>>;
+friend class prepare_enqueue<msg_queue<Type, Allocator, Policy>>;
 
 private:
 	/* Simple names improve readability. */
 	using events =
-	    mq_detail::msg_queue_events<msg_queue<Type, Allocator>&>;
-	using data = mq_detail::data_msg_queue<Type, Allocator>;
+	    mq_detail::msg_queue_events<msg_queue<Type, Allocator, Policy>&>;
+	using data = mq_detail::mq_storage_t<Type, Allocator, Policy>;
 
 	static events&&
 	events_move(msg_queue& mq) noexcept
@@ -625,7 +1065,7 @@ public:
 	}
 
 	using data::empty;
-	using data::dequeue;
+	using data::capacity;
 	using callback_arg_type = typename events::callback_arg_type;
 
 	/*
@@ -641,6 +1081,121 @@ public:
 		this->_fire(*this);
 	}
 
+	/*
+	 * Enqueue message, unless the queue is full.
+	 *
+	 * Returns false if the message was not enqueued.
+	 */
+	template<typename... Args>
+	bool
+	try_enqueue(Args&&... args)
+	{
+		return this->data::_try_enqueue([this]() { this->_fire(*this); },
+		    std::forward<Args>(args)...);
+	}
+
+	/*
+	 * Enqueue message, once the queue has room for it.
+	 *
+	 * The returned future completes when the message is enqueued.
+	 */
+	template<typename... Args>
+	cb_future<void>
+	enqueue_async(Args&&... args)
+	{
+		cb_promise<void> prom;
+		cb_future<void> f = prom.get_future();
+		this->data::_enqueue_async(std::move(prom),
+		    [this]() { this->_fire(*this); },
+		    std::forward<Args>(args)...);
+		return f;
+	}
+
+	/* Dequeue at most N messages. */
+	template<typename Functor>
+	Functor
+	dequeue(Functor f, size_t n = 1)
+	    noexcept(
+		noexcept(f(std::declval<Type>())) &&
+		data::noexcept_destructible)
+	{
+		return this->data::_dequeue(std::move(f), n,
+		    [this]() noexcept { this->_fire(*this); });
+	}
+
+	/*
+	 * Enqueue each message in [first, last).
+	 *
+	 * The event fires once, after all messages are enqueued.
+	 * If constructing a message throws, the messages before it
+	 * stay enqueued.
+	 */
+	template<typename InputIt>
+	void
+	enqueue_bulk(InputIt first, InputIt last)
+	{
+		bool any = false;
+
+		try {
+			for (; first != last; ++first) {
+				this->data::enqueue(*first);
+				any = true;
+			}
+		} catch (...) {
+			if (any)
+				this->_fire(*this);
+			throw;
+		}
+		if (any)
+			this->_fire(*this);
+	}
+
+	/* Enqueue each message in range. */
+	template<typename Range>
+	void
+	enqueue_bulk(Range&& r)
+	{
+		using std::begin;
+		using std::end;
+
+		this->enqueue_bulk(begin(r), end(r));
+	}
+
+	/*
+	 * Move at most max messages to out.
+	 *
+	 * Returns the number of messages dequeued.
+	 */
+	template<typename OutputIt>
+	std::size_t
+	dequeue_bulk(OutputIt out, size_t max)
+	{
+		return this->dequeue(
+		    mq_detail::mq_bulk_out<Type, OutputIt>{ out, 0U },
+		    max).m_count;
+	}
+
+	/*
+	 * Dequeue at most max messages, handing them to fn in batches.
+	 *
+	 * Fn is invoked as fn(Type* first, Type* last), with the messages
+	 * in a contiguous array.  The messages are destroyed once fn returns.
+	 * Returns the number of messages dequeued.
+	 */
+	template<typename BatchFn>
+	std::size_t
+	dequeue_batch(BatchFn fn, size_t max = SIZE_MAX)
+	{
+		mq_detail::mq_batch<Type, BatchFn> batch{ fn };
+
+		this->data::_dequeue(
+		    typename mq_detail::mq_batch<Type, BatchFn>::pusher{ &batch },
+		    max,
+		    [this]() noexcept { this->_fire(*this); });
+		batch.flush();
+		return batch.total();
+	}
+
 	/*
 	 * Callback handler.
 	 *
@@ -668,28 +1223,28 @@ public:
 /*
  * Message queue specialization for untyped messages.
  *
- * The allocator is irrelevant, code between each untyped message queue
- * is shared.
+ * The allocator and policy are irrelevant, code between each untyped
+ * message queue is shared.
  */
-template<typename Allocator>
-class msg_queue<void, Allocator>
-:	protected mq_detail::msg_queue_events<msg_queue<void, Allocator>&>,
+template<typename Allocator, typename Policy>
+class msg_queue<void, Allocator, Policy>
+:	protected mq_detail::msg_queue_events<
+	    msg_queue<void, Allocator, Policy>&>,
 	public mq_detail::void_msg_queue
 {
 private:
 	using events =
-	    mq_detail::msg_queue_events<msg_queue<void, Allocator>&>;
+	    mq_detail::msg_queue_events<msg_queue<void, Allocator, Policy>&>;
 
 public:
 	msg_queue() = default;
 
 	msg_queue(msg_queue&& mq) noexcept
-	:	mq_detail::msg_queue_events<msg_queue<void, Allocator>>(
-		    std::move(mq)),
+	:	events(std::move(mq)),
 		mq_detail::void_msg_queue(std::move(mq))
 	{
 		if (!this->empty())
-			this->_fire();
+			this->_fire(*this);
 	}
 
 	/* Ignore allocator arguments, since we don't use one. */
@@ -896,11 +1451,11 @@ public:
  * Note that unlike the typed prepare_enqueue, this has no distinction
  * between allocation-only and initialized values.
  */
-template<typename Allocator>
-class prepare_enqueue<msg_queue<void, Allocator>>
+template<typename Allocator, typename Policy>
+class prepare_enqueue<msg_queue<void, Allocator, Policy>>
 {
 public:
-	typedef ilias::msg_queue<void, Allocator> msg_queue;
+	typedef ilias::msg_queue<void, Allocator, Policy> msg_queue;
 	typedef typename msg_queue::element_type element_type;
 
 private:
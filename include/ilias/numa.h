@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2013 Ariane van der Steldt <ariane@stack.nl>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef ILIAS_NUMA_H
+#define ILIAS_NUMA_H
+
+#include <ilias/ilias_async_export.h>
+#include <climits>
+#include <cstddef>
+#include <new>
+#include <vector>
+
+namespace ilias {
+namespace numa {
+
+
+/*
+ * Cpu and memory topology.
+ *
+ * The topology is read once, on first use.
+ * On systems without numa support, all cpus are on node 0.
+ */
+
+/* Node of a thread that is not bound to a single node. */
+const unsigned int NO_NODE = UINT_MAX;
+
+/* Cpus the process may run on, in ascending order. */
+ILIAS_ASYNC_EXPORT const std::vector<unsigned int>& cpus() noexcept;
+/* Number of numa nodes, at least 1. */
+ILIAS_ASYNC_EXPORT unsigned int nodes() noexcept;
+/* Cpus on node that the process may run on. */
+ILIAS_ASYNC_EXPORT std::vector<unsigned int> node_cpus(unsigned int node);
+/* Node of cpu. */
+ILIAS_ASYNC_EXPORT unsigned int cpu_node(unsigned int cpu) noexcept;
+
+/*
+ * Node the calling thread runs on.
+ *
+ * For threads bound to cpus of a single node (using bind_thread),
+ * this is that node.
+ * Otherwise it is the node of the cpu the thread happens to run on.
+ */
+ILIAS_ASYNC_EXPORT unsigned int current_node() noexcept;
+
+/*
+ * Restrict the calling thread to the given cpus.
+ * Returns false if the thread could not be bound.
+ */
+ILIAS_ASYNC_EXPORT bool bind_thread(const std::vector<unsigned int>& cpus)
+    noexcept;
+
+/*
+ * Allocate len bytes of page aligned memory, placed on node.
+ * The placement is a preference: if the node has no memory available,
+ * the memory is placed elsewhere.
+ */
+ILIAS_ASYNC_EXPORT void* alloc_onnode(std::size_t len, unsigned int node)
+    ILIAS_ASYNC_THROWS(std::bad_alloc);
+/* Release memory allocated by alloc_onnode. */
+ILIAS_ASYNC_EXPORT void free_onnode(void* p, std::size_t len) noexcept;
+
+
+} /* namespace ilias::numa */
+} /* namespace ilias */
+
+#endif /* ILIAS_NUMA_H */
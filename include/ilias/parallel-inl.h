@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) 2015 Ariane van der Steldt <ariane@stack.nl>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef _ILIAS_PARALLEL_INL_H_
+#define _ILIAS_PARALLEL_INL_H_
+
+#include <ilias/parallel.h>
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ilias {
+namespace parallel_detail {
+
+
+/* Minimum number of elements sorted by a single chunk of parallel_sort. */
+constexpr std::size_t SORT_MIN_RUN = 1024;
+
+template<typename T, typename Combine>
+struct reduce_state {
+  reduce_state(T identity, Combine combine)
+  : identity(std::move(identity)),
+    combine(std::move(combine))
+  {}
+
+  const T identity;
+  const Combine combine;
+  std::mutex mtx;
+  std::vector<std::pair<std::size_t, T>> partials;
+  cb_promise<T> p;
+};
+
+template<typename RandomIt, typename Compare>
+class sort_state
+: public std::enable_shared_from_this<sort_state<RandomIt, Compare>>
+{
+ public:
+  sort_state(workq_service_ptr wqs, RandomIt first, std::size_t runs,
+             std::size_t n, Compare cmp)
+  : wqs_(std::move(wqs)),
+    first_(std::move(first)),
+    cmp_(std::move(cmp))
+  {
+    bounds_.reserve(runs + 1U);
+    for (std::size_t i = 0; i <= runs; ++i)
+      bounds_.push_back(n * i / runs);
+  }
+
+  auto get_future() -> cb_future<void> { return p_.get_future(); }
+  auto runs() const noexcept -> std::size_t { return bounds_.size() - 1U; }
+
+  /* Sort each run. */
+  auto sort() -> void {
+    auto self = this->shared_from_this();
+
+    parallel_range(wqs_, runs(), 1,
+                   [self](std::size_t b, std::size_t e) {
+                     for (std::size_t i = b; i != e; ++i) {
+                       std::sort(self->iter_(i), self->iter_(i + 1U),
+                                 self->cmp_);
+                     }
+                   },
+                   [self](std::exception_ptr exc) {
+                     self->next_(std::move(exc), 1);
+                   });
+  }
+
+ private:
+  auto iter_(std::size_t run) const -> RandomIt {
+    using diff_t = typename std::iterator_traits<RandomIt>::difference_type;
+
+    return first_ + static_cast<diff_t>(bounds_[run]);
+  }
+
+  /* Merge adjacent runs, each spanning width sorted runs. */
+  auto merge_(std::size_t width) -> void {
+    auto self = this->shared_from_this();
+    const std::size_t pairs = (runs() + 2U * width - 1U) / (2U * width);
+
+    parallel_range(wqs_, pairs, 1,
+                   [self, width](std::size_t b, std::size_t e) {
+                     const std::size_t runs = self->runs();
+                     for (std::size_t i = b; i != e; ++i) {
+                       const std::size_t lo = 2U * width * i;
+                       const std::size_t mid = std::min(lo + width, runs);
+                       const std::size_t hi = std::min(mid + width, runs);
+                       if (mid != hi) {
+                         std::inplace_merge(self->iter_(lo),
+                                            self->iter_(mid),
+                                            self->iter_(hi),
+                                            self->cmp_);
+                       }
+                     }
+                   },
+                   [self, width](std::exception_ptr exc) {
+                     self->next_(std::move(exc), 2U * width);
+                   });
+  }
+
+  /* Start the next merge round, or complete the promise. */
+  auto next_(std::exception_ptr exc, std::size_t width) noexcept -> void {
+    if (exc) {
+      p_.set_exception(std::move(exc));
+      return;
+    }
+    if (width >= runs()) {
+      p_.set_value();
+      return;
+    }
+
+    try {
+      merge_(width);
+    } catch (...) {
+      p_.set_exception(std::current_exception());
+    }
+  }
+
+  const workq_service_ptr wqs_;
+  const RandomIt first_;
+  const Compare cmp_;
+  std::vector<std::size_t> bounds_;
+  cb_promise<void> p_;
+};
+
+
+} /* namespace ilias::parallel_detail */
+
+
+template<typename Index, typename Fn>
+auto parallel_for(workq_service_ptr wqs, Index b, Index e, std::size_t grain,
+                  Fn&& fn) ->
+    cb_future<void> {
+  using diff_t = decltype(e - b);
+  using fn_type = std::remove_cv_t<std::remove_reference_t<Fn>>;
+
+  auto p = std::make_shared<cb_promise<void>>();
+  auto f = p->get_future();
+  if (!(b < e)) {
+    p->set_value();
+    return f;
+  }
+
+  parallel_detail::parallel_range(
+      std::move(wqs), static_cast<std::size_t>(e - b), grain,
+      [b, fn = fn_type(std::forward<Fn>(fn))](std::size_t cb,
+                                              std::size_t ce) {
+        Index i = b + static_cast<diff_t>(cb);
+        for (std::size_t n = cb; n != ce; ++n, ++i) fn(i);
+      },
+      [p](std::exception_ptr exc) {
+        if (exc)
+          p->set_exception(std::move(exc));
+        else
+          p->set_value();
+      });
+  return f;
+}
+
+template<typename Index, typename T, typename Fn, typename Combine>
+auto parallel_reduce(workq_service_ptr wqs, Index b, Index e,
+                     std::size_t grain, T identity, Fn&& fn,
+                     Combine&& combine) ->
+    cb_future<T> {
+  using diff_t = decltype(e - b);
+  using fn_type = std::remove_cv_t<std::remove_reference_t<Fn>>;
+  using state_type = parallel_detail::reduce_state<
+      T, std::remove_cv_t<std::remove_reference_t<Combine>>>;
+
+  auto st = std::make_shared<state_type>(std::move(identity),
+                                         std::forward<Combine>(combine));
+  auto f = st->p.get_future();
+  if (!(b < e)) {
+    st->p.set_value(st->identity);
+    return f;
+  }
+
+  parallel_detail::parallel_range(
+      std::move(wqs), static_cast<std::size_t>(e - b), grain,
+      [st, b, fn = fn_type(std::forward<Fn>(fn))](std::size_t cb,
+                                                  std::size_t ce) {
+        T acc = st->identity;
+        Index i = b + static_cast<diff_t>(cb);
+        for (std::size_t n = cb; n != ce; ++n, ++i)
+          acc = fn(std::move(acc), i);
+
+        std::lock_guard<std::mutex> lck{ st->mtx };
+        st->partials.emplace_back(cb, std::move(acc));
+      },
+      [st](std::exception_ptr exc) {
+        if (exc) {
+          st->p.set_exception(std::move(exc));
+          return;
+        }
+
+        try {
+          using partial = std::pair<std::size_t, T>;
+
+          std::sort(st->partials.begin(), st->partials.end(),
+                    [](const partial& x, const partial& y) {
+                      return x.first < y.first;
+                    });
+          T result = st->identity;
+          for (auto& part : st->partials)
+            result = st->combine(std::move(result), std::move(part.second));
+          st->p.set_value(std::move(result));
+        } catch (...) {
+          st->p.set_exception(std::current_exception());
+        }
+      });
+  return f;
+}
+
+template<typename RandomIt, typename Compare>
+auto parallel_sort(workq_service_ptr wqs, RandomIt first, RandomIt last,
+                   Compare cmp) ->
+    cb_future<void> {
+  using state_type = parallel_detail::sort_state<RandomIt, Compare>;
+
+  const std::size_t n = static_cast<std::size_t>(last - first);
+  const std::size_t threads =
+      std::max(std::thread::hardware_concurrency(), 1U);
+  const std::size_t runs = std::max(std::size_t(1),
+      std::min(n / parallel_detail::SORT_MIN_RUN, 4U * threads));
+
+  auto st = std::make_shared<state_type>(std::move(wqs), std::move(first),
+                                         runs, n, std::move(cmp));
+  auto f = st->get_future();
+  st->sort();
+  return f;
+}
+
+
+} /* namespace ilias */
+
+#endif /* _ILIAS_PARALLEL_INL_H_ */
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2015 Ariane van der Steldt <ariane@stack.nl>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef _ILIAS_PARALLEL_H_
+#define _ILIAS_PARALLEL_H_
+
+#include <ilias/ilias_async_export.h>
+#include <ilias/future.h>
+#include <ilias/workq.h>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <new>
+
+namespace ilias {
+namespace parallel_detail {
+
+
+using range_body = std::function<void(std::size_t, std::size_t)>;
+using range_done = std::function<void(std::exception_ptr)>;
+
+/*
+ * Run body over the index range [0, n), in parallel.
+ *
+ * The range is handed out in chunks of at least grain indices,
+ * chunk size shrinks as the remaining range shrinks.
+ * Once all chunks completed, done is invoked with the first exception
+ * thrown by body (or nullptr).  Done must not throw.
+ *
+ * The calling thread participates in running the chunks.
+ */
+ILIAS_ASYNC_EXPORT void parallel_range(workq_service_ptr, std::size_t n,
+                                       std::size_t grain,
+                                       range_body, range_done)
+    ILIAS_ASYNC_THROWS(std::bad_alloc);
+
+
+} /* namespace ilias::parallel_detail */
+
+
+/*
+ * Invoke fn(i) for each i in [b, e).
+ *
+ * Index is either an integral type or a random access iterator.
+ * Fn may be invoked concurrently, from multiple threads.
+ */
+template<typename Index, typename Fn>
+auto parallel_for(workq_service_ptr, Index, Index, std::size_t, Fn&&) ->
+    cb_future<void>;
+
+/*
+ * Fold each i in [b, e) into a value, using acc = fn(acc, i).
+ *
+ * Each chunk starts its fold with identity.
+ * Chunk results are combined in order, using combine(lhs, rhs),
+ * which must be associative.
+ */
+template<typename Index, typename T, typename Fn, typename Combine>
+auto parallel_reduce(workq_service_ptr, Index, Index, std::size_t, T,
+                     Fn&&, Combine&&) ->
+    cb_future<T>;
+
+/*
+ * Sort [first, last) using cmp.
+ *
+ * Sorts chunks in parallel and merges them pairwise.
+ * The sort is not stable.
+ */
+template<typename RandomIt, typename Compare = std::less<>>
+auto parallel_sort(workq_service_ptr, RandomIt, RandomIt,
+                   Compare = Compare()) ->
+    cb_future<void>;
+
+
+} /* namespace ilias */
+
+#include <ilias/parallel-inl.h>
+
+#endif /* _ILIAS_PARALLEL_H_ */
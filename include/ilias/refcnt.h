@@ -20,6 +20,7 @@
 #include <algorithm>
 #include <atomic>
 #include <cassert>
+#include <limits>
 #include <memory>
 #include <utility>
 #include <type_traits>
@@ -53,6 +54,14 @@ public:
 	atom_lck& operator=(const atom_lck&) = delete;
 };
 
+/* Unique address for the calling thread. */
+inline const void*
+thread_token() noexcept
+{
+	static thread_local const char token = 0;
+	return &token;
+}
+
 } /* namespace ilias::refpointer_detail */
 
 
@@ -172,6 +181,295 @@ protected:
 	}
 };
 
+/*
+ * Reference counted base class, with biased reference counting.
+ *
+ * Derived: derived type of the class.
+ * Deleter: deletion invocation on release of last reference.
+ *
+ * Behaves as refcount_base, except that a thread can bias the object
+ * towards itself, using refcnt_bias_guard.
+ * While biased, the owning thread acquires and releases references
+ * using a plain counter, while other threads use the atomic counter.
+ * The plain counter is merged into the atomic counter when the owning
+ * thread ends the bias.
+ *
+ * References may be passed between threads while the object is biased.
+ * If the last reference is released while the object is biased,
+ * the deleter is invoked when the bias ends.
+ *
+ * refcnt_is_solo and refcnt_is_zero are only exact on the owning thread
+ * of a biased object; other threads see a biased object as shared.
+ */
+template<typename Derived,
+    typename Deleter = std::default_delete<const Derived> >
+class biased_refcount_base
+{
+private:
+	/* Marks the atomic counter while the object is biased. */
+	static constexpr unsigned int BIAS =
+	    1U << (std::numeric_limits<unsigned int>::digits - 1);
+
+	mutable std::atomic<unsigned int> m_refcount;
+	mutable std::atomic<const void*> m_owner;
+	mutable unsigned int m_local;	/* Owner only. */
+	mutable unsigned int m_depth;	/* Owner only. */
+	Deleter m_deleter;
+
+protected:
+	biased_refcount_base() noexcept
+	:	m_refcount(0),
+		m_owner(nullptr),
+		m_local(0),
+		m_depth(0),
+		m_deleter()
+	{
+		/* Empty body. */
+	}
+
+	biased_refcount_base(const Deleter& m_deleter)
+		noexcept(std::is_nothrow_copy_constructible<Deleter>::value)
+	:	m_refcount(0),
+		m_owner(nullptr),
+		m_local(0),
+		m_depth(0),
+		m_deleter(m_deleter)
+	{
+		/* Empty body. */
+	}
+
+	biased_refcount_base(Deleter&& m_deleter)
+		noexcept(std::is_nothrow_move_constructible<Deleter>::value)
+	:	m_refcount(0),
+		m_owner(nullptr),
+		m_local(0),
+		m_depth(0),
+		m_deleter(std::move(m_deleter))
+	{
+		/* Empty body. */
+	}
+
+	biased_refcount_base(const biased_refcount_base&) noexcept :
+		biased_refcount_base()
+	{
+		/* Empty body. */
+	}
+
+	~biased_refcount_base() noexcept
+	{
+		assert(this->m_refcount.load(std::memory_order_seq_cst) == 0);
+		assert(this->m_owner.load(std::memory_order_relaxed) ==
+		    nullptr);
+	}
+
+	biased_refcount_base&
+	operator=(const biased_refcount_base&) noexcept
+	{
+		return *this;
+	}
+
+private:
+	bool
+	is_owner_() const noexcept
+	{
+		return (this->m_owner.load(std::memory_order_relaxed) ==
+		    refpointer_detail::thread_token());
+	}
+
+	void
+	delete_() const
+		noexcept(
+		    noexcept((*(Deleter*)nullptr)(
+		      static_cast<const Derived*>(nullptr))) &&
+		    (std::is_nothrow_move_constructible<Deleter>::value ||
+		     std::is_nothrow_copy_constructible<Deleter>::value) &&
+		    std::is_nothrow_destructible<Deleter>::value)
+	{
+		Deleter deleter = std::move_if_noexcept(this->m_deleter);
+		deleter(static_cast<const Derived*>(this));
+	}
+
+public:
+	friend void
+	refcnt_acquire(const Derived& o, unsigned int nrefs = 1U) noexcept
+	{
+		if (nrefs == 0)
+			return;
+
+		const biased_refcount_base& self = o;
+		if (self.is_owner_())
+			self.m_local += nrefs;
+		else
+			self.m_refcount.fetch_add(nrefs, std::memory_order_acquire);
+	}
+
+	friend void
+	refcnt_release(const Derived& o, unsigned int nrefs = 1U)
+		noexcept(noexcept(std::declval<const biased_refcount_base&>().
+		    delete_()))
+	{
+		if (nrefs == 0)
+			return;
+
+		const biased_refcount_base& self = o;
+		if (self.is_owner_()) {
+			/* Deletion is deferred until the bias ends. */
+			self.m_local -= nrefs;
+		} else if (self.m_refcount.fetch_sub(nrefs,
+		    std::memory_order_release) == nrefs) {
+			std::atomic_thread_fence(std::memory_order_acq_rel);
+			self.delete_();
+		}
+	}
+
+	/* Returns true if only one active reference exists to o. */
+	friend bool
+	refcnt_is_solo(const Derived& o) noexcept
+	{
+		const biased_refcount_base& self = o;
+		const auto rc = self.m_refcount.load(std::memory_order_relaxed);
+		if (self.is_owner_())
+			return (rc - BIAS + self.m_local == 1);
+		return (rc == 1);
+	}
+
+	friend bool
+	refcnt_is_zero(const Derived& o) noexcept
+	{
+		const biased_refcount_base& self = o;
+		const auto rc = self.m_refcount.load(std::memory_order_relaxed);
+		if (self.is_owner_())
+			return (rc - BIAS + self.m_local == 0);
+		return (rc == 0);
+	}
+
+	friend bool
+	refcnt_acquire_iff_live(const Derived& o, unsigned int nrefs = 1U)
+		noexcept
+	{
+		const biased_refcount_base& self = o;
+		if (self.is_owner_()) {
+			const auto rc =
+			    self.m_refcount.load(std::memory_order_relaxed);
+			if (rc - BIAS + self.m_local == 0)
+				return false;
+			self.m_local += nrefs;
+			return true;
+		}
+
+		/*
+		 * A biased object is never zero, so this may revive an object
+		 * whose last reference was released by its owner:
+		 * the deleter has not run yet and will now not run either.
+		 */
+		unsigned int expect = 1;
+		while (!self.m_refcount.compare_exchange_weak(
+		    expect, expect + nrefs,
+		    std::memory_order_acquire, std::memory_order_relaxed)) {
+			if (expect == 0) return false;
+		}
+		return true;
+	}
+
+	/*
+	 * Bias o towards the calling thread.
+	 *
+	 * The calling thread must hold a reference to o.
+	 * Returns false if another thread holds the bias.
+	 * Biases nest: each successful call must be matched by a call to
+	 * refcnt_bias_leave.
+	 */
+	friend bool
+	refcnt_bias_enter(const Derived& o) noexcept
+	{
+		const biased_refcount_base& self = o;
+		if (self.is_owner_()) {
+			++self.m_depth;
+			return true;
+		}
+
+		const void* expect = nullptr;
+		if (!self.m_owner.compare_exchange_strong(expect,
+		    refpointer_detail::thread_token(),
+		    std::memory_order_acquire, std::memory_order_relaxed))
+			return false;
+
+		/*
+		 * Keep the atomic counter from reaching zero, while other
+		 * threads release references that the owner acquired.
+		 */
+		assert(self.m_local == 0 && self.m_depth == 0);
+		self.m_refcount.fetch_add(BIAS, std::memory_order_relaxed);
+		self.m_depth = 1;
+		return true;
+	}
+
+	/* End a bias started by refcnt_bias_enter. */
+	friend void
+	refcnt_bias_leave(const Derived& o)
+		noexcept(noexcept(std::declval<const biased_refcount_base&>().
+		    delete_()))
+	{
+		const biased_refcount_base& self = o;
+		assert(self.is_owner_() && self.m_depth > 0);
+		if (--self.m_depth != 0)
+			return;
+
+		/*
+		 * Merge while still owning the object, so no other thread
+		 * can bias it in between.
+		 */
+		const unsigned int delta = self.m_local - BIAS;
+		self.m_local = 0;
+		const bool last = (self.m_refcount.fetch_add(delta,
+		    std::memory_order_acq_rel) + delta == 0);
+		self.m_owner.store(nullptr, std::memory_order_release);
+
+		if (last)
+			self.delete_();
+	}
+};
+
+template<typename Derived, typename Deleter>
+constexpr unsigned int biased_refcount_base<Derived, Deleter>::BIAS;
+
+/*
+ * Bias a biased_refcount_base object towards the calling thread,
+ * for the lifetime of the guard.
+ *
+ * The guard does not hold a reference:
+ * the calling thread must hold a reference when creating the guard.
+ * If another thread holds the bias, the guard has no effect.
+ */
+template<typename Type>
+class refcnt_bias_guard
+{
+private:
+	const Type* m_obj;
+
+public:
+	explicit refcnt_bias_guard(const Type& o) noexcept
+	:	m_obj(refcnt_bias_enter(o) ? &o : nullptr)
+	{
+		/* Empty body. */
+	}
+
+	refcnt_bias_guard(const refcnt_bias_guard&) = delete;
+	refcnt_bias_guard& operator=(const refcnt_bias_guard&) = delete;
+
+	~refcnt_bias_guard() noexcept
+	{
+		if (this->m_obj)
+			refcnt_bias_leave(*this->m_obj);
+	}
+
+	/* Returns true if the calling thread holds the bias. */
+	explicit operator bool() const noexcept
+	{
+		return (this->m_obj != nullptr);
+	}
+};
+
 template<typename Type>
 struct default_refcount_mgr
 {
@@ -374,7 +672,8 @@ public:
 	friend bool
 	operator==(const pointer& a, const refpointer& b) noexcept
 	{
-		return b == a;
+		/* Not b == a: C++20 would resolve that to this operator. */
+		return (b.get() == a);
 	}
 
 	template<typename U>
@@ -387,7 +686,7 @@ public:
 	friend bool
 	operator!=(const pointer& a, const refpointer& b) noexcept
 	{
-		return b != a;
+		return (b.get() != a);
 	}
 
 	explicit operator bool() const noexcept
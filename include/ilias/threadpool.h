@@ -18,7 +18,10 @@
 
 #include <ilias/ilias_async_export.h>
 #include <ilias/threadpool_intf.h>
+#include <atomic>
+#include <chrono>
 #include <memory>
+#include <vector>
 
 namespace ilias {
 
@@ -36,8 +39,38 @@ private:
 	std::unique_ptr<impl, impl_deleter> m_impl;
 
 public:
+	/*
+	 * Placement of worker threads on cpus.
+	 *
+	 * PIN_NONE: workers run on any cpu.
+	 * PIN_CPUSET: workers run on any of the selected cpus.
+	 * PIN_CPU: each worker is pinned to a single cpu,
+	 * spreading the workers evenly over the selected cpus.
+	 * PIN_NODE: each worker is pinned to the selected cpus of
+	 * a single numa node, spreading the workers over the nodes
+	 * according to the number of selected cpus on each node.
+	 *
+	 * If no number of threads is given, the threadpool starts one
+	 * thread per selected cpu.
+	 */
+	struct placement_policy
+	{
+		enum pin_type {
+			PIN_NONE,
+			PIN_CPUSET,
+			PIN_CPU,
+			PIN_NODE
+		};
+
+		pin_type pin{ PIN_NONE };
+		/* Selected cpus, all cpus available to the process if empty. */
+		std::vector<unsigned int> cpus;
+	};
+
 	threadpool();
 	threadpool(unsigned int);
+	explicit threadpool(const placement_policy&);
+	threadpool(unsigned int, const placement_policy&);
 
 	threadpool(threadpool&& o) noexcept
 	:	m_impl(std::move(o.m_impl))
@@ -54,6 +87,58 @@ public:
 
 	void set_nthreads(unsigned int);
 	unsigned int get_nthreads() const noexcept;
+	placement_policy get_placement() const;
+
+	/*
+	 * Idle policy.
+	 *
+	 * A worker that runs out of work spins for a while, polling for
+	 * new work, before it goes to sleep.  Each worker adapts its spin
+	 * duration to the observed time until new work arrives,
+	 * bounded by max_spin.
+	 */
+	struct idle_policy
+	{
+		/* Maximum spin duration, zero disables spinning. */
+		std::chrono::nanoseconds max_spin{
+			std::chrono::microseconds(50)
+		};
+		/* Maximum number of workers spinning at the same time. */
+		unsigned int max_spinners{ 1U };
+		/* Yield the cpu during the second half of the spin. */
+		bool yield{ true };
+	};
+
+	void set_idle_policy(const idle_policy&);
+	idle_policy get_idle_policy() const noexcept;
+
+	/*
+	 * Autoscaling policy.
+	 *
+	 * Threads are added while runnable work stays queued for longer than
+	 * grow_after while all workers are busy, up to max_threads.
+	 * Threads that are idle for longer than idle_timeout are retired,
+	 * down to min_threads.
+	 */
+	struct autoscale_policy
+	{
+		unsigned int min_threads{ 1U };
+		unsigned int max_threads{ 0U };
+		std::chrono::nanoseconds grow_after{
+			std::chrono::milliseconds(1)
+		};
+		std::chrono::nanoseconds idle_timeout{
+			std::chrono::seconds(10)
+		};
+	};
+
+	/*
+	 * Enable autoscaling.
+	 * A call to set_nthreads() disables autoscaling.
+	 */
+	void set_autoscale(const autoscale_policy&);
+	/* Number of threads currently alive (get_nthreads() is the target). */
+	unsigned int get_current_nthreads() const noexcept;
 
 
 	class ILIAS_ASYNC_EXPORT threadpool_service
@@ -63,17 +148,24 @@ public:
 
 	private:
 		impl& m_self;
+		/*
+		 * Number of idle workers.
+		 * Shared with the implementation, so it can be read
+		 * without locking the service.
+		 */
+		const std::shared_ptr<const std::atomic<unsigned int>> m_idle;
 
 	protected:
 		unsigned int wakeup(unsigned int) noexcept;
 
-	public:
-		threadpool_service(threadpool& tp) noexcept
-		:	m_self(*tp.m_impl)
+		std::shared_ptr<const std::atomic<unsigned int>>
+		idle_count() const noexcept
 		{
-			/* Empty body. */
+			return this->m_idle;
 		}
 
+	public:
+		threadpool_service(threadpool& tp) noexcept;
 		~threadpool_service() noexcept;
 	};
 
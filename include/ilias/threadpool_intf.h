@@ -19,8 +19,10 @@
 #include <ilias/ll_list.h>
 #include <ilias/refcnt.h>
 #include <ilias/util.h>
+#include <chrono>
 #include <climits>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <stdexcept>
 #include <type_traits>
@@ -65,7 +67,7 @@ protected:
 	void
 	service_lock_wait() const noexcept
 	{
-		while (this->m_client_locks.load(std::memory_order_acquire) !=
+		while (this->m_service_locks.load(std::memory_order_acquire) !=
 		    0U);
 	}
 
@@ -216,6 +218,34 @@ protected:
 	virtual bool do_work() noexcept = 0;
 	/* Client supplied: test if client has work available. */
 	virtual bool has_work() noexcept = 0;
+	/*
+	 * Client supplied: point in time at which the client will have
+	 * work available, even if none is available now.
+	 * Idle threads sleep no longer than this.
+	 */
+	ILIAS_ASYNC_EXPORT virtual std::chrono::steady_clock::time_point
+	    next_deadline() noexcept;
+	/*
+	 * Client supplied: block until the client has work,
+	 * the deadline passes, or wait_interrupt() is called.
+	 * Returns false if the client cannot block,
+	 * in which case idle threads sleep in the service.
+	 */
+	ILIAS_ASYNC_EXPORT virtual bool wait_work(
+	    std::chrono::steady_clock::time_point) noexcept;
+	/* Client supplied: make a thread blocked in wait_work() return. */
+	ILIAS_ASYNC_EXPORT virtual void wait_interrupt() noexcept;
+
+	/*
+	 * Default idle count: service does not publish one.
+	 * Services that count their idle threads hide this with
+	 * their own implementation.
+	 */
+	std::shared_ptr<const std::atomic<unsigned int>>
+	idle_count() const noexcept
+	{
+		return nullptr;
+	}
 
 private:
 	/*
@@ -253,6 +283,40 @@ protected:
 	 * available.
 	 */
 	virtual unsigned int wakeup(unsigned int = 1) noexcept = 0;
+	/*
+	 * Service supplied: number of idle threads, or null.
+	 * While it reads zero, wakeup() has nothing to do.
+	 * The counter may outlive the service.
+	 */
+	virtual std::shared_ptr<const std::atomic<unsigned int>> idle_count()
+	    const noexcept = 0;
+
+	/*
+	 * Default deadline: client only has work after calling wakeup().
+	 * Clients with timed work hide this with their own implementation.
+	 */
+	std::chrono::steady_clock::time_point
+	next_deadline() noexcept
+	{
+		return std::chrono::steady_clock::time_point::max();
+	}
+
+	/*
+	 * Default wait: client cannot block waiting for work.
+	 * Clients that wait for external events (such as I/O)
+	 * hide these with their own implementation.
+	 */
+	bool
+	wait_work(std::chrono::steady_clock::time_point) noexcept
+	{
+		return false;
+	}
+
+	void
+	wait_interrupt() noexcept
+	{
+		/* Empty body. */
+	}
 
 private:
 	/*
@@ -329,12 +393,37 @@ private:
 		return this->Client::has_work();
 	}
 
+	std::chrono::steady_clock::time_point
+	next_deadline() noexcept override final
+	{
+		return this->Client::next_deadline();
+	}
+
+	bool
+	wait_work(std::chrono::steady_clock::time_point tp) noexcept
+	    override final
+	{
+		return this->Client::wait_work(tp);
+	}
+
+	void
+	wait_interrupt() noexcept override final
+	{
+		this->Client::wait_interrupt();
+	}
+
 	unsigned int
 	wakeup(unsigned int n) noexcept override final
 	{
 		return this->Service::wakeup(n);
 	}
 
+	std::shared_ptr<const std::atomic<unsigned int>>
+	idle_count() const noexcept override final
+	{
+		return this->Service::idle_count();
+	}
+
 	using threadpool_intf_detail::refcount::client_acquire;
 	using threadpool_intf_detail::refcount::client_release;
 	using threadpool_intf_detail::refcount::service_acquire;
@@ -461,6 +550,12 @@ public:
 		bool invoke_work() noexcept;
 		/* Test for work availability. */
 		bool invoke_test() noexcept;
+		/* Query client for its next deadline. */
+		std::chrono::steady_clock::time_point invoke_deadline()
+		    noexcept;
+		/* Block in the client, waiting for work. */
+		bool invoke_wait(std::chrono::steady_clock::time_point)
+		    noexcept;
 
 	public:
 		/* Wakeup N threads. */
@@ -507,6 +602,9 @@ public:
 	protected:
 		bool do_work() noexcept;
 		bool has_work() noexcept;
+		std::chrono::steady_clock::time_point next_deadline() noexcept;
+		bool wait_work(std::chrono::steady_clock::time_point) noexcept;
+		void wait_interrupt() noexcept;
 	};
 
 	tp_service_multiplexer&
@@ -582,6 +680,9 @@ public:
 	protected:
 		bool do_work() noexcept;
 		bool has_work() noexcept;
+		std::chrono::steady_clock::time_point next_deadline() noexcept;
+		bool wait_work(std::chrono::steady_clock::time_point) noexcept;
+		void wait_interrupt() noexcept;
 	};
 
 	tp_client_multiplexer&
@@ -798,6 +899,51 @@ public:
 };
 
 
+/*
+ * Blocking section.
+ *
+ * Declares that the current thread is about to block, for instance in a
+ * system call, until the blocking_section is destroyed.
+ * A threadpool worker that blocks is compensated for:
+ * the threadpool runs an additional worker for the duration,
+ * so that other work keeps its parallelism.
+ * Outside threadpool workers, a blocking_section does nothing.
+ *
+ * Blocking sections may be nested.
+ */
+class ILIAS_ASYNC_EXPORT blocking_section
+{
+public:
+	/* Implemented by threads that compensate for blocking. */
+	class ILIAS_ASYNC_EXPORT handler
+	{
+	public:
+		virtual void blocking_enter() noexcept = 0;
+		virtual void blocking_leave() noexcept = 0;
+
+	protected:
+		~handler() noexcept;
+	};
+
+	/*
+	 * Install the handler for the current thread.
+	 * Returns the previously installed handler.
+	 */
+	static handler* set_handler(handler*) noexcept;
+
+private:
+	handler* m_handler;
+
+public:
+	/* If active is false, the blocking section does nothing. */
+	explicit blocking_section(bool active = true) noexcept;
+	~blocking_section() noexcept;
+
+	blocking_section(const blocking_section&) = delete;
+	blocking_section& operator=(const blocking_section&) = delete;
+};
+
+
 /*
  * A simple service that will allow aid invocations.
  */
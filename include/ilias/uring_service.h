@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2013 Ariane van der Steldt <ariane@stack.nl>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef ILIAS_URING_SERVICE_H
+#define ILIAS_URING_SERVICE_H
+
+#include <ilias/ilias_async_export.h>
+#include <ilias/future.h>
+#include <ilias/threadpool_intf.h>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <sys/uio.h>
+
+namespace ilias {
+
+
+/*
+ * Completion based I/O service (using io_uring).
+ *
+ * Each operation returns a future, which is completed with the result
+ * of the operation, or with a std::system_error if the operation fails.
+ *
+ * Operations are queued, not submitted:
+ * the queued operations are submitted together by the next
+ * aid() call or threadpool worker, using a single system call.
+ * Completions are dispatched by the same.
+ *
+ * The uring_service is a threadpool client:
+ * idle threadpool workers submit and reap without blocking,
+ * and one idle worker blocks waiting for completions,
+ * instead of sleeping on its condition variable.
+ * To share a threadpool with a workq_service,
+ * attach both through a tp_service_multiplexer.
+ *
+ * Buffers passed to an operation must stay valid until
+ * its future is completed.
+ */
+class ILIAS_ASYNC_EXPORT uring_service
+{
+public:
+	class ILIAS_ASYNC_EXPORT threadpool_client
+	:	public virtual threadpool_client_intf
+	{
+	friend class uring_service;
+
+	private:
+		uring_service& m_self;
+
+	public:
+		threadpool_client(uring_service& self)
+		:	m_self(self)
+		{
+			/* Empty body. */
+		}
+
+		~threadpool_client() noexcept;
+
+	protected:
+		bool do_work() noexcept;
+		bool has_work() noexcept;
+		bool wait_work(std::chrono::steady_clock::time_point) noexcept;
+		void wait_interrupt() noexcept;
+	};
+
+	uring_service&
+	threadpool_client_arg() noexcept
+	{
+		return *this;
+	}
+
+	void attach(threadpool_client_ptr<threadpool_client>);
+
+private:
+	/* Pending operation, completed by its completion queue entry. */
+	struct op;
+	template<typename T> struct op_prom;
+	/* Memory mapped submission and completion queues. */
+	struct ring;
+
+	int m_fd;
+	std::unique_ptr<ring> m_ring;
+	/* Protects the submission queue. */
+	std::mutex m_sq_mtx;
+	/* Protects the completion queue. */
+	std::mutex m_cq_mtx;
+	/* Operations queued, but not yet submitted. */
+	unsigned int m_queued{ 0U };
+	/* Operations submitted, but not yet completed. */
+	std::atomic<std::size_t> m_inflight{ 0U };
+	std::atomic<bool> m_stopping{ false };
+	threadpool_client_ptr<threadpool_client> m_tp;
+	/* Kernel cancels all operations with a single entry. */
+	bool m_cancel_any{ false };
+	/* Protects m_ops. */
+	std::mutex m_ops_mtx;
+	/* Operations in flight, tracked only if !m_cancel_any. */
+	op* m_ops{ nullptr };
+
+	template<typename T> ILIAS_ASYNC_LOCAL cb_future<T> queue_(
+	    std::uint8_t, int, std::uint64_t, std::uint32_t, std::uint64_t,
+	    std::uint32_t = 0U, std::uint16_t = 0U);
+	ILIAS_ASYNC_LOCAL unsigned int submit_locked() noexcept;
+	ILIAS_ASYNC_LOCAL unsigned int submit() noexcept;
+	ILIAS_ASYNC_LOCAL unsigned int reap(unsigned int) noexcept;
+	ILIAS_ASYNC_LOCAL bool has_completions() const noexcept;
+	ILIAS_ASYNC_LOCAL void interrupt() noexcept;
+	ILIAS_ASYNC_LOCAL bool probe_cancel_any() noexcept;
+	ILIAS_ASYNC_LOCAL bool cancel_all() noexcept;
+
+public:
+	/* Offset argument: use (and update) the file position. */
+	static const std::uint64_t CUR_POS = ~std::uint64_t(0);
+
+	explicit uring_service(unsigned int entries = 256U);
+	~uring_service() noexcept;
+
+	uring_service(const uring_service&) = delete;
+	uring_service& operator=(const uring_service&) = delete;
+
+	cb_future<std::size_t> read(int fd, void* buf, std::size_t len,
+	    std::uint64_t off = CUR_POS);
+	cb_future<std::size_t> write(int fd, const void* buf, std::size_t len,
+	    std::uint64_t off = CUR_POS);
+	cb_future<std::size_t> fsync(int fd);
+	cb_future<std::size_t> recv(int fd, void* buf, std::size_t len,
+	    int flags = 0);
+	cb_future<std::size_t> send(int fd, const void* buf, std::size_t len,
+	    int flags = 0);
+	/* Completed with the accepted socket. */
+	cb_future<int> accept(int fd);
+
+	/*
+	 * Register buffers with the kernel.
+	 *
+	 * Operations on registered buffers skip mapping the caller's
+	 * memory for each operation: the kernel reads and writes the
+	 * buffer directly.
+	 * Only one set of buffers can be registered at a time.
+	 */
+	void register_buffers(const struct iovec* iov, unsigned int count);
+	void unregister_buffers();
+
+	/*
+	 * Read/write using registered buffer idx.
+	 * [buf, buf + len) must lie within the registered buffer.
+	 */
+	cb_future<std::size_t> read_fixed(int fd, void* buf, std::size_t len,
+	    unsigned int idx, std::uint64_t off = CUR_POS);
+	cb_future<std::size_t> write_fixed(int fd, const void* buf,
+	    std::size_t len, unsigned int idx, std::uint64_t off = CUR_POS);
+
+	/*
+	 * Submit queued operations and dispatch up to count completions,
+	 * without blocking.
+	 * Returns true if any operation was submitted or completed.
+	 */
+	bool aid(unsigned int count = 64U) noexcept;
+};
+
+
+} /* namespace ilias */
+
+#endif /* ILIAS_URING_SERVICE_H */
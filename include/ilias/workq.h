@@ -18,14 +18,20 @@
 
 #include <ilias/ilias_async_export.h>
 #include <ilias/ll_list.h>
+#include <ilias/numa.h>
 #include <ilias/refcnt.h>
 #include <ilias/threadpool_intf.h>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <stdexcept>
 #include <memory>
 #include <mutex>
+#include <new>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -104,8 +110,9 @@ public:
 };
 
 
-ILIAS_ASYNC_EXPORT workq_service_ptr new_workq_service() throw (std::bad_alloc);
-ILIAS_ASYNC_EXPORT workq_pop_state workq_switch(const workq_pop_state&) throw (workq_deadlock, workq_stack_error);
+ILIAS_ASYNC_EXPORT workq_service_ptr new_workq_service() ILIAS_ASYNC_THROWS(std::bad_alloc);
+ILIAS_ASYNC_EXPORT workq_service_ptr new_workq_service(unsigned int) ILIAS_ASYNC_THROWS(std::bad_alloc, std::invalid_argument);
+ILIAS_ASYNC_EXPORT workq_pop_state workq_switch(const workq_pop_state&) ILIAS_ASYNC_THROWS(workq_deadlock, workq_stack_error);
 
 
 namespace workq_detail {
@@ -114,6 +121,12 @@ namespace workq_detail {
 struct runq_tag {};
 struct coroutine_tag {};
 struct parallel_tag {};
+struct local_runq_tag {};
+
+
+class local_runq;
+class timer_wheel;
+class inline_job;
 
 
 struct wq_deleter;
@@ -123,6 +136,7 @@ class workq_int
 {
 template<typename Type> friend struct workq_intref_mgr;
 friend struct wq_deleter;
+friend class ilias::workq;
 
 private:
 	mutable std::atomic<std::uintptr_t> int_refcnt;
@@ -201,6 +215,31 @@ struct wq_deleter
 
 class wq_run_lock;
 
+/*
+ * Timer wheel linkage of a job.
+ *
+ * All fields are protected by the mutex of the timer wheel.
+ */
+class timer_node
+{
+friend class timer_wheel;
+
+private:
+	timer_node* m_prev{ nullptr };
+	timer_node* m_next{ nullptr };
+	/* Expiry tick, relative to the wheel epoch. */
+	std::uint64_t m_tick{ 0U };
+	/* Deadline of the timer. */
+	std::chrono::steady_clock::time_point m_deadline;
+	/* Reactivation interval of periodic jobs. */
+	std::chrono::steady_clock::duration m_interval{ 0 };
+
+protected:
+	timer_node() = default;
+	timer_node(const timer_node&) = delete;
+	timer_node& operator=(const timer_node&) = delete;
+};
+
 #if !ILIAS_ASYNC_HAS_ATOMIC_SHARED_PTR
 class atom_lck
 {
@@ -303,10 +342,12 @@ workq_deactivate(const std::shared_ptr<JobType>& j) noexcept
 class ILIAS_ASYNC_EXPORT workq_job :
 	public workq_detail::workq_int,
 	public ll_list_hook<workq_detail::runq_tag>,
-	public ll_list_hook<workq_detail::parallel_tag>
+	public ll_list_hook<workq_detail::parallel_tag>,
+	private workq_detail::timer_node
 {
 friend class workq;	/* Because MSVC and GCC cannot access private types in friend definitions. :P */
 friend class workq_service;
+friend class workq_detail::timer_wheel;
 friend class workq_detail::wq_run_lock;
 friend struct workq_detail::workq_intref_mgr<workq_job>;
 friend void workq_detail::wq_deleter::operator()(const workq_job*) const noexcept;
@@ -320,15 +361,20 @@ public:
 	static const unsigned int STATE_RUNNING = 0x0001;
 	static const unsigned int STATE_HAS_RUN = 0x0002;
 	static const unsigned int STATE_ACTIVE = 0x0004;
+	static const unsigned int STATE_TIMER = 0x0008;
 
 	static const unsigned int TYPE_ONCE = 0x0001;
 	static const unsigned int TYPE_PERSIST = 0x0002;
 	static const unsigned int TYPE_PARALLEL = 0x0004;
+	static const unsigned int TYPE_PERIODIC = 0x0008;
 	static const unsigned int TYPE_NO_AID = 0x0010;
-	static const unsigned int TYPE_MASK = (TYPE_ONCE | TYPE_PERSIST | TYPE_PARALLEL | TYPE_NO_AID);
+	static const unsigned int TYPE_BLOCKING = 0x0020;
+	static const unsigned int TYPE_MASK = (TYPE_ONCE | TYPE_PERSIST | TYPE_PARALLEL | TYPE_PERIODIC | TYPE_NO_AID | TYPE_BLOCKING);
 
 	static const unsigned int ACT_IMMED = 0x0001;
 
+	using timer_clock = std::chrono::steady_clock;
+
 	const unsigned int m_type;
 
 private:
@@ -340,13 +386,42 @@ protected:
 	virtual run_lck lock_run() noexcept;
 	virtual void unlock_run(run_lck rl) noexcept;
 
-	workq_job(workq_ptr, unsigned int = 0) throw (std::invalid_argument);
+	workq_job(workq_ptr, unsigned int = 0) ILIAS_ASYNC_THROWS(std::invalid_argument);
 	virtual ~workq_job() noexcept;
 	virtual void run() noexcept = 0;
 
+private:
+	void cancel_timer() noexcept;
+
 public:
 	void activate(unsigned int flags = 0) noexcept;
 	void deactivate() noexcept;
+
+	/*
+	 * Activate the job once the deadline passes.
+	 *
+	 * TYPE_PERIODIC jobs are reactivated every interval after
+	 * the deadline, until the job is deactivated.
+	 * Rearming a pending timer moves its deadline.
+	 */
+	void activate_at(timer_clock::time_point,
+	    timer_clock::duration = timer_clock::duration::zero()) noexcept;
+
+	/*
+	 * Activate the job after the duration passes.
+	 *
+	 * TYPE_PERIODIC jobs are reactivated every duration,
+	 * until the job is deactivated.
+	 */
+	template<typename Rep, typename Period>
+	void
+	activate_after(const std::chrono::duration<Rep, Period>& d) noexcept
+	{
+		const auto interval =
+		    std::chrono::duration_cast<timer_clock::duration>(d);
+		this->activate_at(timer_clock::now() + interval, interval);
+	}
+
 	const workq_ptr& get_workq() const noexcept;
 	const workq_service_ptr& get_workq_service() const noexcept;
 
@@ -363,6 +438,136 @@ public:
 };
 
 
+namespace workq_detail {
+
+
+/* Test if FN is a callable that is not a std::function<void()>. */
+template<typename FN, typename = void>
+struct is_job_fn
+:	std::false_type
+{};
+
+template<typename FN>
+struct is_job_fn<FN,
+    decltype(void(std::declval<typename std::decay<FN>::type&>()()))>
+:	std::integral_constant<bool,
+	    !std::is_same<typename std::decay<FN>::type,
+	      std::function<void()> >::value>
+{};
+
+/* Allocation tag: place a job on the given numa node. */
+struct on_node
+{
+	unsigned int node;
+};
+
+/*
+ * Job running a small functor, which is stored inside the job.
+ *
+ * Storage of these jobs is recycled through a per-thread freelist,
+ * so creating them does not allocate once the freelist is populated.
+ * Jobs of a workq that is placed on a numa node use storage on that node.
+ */
+class ILIAS_ASYNC_EXPORT inline_job final :
+	public workq_job
+{
+public:
+	static const std::size_t FN_SIZE = 4 * sizeof(void*);
+
+	/* Test if a functor fits in the job. */
+	template<typename FN>
+	struct fits
+	:	std::integral_constant<bool,
+		    sizeof(FN) <= FN_SIZE &&
+		    alignof(FN) <= alignof(std::max_align_t)>
+	{};
+
+private:
+	typename std::aligned_storage<FN_SIZE,
+	    alignof(std::max_align_t)>::type m_fn;
+	void (*const m_invoke)(void*);
+	void (*const m_destroy)(void*);
+
+	template<typename FN>
+	static void
+	invoke_fn(void* fn)
+	{
+		(*static_cast<FN*>(fn))();
+	}
+
+	template<typename FN>
+	static void
+	destroy_fn(void* fn)
+	{
+		static_cast<FN*>(fn)->~FN();
+	}
+
+	template<typename FN>
+	static bool
+	is_null(const FN&) noexcept
+	{
+		return false;
+	}
+
+	template<typename R, typename... Args>
+	static bool
+	is_null(R (*fn)(Args...)) noexcept
+	{
+		return (fn == nullptr);
+	}
+
+public:
+	template<typename FN>
+	inline_job(workq_ptr wq, FN&& fn, unsigned int type = 0) :
+		workq_job(std::move(wq), type),
+		m_invoke(&invoke_fn<typename std::decay<FN>::type>),
+		m_destroy(&destroy_fn<typename std::decay<FN>::type>)
+	{
+		using fn_type = typename std::decay<FN>::type;
+
+		static_assert(fits<fn_type>::value,
+		    "functor too large to store inline");
+		if (is_null(fn)) {
+			throw std::invalid_argument("workq_job: "
+			    "functor invalid");
+		}
+		new (&this->m_fn) fn_type(std::forward<FN>(fn));
+	}
+
+	virtual ~inline_job() noexcept;
+	virtual void run() noexcept override;
+
+	static void* operator new(std::size_t) ILIAS_ASYNC_THROWS(std::bad_alloc);
+	static void* operator new(std::size_t, on_node) ILIAS_ASYNC_THROWS(std::bad_alloc);
+	static void operator delete(void*) noexcept;
+	static void operator delete(void*, on_node) noexcept;
+};
+
+/*
+ * Threads waiting in workq_switch() for the run-single lock of a workq.
+ *
+ * Waiters are served in order of arrival.
+ * Releasing the run-single lock hands it to the first waiter,
+ * so waiters take priority over workers dispatching the runq.
+ */
+struct switch_queue
+{
+	std::mutex mtx;
+	std::condition_variable cnd;
+	/* Ticket of the next waiter to arrive. */
+	unsigned long tail{ 0UL };
+	/* Ticket of the first waiter. */
+	unsigned long head{ 0UL };
+	/* Set if the lock was handed to the first waiter. */
+	bool granted{ false };
+	/* Number of waiters, read without holding mtx. */
+	std::atomic<unsigned int> waiting{ 0U };
+};
+
+
+} /* namespace ilias::workq_detail */
+
+
 class workq final :
 	public workq_detail::workq_int,
 	public ll_list_hook<workq_detail::runq_tag>,
@@ -392,51 +597,141 @@ private:
 
 	job_runq m_runq;
 	job_p_runq m_p_runq;
-	const workq_service_ptr m_wqs;
+	workq_service_ptr m_wqs;
 	std::atomic<bool> m_run_single;
 	std::atomic<unsigned int> m_run_parallel;
+	workq_detail::switch_queue m_switchq;
+	/* Set for anonymous workqs, pooled by the workq_service. */
+	const bool m_anon;
+	/* Numa node this workq is placed on, or numa::NO_NODE. */
+	const unsigned int m_node;
 
 	ILIAS_ASYNC_LOCAL run_lck lock_run() noexcept;
 	ILIAS_ASYNC_LOCAL run_lck lock_run_parallel() noexcept;
+	ILIAS_ASYNC_LOCAL void lock_run_single_wait() noexcept;
+	ILIAS_ASYNC_LOCAL bool unlock_run_single() noexcept;
 	ILIAS_ASYNC_LOCAL void unlock_run(run_lck rl) noexcept;
 	ILIAS_ASYNC_LOCAL run_lck lock_run_downgrade(run_lck rl) noexcept;
 
-	ILIAS_ASYNC_LOCAL workq(workq_service_ptr wqs) throw (std::invalid_argument);
+	ILIAS_ASYNC_LOCAL workq(workq_service_ptr wqs, bool anon = false, unsigned int node = numa::NO_NODE) ILIAS_ASYNC_THROWS(std::invalid_argument);
 	ILIAS_ASYNC_LOCAL ~workq() noexcept;
 
 public:
 	ILIAS_ASYNC_EXPORT const workq_service_ptr& get_workq_service() const noexcept;
+
+	/* Numa node this workq is placed on, or numa::NO_NODE. */
+	unsigned int
+	get_node() const noexcept
+	{
+		return this->m_node;
+	}
 	ILIAS_ASYNC_EXPORT static workq_ptr get_current() noexcept;
 
 private:
 	ILIAS_ASYNC_LOCAL void job_to_runq(workq_detail::workq_intref<workq_job>) noexcept;
+	ILIAS_ASYNC_EXPORT void once_inline(workq_detail::inline_job*) noexcept;
+
+	template<typename FN>
+	workq_job_ptr
+	new_job_(unsigned int type, FN&& fn, std::true_type)
+	    ILIAS_ASYNC_THROWS(std::bad_alloc, std::invalid_argument)
+	{
+		return workq_job_ptr(
+		    new (workq_detail::on_node{ this->m_node })
+		      workq_detail::inline_job(workq_ptr(this),
+		      std::forward<FN>(fn), type),
+		    workq_detail::wq_deleter());
+	}
+
+	template<typename FN>
+	workq_job_ptr
+	new_job_(unsigned int type, FN&& fn, std::false_type)
+	    ILIAS_ASYNC_THROWS(std::bad_alloc, std::invalid_argument)
+	{
+		return this->new_job(type,
+		    std::function<void()>(std::forward<FN>(fn)));
+	}
+
+	template<typename FN>
+	void
+	once_(FN&& fn, std::true_type)
+	    ILIAS_ASYNC_THROWS(std::bad_alloc, std::invalid_argument)
+	{
+		this->once_inline(
+		    new (workq_detail::on_node{ this->m_node })
+		      workq_detail::inline_job(workq_ptr(this),
+		      std::forward<FN>(fn), workq_job::TYPE_ONCE));
+	}
+
+	template<typename FN>
+	void
+	once_(FN&& fn, std::false_type)
+	    ILIAS_ASYNC_THROWS(std::bad_alloc, std::invalid_argument)
+	{
+		this->once(std::function<void()>(std::forward<FN>(fn)));
+	}
 
 public:
 	ILIAS_ASYNC_EXPORT workq_job_ptr new_job(unsigned int type, std::function<void()>)
-	    throw (std::bad_alloc, std::invalid_argument);
+	    ILIAS_ASYNC_THROWS(std::bad_alloc, std::invalid_argument);
 	ILIAS_ASYNC_EXPORT workq_job_ptr new_job(unsigned int type, std::vector<std::function<void()> >)
-	    throw (std::bad_alloc, std::invalid_argument);
+	    ILIAS_ASYNC_THROWS(std::bad_alloc, std::invalid_argument);
 	ILIAS_ASYNC_EXPORT void once(std::function<void()>)
-	    throw (std::bad_alloc, std::invalid_argument);
+	    ILIAS_ASYNC_THROWS(std::bad_alloc, std::invalid_argument);
 	ILIAS_ASYNC_EXPORT void once(std::vector<std::function<void()> >)
-	    throw (std::bad_alloc, std::invalid_argument);
+	    ILIAS_ASYNC_THROWS(std::bad_alloc, std::invalid_argument);
 
 	workq_job_ptr
-	new_job(std::function<void()> fn) throw (std::bad_alloc, std::invalid_argument)
+	new_job(std::function<void()> fn) ILIAS_ASYNC_THROWS(std::bad_alloc, std::invalid_argument)
 	{
 		return this->new_job(0U, std::move(fn));
 	}
 
 	workq_job_ptr
-	new_job(std::vector<std::function<void()> > fns) throw (std::bad_alloc, std::invalid_argument)
+	new_job(std::vector<std::function<void()> > fns) ILIAS_ASYNC_THROWS(std::bad_alloc, std::invalid_argument)
 	{
 		return this->new_job(0U, std::move(fns));
 	}
 
+	/*
+	 * Create a job from a functor.
+	 * Small functors are stored inside the job, avoiding std::function.
+	 */
+	template<typename FN, typename = typename std::enable_if<
+	    workq_detail::is_job_fn<FN>::value>::type>
+	workq_job_ptr
+	new_job(unsigned int type, FN&& fn) ILIAS_ASYNC_THROWS(std::bad_alloc, std::invalid_argument)
+	{
+		return this->new_job_(type, std::forward<FN>(fn),
+		    workq_detail::inline_job::fits<typename std::decay<FN>::type>());
+	}
+
+	template<typename FN, typename = typename std::enable_if<
+	    workq_detail::is_job_fn<FN>::value>::type>
+	workq_job_ptr
+	new_job(FN&& fn) ILIAS_ASYNC_THROWS(std::bad_alloc, std::invalid_argument)
+	{
+		return this->new_job(0U, std::forward<FN>(fn));
+	}
+
+	/*
+	 * Run a functor once.
+	 * Small functors are stored inside a recycled job,
+	 * in which case no memory is allocated.
+	 */
+	template<typename FN, typename = typename std::enable_if<
+	    workq_detail::is_job_fn<FN>::value>::type>
+	void
+	once(FN&& fn) ILIAS_ASYNC_THROWS(std::bad_alloc, std::invalid_argument)
+	{
+		this->once_(std::forward<FN>(fn),
+		    workq_detail::inline_job::fits<typename std::decay<FN>::type>());
+	}
+
 	template<typename... FN>
 	workq_job_ptr
 	new_job(unsigned int type, std::function<void()> fn0, std::function<void()> fn1, FN&&... fn)
-	    throw (std::bad_alloc, std::invalid_argument)
+	    ILIAS_ASYNC_THROWS(std::bad_alloc, std::invalid_argument)
 	{
 		std::vector<std::function<void()> > fns;
 		fns.push_back(std::move(fn0), std::move(fn1), std::forward<FN>(fn)...);
@@ -447,7 +742,7 @@ public:
 	template<typename... FN>
 	workq_job_ptr
 	new_job(std::function<void()> fn0, std::function<void()> fn1, FN&&... fn)
-	    throw (std::bad_alloc, std::invalid_argument)
+	    ILIAS_ASYNC_THROWS(std::bad_alloc, std::invalid_argument)
 	{
 		return this->new_job(0U, std::move(fn0), std::move(fn1), std::forward<FN>(fn)...);
 	}
@@ -455,7 +750,7 @@ public:
 	template<typename... FN>
 	void
 	once(std::function<void()> fn0, std::function<void()> fn1, FN&&... fn)
-	    throw (std::bad_alloc, std::invalid_argument)
+	    ILIAS_ASYNC_THROWS(std::bad_alloc, std::invalid_argument)
 	{
 		std::vector<std::function<void()> > fns;
 		fns.push_back(std::move(fn0), std::move(fn1), std::forward<FN>(fn)...);
@@ -496,7 +791,7 @@ friend class ilias::workq_service;
 friend class co_runnable;	/* Can't get more specific, since the co_runnable requires wq_run_lock to be defined. */
 friend void ilias::workq_job::activate(unsigned int) noexcept;
 friend bool ilias::workq::aid(unsigned int) noexcept;
-friend ILIAS_ASYNC_EXPORT workq_pop_state ilias::workq_switch(const workq_pop_state&) throw (workq_deadlock, workq_stack_error);
+friend ILIAS_ASYNC_EXPORT workq_pop_state ilias::workq_switch(const workq_pop_state&) ILIAS_ASYNC_THROWS(workq_deadlock, workq_stack_error);
 
 private:
 	workq_intref<workq> m_wq;
@@ -598,6 +893,9 @@ private:
 	bool lock(workq& what) noexcept;
 	bool lock(workq_job& what) noexcept;
 	bool lock(workq_service& wqs) noexcept;
+	bool lock_shared_runq(workq_service& wqs) noexcept;
+	bool lock_local_runq(workq_service& wqs, local_runq* self) noexcept;
+	bool lock_node_runq(workq_service& wqs, unsigned int node) noexcept;
 	void lock_wq(workq& what, workq::run_lck how) noexcept;
 
 	void
@@ -638,14 +936,13 @@ friend class wq_run_lock;
 private:
 	wq_run_lock m_rlck;
 	std::atomic<std::size_t> m_runcount;
+	std::atomic<bool> m_published;
 
 public:
 	virtual ~co_runnable() noexcept;
 
 protected:
-	co_runnable(workq_ptr, unsigned int = 0) throw (std::invalid_argument);
-
-	virtual void unlock_run(run_lck rl) noexcept override;
+	co_runnable(workq_ptr, unsigned int = 0) ILIAS_ASYNC_THROWS(std::invalid_argument);
 
 	void co_publish(std::size_t) noexcept;
 	bool release(std::size_t) noexcept;
@@ -661,18 +958,36 @@ class workq_service final :
 	public workq_detail::workq_int,
 	public refcount_base<workq_service, workq_detail::wq_deleter>
 {
+friend class workq;
 friend class workq_detail::wq_run_lock;
-friend ILIAS_ASYNC_EXPORT workq_service_ptr new_workq_service() throw (std::bad_alloc);
-friend ILIAS_ASYNC_EXPORT workq_service_ptr new_workq_service(unsigned int) throw (std::bad_alloc);
+friend ILIAS_ASYNC_EXPORT workq_service_ptr new_workq_service() ILIAS_ASYNC_THROWS(std::bad_alloc);
+friend ILIAS_ASYNC_EXPORT workq_service_ptr new_workq_service(unsigned int) ILIAS_ASYNC_THROWS(std::bad_alloc, std::invalid_argument);
 friend void workq_detail::wq_deleter::operator()(const workq*) const noexcept;
 friend void workq_detail::wq_deleter::operator()(const workq_service*) const noexcept;
 friend void workq_detail::co_runnable::co_publish(std::size_t) noexcept;
 friend bool workq_detail::co_runnable::release(std::size_t n) noexcept;
 friend void workq::job_to_runq(workq_detail::workq_intref<workq_job>) noexcept;
+friend void workq::unlock_run(workq::run_lck) noexcept;
+friend void workq_job::activate_at(workq_job::timer_clock::time_point,
+    workq_job::timer_clock::duration) noexcept;
+friend void workq_job::cancel_timer() noexcept;
 friend struct workq_detail::workq_intref_mgr<workq_service>;
 
 
 public:
+	/*
+	 * Service flags.
+	 *
+	 * WQS_LOCAL_RUNQ: each worker thread keeps a local runq of workqs.
+	 * Workqs activated from within a worker are placed on the local runq
+	 * of that worker, workers that run out of work steal from the
+	 * local runqs of other workers.
+	 */
+	static const unsigned int WQS_LOCAL_RUNQ = 0x0001;
+	static const unsigned int WQS_MASK = WQS_LOCAL_RUNQ;
+
+	const unsigned int m_flags;
+
 	class threadpool_client
 	:	public virtual threadpool_client_intf
 	{
@@ -693,6 +1008,7 @@ public:
 	protected:
 		bool do_work() noexcept;
 		bool has_work() noexcept;
+		std::chrono::steady_clock::time_point next_deadline() noexcept;
 	};
 
 	workq_service&
@@ -709,12 +1025,27 @@ public:
 			    "cannot assign null client implementation");
 		}
 
+		/*
+		 * Only the idle count of the first service is used:
+		 * a wakeup() racing with a later attach could otherwise
+		 * test the count of the previous service.
+		 */
+		const bool first = !this->m_idle_count;
+		if (!first)
+			this->m_idle_hint.store(nullptr, std::memory_order_relaxed);
+
 		threadpool_client_ptr<threadpool_client> expect{ nullptr };
 		if (!atomic_compare_exchange_strong(&this->m_wakeup_cb,
 		    &expect, p)) {
 			throw std::runtime_error("workq_service: "
 			    "client already present");
 		}
+
+		if (first) {
+			this->m_idle_count = p->idle_count();
+			this->m_idle_hint.store(this->m_idle_count.get(),
+			    std::memory_order_release);
+		}
 	}
 
 
@@ -726,24 +1057,66 @@ private:
 	    workq_detail::coroutine_tag,
 	    workq_detail::workq_intref_mgr<workq_detail::co_runnable>>;
 
+	using local_runqs = ll_smartptr_list<workq_detail::local_runq,
+	    workq_detail::local_runq_tag>;
+
+	/*
+	 * Pool of anonymous workqs.
+	 *
+	 * The pool does not reference its workqs:
+	 * a workq removes itself from the pool when it is destroyed.
+	 * Since each workq holds on to the workq_service until then,
+	 * the pool is empty by the time the workq_service is destroyed.
+	 */
+	static const unsigned int ANON_WQS = 8U;
+
+	struct anon_slot
+	{
+		std::mutex mtx;
+		workq* wq{ nullptr };
+	};
+
 	wq_runq m_wq_runq;
 	co_runq m_co_runq;
+	local_runqs m_local_runqs;
+	/* Runq per numa node, for workqs placed on a node. */
+	const unsigned int m_nodes;
+	const std::unique_ptr<wq_runq[]> m_node_runqs;
+	/* Number of workqs placed on a node. */
+	std::atomic<unsigned int> m_placed{ 0U };
+	anon_slot m_anon[ANON_WQS];
+	const std::unique_ptr<workq_detail::timer_wheel> m_timers;
 	threadpool_client_ptr<threadpool_client> m_wakeup_cb;
+	/*
+	 * Idle thread count of the service, if it publishes one.
+	 * Lets wakeup() skip the service while no thread sleeps,
+	 * without touching m_wakeup_cb.
+	 */
+	std::shared_ptr<const std::atomic<unsigned int>> m_idle_count;
+	std::atomic<const std::atomic<unsigned int>*> m_idle_hint{ nullptr };
 
-	ILIAS_ASYNC_LOCAL wq_runq::iterator& get_runq_iterpos() noexcept;
+	ILIAS_ASYNC_LOCAL workq_detail::local_runq* get_local_runq() noexcept;
 
-	ILIAS_ASYNC_LOCAL workq_service();
+	ILIAS_ASYNC_LOCAL workq_service(unsigned int = 0U);
 	ILIAS_ASYNC_LOCAL ~workq_service() noexcept;
 
-	ILIAS_ASYNC_LOCAL void wq_to_runq(workq_detail::workq_intref<workq>)
-	    noexcept;
+	ILIAS_ASYNC_LOCAL void wq_to_runq(workq_detail::workq_intref<workq>,
+	    bool = false) noexcept;
 	ILIAS_ASYNC_LOCAL void co_to_runq(
 	    workq_detail::workq_intref<workq_detail::co_runnable>, std::size_t)
 	    noexcept;
 	ILIAS_ASYNC_LOCAL void wakeup(std::size_t = 1) noexcept;
+	ILIAS_ASYNC_LOCAL void anon_remove(const workq&) noexcept;
 
 public:
-	ILIAS_ASYNC_EXPORT workq_ptr new_workq() throw (std::bad_alloc);
+	ILIAS_ASYNC_EXPORT workq_ptr new_workq() ILIAS_ASYNC_THROWS(std::bad_alloc);
+	/*
+	 * Create a workq placed on a numa node:
+	 * it preferentially runs on threads on that node,
+	 * and its jobs are allocated on that node where possible.
+	 */
+	ILIAS_ASYNC_EXPORT workq_ptr new_workq(unsigned int node) ILIAS_ASYNC_THROWS(std::bad_alloc, std::invalid_argument);
+	ILIAS_ASYNC_EXPORT workq_ptr anon_workq() ILIAS_ASYNC_THROWS(std::bad_alloc);
 	ILIAS_ASYNC_EXPORT bool aid(unsigned int = 1) noexcept;
 	ILIAS_ASYNC_EXPORT bool empty() const noexcept;
 
@@ -108,8 +108,7 @@ public:
 	void
 	run() noexcept override
 	{
-		auto p = this->m_arg.load(nullptr,
-		    std::memory_order_consume);
+		auto p = this->m_arg.load(std::memory_order_acquire);
 
 		if (p)
 			this->m_fn(*p);
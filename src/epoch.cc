@@ -0,0 +1,262 @@
+/*
+ * Copyright (c) 2013 Ariane van der Steldt <ariane@stack.nl>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include <ilias/epoch.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if !HAS_TLS
+#include "tls_fallback.h"
+#endif
+#if !HAS_THREAD_LOCAL
+#include "thread_local.h"
+#endif
+
+
+namespace ilias {
+namespace epoch_detail {
+namespace {
+
+
+/* Number of retirements between attempts to advance the epoch. */
+constexpr std::size_t ADVANCE_INTERVAL = 64;
+
+std::atomic<std::uintptr_t> global_epoch{ 0U };
+
+/*
+ * Epoch state of a thread, visible to other threads.
+ *
+ * Records are claimed by a thread and released when it exits.
+ * Records are never freed.
+ */
+struct alignas(64) record {
+  static constexpr std::uintptr_t ACTIVE = 0x1U;
+
+  std::atomic<std::uintptr_t> state{ 0U };  // (epoch << 1) | ACTIVE
+  std::atomic<bool> in_use{ true };
+  record* next = nullptr;
+};
+
+constexpr std::uintptr_t record::ACTIVE;
+
+std::atomic<record*> records{ nullptr };
+
+/*
+ * Allocate a record.
+ * Plain new only guarantees alignof(std::max_align_t),
+ * which is less than the cache line alignment of a record.
+ */
+auto new_record() noexcept -> record* {
+  void* p;
+  if (posix_memalign(&p, alignof(record), sizeof(record)) != 0)
+    return nullptr;
+  return new (p) record();
+}
+
+auto claim_record() noexcept -> record& {
+  for (;;) {
+    record* head = records.load(std::memory_order_acquire);
+    for (record* r = head; r != nullptr; r = r->next) {
+      bool expect = false;
+      if (!r->in_use.load(std::memory_order_relaxed) &&
+          r->in_use.compare_exchange_strong(expect, true,
+                                            std::memory_order_acquire,
+                                            std::memory_order_relaxed))
+        return *r;
+    }
+
+    record* r = new_record();
+    if (r == nullptr) {
+      /* Out of memory: wait for another thread to release a record. */
+      std::this_thread::yield();
+      continue;
+    }
+
+    r->next = head;
+    while (!records.compare_exchange_weak(r->next, r,
+                                          std::memory_order_release,
+                                          std::memory_order_relaxed));
+    return *r;
+  }
+}
+
+/*
+ * Try to move the global epoch forward.
+ * Fails if a thread inside a guard has not yet observed the current epoch.
+ */
+auto try_advance() noexcept -> bool {
+  std::uintptr_t e = global_epoch.load(std::memory_order_seq_cst);
+  for (record* r = records.load(std::memory_order_acquire);
+       r != nullptr;
+       r = r->next) {
+    const std::uintptr_t s = r->state.load(std::memory_order_seq_cst);
+    if ((s & record::ACTIVE) != 0U && (s >> 1) != e) return false;
+  }
+  return global_epoch.compare_exchange_strong(e, e + 1U,
+                                              std::memory_order_seq_cst,
+                                              std::memory_order_relaxed) ||
+         e != global_epoch.load(std::memory_order_relaxed);
+}
+
+auto run(std::vector<retired>& bag) noexcept -> void {
+  /* Releases may retire more pointers, so detach the bag first. */
+  std::vector<retired> todo;
+  todo.swap(bag);
+  for (const retired& r : todo) (*r.fn)(r.ptr, r.nrefs);
+}
+
+/*
+ * Thread local epoch state.
+ *
+ * Retired pointers are kept in three bags, one for each of the last
+ * three epochs.  A bag can be released once the global epoch is two
+ * ahead of the epoch in which it was filled.
+ */
+struct local_state {
+  record* rec = nullptr;
+  unsigned int nesting = 0;
+  std::size_t since_advance = 0;
+  std::array<std::vector<retired>, 3> bags;
+  std::array<std::uintptr_t, 3> bag_epoch{{ 0U, 0U, 0U }};
+
+  ~local_state() noexcept;
+
+  void collect() noexcept;
+  void synchronize() noexcept;
+};
+
+auto get_local_state() noexcept -> local_state& {
+#if HAS_THREAD_LOCAL
+  static thread_local local_state m_impl;
+  return m_impl;
+#else
+  static tls_cd<local_state> m_impl;
+  return *m_impl;
+#endif
+}
+
+local_state::~local_state() noexcept {
+  assert(nesting == 0);
+  synchronize();
+  if (rec == nullptr) return;
+
+  rec->state.store(0U, std::memory_order_relaxed);
+  rec->in_use.store(false, std::memory_order_release);
+  rec = nullptr;
+}
+
+auto local_state::collect() noexcept -> void {
+  const std::uintptr_t e = global_epoch.load(std::memory_order_acquire);
+  for (std::size_t i = 0; i < bags.size(); ++i) {
+    if (!bags[i].empty() && bag_epoch[i] + 2U <= e) run(bags[i]);
+  }
+}
+
+auto local_state::synchronize() noexcept -> void {
+  assert(nesting == 0);
+  if (std::all_of(bags.begin(), bags.end(),
+                  [](const std::vector<retired>& bag) {
+                    return bag.empty();
+                  }))
+    return;
+
+  const std::uintptr_t target =
+      global_epoch.load(std::memory_order_seq_cst) + 2U;
+  while (global_epoch.load(std::memory_order_seq_cst) < target) {
+    if (!try_advance()) std::this_thread::yield();
+  }
+
+  /* Releases may retire more pointers. */
+  for (;;) {
+    bool done = true;
+    for (auto& bag : bags) {
+      if (!bag.empty()) {
+        done = false;
+        run(bag);
+      }
+    }
+    if (done) break;
+  }
+}
+
+
+}} /* namespace ilias::epoch_detail::<unnamed> */
+
+
+auto epoch_detail::enter() noexcept -> void {
+  local_state& ls = get_local_state();
+  if (ls.nesting++ != 0) return;
+
+  if (ls.rec == nullptr) ls.rec = &claim_record();
+  const std::uintptr_t e = global_epoch.load(std::memory_order_relaxed);
+  ls.rec->state.store((e << 1) | record::ACTIVE, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+auto epoch_detail::leave() noexcept -> void {
+  local_state& ls = get_local_state();
+  assert(ls.nesting > 0);
+  if (--ls.nesting == 0)
+    ls.rec->state.store(0U, std::memory_order_release);
+}
+
+auto epoch_detail::retire(const retired& r) noexcept -> void {
+  local_state& ls = get_local_state();
+
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  const std::uintptr_t e = global_epoch.load(std::memory_order_relaxed);
+  const std::size_t idx = e % ls.bags.size();
+
+  /* The bag was filled at least three epochs ago. */
+  if (ls.bag_epoch[idx] != e) {
+    run(ls.bags[idx]);
+    ls.bag_epoch[idx] = e;
+  }
+
+  try {
+    ls.bags[idx].push_back(r);
+  } catch (const std::bad_alloc&) {
+    /*
+     * Release synchronously, if the bag cannot grow.
+     * Inside a guard, this thread would wait for itself.
+     */
+    if (ls.nesting != 0) std::terminate();
+    ls.synchronize();
+    (*r.fn)(r.ptr, r.nrefs);
+    return;
+  }
+
+  if (++ls.since_advance >= ADVANCE_INTERVAL) {
+    ls.since_advance = 0;
+    try_advance();
+    ls.collect();
+  }
+}
+
+auto epoch_synchronize() noexcept -> void {
+  epoch_detail::get_local_state().synchronize();
+}
+
+
+} /* namespace ilias */
@@ -14,19 +14,99 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 #include <ilias/future.h>
+#include <climits>
+#ifdef __linux__
+# include <linux/futex.h>
+# include <sys/syscall.h>
+# include <time.h>
+# include <unistd.h>
+#else
+# include <array>
+# include <condition_variable>
+# include <mutex>
+#endif
 
 namespace ilias {
 namespace impl {
+namespace {
+
+
+#ifdef __linux__
+/*
+ * Park on the state word using a futex.
+ *
+ * Only threads waiting on the same shared state are woken up.
+ */
+static_assert(sizeof(std::atomic<shared_state_base::state_t>) == sizeof(int),
+              "futex requires the state to be a 32-bit word");
+
+void futex_wait(const void* addr, int expect,
+                const std::chrono::nanoseconds* timeout) noexcept {
+  using std::chrono::duration_cast;
+  using std::chrono::seconds;
+
+  struct timespec ts;
+  if (timeout) {
+    const auto sec = duration_cast<seconds>(*timeout);
+    ts.tv_sec = sec.count();
+    ts.tv_nsec = (*timeout - sec).count();
+  }
+
+  syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, expect,
+          (timeout ? &ts : nullptr), nullptr, 0);
+}
+
+void futex_wake_all(const void* addr) noexcept {
+  syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+}
+#else
+/*
+ * Parking lot: shared states hash onto a fixed set of
+ * mutex/condition variable pairs.
+ */
+struct parking_spot {
+  std::mutex mtx;
+  std::condition_variable cnd;
+};
+
+std::array<parking_spot, 64> parking_lot;
+
+parking_spot& get_parking_spot(const void* p) noexcept {
+  auto idx = reinterpret_cast<uintptr_t>(p);
+  idx ^= idx >> 12;
+  idx ^= idx >> 6;
+  return parking_lot[idx % parking_lot.size()];
+}
+#endif
+
+
+} /* namespace ilias::impl::<unnamed> */
 
 
 void __throw(std::future_errc ec) {
-  throw std::future_error(std::make_error_code(ec));
+  throw std::future_error(ec);
 }
 
 
+constexpr unsigned int shared_state_base::WAIT_SPIN;
+
+
 void noop_dependant(std::weak_ptr<void>) noexcept {}
 
 
+auto dependant_node::invoke(shared_state_base&) noexcept -> void {
+  const auto f = std::exchange(fn, &noop_dependant);
+  std::weak_ptr<void> a = std::move(arg);
+
+  destroy();
+  (*f)(std::move(a));
+}
+
+auto dependant_node::destroy() noexcept -> void {
+  arg.reset();
+}
+
+
 shared_state_base::shared_state_base(bool deferred) noexcept
 : state_(deferred ? state_t::uninitialized_deferred : state_t::uninitialized),
   lck_(false),
@@ -35,6 +115,15 @@ shared_state_base::shared_state_base(bool deferred) noexcept
   start_deferred_value_(false)
 {}
 
+shared_state_base::~shared_state_base() noexcept {
+  /* Release callbacks that never ran. */
+  callback_node* head = callbacks_.load(std::memory_order_acquire);
+  if (head == callbacks_closed_()) return;
+
+  while (head != nullptr)
+    std::exchange(head, head->next_)->destroy();
+}
+
 auto shared_state_base::start_deferred(bool async) noexcept -> void {
   start_deferred_called_.store(true, std::memory_order_relaxed);
   if (async) start_deferred_value_.store(true, std::memory_order_relaxed);
@@ -74,7 +163,13 @@ auto shared_state_base::ensure_uninitialized() const -> void {
 }
 
 auto shared_state_base::register_dependant_begin() -> register_dependant_tx {
-  return register_dependant_tx(*this, register_dependant_begin_());
+  if (callbacks_.load(std::memory_order_acquire) == callbacks_closed_())
+    return register_dependant_tx(*this, nullptr);
+
+  /* The first dependant uses the embedded node. */
+  if (!embedded_used_.exchange(true, std::memory_order_relaxed))
+    return register_dependant_tx(*this, &embedded_);
+  return register_dependant_tx(*this, new_dependant_());
 }
 
 auto shared_state_base::register_dependant(void (*fn)(std::weak_ptr<void>),
@@ -84,24 +179,145 @@ auto shared_state_base::register_dependant(void (*fn)(std::weak_ptr<void>),
 
 auto shared_state_base::set_ready_val(
     std::unique_lock<shared_state_base> lck) noexcept -> void {
+  /* seq_cst: pairs with the waiters_ increment in park_(). */
   auto old_state = state_.exchange(state_t::ready_value,
-                                   std::memory_order_release);
+                                   std::memory_order_seq_cst);
   assert(old_state == state_t::uninitialized);
   lck.unlock();
 
+  unpark_();
   invoke_ready_cb();
 }
 
 auto shared_state_base::set_ready_exc(
     std::unique_lock<shared_state_base> lck) noexcept -> void {
+  /* seq_cst: pairs with the waiters_ increment in park_(). */
   auto old_state = state_.exchange(state_t::ready_exc,
-                                   std::memory_order_release);
+                                   std::memory_order_seq_cst);
   assert(old_state == state_t::uninitialized);
   lck.unlock();
 
+  unpark_();
   invoke_ready_cb();
 }
 
+/*
+ * Add a callback.
+ *
+ * If the state is already ready, the callback is invoked immediately.
+ */
+auto shared_state_base::add_callback_(callback_node* cb) noexcept -> void {
+  if (!push_callback(cb)) cb->invoke(*this);
+}
+
+/*
+ * Sentinel marking the callback list as closed.
+ *
+ * The address of the shared state is never a valid node address.
+ */
+auto shared_state_base::callbacks_closed_() noexcept -> callback_node* {
+  return reinterpret_cast<callback_node*>(this);
+}
+
+/*
+ * Push a callback on the callback list.
+ *
+ * Fails if the callback list is closed (i.e. the state is ready),
+ * in which case the caller still owns the callback.
+ */
+auto shared_state_base::push_callback(callback_node* cb) noexcept -> bool {
+  const auto closed = callbacks_closed_();
+  auto head = callbacks_.load(std::memory_order_acquire);
+
+  do {
+    if (head == closed) return false;
+    cb->next_ = head;
+  } while (!callbacks_.compare_exchange_weak(head, cb,
+                                             std::memory_order_release,
+                                             std::memory_order_acquire));
+  return true;
+}
+
+/*
+ * Invoke all callbacks.
+ *
+ * Closes the callback list, so callbacks added later are invoked
+ * immediately.  Calling this more than once is harmless, since only
+ * the first call finds any callbacks.
+ *
+ * Callbacks are invoked in the order they were added.
+ */
+auto shared_state_base::invoke_ready_cb() noexcept -> void {
+  callback_node* head = callbacks_.exchange(callbacks_closed_(),
+                                            std::memory_order_acq_rel);
+  if (head == callbacks_closed_()) return;
+
+  /* Reverse the stack. */
+  callback_node* fifo = nullptr;
+  while (head != nullptr)
+    fifo = std::exchange(head, std::exchange(head->next_, fifo));
+
+  while (fifo != nullptr) {
+    std::exchange(fifo, fifo->next_)->invoke(*this);
+  }
+}
+
+auto shared_state_base::wait_slow_() noexcept -> state_t {
+  unsigned int spin = WAIT_SPIN;
+  state_t s;
+
+  while (!is_ready_(s = state_.load(std::memory_order_acquire))) {
+    if (spin != 0U) {
+      --spin;
+      std::this_thread::yield();
+    } else {
+      park_(s, nullptr);
+    }
+  }
+  return s;
+}
+
+/*
+ * Park the calling thread until the state changes from expect,
+ * or the timeout expires.
+ *
+ * Spurious returns are allowed: callers retest the state.
+ */
+auto shared_state_base::park_(state_t expect,
+                              const std::chrono::nanoseconds* timeout)
+    noexcept -> void {
+  waiters_.fetch_add(1U, std::memory_order_seq_cst);
+
+#ifdef __linux__
+  if (state_.load(std::memory_order_seq_cst) == expect)
+    futex_wait(&state_, static_cast<int>(expect), timeout);
+#else
+  parking_spot& ps = get_parking_spot(this);
+  std::unique_lock<std::mutex> guard{ ps.mtx };
+  if (state_.load(std::memory_order_seq_cst) == expect) {
+    if (timeout)
+      ps.cnd.wait_for(guard, *timeout);
+    else
+      ps.cnd.wait(guard);
+  }
+  guard.unlock();
+#endif
+
+  waiters_.fetch_sub(1U, std::memory_order_release);
+}
+
+auto shared_state_base::unpark_() noexcept -> void {
+  if (_predict_true(waiters_.load(std::memory_order_seq_cst) == 0U)) return;
+
+#ifdef __linux__
+  futex_wake_all(&state_);
+#else
+  parking_spot& ps = get_parking_spot(this);
+  std::lock_guard<std::mutex> guard{ ps.mtx };
+  ps.cnd.notify_all();
+#endif
+}
+
 auto shared_state_base::add_promise_reference_() noexcept -> void {
   promise_refcnt_.fetch_add(1U, std::memory_order_acquire);
 }
@@ -114,7 +330,7 @@ auto shared_state_base::remove_promise_reference_() noexcept -> void {
 
   if (promise_refcnt_.fetch_sub(1U, std::memory_order_release) == 1U) {
     if (_predict_false(get_state() == state_t::uninitialized))
-      set_exc(make_exception_ptr(future_error(make_error_code(broken_prom))));
+      set_exc(make_exception_ptr(future_error(broken_prom)));
   }
 }
 
@@ -135,7 +351,7 @@ auto shared_state_converter<void>::install_exc(std::exception_ptr e) -> void {
   prom_.reset();
   if (prom) {
     prom->clear_convert();
-    prom->set_exc(move(e));
+    prom->set_exc(std::move(e));
   }
 }
 
@@ -208,9 +424,16 @@ auto shared_state_base::register_dependant_tx::commit(
     std::weak_ptr<void> arg) noexcept -> void {
   assert(self_ != nullptr);
 
-  auto self_ptr = self_;
-  self_ = nullptr;
-  self_ptr->register_dependant_commit_(idx_, std::move(fn), std::move(arg));
+  auto self_ptr = std::exchange(self_, nullptr);
+  auto node = std::exchange(node_, nullptr);
+  if (node == nullptr) {
+    (*fn)(std::move(arg));
+    return;
+  }
+
+  node->fn = fn;
+  node->arg = std::move(arg);
+  self_ptr->add_callback_(node);
 }
 
 
@@ -14,19 +14,188 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 #include <ilias/hazard.h>
+#include <algorithm>
 #include <array>
+#include <cstdlib>
+#include <new>
 #include <thread>
 
+#if !HAS_TLS
+#include "tls_fallback.h"
+#endif
+#if !HAS_THREAD_LOCAL
+#include "thread_local.h"
+#endif
+
 
 namespace ilias {
 namespace hazard_detail {
 namespace {
 
 
-using hazards_t = std::array<hazard_t, 64>;
+/*
+ * Hazards are kept in segments of 64 slots.
+ *
+ * Each thread claims slots from a segment and keeps them until it exits.
+ * The claimed bitmap of a segment tracks which slots belong to a thread,
+ * so grant and wait only visit those.
+ * If all slots are claimed, a new segment is appended.
+ * Segments are never freed.
+ */
+struct segment {
+  static constexpr std::size_t SIZE = 64;
+
+  std::array<hazard_t, SIZE> slots;
+  std::atomic<std::uint64_t> claimed;
+  std::atomic<segment*> next;
+
+  hazard_t* claim() noexcept;
+  bool unclaim(hazard_t&) noexcept;
+
+  template<typename Fn> bool for_each_claimed(Fn&&) noexcept;
+};
+
+constexpr std::size_t segment::SIZE;
+
+alignas(4096) segment first_segment;  // Page aligned, to reduce TLB misses.
+std::atomic<std::size_t> slot_count{ segment::SIZE };
+
+auto lowest_bit(std::uint64_t bits) noexcept -> unsigned int {
+  assert(bits != 0U);
+#if defined(__GNUC__)
+  return __builtin_ctzll(bits);
+#else
+  unsigned int i = 0;
+  while ((bits & 0x1U) == 0U) {
+    bits >>= 1;
+    ++i;
+  }
+  return i;
+#endif
+}
+
+auto segment::claim() noexcept -> hazard_t* {
+  std::uint64_t bits = claimed.load(std::memory_order_relaxed);
+  while (~bits != 0U) {
+    const unsigned int i = lowest_bit(~bits);
+    if (claimed.compare_exchange_weak(bits, bits | (std::uint64_t(1) << i),
+                                      std::memory_order_seq_cst,
+                                      std::memory_order_relaxed))
+      return &slots[i];
+  }
+  return nullptr;
+}
+
+auto segment::unclaim(hazard_t& h) noexcept -> bool {
+  if (&h < slots.data() || &h >= slots.data() + SIZE) return false;
+
+  const auto i = std::size_t(&h - slots.data());
+  claimed.fetch_and(~(std::uint64_t(1) << i), std::memory_order_release);
+  return true;
+}
+
+/*
+ * Invoke fn on each claimed slot.
+ * Stops early, returning false, if fn returns false.
+ */
+template<typename Fn>
+auto segment::for_each_claimed(Fn&& fn) noexcept -> bool {
+  std::uint64_t bits = claimed.load(std::memory_order_seq_cst);
+  while (bits != 0U) {
+    const unsigned int i = lowest_bit(bits);
+    bits &= bits - 1U;
+    if (!fn(slots[i])) return false;
+  }
+  return true;
+}
+
+/*
+ * Allocate a segment.
+ * Plain new only guarantees alignof(std::max_align_t),
+ * which is less than the cache line alignment of the slots.
+ */
+auto new_segment() noexcept -> segment* {
+  void* p;
+  if (posix_memalign(&p, alignof(segment), sizeof(segment)) != 0)
+    return nullptr;
+  return new (p) segment();
+}
+
+auto delete_segment(segment* s) noexcept -> void {
+  s->~segment();
+  std::free(s);
+}
 
-std::atomic<unsigned short> hz_idx;
-alignas(4096) hazards_t hazards;  // Page aligned, to reduce TLB misses.
+/* Claim a slot from any segment, appending a segment if all are full. */
+auto claim_slot() noexcept -> hazard_t& {
+  segment* s = &first_segment;
+  for (;;) {
+    if (hazard_t* h = s->claim()) return *h;
+
+    segment* n = s->next.load(std::memory_order_acquire);
+    if (n == nullptr) {
+      segment* fresh = new_segment();
+      if (fresh == nullptr) {
+        /* Out of memory: wait for another thread to release a slot. */
+        std::this_thread::yield();
+        s = &first_segment;
+        continue;
+      }
+
+      /*
+       * Grow the slot count before the segment is published,
+       * so a grant never counts fewer slots than are reachable.
+       */
+      slot_count.fetch_add(segment::SIZE, std::memory_order_seq_cst);
+      if (s->next.compare_exchange_strong(n, fresh,
+                                          std::memory_order_acq_rel,
+                                          std::memory_order_acquire)) {
+        n = fresh;
+      } else {
+        slot_count.fetch_sub(segment::SIZE, std::memory_order_relaxed);
+        delete_segment(fresh);
+      }
+    }
+    s = n;
+  }
+}
+
+/* Slots claimed by this thread, released when the thread exits. */
+struct local_slots {
+  hazard_t* head = nullptr;
+
+  ~local_slots() noexcept {
+    while (head != nullptr) {
+      hazard_t& h = *head;
+      head = h.next_local;
+
+      for (segment* s = &first_segment;
+           !s->unclaim(h);
+           s = s->next.load(std::memory_order_acquire));
+    }
+  }
+};
+
+auto get_local_slots() noexcept -> local_slots& {
+#if HAS_THREAD_LOCAL
+  static thread_local local_slots m_impl;
+  return m_impl;
+#else
+  static tls_cd<local_slots> m_impl;
+  return *m_impl;
+#endif
+}
+
+/* Invoke fn on each claimed slot in the first limit slots. */
+template<typename Fn>
+auto for_each_slot(std::size_t limit, Fn&& fn) noexcept -> void {
+  for (segment* s = &first_segment;
+       s != nullptr && limit > 0U;
+       s = s->next.load(std::memory_order_acquire)) {
+    if (!s->for_each_claimed(fn)) break;
+    limit -= std::min(limit, segment::SIZE);
+  }
+}
 
 auto mark(hazard_t& h, std::uintptr_t owner, std::uintptr_t value) noexcept ->
     bool {
@@ -70,33 +239,50 @@ auto basic_hazard::allocate_hazard(std::uintptr_t owner) noexcept ->
 
   assert(owner != 0U && (owner & hazard_t::FLAG) == 0U);
 
-  const hazards_t::size_type idx =
-      hz_idx.fetch_add(1U, std::memory_order_relaxed) % hazards.size();
-
-  for (auto h = hazards.begin() + idx; true; h = hazards.begin()) {
-    for (; h != hazards.end(); ++h) {
-      std::uintptr_t expect = 0U;
-      if (h->owner.compare_exchange_weak(expect, owner,
-                                         std::memory_order_relaxed,
-                                         std::memory_order_relaxed))
-        return *h;
+  /*
+   * Use a slot claimed by this thread earlier.
+   * A slot is only busy if this thread has nested hazards,
+   * or while a grant is briefly marking it.
+   */
+  local_slots& tls = get_local_slots();
+  for (hazard_t* h = tls.head; h != nullptr; h = h->next_local) {
+    std::uintptr_t expect = 0U;
+    while (!h->owner.compare_exchange_weak(expect, owner,
+                                           std::memory_order_relaxed,
+                                           std::memory_order_relaxed)) {
+      if (expect != 0U && expect != hazard_t::FLAG) break;
+      expect = 0U;
     }
+    if (expect == 0U) return *h;
   }
 
-  /* UNREACHABLE */
+  hazard_t& h = claim_slot();
+  std::uintptr_t expect = 0U;
+  while (!h.owner.compare_exchange_weak(expect, owner,
+                                        std::memory_order_relaxed,
+                                        std::memory_order_relaxed)) {
+    assert(expect == 0U || expect == hazard_t::FLAG);
+    expect = 0U;
+  }
+  h.next_local = tls.head;
+  tls.head = &h;
+  return h;
 }
 
-const std::size_t basic_hazard::hazard_count = hazard_detail::hazards.size();
+auto basic_hazard::hazard_count() noexcept -> std::size_t {
+  return hazard_detail::slot_count.load(std::memory_order_seq_cst);
+}
 
-auto basic_hazard::hazard_grant(std::uintptr_t owner, std::uintptr_t value)
-    noexcept -> std::size_t {
+auto basic_hazard::hazard_grant(std::uintptr_t owner, std::uintptr_t value,
+                                std::size_t limit) noexcept -> std::size_t {
   using namespace hazard_detail;
 
   std::size_t count = 0;
-  for (auto& h : hazards) {
-    if (mark(h, owner, value))
-      ++count;
-  }
+  for_each_slot(limit,
+                [&](hazard_t& h) {
+                  if (mark(h, owner, value)) ++count;
+                  return true;
+                });
   return count;
 }
 
@@ -105,10 +291,12 @@ auto basic_hazard::hazard_grant_n(std::uintptr_t owner, std::uintptr_t value,
   using namespace hazard_detail;
 
   std::size_t count = 0;
-  for (auto& h : hazards) {
-    if (count == nrefs) break;
-    if (mark(h, owner, value)) ++count;
-  }
+  if (nrefs == 0U) return count;
+  for_each_slot(hazard_count(),
+                [&](hazard_t& h) {
+                  if (mark(h, owner, value)) ++count;
+                  return count != nrefs;
+                });
   return count;
 }
 
@@ -116,12 +304,14 @@ auto basic_hazard::hazard_wait(std::uintptr_t owner, std::uintptr_t value)
     noexcept -> void {
   using namespace hazard_detail;
 
-  for (auto& h : hazards) {
-    while (((h.owner.load(std::memory_order_consume) & hazard_t::MASK) ==
-            owner) &&
-           h.value.load(std::memory_order_consume) == value)
-      std::this_thread::yield();
-  }
+  for_each_slot(hazard_count(),
+                [&](hazard_t& h) {
+                  while (((h.owner.load(std::memory_order_consume) &
+                           hazard_t::MASK) == owner) &&
+                         h.value.load(std::memory_order_consume) == value)
+                    std::this_thread::yield();
+                  return true;
+                });
 }
 
 
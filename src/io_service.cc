@@ -0,0 +1,368 @@
+/*
+ * Copyright (c) 2013 Ariane van der Steldt <ariane@stack.nl>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include <ilias/io_service.h>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <stdexcept>
+#include <system_error>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace ilias {
+namespace {
+
+
+/* Number of events dispatched per epoll_wait call. */
+constexpr unsigned int MAX_EVENTS = 64U;
+
+/* Translate io_service events to epoll events. */
+std::uint32_t
+to_epoll(unsigned int events) noexcept
+{
+	std::uint32_t rv = 0;
+	if (events & io_service::READ)
+		rv |= EPOLLIN | EPOLLRDHUP;
+	if (events & io_service::WRITE)
+		rv |= EPOLLOUT;
+	return rv;
+}
+
+/*
+ * Translate epoll events to io_service events.
+ * Errors and hangups make the fd ready for everything,
+ * so the operation that follows reports the error.
+ */
+unsigned int
+from_epoll(std::uint32_t events) noexcept
+{
+	unsigned int rv = 0;
+	if (events & (EPOLLERR | EPOLLHUP))
+		rv |= io_service::READ | io_service::WRITE;
+	if (events & (EPOLLIN | EPOLLPRI | EPOLLRDHUP))
+		rv |= io_service::READ;
+	if (events & EPOLLOUT)
+		rv |= io_service::WRITE;
+	return rv;
+}
+
+[[noreturn]] void
+throw_errno(const char* what)
+{
+	throw std::system_error(errno, std::system_category(), what);
+}
+
+
+} /* namespace ilias::<unnamed> */
+
+
+const unsigned int io_service::READ;
+const unsigned int io_service::WRITE;
+const unsigned int io_service::EVENT_MASK;
+
+io_service::io_service()
+:	m_epfd(-1),
+	m_wfd(-1),
+	m_evfd(-1)
+{
+	try {
+		if ((this->m_epfd = epoll_create1(EPOLL_CLOEXEC)) == -1)
+			throw_errno("io_service: epoll_create1");
+		if ((this->m_wfd = epoll_create1(EPOLL_CLOEXEC)) == -1)
+			throw_errno("io_service: epoll_create1");
+		if ((this->m_evfd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) ==
+		    -1)
+			throw_errno("io_service: eventfd");
+
+		/*
+		 * The blocking wait watches the set of fds and the eventfd,
+		 * so an interrupt cannot be consumed by a non-blocking poll.
+		 */
+		for (int fd : { this->m_epfd, this->m_evfd }) {
+			epoll_event ev{};
+			ev.events = EPOLLIN;
+			ev.data.fd = fd;
+			if (epoll_ctl(this->m_wfd, EPOLL_CTL_ADD, fd, &ev))
+				throw_errno("io_service: epoll_ctl");
+		}
+	} catch (...) {
+		for (int fd : { this->m_epfd, this->m_wfd, this->m_evfd }) {
+			if (fd != -1)
+				close(fd);
+		}
+		throw;
+	}
+}
+
+io_service::~io_service() noexcept
+{
+	/* Release a thread blocked in the wait and keep it from returning. */
+	this->m_stopping.store(true, std::memory_order_release);
+	this->interrupt();
+	atomic_exchange(&this->m_tp, nullptr);
+
+	close(this->m_evfd);
+	close(this->m_wfd);
+	close(this->m_epfd);
+}
+
+void
+io_service::attach(threadpool_client_ptr<threadpool_client> p)
+{
+	if (!p) {
+		throw std::invalid_argument("io_service: "
+		    "cannot assign null client implementation");
+	}
+
+	threadpool_client_ptr<threadpool_client> expect{ nullptr };
+	if (!atomic_compare_exchange_strong(&this->m_tp, &expect, p)) {
+		throw std::runtime_error("io_service: "
+		    "client already present");
+	}
+}
+
+void
+io_service::add_(int fd, unsigned int events, registration&& r)
+{
+	if (fd < 0)
+		throw std::invalid_argument("io_service: invalid fd");
+	if (events == 0 || (events & EVENT_MASK) != events)
+		throw std::invalid_argument("io_service: invalid events");
+
+	std::lock_guard<std::mutex> guard{ this->m_mtx };
+
+	/*
+	 * The generation tells registrations of the same fd apart,
+	 * so stale events of a removed registration are dropped.
+	 */
+	r.gen = ++this->m_gen;
+	r.events = events;
+	epoll_event ev{};
+	ev.events = to_epoll(events) | (r.prom ? EPOLLONESHOT : EPOLLET);
+	ev.data.u64 = (std::uint64_t(r.gen) << 32) |
+	    static_cast<std::uint32_t>(fd);
+
+	const auto ins = this->m_regs.emplace(fd, std::move(r));
+	if (!ins.second) {
+		throw std::system_error(EEXIST, std::generic_category(),
+		    "io_service: fd already watched");
+	}
+	if (epoll_ctl(this->m_epfd, EPOLL_CTL_ADD, fd, &ev)) {
+		const int e = errno;
+		this->m_regs.erase(ins.first);
+		throw std::system_error(e, std::system_category(),
+		    "io_service: epoll_ctl");
+	}
+}
+
+void
+io_service::add(int fd, unsigned int events, const workq_job_ptr& job)
+{
+	if (!job)
+		throw std::invalid_argument("io_service: null job");
+
+	registration r;
+	r.job = job;
+	this->add_(fd, events, std::move(r));
+}
+
+cb_future<unsigned int>
+io_service::wait(int fd, unsigned int events)
+{
+	registration r;
+	r.prom.reset(new cb_promise<unsigned int>());
+	auto f = r.prom->get_future();
+	this->add_(fd, events, std::move(r));
+	return f;
+}
+
+bool
+io_service::remove(int fd) noexcept
+{
+	/* Broken outside the lock: callbacks may use the io_service. */
+	std::unique_ptr<cb_promise<unsigned int>> prom;
+
+	std::lock_guard<std::mutex> guard{ this->m_mtx };
+	const auto i = this->m_regs.find(fd);
+	if (i == this->m_regs.end())
+		return false;
+	prom = std::move(i->second.prom);
+	this->m_regs.erase(i);
+	epoll_ctl(this->m_epfd, EPOLL_CTL_DEL, fd, nullptr);
+	return true;
+}
+
+/*
+ * Dispatch a readiness event.
+ *
+ * A one-shot wait is removed before its promise is completed,
+ * so the callback may watch the fd again.
+ * A job registration whose job is gone is removed.
+ */
+bool
+io_service::dispatch(std::uint64_t data, std::uint32_t events) noexcept
+{
+	const int fd = static_cast<int>(data & 0xffffffffU);
+	const auto gen = static_cast<std::uint32_t>(data >> 32);
+	std::unique_ptr<cb_promise<unsigned int>> prom;
+	workq_job_ptr job;
+	unsigned int ready;
+
+	{
+		std::lock_guard<std::mutex> guard{ this->m_mtx };
+		const auto i = this->m_regs.find(fd);
+		if (i == this->m_regs.end() || i->second.gen != gen)
+			return false;
+
+		ready = from_epoll(events) & i->second.events;
+		if (i->second.prom)
+			prom = std::move(i->second.prom);
+		else
+			job = i->second.job.lock();
+
+		if (!job) {
+			this->m_regs.erase(i);
+			epoll_ctl(this->m_epfd, EPOLL_CTL_DEL, fd, nullptr);
+		}
+	}
+
+	if (job)
+		job->activate();
+	else if (prom)
+		prom->set_value(ready);
+	else
+		return false;
+	return true;
+}
+
+/* Dispatch up to count ready events, without blocking. */
+unsigned int
+io_service::poll(unsigned int count) noexcept
+{
+	epoll_event ev[MAX_EVENTS];
+	unsigned int rv = 0;
+
+	while (count > 0) {
+		const int n = epoll_wait(this->m_epfd, ev,
+		    std::min(count, MAX_EVENTS), 0);
+		if (n <= 0)
+			break;
+
+		count -= n;
+		for (int i = 0; i < n; ++i) {
+			if (this->dispatch(ev[i].data.u64, ev[i].events))
+				++rv;
+		}
+		if (static_cast<unsigned int>(n) < MAX_EVENTS)
+			break;
+	}
+	return rv;
+}
+
+void
+io_service::interrupt() noexcept
+{
+	const std::uint64_t one = 1U;
+	while (write(this->m_evfd, &one, sizeof(one)) == -1 &&
+	    errno == EINTR);
+}
+
+bool
+io_service::aid(unsigned int count) noexcept
+{
+	return (this->poll(count) > 0U);
+}
+
+
+io_service::threadpool_client::~threadpool_client() noexcept
+{
+	/* Empty body. */
+}
+
+bool
+io_service::threadpool_client::do_work() noexcept
+{
+	threadpool_client_lock lck{ *this };
+	if (!this->has_client())
+		return false;
+	return (this->m_self.poll(MAX_EVENTS) > 0U);
+}
+
+bool
+io_service::threadpool_client::has_work() noexcept
+{
+	threadpool_client_lock lck{ *this };
+	if (!this->has_client())
+		return false;
+
+	pollfd pfd{ this->m_self.m_epfd, POLLIN, 0 };
+	return (::poll(&pfd, 1, 0) > 0);
+}
+
+/*
+ * Block until an fd is ready, the deadline passes or
+ * wait_interrupt() is called, then dispatch the ready events.
+ *
+ * The client lock is held while blocking:
+ * the io_service destructor interrupts the wait before detaching.
+ */
+bool
+io_service::threadpool_client::wait_work(
+    std::chrono::steady_clock::time_point tp) noexcept
+{
+	using std::chrono::steady_clock;
+
+	threadpool_client_lock lck{ *this };
+	if (!this->has_client() ||
+	    this->m_self.m_stopping.load(std::memory_order_acquire))
+		return false;
+
+	int timeout = -1;
+	if (tp != steady_clock::time_point::max()) {
+		const auto now = steady_clock::now();
+		const auto ms = (tp <= now ? 0 :
+		    std::chrono::duration_cast<std::chrono::milliseconds>(
+		      tp - now + std::chrono::milliseconds(1) -
+		      steady_clock::duration(1)).count());
+		timeout = static_cast<int>(std::min<decltype(ms)>(ms, INT_MAX));
+	}
+
+	epoll_event ev[2];
+	const int n = epoll_wait(this->m_self.m_wfd, ev, 2, timeout);
+	for (int i = 0; i < n; ++i) {
+		if (ev[i].data.fd == this->m_self.m_evfd) {
+			std::uint64_t v;
+			while (read(this->m_self.m_evfd, &v, sizeof(v)) == -1 &&
+			    errno == EINTR);
+		}
+	}
+
+	this->m_self.poll(MAX_EVENTS);
+	return true;
+}
+
+void
+io_service::threadpool_client::wait_interrupt() noexcept
+{
+	threadpool_client_lock lck{ *this };
+	if (this->has_client())
+		this->m_self.interrupt();
+}
+
+
+} /* namespace ilias */
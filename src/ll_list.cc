@@ -369,6 +369,15 @@ auto list::link_(elem& a, elem& x, elem& b) noexcept -> axb_link_result {
         pred_(b);
       }
     }
+
+    /*
+     * x may have been unlinked before b.pred was fixed,
+     * in which case the unlink could not move b.pred away from x
+     * and b.pred now holds on to an unlinked element.
+     */
+    atomic_thread_fence(memory_order_seq_cst);
+    if (get<1>(x.pred_.load_no_acquire(memory_order_acquire)) == MARKED)
+      pred_(b);
     return XLINK_OK;
   }
 
@@ -379,9 +388,11 @@ auto list::link_(elem& a, elem& x, elem& b) noexcept -> axb_link_result {
       error = XLINK_LOST_AB;
     else
       error = XLINK_LOST_A;
-  } else if (as_expect != make_tuple(&b, S_MARKED)) {
+  } else if (as_expect != make_tuple(&b, S_MARKED) &&
+             get<1>(b.pred_.load_no_acquire(memory_order_acquire)) !=
+             MARKED) {
     error = XLINK_RETRY;
-  } else /* if (get<1>(as_expect) == MARKED) */ {
+  } else /* if (get<1>(as_expect) == MARKED || b is unlinked) */ {
     auto ap = a.pred_.load_no_acquire(memory_order_relaxed);
     if (get<1>(ap) == MARKED)
       error = XLINK_LOST_AB;
@@ -764,17 +775,19 @@ auto list::unlink(elem& e, position* out, size_t expect) ->
     assert(lr == LINK_OK);
 
     ur = unlink_(&out->back_(), e, expect + 1U);
-    switch (ur) {
-    case UNLINK_OK:
-      return make_tuple(e_ptr, true);
-    case UNLINK_RETRY:
-      break;
-    case UNLINK_FAIL:
-      out->unlink();
-      return make_tuple(nullptr, false);
-    }
+    if (ur == UNLINK_OK) return make_tuple(e_ptr, true);
 
+    /*
+     * Release e before unlinking the iterators:
+     * a concurrent unlink of e keeps e.pred pointing at out->back_()
+     * until the link count of e drops,
+     * while unlinking out->back_() waits for that reference to go away.
+     * The caller holds a reference to e, keeping it valid.
+     */
+    e_ptr = nullptr;
     out->unlink();
+    if (ur == UNLINK_FAIL) return make_tuple(nullptr, false);
+    e_ptr = &e;
   }
   /* UNREACHABLE */
 }
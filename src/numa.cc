@@ -0,0 +1,267 @@
+/*
+ * Copyright (c) 2013 Ariane van der Steldt <ariane@stack.nl>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include <ilias/numa.h>
+#if !HAS_TLS
+#include "tls_fallback.h"
+#endif
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <thread>
+#if HAS_AFFINITY
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace ilias {
+namespace numa {
+namespace {
+
+
+#if HAS_AFFINITY
+/* From <numaif.h>, which is part of libnuma rather than the kernel. */
+constexpr int MPOL_PREFERRED_ = 1;
+#endif
+
+/*
+ * Parse a kernel cpu or node list, such as "0-3,8,10-11".
+ * Returns an empty list if the file can't be read.
+ */
+std::vector<unsigned int>
+read_list(const char* path)
+{
+	std::vector<unsigned int> rv;
+	std::ifstream in{ path };
+	std::string range;
+
+	while (std::getline(in, range, ',')) {
+		unsigned long lo, hi;
+		std::size_t pos;
+
+		try {
+			lo = hi = std::stoul(range, &pos);
+			if (pos < range.size() && range[pos] == '-')
+				hi = std::stoul(range.substr(pos + 1));
+		} catch (const std::logic_error&) {
+			break;
+		}
+		for (auto i = lo; i <= hi; ++i)
+			rv.push_back(static_cast<unsigned int>(i));
+	}
+	return rv;
+}
+
+struct topology
+{
+	/* Cpus the process may run on. */
+	std::vector<unsigned int> cpus;
+	/* Node of each cpu, indexed by cpu. */
+	std::vector<unsigned int> cpu_node;
+	/* Number of nodes. */
+	unsigned int nodes{ 1U };
+
+	topology()
+	{
+#if HAS_AFFINITY
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+			for (unsigned int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+				if (CPU_ISSET(cpu, &set))
+					this->cpus.push_back(cpu);
+			}
+		}
+#endif
+		if (this->cpus.empty()) {
+			const auto n = std::max(1U,
+			    std::thread::hardware_concurrency());
+			for (unsigned int cpu = 0; cpu < n; ++cpu)
+				this->cpus.push_back(cpu);
+		}
+		this->cpu_node.resize(this->cpus.back() + 1U, 0U);
+
+#if HAS_AFFINITY
+		const std::string base = "/sys/devices/system/node/node";
+		for (auto node : read_list("/sys/devices/system/node/online")) {
+			const auto cpulist = base + std::to_string(node) +
+			    "/cpulist";
+			for (auto cpu : read_list(cpulist.c_str())) {
+				if (cpu < this->cpu_node.size())
+					this->cpu_node[cpu] = node;
+			}
+			this->nodes = std::max(this->nodes, node + 1U);
+		}
+#endif
+	}
+
+	static const topology&
+	get() noexcept
+	{
+		static const topology impl;
+		return impl;
+	}
+};
+
+/*
+ * Node of the calling thread, if it is bound to a single node.
+ */
+unsigned int&
+bound_node() noexcept
+{
+#if HAS_TLS
+	static THREAD_LOCAL unsigned int impl = NO_NODE;
+	return impl;
+#else
+	struct wrapper
+	{
+		unsigned int node{ NO_NODE };
+	};
+	static tls<wrapper> impl;
+	return impl->node;
+#endif
+}
+
+
+} /* namespace ilias::numa::<unnamed> */
+
+
+const std::vector<unsigned int>&
+cpus() noexcept
+{
+	return topology::get().cpus;
+}
+
+unsigned int
+nodes() noexcept
+{
+	return topology::get().nodes;
+}
+
+std::vector<unsigned int>
+node_cpus(unsigned int node)
+{
+	std::vector<unsigned int> rv;
+	for (auto cpu : cpus()) {
+		if (cpu_node(cpu) == node)
+			rv.push_back(cpu);
+	}
+	return rv;
+}
+
+unsigned int
+cpu_node(unsigned int cpu) noexcept
+{
+	const auto& t = topology::get();
+	return (cpu < t.cpu_node.size() ? t.cpu_node[cpu] : 0U);
+}
+
+unsigned int
+current_node() noexcept
+{
+	const auto node = bound_node();
+	if (node != NO_NODE)
+		return node;
+	if (nodes() == 1U)
+		return 0U;
+
+#if HAS_AFFINITY
+	const int cpu = sched_getcpu();
+	if (cpu >= 0)
+		return cpu_node(static_cast<unsigned int>(cpu));
+#endif
+	return 0U;
+}
+
+bool
+bind_thread(const std::vector<unsigned int>& cpus) noexcept
+{
+	if (cpus.empty())
+		return false;
+
+#if HAS_AFFINITY
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (auto cpu : cpus) {
+		if (cpu >= CPU_SETSIZE)
+			return false;
+		CPU_SET(cpu, &set);
+	}
+	if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set))
+		return false;
+
+	/* Remember the node, so current_node() needn't look it up. */
+	const auto node = cpu_node(cpus.front());
+	const bool single = std::all_of(cpus.begin(), cpus.end(),
+	    [node](unsigned int cpu) {
+		return (cpu_node(cpu) == node);
+	    });
+	bound_node() = (single ? node : NO_NODE);
+	return true;
+#else
+	return false;
+#endif
+}
+
+void*
+alloc_onnode(std::size_t len, unsigned int node)
+    ILIAS_ASYNC_THROWS(std::bad_alloc)
+{
+#if HAS_AFFINITY
+	/* Built before the mapping exists, so bad_alloc leaks nothing. */
+	constexpr unsigned int BITS = CHAR_BIT * sizeof(unsigned long);
+	std::vector<unsigned long> mask;
+	if (nodes() > 1U && node < nodes()) {
+		mask.resize(node / BITS + 1U, 0UL);
+		mask[node / BITS] |= 1UL << (node % BITS);
+	}
+
+	void* p = mmap(nullptr, len, PROT_READ | PROT_WRITE,
+	    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (p == MAP_FAILED)
+		throw std::bad_alloc();
+
+	/*
+	 * The memory is placed on first touch:
+	 * set the policy before anything touches it.
+	 * Failure leaves the memory wherever the kernel puts it.
+	 */
+	if (!mask.empty()) {
+		syscall(SYS_mbind, p, len, MPOL_PREFERRED_, mask.data(),
+		    mask.size() * BITS + 1U, 0U);
+	}
+	return p;
+#else
+	return ::operator new(len);
+#endif
+}
+
+void
+free_onnode(void* p, std::size_t len) noexcept
+{
+#if HAS_AFFINITY
+	if (p)
+		munmap(p, len);
+#else
+	::operator delete(p);
+#endif
+}
+
+
+} /* namespace ilias::numa */
+} /* namespace ilias */
@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2015 Ariane van der Steldt <ariane@stack.nl>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include <ilias/parallel.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+
+namespace ilias {
+namespace parallel_detail {
+namespace {
+
+
+/*
+ * Co-runnable running a range of indices.
+ *
+ * Each participating thread claims chunks from the range, until the range
+ * is exhausted.  Chunks start large and shrink as the range is consumed,
+ * so threads finishing late have small chunks left to balance the load.
+ *
+ * The job keeps itself alive until the last participant releases it.
+ */
+class range_job
+: public workq_detail::co_runnable
+{
+ public:
+  range_job(workq_ptr wq, std::size_t n, std::size_t grain,
+            range_body body, range_done done)
+  : workq_detail::co_runnable(std::move(wq),
+                              workq_job::TYPE_ONCE |
+                              workq_job::TYPE_PARALLEL),
+    n_(n),
+    grain_(std::max(grain, std::size_t(1))),
+    width_(std::min<std::size_t>(
+        std::max(std::thread::hardware_concurrency(), 1U),
+        (n + grain_ - 1U) / grain_)),
+    body_(std::move(body)),
+    done_(std::move(done))
+  {}
+
+  ~range_job() noexcept override;
+
+  void start(std::shared_ptr<range_job>) noexcept;
+  void run() noexcept override;
+  bool co_run() noexcept override;
+
+ private:
+  bool claim_(std::size_t&, std::size_t&) noexcept;
+
+  const std::size_t n_;
+  const std::size_t grain_;
+  const std::size_t width_;
+  std::atomic<std::size_t> next_{ 0 };
+  std::atomic<std::size_t> completed_{ 0 };
+  std::atomic<bool> failed_{ false };
+  std::exception_ptr exc_;
+  const range_body body_;
+  const range_done done_;
+  std::shared_ptr<range_job> self_;
+};
+
+range_job::~range_job() noexcept {}
+
+/*
+ * Activate the job and help running it.
+ *
+ * The job is published from within the calling thread, after which the
+ * calling thread participates via aid().
+ */
+void range_job::start(std::shared_ptr<range_job> self) noexcept {
+  const workq_service_ptr wqs = get_workq_service();
+
+  self_ = std::move(self);
+  activate(workq_job::ACT_IMMED);
+  wqs->aid(1);
+}
+
+void range_job::run() noexcept {
+  co_publish(width_);
+}
+
+bool range_job::co_run() noexcept {
+  std::size_t count = 0;
+  std::size_t b, e;
+
+  while (claim_(b, e)) {
+    ++count;
+
+    /* Skip remaining chunks once a chunk failed. */
+    if (!failed_.load(std::memory_order_relaxed)) {
+      try {
+        body_(b, e);
+      } catch (...) {
+        if (!failed_.exchange(true, std::memory_order_relaxed))
+          exc_ = std::current_exception();
+      }
+    }
+
+    const std::size_t len = e - b;
+    if (completed_.fetch_add(len, std::memory_order_acq_rel) + len == n_)
+      done_(exc_);
+  }
+
+  if (release(count)) {
+    /*
+     * Last participant: drop the self reference.
+     * The job is destroyed once this thread unlocks it.
+     */
+    std::shared_ptr<range_job> self = std::move(self_);
+  }
+  return count > 0;
+}
+
+/*
+ * Claim the next chunk of the range.
+ *
+ * The chunk size is a fraction of the remaining range,
+ * but never smaller than the grain.
+ */
+bool range_job::claim_(std::size_t& b, std::size_t& e) noexcept {
+  b = next_.load(std::memory_order_relaxed);
+  do {
+    if (b >= n_) return false;
+    const std::size_t chunk =
+        std::max(grain_, (n_ - b) / (2U * width_));
+    e = b + std::min(chunk, n_ - b);
+  } while (!next_.compare_exchange_weak(b, e, std::memory_order_relaxed,
+                                        std::memory_order_relaxed));
+  return true;
+}
+
+
+} /* namespace ilias::parallel_detail::<unnamed> */
+
+
+void parallel_range(workq_service_ptr wqs, std::size_t n, std::size_t grain,
+                    range_body body, range_done done)
+    ILIAS_ASYNC_THROWS(std::bad_alloc) {
+  if (n == 0) {
+    done(nullptr);
+    return;
+  }
+
+  auto job = new_workq_job<range_job>(wqs->anon_workq(), n, grain,
+                                      std::move(body), std::move(done));
+  job->start(job);
+}
+
+
+}} /* namespace ilias::parallel_detail */
@@ -18,16 +18,45 @@
 #include "tls_fallback.h"
 #endif
 #include <ilias/ll_list.h>
+#include <ilias/numa.h>
 #include <ilias/refcnt.h>
 #include <ilias/workq.h>
 #include <ilias/util.h>
 #include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <iterator>
 #include <mutex>
+#include <stdexcept>
 #include <thread>
+#include <vector>
 
 namespace ilias {
+namespace {
+
+
+/* Pause the cpu for a moment, during spinning. */
+inline void
+cpu_pause() noexcept
+{
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+	/* MS-compiler x86/x86_64 assembly. */
+	__asm {
+		__asm pause
+	};
+#elif (defined(__GNUC__) || defined(__clang__)) &&			\
+    (defined(__amd64__) || defined(__x86_64__) ||			\
+     defined(__i386__) || defined(__ia64__))
+	/* GCC/clang assembly. */
+	__asm __volatile("pause":::"memory");
+#else
+	std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+}
+
+
+} /* namespace ilias::<unnamed> */
 
 
 struct idle_tag {};
@@ -37,7 +66,9 @@ enum class thread_state : unsigned char
 {
 	BUSY,
 	SLEEP_TEST,
+	SPIN,
 	SLEEP,
+	POLL,
 	DYING,
 	DEAD
 };
@@ -45,9 +76,16 @@ enum class thread_state : unsigned char
 class threadpool::impl
 {
 friend struct threadpool::impl_deleter;	/* Initiates destruction. */
+friend class threadpool::threadpool_service;	/* Shares the idle count. */
 
 public:
 	static const unsigned int COLLECT_INTERVAL = 0x10000;
+	/* Maximum number of pause instructions between polls. */
+	static const unsigned int SPIN_BACKOFF_MAX = 64;
+	/* Spin budgets below this are not worth spinning for. */
+	static constexpr std::chrono::nanoseconds SPIN_MIN{ 500 };
+	/* Slot of a worker that is not pinned. */
+	static const unsigned int NO_SLOT = UINT_MAX;
 
 private:
 	/* Worker thread. */
@@ -75,22 +113,78 @@ private:
 	std::atomic<unsigned int> n_threads{ 0 };
 	/* Number of threads exceeding pool size. */
 	std::atomic<unsigned int> n_oversize{ 0 };
+	/* Number of workers blocking without compensation. */
+	std::atomic<unsigned int> n_blocked{ 0 };
 
 	/* Idle threads. */
 	idle_type m_idle;
+	/*
+	 * Number of idle threads (the event count).
+	 * Shared with the service, which outlives the implementation.
+	 */
+	const std::shared_ptr<std::atomic<unsigned int>> m_idle_count{
+		std::make_shared<std::atomic<unsigned int>>(0U)
+	};
 	/* Dead threads. */
 	dead_type m_dead;
 
 	/* Counter for active threads. */
 	unsigned int n_active{ 0U };
 	/* Mutex protecting active counter. */
-	std::mutex m_active_mtx;
+	mutable std::mutex m_active_mtx;
 	/* Condition notifying n_active decrease. */
 	std::condition_variable m_active_cnd;
 
 	/* Service pointer. */
 	threadpool_service_ptr<threadpool_service> m_serv;
 
+	/*
+	 * Deadline of the worker that is sleeping on behalf of the timed
+	 * work of the service (time_point::max() if there is none).
+	 * Other idle workers sleep until woken up.
+	 */
+	std::atomic<std::chrono::steady_clock::rep> m_timed_sleep{
+		std::chrono::steady_clock::time_point::max().time_since_epoch().
+		    count()
+	};
+
+	/* Idle policy. */
+	std::atomic<std::chrono::nanoseconds::rep> m_max_spin{
+		idle_policy().max_spin.count()
+	};
+	std::atomic<unsigned int> m_max_spinners{ idle_policy().max_spinners };
+	std::atomic<bool> m_spin_yield{ idle_policy().yield };
+	/* Number of workers currently spinning. */
+	std::atomic<unsigned int> m_spinners{ 0U };
+	/* Set while a worker is blocked in the service, waiting for work. */
+	std::atomic<bool> m_poller{ false };
+
+	/* Autoscaling policy. */
+	std::atomic<bool> m_autoscale{ false };
+	std::atomic<unsigned int> m_min_threads{ 0U };
+	std::atomic<unsigned int> m_max_threads{ 0U };
+	std::atomic<std::chrono::nanoseconds::rep> m_grow_after{ 0 };
+	std::atomic<std::chrono::nanoseconds::rep> m_idle_timeout{ 0 };
+	/* Scaler thread, adding threads when work is starved. */
+	std::thread m_scaler;
+	/* Mutex protecting scaler thread. */
+	std::mutex m_scale_mtx;
+	/* Condition notifying scaler thread to stop. */
+	std::condition_variable m_scale_cnd;
+	/* Set to inform scaler thread to stop. */
+	bool m_scale_stop{ false };
+
+	/* Worker placement, with the cpus resolved. */
+	const placement_policy m_placement;
+	/*
+	 * Cpu sets that workers are pinned to (empty if workers aren't
+	 * pinned) and the number of workers pinned to each.
+	 */
+	std::vector<std::vector<unsigned int>> m_slots;
+	std::vector<unsigned int> m_slot_workers;
+	/* Mutex protecting slot worker counts. */
+	std::mutex m_slot_mtx;
+
 
 	/* Test if there is work available. */
 	bool
@@ -108,6 +202,200 @@ private:
 		return (serv && serv->do_work());
 	}
 
+	/* Point in time at which the service will have work. */
+	std::chrono::steady_clock::time_point
+	next_deadline() const noexcept
+	{
+		auto serv = atomic_load(&this->m_serv);
+		return (serv ? serv->next_deadline() :
+		    std::chrono::steady_clock::time_point::max());
+	}
+
+	/*
+	 * Block in the service until it has work, the deadline passes,
+	 * or interrupt_wait() is called.
+	 * Returns false if the service cannot block.
+	 */
+	bool
+	wait_work(std::chrono::steady_clock::time_point tp) const noexcept
+	{
+		auto serv = atomic_load(&this->m_serv);
+		return (serv && serv->wait_work(tp));
+	}
+
+	/* Make the worker blocked in wait_work() return. */
+	void
+	interrupt_wait() const noexcept
+	{
+		auto serv = atomic_load(&this->m_serv);
+		if (serv)
+			serv->wait_interrupt();
+	}
+
+	/*
+	 * Claim the poller role.
+	 * Only one worker at a time blocks in the service.
+	 */
+	bool
+	claim_poller() noexcept
+	{
+		return !this->m_poller.load(std::memory_order_relaxed) &&
+		    !this->m_poller.exchange(true, std::memory_order_acquire);
+	}
+
+	/* Release the poller role. */
+	void
+	release_poller() noexcept
+	{
+		this->m_poller.store(false, std::memory_order_release);
+	}
+
+	/*
+	 * Claim the timed sleep for the given deadline.
+	 * Succeeds if no other worker will wake up at or before the deadline.
+	 */
+	bool
+	claim_timed_sleep(std::chrono::steady_clock::time_point tp) noexcept
+	{
+		const auto d = tp.time_since_epoch().count();
+		auto cur = this->m_timed_sleep.load(std::memory_order_relaxed);
+		while (d < cur) {
+			if (this->m_timed_sleep.compare_exchange_weak(cur, d,
+			    std::memory_order_relaxed,
+			    std::memory_order_relaxed))
+				return true;
+		}
+		return false;
+	}
+
+	/*
+	 * Release the timed sleep claim.
+	 * Returns false if another worker took over the claim.
+	 */
+	bool
+	release_timed_sleep(std::chrono::steady_clock::time_point tp) noexcept
+	{
+		auto d = tp.time_since_epoch().count();
+		return this->m_timed_sleep.compare_exchange_strong(d,
+		    std::chrono::steady_clock::time_point::max().
+		      time_since_epoch().count(),
+		    std::memory_order_relaxed, std::memory_order_relaxed);
+	}
+
+	/* Maximum spin duration of idle workers. */
+	std::chrono::nanoseconds
+	max_spin() const noexcept
+	{
+		return std::chrono::nanoseconds(
+		    this->m_max_spin.load(std::memory_order_relaxed));
+	}
+
+	/*
+	 * Claim a spinner slot.
+	 * Fails if the maximum number of workers is already spinning.
+	 */
+	bool
+	claim_spinner() noexcept
+	{
+		const auto max = this->m_max_spinners.load(
+		    std::memory_order_relaxed);
+		auto cur = this->m_spinners.load(std::memory_order_relaxed);
+		while (cur < max) {
+			if (this->m_spinners.compare_exchange_weak(cur, cur + 1U,
+			    std::memory_order_relaxed,
+			    std::memory_order_relaxed))
+				return true;
+		}
+		return false;
+	}
+
+	/* Release a spinner slot. */
+	void
+	release_spinner() noexcept
+	{
+		const auto old = this->m_spinners.fetch_sub(1U,
+		    std::memory_order_relaxed);
+		assert(old > 0U);
+	}
+
+	/*
+	 * Idle duration after which a worker retires,
+	 * zero if workers don't retire.
+	 */
+	std::chrono::nanoseconds
+	idle_timeout() const noexcept
+	{
+		if (!this->m_autoscale.load(std::memory_order_relaxed))
+			return std::chrono::nanoseconds::zero();
+		return std::chrono::nanoseconds(
+		    this->m_idle_timeout.load(std::memory_order_relaxed));
+	}
+
+	/*
+	 * Retire an idle thread.
+	 *
+	 * Lowers the number of threads by one, unless this would go below
+	 * the autoscale minimum.
+	 */
+	bool
+	retire_idle() noexcept
+	{
+		const auto min = this->m_min_threads.load(
+		    std::memory_order_relaxed);
+		auto n = this->n_threads.load(std::memory_order_relaxed);
+		do {
+			if (!this->m_autoscale.load(std::memory_order_relaxed) ||
+			    n <= min)
+				return false;
+		} while (!this->n_threads.compare_exchange_weak(n, n - 1U,
+		    std::memory_order_relaxed, std::memory_order_relaxed));
+
+		this->increase_oversize(1U);
+		return true;
+	}
+
+	/* Scaler thread function. */
+	void scale() noexcept;
+
+	/* Validate placement and resolve the cpus it selects. */
+	static placement_policy resolve_placement(const placement_policy&);
+
+	/*
+	 * Pick the slot for a new worker:
+	 * the slot with the fewest workers, relative to its number of cpus.
+	 * Returns NO_SLOT if workers aren't pinned.
+	 */
+	unsigned int
+	claim_slot() noexcept
+	{
+		if (this->m_slots.empty())
+			return NO_SLOT;
+
+		std::lock_guard<std::mutex> guard{ this->m_slot_mtx };
+		unsigned int best = 0;
+		for (unsigned int i = 1; i < this->m_slots.size(); ++i) {
+			if (this->m_slot_workers[i] *
+			    this->m_slots[best].size() <
+			    this->m_slot_workers[best] *
+			    this->m_slots[i].size())
+				best = i;
+		}
+		++this->m_slot_workers[best];
+		return best;
+	}
+
+	/* Release the slot of a worker. */
+	void
+	release_slot(unsigned int slot) noexcept
+	{
+		if (slot == NO_SLOT)
+			return;
+
+		std::lock_guard<std::mutex> guard{ this->m_slot_mtx };
+		assert(this->m_slot_workers[slot] > 0U);
+		--this->m_slot_workers[slot];
+	}
+
 	/* Collect at most count dead worker threads. */
 	unsigned int collect(unsigned int = UINT_MAX) noexcept;
 
@@ -151,8 +439,101 @@ private:
 		this->wakeup(add);
 	}
 
+	/*
+	 * Run one more worker:
+	 * a worker that is about to retire stays,
+	 * otherwise a worker is created.
+	 * Returns false if no compensation took place.
+	 */
+	bool
+	compensate() noexcept
+	{
+		if (this->get_nthreads() == 0U)
+			return false;	/* Shutting down. */
+		if (this->reduce_oversize(1U))
+			return true;
+
+		try {
+			this->create_worker();
+		} catch (...) {
+			return false;
+		}
+		return true;
+	}
+
+	/* Test if the pool is saturated: no worker is spinning or idle. */
+	bool
+	saturated() const noexcept
+	{
+		return (this->m_spinners.load(std::memory_order_relaxed) == 0U &&
+		    !has_idle(*this->m_idle_count));
+	}
+
+	/*
+	 * Compensate for a worker entering a blocking section.
+	 * If a worker is spinning or idle, the pool is not saturated
+	 * and that worker picks up the slack instead:
+	 * compensation is deferred until the pool saturates.
+	 * Returns false if no compensation took place.
+	 */
+	bool
+	blocking_enter() noexcept
+	{
+		if (this->saturated() && this->compensate())
+			return true;
+
+		this->n_blocked.fetch_add(1U, std::memory_order_relaxed);
+		return false;
+	}
+
+	/*
+	 * End compensation for a worker leaving its blocking section.
+	 * The surplus worker retires through the oversize.
+	 *
+	 * Workers blocking without compensation are interchangeable:
+	 * if none is left uncompensated, a deferred compensation
+	 * took place on behalf of this worker.
+	 */
+	void
+	blocking_leave(bool compensated) noexcept
+	{
+		if (!compensated) {
+			auto n = this->n_blocked.load(std::memory_order_relaxed);
+			while (n > 0U) {
+				if (this->n_blocked.compare_exchange_weak(n,
+				    n - 1U,
+				    std::memory_order_relaxed,
+				    std::memory_order_relaxed))
+					return;
+			}
+		}
+		this->increase_oversize(1U);
+	}
+
+	/*
+	 * Perform deferred compensation, once a worker picks up work
+	 * while other workers are blocked without compensation
+	 * and no worker is left spinning or idle.
+	 */
+	void
+	compensate_blocked() noexcept
+	{
+		auto n = this->n_blocked.load(std::memory_order_relaxed);
+		if (n == 0U || !this->saturated())
+			return;
+
+		do {
+			if (n == 0U)
+				return;
+		} while (!this->n_blocked.compare_exchange_weak(n, n - 1U,
+		    std::memory_order_relaxed, std::memory_order_relaxed));
+
+		if (!this->compensate())
+			this->n_blocked.fetch_add(1U, std::memory_order_relaxed);
+	}
+
 public:
-	impl() = default;
+	explicit impl(const placement_policy&);
 	impl(const impl&) = delete;
 	impl& operator=(const impl&) = delete;
 	impl(impl&&) = delete;
@@ -166,6 +547,8 @@ private:
 	 */
 	~impl() noexcept
 	{
+		this->stop_autoscale();
+
 		/* Wait until all active threads have terminated. */
 		std::unique_lock<std::mutex> guard{ this->m_active_mtx };
 		while (this->n_active > 0) {
@@ -195,6 +578,20 @@ public:
 	 */
 	unsigned int wakeup(unsigned int) noexcept;
 
+	/*
+	 * Test if any worker is idle.
+	 *
+	 * Pairs with the fence in worker::do_sleep():
+	 * either the idle worker sees the work published prior to
+	 * this call, or this call sees the idle worker.
+	 */
+	static bool
+	has_idle(const std::atomic<unsigned int>& idle_count) noexcept
+	{
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		return (idle_count.load(std::memory_order_relaxed) > 0U);
+	}
+
 	/* Read number of worker threads. */
 	unsigned int
 	get_nthreads() const noexcept
@@ -202,6 +599,59 @@ public:
 		return this->n_threads.load(std::memory_order_acquire);
 	}
 
+	/* Number of threads started if none is specified. */
+	unsigned int
+	default_nthreads() const noexcept
+	{
+		if (this->m_placement.pin == placement_policy::PIN_NONE)
+			return std::max(1U, std::thread::hardware_concurrency());
+		return this->m_placement.cpus.size();
+	}
+
+	/* Read placement. */
+	const placement_policy&
+	get_placement() const noexcept
+	{
+		return this->m_placement;
+	}
+
+	/* Change idle policy. */
+	void
+	set_idle_policy(const idle_policy& p) noexcept
+	{
+		this->m_max_spin.store(std::max(p.max_spin,
+		    std::chrono::nanoseconds::zero()).count(),
+		    std::memory_order_relaxed);
+		this->m_max_spinners.store(p.max_spinners,
+		    std::memory_order_relaxed);
+		this->m_spin_yield.store(p.yield, std::memory_order_relaxed);
+	}
+
+	/* Enable autoscaling. */
+	void set_autoscale(const autoscale_policy&);
+	/* Disable autoscaling and wait for the scaler thread to stop. */
+	void stop_autoscale() noexcept;
+
+	/* Read number of live worker threads. */
+	unsigned int
+	get_current_nthreads() const noexcept
+	{
+		std::lock_guard<std::mutex> guard{ this->m_active_mtx };
+		return this->n_active;
+	}
+
+	/* Read idle policy. */
+	idle_policy
+	get_idle_policy() const noexcept
+	{
+		idle_policy p;
+		p.max_spin = this->max_spin();
+		p.max_spinners = this->m_max_spinners.load(
+		    std::memory_order_relaxed);
+		p.yield = this->m_spin_yield.load(std::memory_order_relaxed);
+		return p;
+	}
+
 	/* Attach service to threadpool. */
 	void
 	attach(threadpool_service_ptr<threadpool_service> p)
@@ -229,9 +679,10 @@ public:
 };
 
 
-class threadpool::impl::worker
+class threadpool::impl::worker final
 :	public ll_list_hook<idle_tag>,
-	public ll_list_hook<dead_tag>
+	public ll_list_hook<dead_tag>,
+	public blocking_section::handler
 {
 private:
 	std::atomic<thread_state> m_state{ thread_state::BUSY };
@@ -239,6 +690,23 @@ private:
 	std::condition_variable m_sleep_cnd;
 	impl& tp;
 	std::thread m_thread;
+	/* Placement slot of this worker, NO_SLOT if not pinned. */
+	const unsigned int m_slot;
+	/*
+	 * Spin duration, adapted to the observed time between running out
+	 * of work and new work arriving.
+	 * Only accessed by the worker thread.
+	 */
+	std::chrono::nanoseconds m_spin_budget{
+		std::chrono::nanoseconds::max()
+	};
+	/*
+	 * Blocking section nesting depth,
+	 * and whether the threadpool compensates for the outermost one.
+	 * Only accessed by the worker thread.
+	 */
+	unsigned int m_blocking{ 0U };
+	bool m_compensated{ false };
 
 public:
 	/* Initialization mutex, protects worker from starting too early. */
@@ -251,10 +719,33 @@ public:
 	bool
 	wakeup() noexcept
 	{
+		/* A spinning worker notices the state change by itself. */
+		if (transition(thread_state::SPIN, thread_state::BUSY,
+		    std::memory_order_acquire, std::memory_order_relaxed))
+			return true;
+
+		/* A polling worker is blocked in the service. */
+		if (transition(thread_state::POLL, thread_state::BUSY,
+		    std::memory_order_acquire, std::memory_order_relaxed)) {
+			this->tp.interrupt_wait();
+			return true;
+		}
+
+		/*
+		 * A worker in the sleep test takes the sleep mutex before
+		 * it commits to sleeping: it notices the state change.
+		 */
 		if (transition(thread_state::SLEEP_TEST, thread_state::BUSY,
-		      std::memory_order_acquire, std::memory_order_relaxed) ||
-		    transition(thread_state::SLEEP, thread_state::BUSY,
-		      std::memory_order_acquire, std::memory_order_relaxed)) {
+		    std::memory_order_acquire, std::memory_order_relaxed))
+			return true;
+
+		/*
+		 * A sleeping worker tests its state with the sleep mutex held.
+		 * Notify with the mutex held: once the mutex is released,
+		 * the worker may run off, retire and be destroyed.
+		 */
+		if (transition(thread_state::SLEEP, thread_state::BUSY,
+		    std::memory_order_acquire, std::memory_order_relaxed)) {
 			return do_locked(this->m_sleep_mtx, [&]() -> bool {
 				this->m_sleep_cnd.notify_one();
 				return true;
@@ -274,6 +765,9 @@ public:
 			do_locked(this->m_sleep_mtx, [&]() {
 				this->m_sleep_cnd.notify_one();
 			    });
+			return true;
+		case thread_state::POLL:
+			this->tp.interrupt_wait();
 			/* FALLTHROUGH */
 		default:
 			return true;
@@ -313,14 +807,50 @@ private:
 	 */
 	void do_sleep() noexcept;
 
+	/*
+	 * Spin, polling for work, prior to sleeping.
+	 *
+	 * The worker transitions from SLEEP_TEST to SPIN and
+	 * waits for a wakeup or for work to become available,
+	 * until its spin budget expires.
+	 * Returns false if the worker is to go to sleep,
+	 * in which case it is back in the SLEEP_TEST state.
+	 */
+	bool do_spin(std::chrono::steady_clock::time_point) noexcept;
+
+	/*
+	 * Block in the service, waiting for work.
+	 *
+	 * At most one worker polls at a time:
+	 * it transitions from SLEEP_TEST to POLL and blocks in the service
+	 * (for instance waiting for I/O), instead of on its condition
+	 * variable.  A wakeup interrupts the service wait.
+	 * Returns false if the worker is to go to sleep,
+	 * in which case it is back in the SLEEP_TEST state.
+	 */
+	bool do_poll() noexcept;
+
+	/*
+	 * Adapt the spin budget to the time it took for work to arrive.
+	 *
+	 * If work arrives within the maximum spin duration,
+	 * spinning a little longer than the gap would have caught it.
+	 * Otherwise spinning is wasted, so the budget decays.
+	 */
+	void adapt_spin(std::chrono::nanoseconds) noexcept;
+
 	/*
 	 * Test if this thread is to die.
 	 */
 	bool must_die() noexcept;
 
+	void blocking_enter() noexcept override;
+	void blocking_leave() noexcept override;
+
 public:
-	worker(threadpool::impl& tp)
-	:	tp(tp)
+	worker(threadpool::impl& tp, unsigned int slot)
+	:	tp(tp),
+		m_slot(slot)
 	{
 		/* Empty body. */
 	}
@@ -330,7 +860,9 @@ public:
 	assign_thread(std::thread&& t) noexcept
 	{
 		this->m_thread = std::move(t);
-		++this->tp.n_active;
+		do_locked(this->tp.m_active_mtx, [this]() {
+			++this->tp.n_active;
+		    });
 	}
 
 private:
@@ -360,6 +892,10 @@ public:
 };
 
 
+const unsigned int threadpool::impl::SPIN_BACKOFF_MAX;
+const unsigned int threadpool::impl::NO_SLOT;
+constexpr std::chrono::nanoseconds threadpool::impl::SPIN_MIN;
+
 threadpool::impl::tp_tls_data&
 threadpool::impl::get_tls() noexcept
 {
@@ -375,6 +911,10 @@ threadpool::impl::get_tls() noexcept
 unsigned int
 threadpool::impl::wakeup(unsigned int n) noexcept
 {
+	/* Nobody to wake up: don't touch the idle list. */
+	if (!has_idle(*this->m_idle_count))
+		return 0;
+
 	unsigned int c = 0;
 	while (c < n) {
 		auto i = this->m_idle.pop_front();
@@ -401,24 +941,99 @@ threadpool::impl::collect(unsigned int count) noexcept
 	return rv;
 }
 
+threadpool::placement_policy
+threadpool::impl::resolve_placement(const placement_policy& p)
+{
+	placement_policy rv;
+	rv.pin = p.pin;
+
+	switch (p.pin) {
+	case placement_policy::PIN_NONE:
+		return rv;
+	case placement_policy::PIN_CPUSET:
+	case placement_policy::PIN_CPU:
+	case placement_policy::PIN_NODE:
+		break;
+	default:
+		throw std::invalid_argument("threadpool: "
+		    "invalid placement");
+	}
+
+	const auto& avail = numa::cpus();
+	if (p.cpus.empty()) {
+		rv.cpus = avail;
+		return rv;
+	}
+
+	rv.cpus = p.cpus;
+	std::sort(rv.cpus.begin(), rv.cpus.end());
+	rv.cpus.erase(std::unique(rv.cpus.begin(), rv.cpus.end()),
+	    rv.cpus.end());
+	if (!std::includes(avail.begin(), avail.end(),
+	    rv.cpus.begin(), rv.cpus.end())) {
+		throw std::invalid_argument("threadpool: "
+		    "placement selects unavailable cpu");
+	}
+	return rv;
+}
+
+threadpool::impl::impl(const placement_policy& p)
+:	m_placement(resolve_placement(p))
+{
+	const auto& cpus = this->m_placement.cpus;
+
+	switch (this->m_placement.pin) {
+	case placement_policy::PIN_NONE:
+		break;
+	case placement_policy::PIN_CPUSET:
+		this->m_slots.push_back(cpus);
+		break;
+	case placement_policy::PIN_CPU:
+		for (auto cpu : cpus)
+			this->m_slots.push_back({ cpu });
+		break;
+	case placement_policy::PIN_NODE:
+		for (unsigned int node = 0; node < numa::nodes(); ++node) {
+			std::vector<unsigned int> node_cpus;
+			std::copy_if(cpus.begin(), cpus.end(),
+			    std::back_inserter(node_cpus),
+			    [node](unsigned int cpu) {
+				return (numa::cpu_node(cpu) == node);
+			    });
+			if (!node_cpus.empty())
+				this->m_slots.push_back(std::move(node_cpus));
+		}
+		break;
+	}
+	this->m_slot_workers.resize(this->m_slots.size(), 0U);
+}
+
 void
 threadpool::impl::create_worker()
 {
-	/* Create worker structure. */
-	std::unique_ptr<worker> w{ new worker{ *this } };
+	const auto slot = this->claim_slot();
 
-	/*
-	 * Start thread for the worker.
-	 * Block thread until the initialization (assigning
-	 * the thread variable) is complete.
-	 * This prevents the thread from being able to call delete until we are
-	 * finished with the worker structure and enables the worker to verify
-	 * initialization happened correctly.
-	 */
-	do_locked(w->m_init_mtx, [&]() {
-		w->assign_thread(std::thread{ &worker::run, w.get() });
-	    });
-	w.release();
+	try {
+		/* Create worker structure. */
+		std::unique_ptr<worker> w{ new worker{ *this, slot } };
+
+		/*
+		 * Start thread for the worker.
+		 * Block thread until the initialization (assigning
+		 * the thread variable) is complete.
+		 * This prevents the thread from being able to call delete
+		 * until we are finished with the worker structure and
+		 * enables the worker to verify initialization happened
+		 * correctly.
+		 */
+		do_locked(w->m_init_mtx, [&]() {
+			w->assign_thread(std::thread{ &worker::run, w.get() });
+		    });
+		w.release();
+	} catch (...) {
+		this->release_slot(slot);
+		throw;
+	}
 }
 
 void
@@ -494,6 +1109,7 @@ threadpool::impl::set_nthreads(unsigned int n)
 void
 threadpool::impl_deleter::operator()(impl* i) const noexcept
 {
+	i->stop_autoscale();
 	i->set_nthreads(0U);
 	atomic_store(&i->m_serv, nullptr);
 
@@ -508,6 +1124,105 @@ threadpool::impl_deleter::operator()(impl* i) const noexcept
 		delete i;
 }
 
+void
+threadpool::impl::set_autoscale(const autoscale_policy& p)
+{
+	if (p.max_threads == 0U || p.min_threads > p.max_threads) {
+		throw std::invalid_argument("threadpool: "
+		    "invalid autoscale thread bounds");
+	}
+
+	this->m_min_threads.store(p.min_threads, std::memory_order_relaxed);
+	this->m_max_threads.store(p.max_threads, std::memory_order_relaxed);
+	this->m_grow_after.store(std::max(p.grow_after,
+	    std::chrono::nanoseconds::zero()).count(),
+	    std::memory_order_relaxed);
+	this->m_idle_timeout.store(std::max(p.idle_timeout,
+	    std::chrono::nanoseconds::zero()).count(),
+	    std::memory_order_relaxed);
+	this->m_autoscale.store(true, std::memory_order_release);
+
+	/* Move the number of threads within bounds. */
+	const auto n = this->get_nthreads();
+	if (n < p.min_threads)
+		this->set_nthreads(p.min_threads);
+	else if (n > p.max_threads)
+		this->set_nthreads(p.max_threads);
+
+	std::lock_guard<std::mutex> guard{ this->m_scale_mtx };
+	if (!this->m_scaler.joinable())
+		this->m_scaler = std::thread{ &impl::scale, this };
+}
+
+void
+threadpool::impl::stop_autoscale() noexcept
+{
+	this->m_autoscale.store(false, std::memory_order_release);
+
+	std::unique_lock<std::mutex> guard{ this->m_scale_mtx };
+	if (!this->m_scaler.joinable())
+		return;
+	this->m_scale_stop = true;
+	this->m_scale_cnd.notify_all();
+	std::thread scaler = std::move(this->m_scaler);
+	guard.unlock();
+
+	scaler.join();
+	do_locked(this->m_scale_mtx, [this]() {
+		this->m_scale_stop = false;
+	    });
+}
+
+/*
+ * Scaler thread.
+ *
+ * Periodically checks if work is waiting while no worker is idle.
+ * If that situation persists for the grow_after duration,
+ * a thread is added to the pool.
+ */
+void
+threadpool::impl::scale() noexcept
+{
+	using std::chrono::steady_clock;
+
+	std::unique_lock<std::mutex> guard{ this->m_scale_mtx };
+	steady_clock::time_point starved = steady_clock::time_point::max();
+
+	while (!this->m_scale_stop) {
+		const auto grow_after = std::chrono::nanoseconds(
+		    this->m_grow_after.load(std::memory_order_relaxed));
+		this->m_scale_cnd.wait_for(guard, std::max(grow_after / 4,
+		    std::chrono::nanoseconds(std::chrono::microseconds(100))));
+		if (this->m_scale_stop)
+			break;
+
+		if (!this->m_idle.empty() || !this->has_work()) {
+			starved = steady_clock::time_point::max();
+			continue;
+		}
+
+		const auto now = steady_clock::now();
+		if (starved == steady_clock::time_point::max()) {
+			starved = now;
+			continue;
+		}
+		if (now - starved < grow_after)
+			continue;
+
+		starved = steady_clock::time_point::max();
+		const auto n = this->get_nthreads();
+		if (n < this->m_max_threads.load(std::memory_order_relaxed)) {
+			do_unlocked(guard, [this, n]() {
+				try {
+					this->set_nthreads(n + 1U);
+				} catch (...) {
+					/* Try again next time. */
+				}
+			    });
+		}
+	}
+}
+
 threadpool::threadpool()
 :	threadpool(std::max(1U, std::thread::hardware_concurrency()))
 {
@@ -515,7 +1230,19 @@ threadpool::threadpool()
 }
 
 threadpool::threadpool(unsigned int n_threads)
-:	m_impl(new impl())
+:	threadpool(n_threads, placement_policy())
+{
+	/* Empty body. */
+}
+
+threadpool::threadpool(const placement_policy& p)
+:	m_impl(new impl(p))
+{
+	this->m_impl->set_nthreads(this->m_impl->default_nthreads());
+}
+
+threadpool::threadpool(unsigned int n_threads, const placement_policy& p)
+:	m_impl(new impl(p))
 {
 	this->m_impl->set_nthreads(n_threads);
 }
@@ -532,15 +1259,56 @@ threadpool::set_nthreads(unsigned int n)
 		throw std::runtime_error("threadpool: "
 		    "no implementation present");
 	}
+	this->m_impl->stop_autoscale();
 	this->m_impl->set_nthreads(n);
 }
 
+void
+threadpool::set_autoscale(const autoscale_policy& p)
+{
+	if (!this->m_impl) {
+		throw std::runtime_error("threadpool: "
+		    "no implementation present");
+	}
+	this->m_impl->set_autoscale(p);
+}
+
+unsigned int
+threadpool::get_current_nthreads() const noexcept
+{
+	return (this->m_impl ? this->m_impl->get_current_nthreads() : 0U);
+}
+
 unsigned int
 threadpool::get_nthreads() const noexcept
 {
 	return (this->m_impl ? this->m_impl->get_nthreads() : 0U);
 }
 
+threadpool::placement_policy
+threadpool::get_placement() const
+{
+	return (this->m_impl ? this->m_impl->get_placement() :
+	    placement_policy());
+}
+
+void
+threadpool::set_idle_policy(const idle_policy& p)
+{
+	if (!this->m_impl) {
+		throw std::runtime_error("threadpool: "
+		    "no implementation present");
+	}
+	this->m_impl->set_idle_policy(p);
+}
+
+threadpool::idle_policy
+threadpool::get_idle_policy() const noexcept
+{
+	return (this->m_impl ? this->m_impl->get_idle_policy() :
+	    idle_policy());
+}
+
 bool
 threadpool::curthread_is_threadpool() const noexcept
 {
@@ -576,13 +1344,23 @@ threadpool::impl::worker::do_sleep() noexcept
 			 * less chance of all data to have been flushed
 			 * from the cpu caches.
 			 */
+			this->tp.m_idle_count->fetch_add(1U,
+			    std::memory_order_relaxed);
 			this->tp.m_idle.link_front(&this->self);
+
+			/*
+			 * Publish as idle before the sleep test:
+			 * pairs with the fence in impl::has_idle().
+			 */
+			std::atomic_thread_fence(std::memory_order_seq_cst);
 		}
 
 		~idle_set_guard() noexcept
 		{
 			this->tp.m_idle.erase(
 			    this->tp.m_idle.iterator_to(&this->self));
+			this->tp.m_idle_count->fetch_sub(1U,
+			    std::memory_order_relaxed);
 		}
 	};
 
@@ -603,19 +1381,190 @@ threadpool::impl::worker::do_sleep() noexcept
 		return;
 	}
 
+	/* Spin for a while, before committing to sleep. */
+	const auto idle_start = std::chrono::steady_clock::now();
+	if (this->do_spin(idle_start)) {
+		if (this->m_state.load(std::memory_order_relaxed) ==
+		    thread_state::BUSY) {
+			this->adapt_spin(std::chrono::steady_clock::now() -
+			    idle_start);
+		}
+		return;
+	}
+
+	/* Block in the service, if it is able to. */
+	if (this->do_poll())
+		return;
+
+	/*
+	 * If the service has timed work, one worker sleeps until its
+	 * deadline, the others sleep until woken up.
+	 */
+	const auto deadline = this->tp.next_deadline();
+	const bool timed = (deadline !=
+	    std::chrono::steady_clock::time_point::max() &&
+	    this->tp.claim_timed_sleep(deadline));
+	bool timed_out = false;
+
+	/* Autoscaling: retire after sleeping for too long. */
+	const auto idle_timeout = this->tp.idle_timeout();
+
 	/* Prevent missing of wakeup calls. */
 	std::unique_lock<std::mutex> guard{ this->m_sleep_mtx };
 	/* Transition to SLEEP. */
-	if (!this->transition(thread_state::SLEEP_TEST,
+	if (this->transition(thread_state::SLEEP_TEST,
 	    thread_state::SLEEP,
-	    std::memory_order_acq_rel, std::memory_order_relaxed))
-		return;
-	/* Wait until state changes to non-sleep. */
-	do {
-		if (!this->must_die())
-			this->m_sleep_cnd.wait(guard);
-	} while (this->m_state.load(std::memory_order_relaxed) ==
-	    thread_state::SLEEP);
+	    std::memory_order_acq_rel, std::memory_order_relaxed)) {
+		/* Wait until state changes to non-sleep. */
+		do {
+			if (this->must_die())
+				continue;
+			if (!timed && idle_timeout ==
+			    std::chrono::nanoseconds::zero()) {
+				this->m_sleep_cnd.wait(guard);
+			} else if (!timed) {
+				/*
+				 * Retiring increases oversize, which wakes up
+				 * idle workers: can't hold the sleep mutex.
+				 * The next must_die() test picks up
+				 * the oversize.
+				 */
+				if (this->m_sleep_cnd.wait_for(guard,
+				    idle_timeout) == std::cv_status::timeout) {
+					do_unlocked(guard, [this]() {
+						this->tp.retire_idle();
+					    });
+				}
+			} else if (this->m_sleep_cnd.wait_until(guard,
+			    deadline) == std::cv_status::timeout) {
+				/* Deadline passed: go process timed work. */
+				timed_out = this->transition(
+				    thread_state::SLEEP, thread_state::BUSY,
+				    std::memory_order_acquire,
+				    std::memory_order_relaxed);
+			}
+		} while (this->m_state.load(std::memory_order_relaxed) ==
+		    thread_state::SLEEP);
+	}
+	guard.unlock();
+
+	/* Learn from the time it took for a wakeup to arrive. */
+	if (!timed_out && this->m_state.load(std::memory_order_relaxed) ==
+	    thread_state::BUSY)
+		this->adapt_spin(std::chrono::steady_clock::now() - idle_start);
+
+	/*
+	 * If woken up for a different reason than the deadline,
+	 * hand the timed sleep over to another idle worker.
+	 */
+	if (timed && this->tp.release_timed_sleep(deadline) && !timed_out)
+		this->tp.wakeup(1);
+}
+
+bool
+threadpool::impl::worker::do_spin(std::chrono::steady_clock::time_point start)
+    noexcept
+{
+	const auto budget = std::min(this->m_spin_budget, this->tp.max_spin());
+	if (budget < SPIN_MIN || !this->tp.claim_spinner())
+		return false;
+
+	/* Transition from SLEEP_TEST to SPIN. */
+	if (!this->transition(thread_state::SLEEP_TEST, thread_state::SPIN,
+	    std::memory_order_acquire, std::memory_order_relaxed)) {
+		/* Woken up or killed in the mean time. */
+		this->tp.release_spinner();
+		return true;
+	}
+
+	const auto spin_end = start + budget;
+	const auto yield_at = start + budget / 2;
+	const bool yield = this->tp.m_spin_yield.load(
+	    std::memory_order_relaxed);
+	unsigned int backoff = 1U;
+	bool rv = true;
+
+	for (;;) {
+		/* Woken up or killed. */
+		if (this->m_state.load(std::memory_order_acquire) !=
+		    thread_state::SPIN)
+			break;
+
+		if (this->tp.has_work()) {
+			this->transition(thread_state::SPIN, thread_state::BUSY,
+			    std::memory_order_acquire,
+			    std::memory_order_relaxed);
+			break;
+		}
+
+		const auto now = std::chrono::steady_clock::now();
+		if (now >= spin_end) {
+			/* Spin expired: prepare for sleep. */
+			rv = !this->transition(thread_state::SPIN,
+			    thread_state::SLEEP_TEST,
+			    std::memory_order_acquire,
+			    std::memory_order_relaxed);
+			break;
+		}
+
+		if (yield && now >= yield_at) {
+			std::this_thread::yield();
+		} else {
+			for (unsigned int i = 0; i < backoff; ++i)
+				cpu_pause();
+			backoff = std::min(2U * backoff, SPIN_BACKOFF_MAX);
+		}
+	}
+
+	this->tp.release_spinner();
+	return rv;
+}
+
+bool
+threadpool::impl::worker::do_poll() noexcept
+{
+	if (!this->tp.claim_poller())
+		return false;
+
+	/* Transition from SLEEP_TEST to POLL. */
+	if (!this->transition(thread_state::SLEEP_TEST, thread_state::POLL,
+	    std::memory_order_acquire, std::memory_order_relaxed)) {
+		/* Woken up or killed in the mean time. */
+		this->tp.release_poller();
+		return true;
+	}
+
+	/* The service wakes up for timed work as well. */
+	const bool rv = this->tp.wait_work(this->tp.next_deadline());
+	this->tp.release_poller();
+
+	/*
+	 * If the service could not block, go to sleep instead,
+	 * unless woken up or killed in the mean time.
+	 */
+	if (!rv) {
+		return !this->transition(thread_state::POLL,
+		    thread_state::SLEEP_TEST,
+		    std::memory_order_acquire, std::memory_order_relaxed);
+	}
+
+	this->transition(thread_state::POLL, thread_state::BUSY,
+	    std::memory_order_acquire, std::memory_order_relaxed);
+	return true;
+}
+
+void
+threadpool::impl::worker::adapt_spin(std::chrono::nanoseconds gap) noexcept
+{
+	const auto max_spin = this->tp.max_spin();
+
+	if (gap <= max_spin) {
+		this->m_spin_budget = std::min(max_spin, 2 * gap + SPIN_MIN);
+	} else {
+		this->m_spin_budget = std::min(this->m_spin_budget, max_spin) / 2;
+		if (this->m_spin_budget < SPIN_MIN)
+			this->m_spin_budget = std::chrono::nanoseconds::zero();
+	}
 }
 
 bool
@@ -625,6 +1574,7 @@ threadpool::impl::worker::must_die() noexcept
 	case thread_state::BUSY:
 	case thread_state::SLEEP:
 	case thread_state::SLEEP_TEST:
+	case thread_state::SPIN:
 		break;
 	default:
 		return true;
@@ -639,6 +1589,10 @@ threadpool::impl::worker::must_die() noexcept
 		      thread_state::DYING,
 		      std::memory_order_release,
 		      std::memory_order_relaxed) ||
+		    this->transition(thread_state::SPIN,
+		      thread_state::DYING,
+		      std::memory_order_release,
+		      std::memory_order_relaxed) ||
 		    this->transition(thread_state::SLEEP,
 		      thread_state::DYING,
 		      std::memory_order_release,
@@ -651,9 +1605,42 @@ threadpool::impl::worker::must_die() noexcept
 	return false;
 }
 
+void
+threadpool::impl::worker::blocking_enter() noexcept
+{
+	if (this->m_blocking++ == 0U)
+		this->m_compensated = this->tp.blocking_enter();
+}
+
+void
+threadpool::impl::worker::blocking_leave() noexcept
+{
+	assert(this->m_blocking > 0U);
+	if (--this->m_blocking == 0U) {
+		this->tp.blocking_leave(this->m_compensated);
+		this->m_compensated = false;
+	}
+}
+
+threadpool::threadpool_service::threadpool_service(threadpool& tp) noexcept
+:	m_self(*tp.m_impl),
+	m_idle(tp.m_impl->m_idle_count)
+{
+	/* Empty body. */
+}
+
+/*
+ * Wakeup n idle workers.
+ *
+ * If no worker is idle, the work is picked up by a busy worker,
+ * before it goes idle: skip locking the service.
+ */
 unsigned int
 threadpool::threadpool_service::wakeup(unsigned int n) noexcept
 {
+	if (n == 0 || !impl::has_idle(*this->m_idle))
+		return 0;
+
 	threadpool_service_lock lck{ *this };
 	if (!this->has_service() || n == 0)
 		return 0;
@@ -677,6 +1664,11 @@ threadpool::impl::worker::_run() noexcept
 	tls.tp = &this->tp;
 	tls.w = this;
 	tls.collect = false;
+	blocking_section::set_handler(this);
+
+	/* Failure to pin leaves the worker running unpinned. */
+	if (this->m_slot != NO_SLOT)
+		numa::bind_thread(this->tp.m_slots[this->m_slot]);
 
 	/* Collection of dead threads is done every interval. */
 	unsigned int interval = 0;
@@ -689,6 +1681,8 @@ threadpool::impl::worker::_run() noexcept
 			interval = (this->tp.collect() == 0 ?
 			    0U : COLLECT_INTERVAL);
 			this->do_sleep();
+			/* Leaving idle may saturate the pool. */
+			this->tp.compensate_blocked();
 		}
 
 		/*
@@ -713,6 +1707,9 @@ threadpool::impl::worker::_run() noexcept
 	 * will not be published).
 	 */
 
+	blocking_section::set_handler(nullptr);
+	this->tp.release_slot(this->m_slot);
+
 	/* Mark as dead. */
 	this->m_state.store(thread_state::DEAD);
 	/*
@@ -14,7 +14,11 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 #include <ilias/threadpool_intf.h>
+#if !HAS_TLS
+#include "tls_fallback.h"
+#endif
 #include <ilias/util.h>
+#include <algorithm>
 #include <stdexcept>
 
 
@@ -134,7 +138,7 @@ refcount::_has_service() const noexcept
 bool
 refcount::_has_client() const noexcept
 {
-	return (this->m_service_refcnt.load(std::memory_order_relaxed) > 0U);
+	return (this->m_client_refcnt.load(std::memory_order_relaxed) > 0U);
 }
 
 threadpool_intf_refcnt::~threadpool_intf_refcnt() noexcept
@@ -158,6 +162,27 @@ threadpool_service_intf::on_client_detach() noexcept
 	/* Default implementation: do nothing. */
 }
 
+std::chrono::steady_clock::time_point
+threadpool_service_intf::next_deadline() noexcept
+{
+	/* Default implementation: no timed work. */
+	return std::chrono::steady_clock::time_point::max();
+}
+
+bool
+threadpool_service_intf::wait_work(std::chrono::steady_clock::time_point)
+    noexcept
+{
+	/* Default implementation: cannot block. */
+	return false;
+}
+
+void
+threadpool_service_intf::wait_interrupt() noexcept
+{
+	/* Default implementation: do nothing. */
+}
+
 threadpool_client_intf::~threadpool_client_intf() noexcept
 {
 	/* Empty body. */
@@ -269,6 +294,25 @@ tp_service_multiplexer::threadpool_service::invoke_test() noexcept
 	return rv;
 }
 
+std::chrono::steady_clock::time_point
+tp_service_multiplexer::threadpool_service::invoke_deadline() noexcept
+{
+	if (this->m_work_avail.load(std::memory_order_relaxed) ==
+	    work_avail::DETACHED)
+		return std::chrono::steady_clock::time_point::max();
+	return this->next_deadline();
+}
+
+bool
+tp_service_multiplexer::threadpool_service::invoke_wait(
+    std::chrono::steady_clock::time_point tp) noexcept
+{
+	if (this->m_work_avail.load(std::memory_order_relaxed) ==
+	    work_avail::DETACHED)
+		return false;
+	return this->wait_work(tp);
+}
+
 unsigned int
 tp_service_multiplexer::threadpool_service::wakeup(unsigned int n) noexcept
 {
@@ -281,7 +325,7 @@ tp_service_multiplexer::threadpool_service::wakeup(unsigned int n) noexcept
 		return 0;
 
 	auto c = work_avail::MAYBE;
-	while (this->m_work_avail.compare_exchange_weak(c, work_avail::YES,
+	while (!this->m_work_avail.compare_exchange_weak(c, work_avail::YES,
 	    std::memory_order_acquire, std::memory_order_relaxed) &&
 	    c != work_avail::YES) {
 		if (c == work_avail::DETACHED)
@@ -337,6 +381,41 @@ tp_service_multiplexer::threadpool_client::has_work() noexcept
 	return !this->m_self.m_active.empty();
 }
 
+std::chrono::steady_clock::time_point
+tp_service_multiplexer::threadpool_client::next_deadline() noexcept
+{
+	threadpool_client_lock lck{ *this };
+	auto rv = std::chrono::steady_clock::time_point::max();
+	for (auto& s : this->m_self.m_data)
+		rv = std::min(rv, s.invoke_deadline());
+	return rv;
+}
+
+/*
+ * Block in the first client that is able to.
+ * Clients that wait for work are expected to be rare,
+ * so no attempt is made to block in more than one of them.
+ */
+bool
+tp_service_multiplexer::threadpool_client::wait_work(
+    std::chrono::steady_clock::time_point tp) noexcept
+{
+	threadpool_client_lock lck{ *this };
+	for (auto& s : this->m_self.m_data) {
+		if (s.invoke_wait(tp))
+			return true;
+	}
+	return false;
+}
+
+void
+tp_service_multiplexer::threadpool_client::wait_interrupt() noexcept
+{
+	threadpool_client_lock lck{ *this };
+	for (auto& s : this->m_self.m_data)
+		s.wait_interrupt();
+}
+
 tp_service_multiplexer::threadpool_client::~threadpool_client() noexcept
 {
 	/* Empty body. */
@@ -377,6 +456,9 @@ tp_service_multiplexer::attach(threadpool_client_ptr<threadpool_client> p)
 void
 tp_service_multiplexer::clear() noexcept
 {
+	/* Don't leave a thread blocked in a client that is going away. */
+	for (auto& s : this->m_data)
+		s.wait_interrupt();
 	this->m_data.clear();
 }
 
@@ -412,6 +494,42 @@ tp_client_multiplexer::threadpool_client::has_work() noexcept
 	return impl && impl->has_work();
 }
 
+std::chrono::steady_clock::time_point
+tp_client_multiplexer::threadpool_client::next_deadline() noexcept
+{
+	threadpool_client_lock lck{ *this };
+	if (!this->has_client())
+		return std::chrono::steady_clock::time_point::max();
+
+	auto impl = atomic_load(&this->m_client.m_impl);
+	return (impl ? impl->next_deadline() :
+	    std::chrono::steady_clock::time_point::max());
+}
+
+bool
+tp_client_multiplexer::threadpool_client::wait_work(
+    std::chrono::steady_clock::time_point tp) noexcept
+{
+	threadpool_client_lock lck{ *this };
+	if (!this->has_client())
+		return false;
+
+	auto impl = atomic_load(&this->m_client.m_impl);
+	return impl && impl->wait_work(tp);
+}
+
+void
+tp_client_multiplexer::threadpool_client::wait_interrupt() noexcept
+{
+	threadpool_client_lock lck{ *this };
+	if (!this->has_client())
+		return;
+
+	auto impl = atomic_load(&this->m_client.m_impl);
+	if (impl)
+		impl->wait_interrupt();
+}
+
 tp_client_multiplexer::threadpool_service::~threadpool_service() noexcept
 {
 	/* Empty body. */
@@ -535,6 +653,49 @@ tp_aid_service::do_work() noexcept
 }
 
 
+namespace {
+
+/* Blocking section handler of the current thread. */
+blocking_section::handler*&
+blocking_handler() noexcept
+{
+#if HAS_TLS
+	static THREAD_LOCAL blocking_section::handler* impl = nullptr;
+	return impl;
+#else
+	static tls<blocking_section::handler*> impl;
+	return *impl;
+#endif
+}
+
+} /* namespace ilias::<unnamed> */
+
+blocking_section::handler::~handler() noexcept
+{
+	/* Empty body. */
+}
+
+blocking_section::handler*
+blocking_section::set_handler(handler* h) noexcept
+{
+	auto& cur = blocking_handler();
+	std::swap(cur, h);
+	return h;
+}
+
+blocking_section::blocking_section(bool active) noexcept
+:	m_handler(active ? blocking_handler() : nullptr)
+{
+	if (this->m_handler)
+		this->m_handler->blocking_enter();
+}
+
+blocking_section::~blocking_section() noexcept
+{
+	if (this->m_handler)
+		this->m_handler->blocking_leave();
+}
+
 template void threadpool_attach<tp_client_multiplexer, tp_service_multiplexer>(
     tp_client_multiplexer&, tp_service_multiplexer&);
 template void threadpool_attach<tp_client_multiplexer, tp_aid_service>(
@@ -0,0 +1,716 @@
+/*
+ * Copyright (c) 2013 Ariane van der Steldt <ariane@stack.nl>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include <ilias/uring_service.h>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace ilias {
+namespace {
+
+
+/* Number of completions dispatched per batch. */
+constexpr unsigned int MAX_EVENTS = 64U;
+
+/* User data of cancel entries, never the address of an operation. */
+constexpr std::uint64_t CANCEL_TAG = ~std::uint64_t(0);
+
+/* The io_uring system calls; glibc provides no wrappers. */
+int
+sys_io_uring_setup(unsigned int entries, io_uring_params* p) noexcept
+{
+	return static_cast<int>(syscall(__NR_io_uring_setup, entries, p));
+}
+
+int
+sys_io_uring_enter(int fd, unsigned int to_submit, unsigned int min_complete,
+    unsigned int flags, const void* arg = nullptr, std::size_t argsz = 0)
+    noexcept
+{
+	return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit,
+	    min_complete, flags, arg, argsz));
+}
+
+int
+sys_io_uring_register(int fd, unsigned int opcode, const void* arg,
+    unsigned int nr_args) noexcept
+{
+	return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode,
+	    arg, nr_args));
+}
+
+[[noreturn]] void
+throw_errno(int e, const char* what)
+{
+	throw std::system_error(e, std::system_category(), what);
+}
+
+
+} /* namespace ilias::<unnamed> */
+
+
+struct uring_service::op
+{
+	/* Links on uring_service::m_ops. */
+	op* prev{ nullptr };
+	op* next{ nullptr };
+
+	virtual ~op() noexcept = default;
+	virtual void complete(int) noexcept = 0;
+
+	void
+	link(op*& head) noexcept
+	{
+		this->next = head;
+		if (head)
+			head->prev = this;
+		head = this;
+	}
+
+	void
+	unlink(op*& head) noexcept
+	{
+		(this->prev ? this->prev->next : head) = this->next;
+		if (this->next)
+			this->next->prev = this->prev;
+	}
+};
+
+template<typename T>
+struct uring_service::op_prom final
+:	uring_service::op
+{
+	cb_promise<T> prom;
+
+	void
+	complete(int res) noexcept override
+	{
+		if (res < 0) {
+			this->prom.set_exception(std::make_exception_ptr(
+			    std::system_error(-res, std::system_category(),
+			      "uring_service")));
+		} else
+			this->prom.set_value(static_cast<T>(res));
+	}
+};
+
+/*
+ * Memory mapped rings, shared with the kernel.
+ * The indices written by the kernel are accessed atomically.
+ */
+struct uring_service::ring
+{
+	void* sq_ptr{ MAP_FAILED };
+	std::size_t sq_sz{ 0U };
+	void* cq_ptr{ MAP_FAILED };
+	std::size_t cq_sz{ 0U };
+	io_uring_sqe* sqes{ static_cast<io_uring_sqe*>(MAP_FAILED) };
+	std::size_t sqes_sz{ 0U };
+
+	unsigned int* sq_head;
+	unsigned int* sq_tail;
+	unsigned int sq_mask;
+	unsigned int sq_entries;
+	unsigned int* sq_array;
+	unsigned int* cq_head;
+	unsigned int* cq_tail;
+	unsigned int cq_mask;
+	io_uring_cqe* cqes;
+
+	/* Kernel supports timed waits. */
+	bool ext_arg;
+
+	ring(int, const io_uring_params&);
+	~ring() noexcept;
+
+	/*
+	 * Next free submission queue entry, cleared.
+	 * Returns null if the submission queue is full.
+	 */
+	io_uring_sqe*
+	get_sqe() noexcept
+	{
+		const auto tail = *this->sq_tail;
+		if (tail - __atomic_load_n(this->sq_head, __ATOMIC_ACQUIRE) ==
+		    this->sq_entries)
+			return nullptr;
+
+		auto sqe = &this->sqes[tail & this->sq_mask];
+		std::memset(sqe, 0, sizeof(*sqe));
+		return sqe;
+	}
+
+	/* Publish the entry returned by get_sqe(). */
+	void
+	commit_sqe() noexcept
+	{
+		const auto tail = *this->sq_tail;
+		this->sq_array[tail & this->sq_mask] = tail & this->sq_mask;
+		__atomic_store_n(this->sq_tail, tail + 1U, __ATOMIC_RELEASE);
+	}
+
+	/* Number of entries not yet consumed by the kernel. */
+	unsigned int
+	sq_pending() const noexcept
+	{
+		return *this->sq_tail -
+		    __atomic_load_n(this->sq_head, __ATOMIC_ACQUIRE);
+	}
+
+	bool
+	cq_empty() const noexcept
+	{
+		return __atomic_load_n(this->cq_head, __ATOMIC_RELAXED) ==
+		    __atomic_load_n(this->cq_tail, __ATOMIC_ACQUIRE);
+	}
+};
+
+uring_service::ring::ring(int fd, const io_uring_params& p)
+{
+	this->sq_sz = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+	this->cq_sz = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP)
+		this->sq_sz = this->cq_sz = std::max(this->sq_sz, this->cq_sz);
+
+	this->sq_ptr = mmap(nullptr, this->sq_sz, PROT_READ | PROT_WRITE,
+	    MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	if (this->sq_ptr == MAP_FAILED)
+		throw_errno(errno, "uring_service: mmap");
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		this->cq_ptr = this->sq_ptr;
+	} else {
+		this->cq_ptr = mmap(nullptr, this->cq_sz,
+		    PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+		    fd, IORING_OFF_CQ_RING);
+		if (this->cq_ptr == MAP_FAILED)
+			throw_errno(errno, "uring_service: mmap");
+	}
+
+	this->sqes_sz = p.sq_entries * sizeof(io_uring_sqe);
+	this->sqes = static_cast<io_uring_sqe*>(mmap(nullptr, this->sqes_sz,
+	    PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+	    fd, IORING_OFF_SQES));
+	if (this->sqes == MAP_FAILED)
+		throw_errno(errno, "uring_service: mmap");
+
+	const auto sq = static_cast<char*>(this->sq_ptr);
+	const auto cq = static_cast<char*>(this->cq_ptr);
+	this->sq_head = reinterpret_cast<unsigned int*>(sq + p.sq_off.head);
+	this->sq_tail = reinterpret_cast<unsigned int*>(sq + p.sq_off.tail);
+	this->sq_mask =
+	    *reinterpret_cast<unsigned int*>(sq + p.sq_off.ring_mask);
+	this->sq_entries =
+	    *reinterpret_cast<unsigned int*>(sq + p.sq_off.ring_entries);
+	this->sq_array = reinterpret_cast<unsigned int*>(sq + p.sq_off.array);
+	this->cq_head = reinterpret_cast<unsigned int*>(cq + p.cq_off.head);
+	this->cq_tail = reinterpret_cast<unsigned int*>(cq + p.cq_off.tail);
+	this->cq_mask =
+	    *reinterpret_cast<unsigned int*>(cq + p.cq_off.ring_mask);
+	this->cqes = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+
+	this->ext_arg = (p.features & IORING_FEAT_EXT_ARG);
+}
+
+uring_service::ring::~ring() noexcept
+{
+	if (this->sqes != MAP_FAILED)
+		munmap(this->sqes, this->sqes_sz);
+	if (this->cq_ptr != MAP_FAILED && this->cq_ptr != this->sq_ptr)
+		munmap(this->cq_ptr, this->cq_sz);
+	if (this->sq_ptr != MAP_FAILED)
+		munmap(this->sq_ptr, this->sq_sz);
+}
+
+
+const std::uint64_t uring_service::CUR_POS;
+
+uring_service::uring_service(unsigned int entries)
+:	m_fd(-1)
+{
+	io_uring_params p;
+	std::memset(&p, 0, sizeof(p));
+	p.flags = IORING_SETUP_CLAMP;
+	if ((this->m_fd = sys_io_uring_setup(entries, &p)) == -1)
+		throw_errno(errno, "uring_service: io_uring_setup");
+
+	try {
+		this->m_ring.reset(new ring(this->m_fd, p));
+	} catch (...) {
+		close(this->m_fd);
+		throw;
+	}
+	this->m_cancel_any = this->probe_cancel_any();
+}
+
+/*
+ * Test if the kernel accepts IORING_ASYNC_CANCEL_ANY (Linux 5.19).
+ * Nothing is in flight yet, so a kernel that supports it fails the
+ * cancel with ENOENT, while older kernels reject the flag with EINVAL.
+ */
+bool
+uring_service::probe_cancel_any() noexcept
+{
+	auto& r = *this->m_ring;
+	auto sqe = r.get_sqe();
+	if (!sqe)
+		return false;
+	sqe->opcode = IORING_OP_ASYNC_CANCEL;
+	sqe->cancel_flags = IORING_ASYNC_CANCEL_ANY;
+	sqe->user_data = CANCEL_TAG;
+	r.commit_sqe();
+
+	while (r.cq_empty()) {
+		if (sys_io_uring_enter(this->m_fd, r.sq_pending(), 1,
+		    IORING_ENTER_GETEVENTS) == -1 && errno != EINTR)
+			return false;
+	}
+
+	const auto head = *r.cq_head;
+	const int res = r.cqes[head & r.cq_mask].res;
+	__atomic_store_n(r.cq_head, head + 1U, __ATOMIC_RELEASE);
+	return (res != -EINVAL);
+}
+
+/*
+ * Operations in flight reference the caller's buffers:
+ * cancel them and wait until they complete.
+ */
+uring_service::~uring_service() noexcept
+{
+	/* Release a thread blocked in the wait and keep it from returning. */
+	this->m_stopping.store(true, std::memory_order_release);
+	this->interrupt();
+	atomic_exchange(&this->m_tp, nullptr);
+
+	bool cancelled = false;
+	for (;;) {
+		this->submit();
+		this->reap(UINT_MAX);
+		if (this->m_inflight.load(std::memory_order_acquire) == 0U)
+			break;
+
+		if (!cancelled)
+			cancelled = this->cancel_all();
+		sys_io_uring_enter(this->m_fd, 0, 1, IORING_ENTER_GETEVENTS);
+	}
+
+	this->m_ring.reset();
+	close(this->m_fd);
+}
+
+/*
+ * Submit cancellation of all operations in flight.
+ * Kernels without IORING_ASYNC_CANCEL_ANY get a cancel entry
+ * per operation, matched on its user data.
+ * Returns false if the cancellation could not be submitted yet.
+ */
+bool
+uring_service::cancel_all() noexcept
+{
+	std::lock_guard<std::mutex> guard{ this->m_sq_mtx };
+	auto& r = *this->m_ring;
+
+	if (this->m_cancel_any) {
+		auto sqe = r.get_sqe();
+		if (!sqe)
+			return false;
+		sqe->opcode = IORING_OP_ASYNC_CANCEL;
+		sqe->cancel_flags = IORING_ASYNC_CANCEL_ANY;
+		sqe->user_data = CANCEL_TAG;
+		r.commit_sqe();
+		++this->m_queued;
+	} else {
+		std::lock_guard<std::mutex> ops_guard{ this->m_ops_mtx };
+		for (op* o = this->m_ops; o != nullptr; o = o->next) {
+			auto sqe = r.get_sqe();
+			if (!sqe) {
+				this->submit_locked();
+				if (!(sqe = r.get_sqe()))
+					return false;
+			}
+			sqe->opcode = IORING_OP_ASYNC_CANCEL;
+			sqe->addr = reinterpret_cast<std::uintptr_t>(o);
+			sqe->user_data = CANCEL_TAG;
+			r.commit_sqe();
+			++this->m_queued;
+		}
+	}
+	this->submit_locked();
+	return (this->m_queued == 0U);
+}
+
+void
+uring_service::attach(threadpool_client_ptr<threadpool_client> p)
+{
+	if (!p) {
+		throw std::invalid_argument("uring_service: "
+		    "cannot assign null client implementation");
+	}
+
+	threadpool_client_ptr<threadpool_client> expect{ nullptr };
+	if (!atomic_compare_exchange_strong(&this->m_tp, &expect, p)) {
+		throw std::runtime_error("uring_service: "
+		    "client already present");
+	}
+}
+
+/*
+ * Queue an operation.
+ *
+ * The operation is submitted by the next aid() or threadpool worker,
+ * together with other queued operations.
+ * Queueing to an empty queue wakes up the threadpool.
+ */
+template<typename T>
+cb_future<T>
+uring_service::queue_(std::uint8_t opcode, int fd, std::uint64_t addr,
+    std::uint32_t len, std::uint64_t off, std::uint32_t op_flags,
+    std::uint16_t buf_index)
+{
+	std::unique_ptr<op_prom<T>> o{ new op_prom<T>() };
+	auto f = o->prom.get_future();
+	bool first;
+
+	{
+		std::lock_guard<std::mutex> guard{ this->m_sq_mtx };
+		auto sqe = this->m_ring->get_sqe();
+		if (!sqe) {
+			/* Make room by submitting. */
+			this->submit_locked();
+			if (!(sqe = this->m_ring->get_sqe())) {
+				throw_errno(EBUSY,
+				    "uring_service: submission queue full");
+			}
+		}
+
+		sqe->opcode = opcode;
+		sqe->fd = fd;
+		sqe->addr = addr;
+		sqe->len = len;
+		sqe->off = off;
+		sqe->msg_flags = op_flags;
+		sqe->buf_index = buf_index;
+		if (!this->m_cancel_any) {
+			std::lock_guard<std::mutex> ops_guard{ this->m_ops_mtx };
+			o->link(this->m_ops);
+		}
+		sqe->user_data = reinterpret_cast<std::uintptr_t>(o.release());
+		this->m_ring->commit_sqe();
+		first = (this->m_queued++ == 0U);
+	}
+
+	if (first) {
+		auto tp = atomic_load(&this->m_tp);
+		if (tp && tp->has_service())
+			tp->wakeup();
+	}
+	return f;
+}
+
+/*
+ * Submit all queued operations, using a single system call.
+ * Must be called with m_sq_mtx held.
+ */
+unsigned int
+uring_service::submit_locked() noexcept
+{
+	const auto queued = this->m_queued;
+	if (queued == 0U)
+		return 0U;
+
+	/* Counted in flight first: completions may be reaped right away. */
+	this->m_inflight.fetch_add(queued, std::memory_order_relaxed);
+	while (sys_io_uring_enter(this->m_fd, queued, 0, 0) == -1 &&
+	    errno == EINTR);
+
+	/* Entries that the kernel consumed are in flight. */
+	this->m_queued = this->m_ring->sq_pending();
+	this->m_inflight.fetch_sub(this->m_queued, std::memory_order_relaxed);
+	return queued - this->m_queued;
+}
+
+unsigned int
+uring_service::submit() noexcept
+{
+	std::lock_guard<std::mutex> guard{ this->m_sq_mtx };
+	return this->submit_locked();
+}
+
+bool
+uring_service::has_completions() const noexcept
+{
+	return !this->m_ring->cq_empty();
+}
+
+/*
+ * Dispatch up to count completions.
+ * The completion queue is unlocked while promises are completed,
+ * since their callbacks may queue new operations.
+ */
+unsigned int
+uring_service::reap(unsigned int count) noexcept
+{
+	unsigned int rv = 0U;
+	op* done[MAX_EVENTS];
+	int res[MAX_EVENTS];
+	auto& r = *this->m_ring;
+
+	while (rv < count) {
+		unsigned int n = 0U, consumed = 0U;
+		{
+			std::lock_guard<std::mutex> guard{ this->m_cq_mtx };
+			auto head = *r.cq_head;
+			const auto tail = __atomic_load_n(r.cq_tail,
+			    __ATOMIC_ACQUIRE);
+			while (head != tail && n < MAX_EVENTS &&
+			    rv + n < count) {
+				const auto& cqe = r.cqes[head++ & r.cq_mask];
+				++consumed;
+				/* Interrupts and cancels carry no operation. */
+				if (cqe.user_data != 0U &&
+				    cqe.user_data != CANCEL_TAG) {
+					done[n] = reinterpret_cast<op*>(
+					    static_cast<std::uintptr_t>(
+					      cqe.user_data));
+					res[n++] = cqe.res;
+				}
+			}
+			__atomic_store_n(r.cq_head, head, __ATOMIC_RELEASE);
+		}
+		if (consumed == 0U)
+			break;
+		this->m_inflight.fetch_sub(consumed, std::memory_order_release);
+
+		if (!this->m_cancel_any && n > 0U) {
+			std::lock_guard<std::mutex> ops_guard{ this->m_ops_mtx };
+			for (unsigned int i = 0; i < n; ++i)
+				done[i]->unlink(this->m_ops);
+		}
+		for (unsigned int i = 0; i < n; ++i) {
+			done[i]->complete(res[i]);
+			delete done[i];
+		}
+		rv += n;
+	}
+	return rv;
+}
+
+/* Make a thread blocked in the wait return, by completing a no-op. */
+void
+uring_service::interrupt() noexcept
+{
+	std::lock_guard<std::mutex> guard{ this->m_sq_mtx };
+	if (auto sqe = this->m_ring->get_sqe()) {
+		sqe->opcode = IORING_OP_NOP;
+		this->m_ring->commit_sqe();
+		++this->m_queued;
+	}
+	this->submit_locked();
+}
+
+cb_future<std::size_t>
+uring_service::read(int fd, void* buf, std::size_t len, std::uint64_t off)
+{
+	return this->queue_<std::size_t>(IORING_OP_READ, fd,
+	    reinterpret_cast<std::uintptr_t>(buf),
+	    static_cast<std::uint32_t>(std::min<std::size_t>(len, UINT_MAX)),
+	    off);
+}
+
+cb_future<std::size_t>
+uring_service::write(int fd, const void* buf, std::size_t len,
+    std::uint64_t off)
+{
+	return this->queue_<std::size_t>(IORING_OP_WRITE, fd,
+	    reinterpret_cast<std::uintptr_t>(buf),
+	    static_cast<std::uint32_t>(std::min<std::size_t>(len, UINT_MAX)),
+	    off);
+}
+
+cb_future<std::size_t>
+uring_service::fsync(int fd)
+{
+	return this->queue_<std::size_t>(IORING_OP_FSYNC, fd, 0U, 0U, 0U);
+}
+
+cb_future<std::size_t>
+uring_service::recv(int fd, void* buf, std::size_t len, int flags)
+{
+	return this->queue_<std::size_t>(IORING_OP_RECV, fd,
+	    reinterpret_cast<std::uintptr_t>(buf),
+	    static_cast<std::uint32_t>(std::min<std::size_t>(len, UINT_MAX)),
+	    0U, static_cast<std::uint32_t>(flags));
+}
+
+cb_future<std::size_t>
+uring_service::send(int fd, const void* buf, std::size_t len, int flags)
+{
+	return this->queue_<std::size_t>(IORING_OP_SEND, fd,
+	    reinterpret_cast<std::uintptr_t>(buf),
+	    static_cast<std::uint32_t>(std::min<std::size_t>(len, UINT_MAX)),
+	    0U, static_cast<std::uint32_t>(flags));
+}
+
+cb_future<int>
+uring_service::accept(int fd)
+{
+	return this->queue_<int>(IORING_OP_ACCEPT, fd, 0U, 0U, 0U,
+	    SOCK_CLOEXEC);
+}
+
+void
+uring_service::register_buffers(const struct iovec* iov, unsigned int count)
+{
+	if (sys_io_uring_register(this->m_fd, IORING_REGISTER_BUFFERS,
+	    iov, count))
+		throw_errno(errno, "uring_service: register buffers");
+}
+
+void
+uring_service::unregister_buffers()
+{
+	if (sys_io_uring_register(this->m_fd, IORING_UNREGISTER_BUFFERS,
+	    nullptr, 0))
+		throw_errno(errno, "uring_service: unregister buffers");
+}
+
+cb_future<std::size_t>
+uring_service::read_fixed(int fd, void* buf, std::size_t len,
+    unsigned int idx, std::uint64_t off)
+{
+	return this->queue_<std::size_t>(IORING_OP_READ_FIXED, fd,
+	    reinterpret_cast<std::uintptr_t>(buf),
+	    static_cast<std::uint32_t>(std::min<std::size_t>(len, UINT_MAX)),
+	    off, 0U, static_cast<std::uint16_t>(idx));
+}
+
+cb_future<std::size_t>
+uring_service::write_fixed(int fd, const void* buf, std::size_t len,
+    unsigned int idx, std::uint64_t off)
+{
+	return this->queue_<std::size_t>(IORING_OP_WRITE_FIXED, fd,
+	    reinterpret_cast<std::uintptr_t>(buf),
+	    static_cast<std::uint32_t>(std::min<std::size_t>(len, UINT_MAX)),
+	    off, 0U, static_cast<std::uint16_t>(idx));
+}
+
+bool
+uring_service::aid(unsigned int count) noexcept
+{
+	const bool submitted = (this->submit() > 0U);
+	return (this->reap(count) > 0U || submitted);
+}
+
+
+uring_service::threadpool_client::~threadpool_client() noexcept
+{
+	/* Empty body. */
+}
+
+bool
+uring_service::threadpool_client::do_work() noexcept
+{
+	threadpool_client_lock lck{ *this };
+	if (!this->has_client())
+		return false;
+	return this->m_self.aid(MAX_EVENTS);
+}
+
+bool
+uring_service::threadpool_client::has_work() noexcept
+{
+	threadpool_client_lock lck{ *this };
+	if (!this->has_client())
+		return false;
+
+	/* The completion queue is shared memory: no system call needed. */
+	if (this->m_self.has_completions())
+		return true;
+	std::lock_guard<std::mutex> guard{ this->m_self.m_sq_mtx };
+	return (this->m_self.m_queued > 0U);
+}
+
+/*
+ * Submit queued operations, then block until an operation completes,
+ * the deadline passes or wait_interrupt() is called,
+ * and dispatch the completions.
+ *
+ * The client lock is held while blocking:
+ * the uring_service destructor interrupts the wait before detaching.
+ */
+bool
+uring_service::threadpool_client::wait_work(
+    std::chrono::steady_clock::time_point tp) noexcept
+{
+	using std::chrono::steady_clock;
+
+	threadpool_client_lock lck{ *this };
+	if (!this->has_client() ||
+	    this->m_self.m_stopping.load(std::memory_order_acquire))
+		return false;
+
+	auto& self = this->m_self;
+	unsigned int flags = IORING_ENTER_GETEVENTS;
+	io_uring_getevents_arg arg;
+	__kernel_timespec ts;
+	std::memset(&arg, 0, sizeof(arg));
+	if (tp != steady_clock::time_point::max()) {
+		/* Timed waits require the extended argument. */
+		if (!self.m_ring->ext_arg)
+			return false;
+
+		const auto ns = std::max(steady_clock::duration::zero(),
+		    tp - steady_clock::now());
+		const auto sec =
+		    std::chrono::duration_cast<std::chrono::seconds>(ns);
+		ts.tv_sec = sec.count();
+		ts.tv_nsec = std::chrono::duration_cast<
+		    std::chrono::nanoseconds>(ns - sec).count();
+		arg.ts = reinterpret_cast<std::uintptr_t>(&ts);
+		flags |= IORING_ENTER_EXT_ARG;
+	}
+
+	self.submit();
+	if (!self.has_completions()) {
+		if (flags & IORING_ENTER_EXT_ARG) {
+			sys_io_uring_enter(self.m_fd, 0, 1, flags,
+			    &arg, sizeof(arg));
+		} else
+			sys_io_uring_enter(self.m_fd, 0, 1, flags);
+	}
+
+	self.reap(MAX_EVENTS);
+	return true;
+}
+
+void
+uring_service::threadpool_client::wait_interrupt() noexcept
+{
+	threadpool_client_lock lck{ *this };
+	if (this->has_client())
+		this->m_self.interrupt();
+}
+
+
+} /* namespace ilias */
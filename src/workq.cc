@@ -14,6 +14,9 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 #include <ilias/workq.h>
+#include <algorithm>
+#include <chrono>
+#include <climits>
 #include <thread>
 
 #if !HAS_TLS
@@ -37,16 +40,30 @@ namespace ilias {
 const unsigned int workq_job::STATE_RUNNING;
 const unsigned int workq_job::STATE_HAS_RUN;
 const unsigned int workq_job::STATE_ACTIVE;
+const unsigned int workq_job::STATE_TIMER;
 
 const unsigned int workq_job::TYPE_ONCE;
 const unsigned int workq_job::TYPE_PERSIST;
 const unsigned int workq_job::TYPE_PARALLEL;
+const unsigned int workq_job::TYPE_PERIODIC;
 const unsigned int workq_job::TYPE_NO_AID;
+const unsigned int workq_job::TYPE_BLOCKING;
 const unsigned int workq_job::TYPE_MASK;
 
 const unsigned int workq_job::ACT_IMMED;
 
+const std::size_t workq_detail::inline_job::FN_SIZE;
+
+const unsigned int workq_service::WQS_LOCAL_RUNQ;
+const unsigned int workq_service::WQS_MASK;
+const unsigned int workq_service::ANON_WQS;
+
 const unsigned int ACT_IMMED_MAX_STACK = 64;
+/*
+ * Time a workq_switch() waits for the workq lock,
+ * before it declares the thread blocked.
+ */
+constexpr std::chrono::microseconds SWITCH_BLOCK_DELAY{ 100 };
 
 
 workq_error::~workq_error() noexcept
@@ -92,6 +109,8 @@ struct wq_stack
 {
 	workq_detail::wq_run_lock lck;
 	wq_stack* pred;
+	/* Compensates for TYPE_BLOCKING jobs. */
+	blocking_section blocking;
 
 	wq_stack(workq_detail::wq_run_lock&&) noexcept;
 	~wq_stack() noexcept;
@@ -275,10 +294,21 @@ public:
 };
 
 
+/* Test if the job of the run lock declared itself blocking. */
+inline bool
+is_blocking(const workq_detail::wq_run_lock& lck) noexcept
+{
+	const workq_job* j = lck.get_wq_job().get();
+	if (!j)
+		j = lck.get_co().get();
+	return (j && (j->m_type & workq_job::TYPE_BLOCKING));
+}
+
 inline
 wq_stack::wq_stack(workq_detail::wq_run_lock&& lck) noexcept :
 	lck(std::move(lck)),
-	pred(nullptr)
+	pred(nullptr),
+	blocking(is_blocking(this->lck))
 {
 	get_wq_tls().push(*this);
 }
@@ -299,7 +329,18 @@ namespace workq_detail {
 wq_run_lock::wq_run_lock(workq_detail::co_runnable& co) noexcept :
 	wq_run_lock()
 {
-	co.m_runcount.fetch_add(1, std::memory_order_acquire);
+	/*
+	 * Only join the co-runnable while it is published:
+	 * once the run count drops to zero, the last participant
+	 * has unlocked the job.
+	 */
+	auto rc = co.m_runcount.load(std::memory_order_relaxed);
+	do {
+		if (rc == 0)
+			return;
+	} while (!co.m_runcount.compare_exchange_weak(rc, rc + 1,
+	    std::memory_order_acquire, std::memory_order_relaxed));
+
 	this->m_co = &co;
 	this->m_wq = co.get_workq();
 	this->m_wq_lck = this->m_wq->lock_run_parallel();
@@ -364,9 +405,12 @@ wq_run_lock::lock(workq& what) noexcept
 				break;		/* GUARD */
 		}
 
-		/* Take job away from parallel runq iff it is parallel. */
-		if (this->m_wq_job && (this->m_wq_job->m_type & workq_job::TYPE_PARALLEL))
-			this->m_wq->m_p_runq.erase(this->m_wq->m_p_runq.iterator_to(*this->m_wq_job));
+		/*
+		 * A parallel job is left on the parallel runq:
+		 * erasing it would race with parallel runners popping it
+		 * and livelock the list.
+		 * Parallel runners will find it busy and drop it.
+		 */
 
 		/* Downgrade to parallel lock iff job is a parallel job. */
 		if (this->m_wq_job && (this->m_wq_job->m_type & workq_job::TYPE_PARALLEL)) {
@@ -387,9 +431,11 @@ wq_run_lock::lock(workq& what) noexcept
 				break;		/* GUARD */
 		}
 
-		/* Take job away from single runq. */
-		if (this->m_wq_job)
-			this->m_wq->m_runq.erase(this->m_wq->m_runq.iterator_to(*this->m_wq_job));
+		/*
+		 * The job is left on the single runq, for the same reason
+		 * as above: the single runner will drop it once it finds
+		 * the job busy or run.
+		 */
 
 		break;
 	}
@@ -443,83 +489,578 @@ wq_run_lock::lock(workq_job& what) noexcept
 	return true;
 }
 
+/*
+ * Per-thread runq of workqs.
+ *
+ * Only used by workq_service with the WQS_LOCAL_RUNQ flag set.
+ * Each worker thread claims a local runq on the workq_service it runs,
+ * workqs activated from that worker are placed on it.
+ * The owner takes workqs from the back (most recently activated, so
+ * most likely to still be in the cpu cache), while other workers
+ * steal from the front.
+ *
+ * A local runq is referenced by the workq_service and by its owning thread.
+ * When the owning thread exits, the runq becomes available for claiming
+ * by another thread.
+ */
+class local_runq
+:	public ll_list_hook<local_runq_tag>,
+	public refcount_base<local_runq>
+{
+public:
+	using runq_type = ll_smartptr_list<workq,
+	    runq_tag,
+	    workq_intref_mgr<workq>>;
+
+	runq_type m_runq;
+	/* Service owning this runq. */
+	const workq_service*const m_wqs;
+	/* Set if a thread has claimed this runq. */
+	std::atomic<bool> m_owned{ true };
+	/* Set when the owning workq_service is destroyed. */
+	std::atomic<bool> m_dead{ false };
+
+	local_runq(const workq_service& wqs) noexcept
+	:	m_wqs(&wqs)
+	{
+		/* Empty body. */
+	}
+
+	bool
+	try_claim() noexcept
+	{
+		bool expect = false;
+		return this->m_owned.compare_exchange_strong(expect, true,
+		    std::memory_order_acquire, std::memory_order_relaxed);
+	}
+
+	void
+	unclaim() noexcept
+	{
+		this->m_owned.store(false, std::memory_order_release);
+	}
+
+	bool
+	is_valid_for(const workq_service& wqs) const noexcept
+	{
+		return (this->m_wqs == &wqs &&
+		    !this->m_dead.load(std::memory_order_acquire));
+	}
+};
+
+/*
+ * Hierarchical timer wheel.
+ *
+ * The wheel has LEVELS levels of SLOTS slots each.
+ * A slot at level n spans SLOTS^n ticks; once its time comes,
+ * the timers in it are cascaded into the lower levels.
+ * Timers that expire are moved to the due list.
+ *
+ * Arming and cancelling a timer are O(1).
+ */
+class timer_wheel
+{
+public:
+	using clock = workq_job::timer_clock;
+	using tick = std::chrono::milliseconds;
+
+	static const unsigned int LEVEL_BITS = 6U;
+	static const unsigned int LEVELS = 4U;
+	static const std::uint64_t SLOTS = (std::uint64_t(1) << LEVEL_BITS);
+	static const std::uint64_t SLOT_MASK = SLOTS - 1U;
+	static const std::uint64_t NO_TICK = UINT64_MAX;
+
+private:
+	std::mutex m_mtx;
+	/* Point in time of tick 0. */
+	const clock::time_point m_epoch;
+	/* Last processed tick. */
+	std::uint64_t m_now{ 0U };
+	/* Timers with an expired deadline. */
+	timer_node m_due;
+	/* Timer slots. */
+	timer_node m_slots[LEVELS][SLOTS];
+	/* Lower bound on the earliest deadline in the wheel. */
+	std::atomic<clock::rep> m_earliest{
+		clock::time_point::max().time_since_epoch().count()
+	};
+
+	static bool
+	empty(const timer_node& s) noexcept
+	{
+		return (s.m_next == &s);
+	}
+
+	static void
+	link(timer_node& s, timer_node& n) noexcept
+	{
+		n.m_prev = s.m_prev;
+		n.m_next = &s;
+		n.m_prev->m_next = &n;
+		s.m_prev = &n;
+	}
+
+	static void
+	unlink(timer_node& n) noexcept
+	{
+		n.m_prev->m_next = n.m_next;
+		n.m_next->m_prev = n.m_prev;
+		n.m_prev = n.m_next = nullptr;
+	}
+
+	/* Move all timers in src to the back of dst. */
+	static void
+	splice(timer_node& dst, timer_node& src) noexcept
+	{
+		if (empty(src))
+			return;
+
+		src.m_next->m_prev = dst.m_prev;
+		src.m_prev->m_next = &dst;
+		dst.m_prev->m_next = src.m_next;
+		dst.m_prev = src.m_prev;
+		src.m_next = src.m_prev = &src;
+	}
+
+	/* Tick at which deadline tp has passed. */
+	std::uint64_t
+	tick_of(clock::time_point tp) const noexcept
+	{
+		if (tp <= this->m_epoch)
+			return 0U;
+
+		const auto d = tp - this->m_epoch;
+		auto t = std::chrono::duration_cast<tick>(d);
+		if (t < d)
+			++t;
+		return t.count();
+	}
+
+	clock::time_point
+	time_of(std::uint64_t t) const noexcept
+	{
+		return this->m_epoch + tick(t);
+	}
+
+	/* Put timer in the slot matching its tick. */
+	void
+	insert(timer_node& n) noexcept
+	{
+		if (n.m_tick <= this->m_now) {
+			link(this->m_due, n);
+			return;
+		}
+
+		/* Timers beyond the top level wait in its last slot. */
+		auto t = n.m_tick;
+		const auto span = (std::uint64_t(1) << (LEVEL_BITS * LEVELS));
+		if (t - this->m_now >= span)
+			t = this->m_now + span - 1U;
+
+		unsigned int level = 0;
+		while (level < LEVELS - 1U &&
+		    t - this->m_now >= (std::uint64_t(1) <<
+		      (LEVEL_BITS * (level + 1U))))
+			++level;
+
+		link(this->m_slots[level][(t >> (LEVEL_BITS * level)) &
+		    SLOT_MASK], n);
+	}
+
+	/*
+	 * First tick after m_now at which a slot needs processing,
+	 * either because its timers expire or because they cascade.
+	 */
+	std::uint64_t
+	next_tick() const noexcept
+	{
+		auto rv = NO_TICK;
+
+		for (std::uint64_t i = 1; i < SLOTS; ++i) {
+			if (!empty(this->m_slots[0][(this->m_now + i) &
+			    SLOT_MASK])) {
+				rv = this->m_now + i;
+				break;
+			}
+		}
+
+		for (unsigned int level = 1; level < LEVELS; ++level) {
+			const auto shift = LEVEL_BITS * level;
+			const auto block = (this->m_now >> shift);
+			for (std::uint64_t i = 1; i <= SLOTS; ++i) {
+				if (!empty(this->m_slots[level][(block + i) &
+				    SLOT_MASK])) {
+					rv = std::min(rv, (block + i) << shift);
+					break;
+				}
+			}
+		}
+		return rv;
+	}
+
+	/* Cascade higher level slots that start at m_now. */
+	void
+	cascade() noexcept
+	{
+		for (unsigned int level = LEVELS - 1U; level > 0; --level) {
+			const auto shift = LEVEL_BITS * level;
+			if ((this->m_now & ((std::uint64_t(1) << shift) - 1U)) !=
+			    0U)
+				continue;
+
+			auto& s = this->m_slots[level][(this->m_now >> shift) &
+			    SLOT_MASK];
+			while (!empty(s)) {
+				auto& n = *s.m_next;
+				unlink(n);
+				this->insert(n);
+			}
+		}
+	}
+
+	/* Advance the wheel to now, moving expired timers to the due list. */
+	void
+	advance(clock::time_point now) noexcept
+	{
+		if (now < this->m_epoch)
+			return;
+		const std::uint64_t target =
+		    std::chrono::duration_cast<tick>(now - this->m_epoch).
+		    count();
+
+		while (this->m_now < target) {
+			/* Skip over ticks without work. */
+			const auto t = this->next_tick();
+			if (t > target) {
+				this->m_now = target;
+				break;
+			}
+
+			this->m_now = t;
+			this->cascade();
+			splice(this->m_due,
+			    this->m_slots[0][this->m_now & SLOT_MASK]);
+		}
+	}
+
+	void
+	update_earliest() noexcept
+	{
+		auto e = clock::time_point::max();
+		if (!empty(this->m_due))
+			e = this->time_of(this->m_now);
+		else if (this->next_tick() != NO_TICK)
+			e = this->time_of(this->next_tick());
+		this->m_earliest.store(e.time_since_epoch().count(),
+		    std::memory_order_release);
+	}
+
+public:
+	timer_wheel() noexcept
+	:	m_epoch(clock::now())
+	{
+		this->m_due.m_prev = this->m_due.m_next = &this->m_due;
+		for (auto& level : this->m_slots) {
+			for (auto& s : level)
+				s.m_prev = s.m_next = &s;
+		}
+	}
+
+	timer_wheel(const timer_wheel&) = delete;
+	timer_wheel& operator=(const timer_wheel&) = delete;
+
+	~timer_wheel() noexcept
+	{
+		/* Armed jobs keep the workq_service alive. */
+		assert(empty(this->m_due));
+	}
+
+	/*
+	 * Arm the timer of a job, moving it if it is already armed.
+	 * Returns true if the deadline precedes all other deadlines,
+	 * in which case a sleeping worker may need to be woken up.
+	 */
+	bool
+	arm(workq_job& j, clock::time_point deadline,
+	    clock::duration interval) noexcept
+	{
+		timer_node& n = j;
+
+		std::lock_guard<std::mutex> guard{ this->m_mtx };
+		if (j.m_state.load(std::memory_order_relaxed) &
+		    workq_job::STATE_TIMER)
+			unlink(n);
+		n.m_deadline = deadline;
+		n.m_interval = interval;
+		n.m_tick = this->tick_of(deadline);
+		this->insert(n);
+		j.m_state.fetch_or(workq_job::STATE_TIMER,
+		    std::memory_order_relaxed);
+
+		const auto d = deadline.time_since_epoch().count();
+		auto e = this->m_earliest.load(std::memory_order_relaxed);
+		if (d >= e)
+			return false;
+		this->m_earliest.store(d, std::memory_order_release);
+		return true;
+	}
+
+	/* Cancel the timer of a job. */
+	void
+	cancel(workq_job& j) noexcept
+	{
+		std::lock_guard<std::mutex> guard{ this->m_mtx };
+		if (j.m_state.fetch_and(~workq_job::STATE_TIMER,
+		    std::memory_order_relaxed) & workq_job::STATE_TIMER)
+			unlink(j);
+	}
+
+	/* Test if a timer may have expired. */
+	bool
+	due(clock::time_point now) const noexcept
+	{
+		return (now.time_since_epoch().count() >=
+		    this->m_earliest.load(std::memory_order_acquire));
+	}
+
+	/* Lower bound on the earliest deadline. */
+	clock::time_point
+	next_deadline() const noexcept
+	{
+		return clock::time_point(clock::duration(
+		    this->m_earliest.load(std::memory_order_acquire)));
+	}
+
+	/*
+	 * Activate all jobs with an expired deadline.
+	 * Periodic jobs are rearmed for their next interval.
+	 *
+	 * Activation happens with the wheel locked,
+	 * so a job cannot be destroyed halfway through.
+	 */
+	void
+	expire() noexcept
+	{
+		if (this->m_earliest.load(std::memory_order_relaxed) ==
+		    clock::time_point::max().time_since_epoch().count())
+			return;
+		auto now = clock::now();
+		if (!this->due(now))
+			return;
+
+		std::unique_lock<std::mutex> guard{ this->m_mtx,
+			std::try_to_lock };
+		if (!guard.owns_lock())
+			return;	/* Another thread is processing timers. */
+
+		this->advance(now);
+		timer_node expired;
+		expired.m_prev = expired.m_next = &expired;
+		splice(expired, this->m_due);
+
+		while (!empty(expired)) {
+			timer_node& n = *expired.m_next;
+			workq_job& j = static_cast<workq_job&>(n);
+			unlink(n);
+
+			const bool periodic =
+			    ((j.m_type & workq_job::TYPE_PERIODIC) &&
+			     n.m_interval > clock::duration::zero());
+			if (periodic) {
+				/* Skip missed intervals instead of bursting. */
+				n.m_deadline += n.m_interval;
+				if (n.m_deadline <= now)
+					n.m_deadline = now + n.m_interval;
+				n.m_tick = this->tick_of(n.m_deadline);
+				this->insert(n);
+			}
+
+			j.activate();
+
+			/*
+			 * Only clear the timer bit once the activation is
+			 * done: until then, cancel_timer() takes the wheel
+			 * lock, so the job can't be destroyed underneath us.
+			 * The job must not be touched after this.
+			 */
+			if (!periodic) {
+				j.m_state.fetch_and(~workq_job::STATE_TIMER,
+				    std::memory_order_release);
+			}
+		}
+
+		this->update_earliest();
+	}
+};
+
+const unsigned int timer_wheel::LEVEL_BITS;
+const unsigned int timer_wheel::LEVELS;
+const std::uint64_t timer_wheel::SLOTS;
+const std::uint64_t timer_wheel::SLOT_MASK;
+const std::uint64_t timer_wheel::NO_TICK;
+
 bool
 wq_run_lock::lock(workq_service& wqs) noexcept
 {
 	assert(!this->m_wq && !this->m_wq_job && !this->m_co);
 
 	/*
-	 * Fetch a workq and hold on to it.
-	 *
-	 * Loop terminates when either we manage to lock a job on a workq,
-	 * or when the runq is depleted.
+	 * Workqs placed on the node of this thread first,
+	 * workqs placed on other nodes only if nothing else is runnable.
 	 */
-	auto& runq_iter = wqs.get_runq_iterpos();
-	auto wq = (++runq_iter).get();
-	for (;;) {
-		if (!wq) {
-			runq_iter = wqs.m_wq_runq.begin();
-			wq = runq_iter.get();
-			if (!wq)
-				break;	/* GUARD */
-		}
+	const bool placed =
+	    (wqs.m_placed.load(std::memory_order_relaxed) > 0U);
+	if (placed && this->lock_node_runq(wqs, numa::current_node()))
+		return true;
+
+	if (!(wqs.m_flags & workq_service::WQS_LOCAL_RUNQ)) {
+		if (this->lock_shared_runq(wqs))
+			return true;
+	} else {
+		/*
+		 * Local runq first, then workqs that were activated from
+		 * outside the worker threads, then steal from other workers.
+		 */
+		auto self = wqs.get_local_runq();
+		if (self && this->lock_local_runq(wqs, self))
+			return true;
+		if (this->lock_shared_runq(wqs))
+			return true;
+		if (this->lock_local_runq(wqs, nullptr))
+			return true;
+	}
+
+	return (placed && this->lock_node_runq(wqs, numa::NO_NODE));
+}
 
+/*
+ * Lock a job from the shared runq.
+ *
+ * The shared runq is used as a fifo: workqs are taken from the front and,
+ * if they yield a job, are placed at the back so each workq gets its turn.
+ * Workqs without a job are depleted and dropped.
+ * This is race free: an activation after the workq is popped finds it
+ * unlinked and will put it back on a runq.
+ */
+bool
+wq_run_lock::lock_shared_runq(workq_service& wqs) noexcept
+{
+	while (auto wq = wqs.m_wq_runq.pop_front()) {
 		if (this->lock(*wq)) {
-			/* Acquired a job: workq may stay on the runq. */
-			break;		/* GUARD */
-		} else {
-			/*
-			 * No job acquired, workq is depleted and
-			 * must be removed.
-			 */
-			wqs.m_wq_runq.erase(runq_iter);
+			wqs.m_wq_runq.link_back(std::move(wq));
+			return true;
+		}
+	}
+	return false;
+}
 
-			/*
-			 * Retest to see if the workq has a job.
-			 *
-			 * This test is important, because without it there
-			 * will be a race condition where the job acquires new
-			 * workq between the lock (above) and the erase call
-			 * we just did.
-			 */
+/*
+ * Lock a job from a local runq.
+ *
+ * If self is non-null, workqs are taken from the back of the local runq
+ * of the current thread.
+ * Otherwise, workqs are stolen from the front of the runqs of
+ * all other threads.
+ *
+ * Workqs which yield a job are placed at the front of the local runq of
+ * the current thread, so other workers can steal them while the current
+ * thread is busy.
+ * Workqs without a job are dropped: a subsequent activation will put them
+ * back on a runq.
+ */
+bool
+wq_run_lock::lock_local_runq(workq_service& wqs, local_runq* self) noexcept
+{
+	auto wq_pop = [](local_runq& q, bool back) {
+		return (back ? q.m_runq.pop_back() : q.m_runq.pop_front());
+	    };
+	auto wq_requeue = [&wqs, &self](local_runq::runq_type::pointer wq) {
+		if (self)
+			self->m_runq.link_front(std::move(wq));
+		else
+			wqs.m_wq_runq.link_back(std::move(wq));
+	    };
+
+	if (self) {
+		while (auto wq = wq_pop(*self, true)) {
 			if (this->lock(*wq)) {
-				wqs.m_wq_runq.link(runq_iter, std::move(wq));
-				wqs.wakeup();
-				break;
+				wq_requeue(std::move(wq));
+				return true;
 			}
 		}
+		return false;
 	}
-	runq_iter.release();
-	return this->is_locked();
+
+	self = wqs.get_local_runq();
+	for (auto victim = wqs.m_local_runqs.begin();
+	    victim != wqs.m_local_runqs.end();
+	    ++victim) {
+		if (victim.get() == self)
+			continue;
+
+		while (auto wq = wq_pop(*victim, false)) {
+			if (this->lock(*wq)) {
+				wq_requeue(std::move(wq));
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+/*
+ * Lock a job from a node runq.
+ *
+ * If node is numa::NO_NODE, workqs are taken from the runqs of all nodes
+ * other than the node of the current thread.
+ * Node runqs are used as a fifo, like the shared runq:
+ * a workq that yields a job goes back on the runq of its node.
+ */
+bool
+wq_run_lock::lock_node_runq(workq_service& wqs, unsigned int node) noexcept
+{
+	auto lock_runq = [this](workq_service::wq_runq& q) {
+		while (auto wq = q.pop_front()) {
+			if (this->lock(*wq)) {
+				q.link_back(std::move(wq));
+				return true;
+			}
+		}
+		return false;
+	    };
+
+	if (node != numa::NO_NODE)
+		return (node < wqs.m_nodes && lock_runq(wqs.m_node_runqs[node]));
+
+	const auto self = numa::current_node();
+	for (unsigned int i = 0; i < wqs.m_nodes; ++i) {
+		if (i != self && lock_runq(wqs.m_node_runqs[i]))
+			return true;
+	}
+	return false;
 }
 
 /*
  * Acquire a specific lock on only this workq.
  *
- * XXX needs to have priority over run threads for locking run-single.
+ * Run-single is acquired through the switch queue of the workq:
+ * the caller blocks until the lock is handed to it.
  */
 void
 wq_run_lock::lock_wq(workq& what, workq::run_lck how) noexcept
 {
 	assert(!this->m_wq);	/* May not hold a workq lock. */
 
-	for (;;) {
-		switch (how) {
-		case workq::RUN_SINGLE:
-			this->m_wq_lck = what.lock_run();
-			break;
-		case workq::RUN_PARALLEL:
-			this->m_wq_lck = what.lock_run_parallel();
-			break;
-		}
-
-		if (this->m_wq_lck == how)
-			break;		/* GUARD */
-
-		what.unlock_run(this->m_wq_lck);
-		std::this_thread::yield();
+	switch (how) {
+	case workq::RUN_SINGLE:
+		what.lock_run_single_wait();
+		break;
+	case workq::RUN_PARALLEL:
+		what.lock_run_parallel();
+		break;
 	}
 
+	this->m_wq_lck = how;
 	this->m_wq = &what;
 }
 
@@ -536,14 +1077,25 @@ workq_detail::workq_int::wait_unreferenced() const noexcept
 
 
 workq_service_ptr
-new_workq_service() throw (std::bad_alloc)
+new_workq_service() ILIAS_ASYNC_THROWS(std::bad_alloc)
 {
 	return workq_service_ptr(new workq_service());
 }
 
+workq_service_ptr
+new_workq_service(unsigned int flags)
+    ILIAS_ASYNC_THROWS(std::bad_alloc, std::invalid_argument)
+{
+	if ((flags & workq_service::WQS_MASK) != flags) {
+		throw std::invalid_argument("workq_service: "
+		    "invalid flags (unrecognized flags)");
+	}
+	return workq_service_ptr(new workq_service(flags));
+}
+
 
 workq_job::workq_job(workq_ptr wq, unsigned int type)
-    throw (std::invalid_argument) :
+    ILIAS_ASYNC_THROWS(std::invalid_argument) :
 	m_type(type),
 	m_run_gen(0),
 	m_state(0),
@@ -555,6 +1107,10 @@ workq_job::workq_job(workq_ptr wq, unsigned int type)
 		throw std::invalid_argument("workq_job: "
 		    "cannot create persistent job that only runs once");
 	}
+	if ((type & TYPE_ONCE) && (type & TYPE_PERIODIC)) {
+		throw std::invalid_argument("workq_job: "
+		    "cannot create periodic job that only runs once");
+	}
 	if ((type & TYPE_MASK) != type) {
 		throw std::invalid_argument("workq_job: "
 		    "invalid type (unrecognized flags)");
@@ -592,6 +1148,8 @@ workq_job::activate(unsigned int flags) noexcept
 void
 workq_job::deactivate() noexcept
 {
+	this->cancel_timer();
+
 	const auto gen = this->m_run_gen.load(std::memory_order_relaxed);
 	auto s = this->m_state.fetch_and(~STATE_ACTIVE,
 	    std::memory_order_release);
@@ -606,6 +1164,23 @@ workq_job::deactivate() noexcept
 	}
 }
 
+void
+workq_job::activate_at(timer_clock::time_point deadline,
+    timer_clock::duration interval) noexcept
+{
+	const auto& wqs = this->get_workq_service();
+	if (wqs->m_timers->arm(*this, deadline, interval))
+		wqs->wakeup();
+}
+
+void
+workq_job::cancel_timer() noexcept
+{
+	/* Pairs with the release in timer_wheel::expire(). */
+	if (this->m_state.load(std::memory_order_acquire) & STATE_TIMER)
+		this->get_workq_service()->m_timers->cancel(*this);
+}
+
 const workq_ptr&
 workq_job::get_workq() const noexcept
 {
@@ -669,19 +1244,29 @@ workq_detail::co_runnable::~co_runnable() noexcept
 }
 
 workq_detail::co_runnable::co_runnable(workq_ptr wq, unsigned int type)
-    throw (std::invalid_argument)
+    ILIAS_ASYNC_THROWS(std::invalid_argument)
 :	workq_job(std::move(wq), type),
-	m_runcount(0)
+	m_runcount(0),
+	m_published(false)
 {
 	/* Empty body. */
 }
 
+/*
+ * Publish the co-runnable on the co-runq.
+ *
+ * The job lock is moved into the co-runnable and the run count is set to one,
+ * representing the publication itself.  Each thread running co_run()
+ * adds to the run count.  The publication is dropped by the first call
+ * to release(), the last participant to leave unlocks the job.
+ */
 void
 workq_detail::co_runnable::co_publish(std::size_t runcount) noexcept
 {
 	if (runcount > 0) {
 		this->m_rlck = get_wq_tls().steal_lock(*this);
-		this->m_runcount.exchange(runcount, std::memory_order_acq_rel);
+		this->m_published.store(true, std::memory_order_relaxed);
+		this->m_runcount.store(1, std::memory_order_release);
 		this->get_workq_service()->co_to_runq(this, runcount);
 	} else {
 		/* Not publishing co-runnable, not eating lock,
@@ -689,20 +1274,6 @@ workq_detail::co_runnable::co_publish(std::size_t runcount) noexcept
 	}
 }
 
-void
-workq_detail::co_runnable::unlock_run(workq_job::run_lck rl) noexcept
-{
-	switch (rl) {
-	case RUNNING:
-		/* Handled by co_runnable::release,
-		 * which will be called from co_run() as appropriate. */
-		return;
-	case BUSY:
-		break;
-	}
-	this->workq_job::unlock_run(rl);
-}
-
 bool
 workq_detail::co_runnable::release(std::size_t) noexcept
 {
@@ -724,6 +1295,16 @@ workq_detail::co_runnable::release(std::size_t) noexcept
 	this->get_workq_service()->m_co_runq.erase(
 	    this->get_workq_service()->m_co_runq.iterator_to(*this));
 
+	/*
+	 * Drop the reference held by the publication.
+	 * The caller holds its own reference, so this is never the last.
+	 */
+	if (this->m_published.exchange(false, std::memory_order_acq_rel)) {
+		const auto old = this->m_runcount.fetch_sub(1,
+		    std::memory_order_release);
+		assert(old > 1);
+	}
+
 	assert(this->m_rlck.is_locked());
 	std::atomic_thread_fence(std::memory_order_release);
 	if (get_wq_tls().steal_lock(*this).co_unlock()) {
@@ -735,13 +1316,20 @@ workq_detail::co_runnable::release(std::size_t) noexcept
 }
 
 
-workq::workq(workq_service_ptr wqs) throw (std::invalid_argument)
+workq::workq(workq_service_ptr wqs, bool anon, unsigned int node) ILIAS_ASYNC_THROWS(std::invalid_argument)
 :	m_wqs(std::move(wqs)),
 	m_run_single(false),
-	m_run_parallel(0)
+	m_run_parallel(0),
+	m_anon(anon),
+	m_node(node)
 {
 	if (!this->m_wqs)
 		throw std::invalid_argument("workq: null workq service");
+	if (this->m_node != numa::NO_NODE) {
+		if (this->m_node >= this->m_wqs->m_nodes)
+			throw std::invalid_argument("workq: invalid numa node");
+		this->m_wqs->m_placed.fetch_add(1U, std::memory_order_relaxed);
+	}
 }
 
 workq::~workq() noexcept
@@ -749,6 +1337,11 @@ workq::~workq() noexcept
 	assert(this->m_runq.empty());
 	assert(!this->m_run_single.load(std::memory_order_acquire));
 	assert(this->m_run_parallel.load(std::memory_order_acquire) == 0);
+
+	if (this->m_node != numa::NO_NODE)
+		this->m_wqs->m_placed.fetch_sub(1U, std::memory_order_relaxed);
+	if (this->m_anon)
+		this->m_wqs->anon_remove(*this);
 }
 
 const workq_service_ptr&
@@ -767,14 +1360,15 @@ void
 workq::job_to_runq(workq_detail::workq_intref<workq_job> j) noexcept
 {
 	bool activate = false;
+	bool parallel = false;
 	if ((j->m_type & workq_job::TYPE_PARALLEL) &&
 	    this->m_p_runq.link_back(j))
-		activate = true;
+		activate = parallel = true;
 	if (this->m_runq.link_back(std::move(j)))
 		activate = true;
 
 	if (activate)
-		this->get_workq_service()->wq_to_runq(this);
+		this->get_workq_service()->wq_to_runq(this, parallel);
 }
 
 workq::run_lck
@@ -793,17 +1387,116 @@ workq::lock_run_parallel() noexcept
 	return RUN_PARALLEL;
 }
 
+/*
+ * Acquire the run-single lock, waiting for it if needed.
+ *
+ * Waiters queue up in the switch queue,
+ * the thread is blocked (not spinning) until the lock is released.
+ * The holder usually hands over quickly, so the threadpool is only told
+ * that the thread blocks once the wait takes longer than that.
+ */
+void
+workq::lock_run_single_wait() noexcept
+{
+	if (!this->m_run_single.exchange(true, std::memory_order_acquire))
+		return;
+
+	auto& q = this->m_switchq;
+	std::unique_lock<std::mutex> lck{ q.mtx };
+	const auto ticket = q.tail++;
+	/* Pairs with the load in unlock_run_single(). */
+	q.waiting.fetch_add(1U, std::memory_order_seq_cst);
+
+	/* Try to take the lock, if it is our turn. */
+	const auto acquire = [&]() -> bool {
+		if (ticket != q.head)
+			return false;
+		if (q.granted) {
+			q.granted = false;
+			return true;
+		}
+		return !this->m_run_single.exchange(true,
+		    std::memory_order_seq_cst);
+	    };
+
+	const auto deadline = std::chrono::steady_clock::now() +
+	    SWITCH_BLOCK_DELAY;
+	bool acquired = acquire();
+	while (!acquired && std::chrono::steady_clock::now() < deadline) {
+		q.cnd.wait_until(lck, deadline);
+		acquired = acquire();
+	}
+
+	if (!acquired) {
+		/*
+		 * Let the threadpool run other work in the meantime.
+		 * Don't hold the queue while the threadpool compensates.
+		 */
+		lck.unlock();
+		blocking_section blocked;
+		lck.lock();
+		while (!acquire())
+			q.cnd.wait(lck);
+		++q.head;
+		q.waiting.fetch_sub(1U, std::memory_order_relaxed);
+		lck.unlock();
+		return;
+	}
+
+	++q.head;
+	q.waiting.fetch_sub(1U, std::memory_order_relaxed);
+}
+
+/*
+ * Release the run-single lock.
+ *
+ * If a thread waits in the switch queue, the lock is handed to it
+ * (instead of released) and false is returned.
+ */
+bool
+workq::unlock_run_single() noexcept
+{
+	auto& q = this->m_switchq;
+
+	if (q.waiting.load(std::memory_order_seq_cst) > 0U) {
+		std::lock_guard<std::mutex> lck{ q.mtx };
+		if (q.head != q.tail) {
+			q.granted = true;
+			q.cnd.notify_all();
+			return false;
+		}
+	}
+
+	const auto old_run_single = this->m_run_single.exchange(false,
+	    std::memory_order_seq_cst);
+	assert(old_run_single);
+
+	/*
+	 * A waiter arrived while the lock was released:
+	 * the first waiter retries acquiring the lock.
+	 */
+	if (q.waiting.load(std::memory_order_seq_cst) > 0U) {
+		std::lock_guard<std::mutex> lck{ q.mtx };
+		q.cnd.notify_all();
+	}
+	return true;
+}
+
 void
 workq::unlock_run(workq::run_lck rl) noexcept
 {
 	switch (rl) {
 	case RUN_SINGLE:
-		{
-			const auto old_run_single =
-			    this->m_run_single.exchange(false,
-			    std::memory_order_release);
-			assert(old_run_single);
-		}
+		/* The lock was handed off: the new holder requeues. */
+		if (!this->unlock_run_single())
+			break;
+
+		/*
+		 * Workers that found this workq while it was locked single
+		 * dropped it from their runq: requeue it if jobs are pending.
+		 */
+		if (!this->m_runq.empty())
+			this->get_workq_service()->wq_to_runq(this);
 		break;
 	case RUN_PARALLEL:
 		{
@@ -821,16 +1514,9 @@ workq::lock_run_downgrade(workq::run_lck rl) noexcept
 {
 	switch (rl) {
 	case RUN_SINGLE:
-		{
-			this->m_run_parallel.fetch_add(1,
-			    std::memory_order_acquire);
-			const auto old_run_single =
-			    this->m_run_single.exchange(false,
-			    std::memory_order_release);
-			assert(old_run_single);
-
-			rl = RUN_PARALLEL;
-		}
+		this->m_run_parallel.fetch_add(1, std::memory_order_acquire);
+		this->unlock_run_single();
+		rl = RUN_PARALLEL;
 		break;
 	case RUN_PARALLEL:
 		break;
@@ -885,50 +1571,129 @@ bool
 workq_service::threadpool_client::has_work() noexcept
 {
 	threadpool_client_lock lck{ *this };
-	return (this->has_client() && !this->m_self.empty());
+	return (this->has_client() && (!this->m_self.empty() ||
+	    this->m_self.m_timers->due(std::chrono::steady_clock::now())));
+}
+
+std::chrono::steady_clock::time_point
+workq_service::threadpool_client::next_deadline() noexcept
+{
+	threadpool_client_lock lck{ *this };
+	if (!this->has_client())
+		return std::chrono::steady_clock::time_point::max();
+	return this->m_self.m_timers->next_deadline();
 }
 
-workq_service::wq_runq::iterator&
-workq_service::get_runq_iterpos() noexcept
+workq_detail::local_runq*
+workq_service::get_local_runq() noexcept
 {
-	using runq_iterator = wq_runq::iterator;
-	using tls_type = std::tuple<runq_iterator, workq_service*>;
+	using workq_detail::local_runq;
+
+	/* Claim on a local runq, released when the thread exits. */
+	struct local_runq_claim
+	{
+		refpointer<local_runq> q;
+
+		~local_runq_claim() noexcept
+		{
+			if (this->q)
+				this->q->unclaim();
+		}
+	};
 
 #if HAS_THREAD_LOCAL
-	static thread_local tls_type m_impl;
-	tls_type& tls = m_impl;
+	static thread_local local_runq_claim m_impl;
+	local_runq_claim& tls = m_impl;
 #else
-	static tls_cd<tls_type> m_impl;
-	tls_type& tls = *m_impl;
+	static tls_cd<local_runq_claim> m_impl;
+	local_runq_claim& tls = *m_impl;
 #endif
 
-	if (std::get<1>(tls) != this) {
-		std::get<0>(tls) = this->m_wq_runq.begin();
-		std::get<1>(tls) = this;
+	/* Only worker threads that are running this service have a runq. */
+	if (!(this->m_flags & WQS_LOCAL_RUNQ) || get_wq_tls().wqs != this)
+		return nullptr;
+	if (tls.q && tls.q->is_valid_for(*this))
+		return tls.q.get();
+
+	/* Drop claim on runq of a different service. */
+	if (tls.q) {
+		tls.q->unclaim();
+		tls.q.reset();
+	}
+
+	/* Claim the runq of a thread that exited. */
+	for (auto i = this->m_local_runqs.begin();
+	    i != this->m_local_runqs.end();
+	    ++i) {
+		if (i->try_claim()) {
+			tls.q = i.get();
+			return tls.q.get();
+		}
+	}
+
+	/* Create a new runq, falling back to the shared runq on failure. */
+	try {
+		tls.q = new local_runq(*this);
+	} catch (const std::bad_alloc&) {
+		return nullptr;
 	}
-	return std::get<0>(tls);
+	this->m_local_runqs.link_back(tls.q);
+	return tls.q.get();
 }
 
-workq_service::workq_service()
+workq_service::workq_service(unsigned int flags)
+:	m_flags(flags),
+	m_nodes(numa::nodes()),
+	m_node_runqs(new wq_runq[numa::nodes()]),
+	m_timers(new workq_detail::timer_wheel())
 {
 	return;
 }
 
 workq_service::~workq_service() noexcept
 {
+	/* Anonymous workqs reference this until they are destroyed. */
+	for (auto& slot : this->m_anon)
+		assert(slot.wq == nullptr);
+
 	this->m_wq_runq.clear();
 	this->m_co_runq.clear();
+	for (unsigned int node = 0; node < this->m_nodes; ++node)
+		this->m_node_runqs[node].clear();
+	this->m_local_runqs.clear_and_dispose(
+	    [](refpointer<workq_detail::local_runq> q) {
+		q->m_dead.store(true, std::memory_order_release);
+		q->m_runq.clear();
+	    });
 
 	atomic_store(&this->m_wakeup_cb, nullptr);
 }
 
+/*
+ * Put wq on a runq.
+ *
+ * A worker is woken up only if the workq was not on a runq yet:
+ * otherwise the wakeup for the queued workq covers its new jobs.
+ * Parallel jobs can use an additional worker, so they always wake one.
+ */
 void
-workq_service::wq_to_runq(workq_detail::workq_intref<workq> wq) noexcept
-{
-	/* Load insert position suitable for this thread. */
-	auto ipos = this->get_runq_iterpos();
-	this->m_wq_runq.link(++ipos, wq);
-	this->wakeup();
+workq_service::wq_to_runq(workq_detail::workq_intref<workq> wq,
+    bool parallel) noexcept
+{
+	bool linked;
+
+	if (wq->m_node != numa::NO_NODE) {
+		/* Placed workqs go on the runq of their node. */
+		linked = this->m_node_runqs[wq->m_node].link_back(
+		    std::move(wq));
+	} else if (auto q = this->get_local_runq()) {
+		/* Workqs activated from within a worker go on its local runq. */
+		linked = q->m_runq.link_back(std::move(wq));
+	} else
+		linked = this->m_wq_runq.link_back(std::move(wq));
+
+	if (linked || parallel)
+		this->wakeup();
 }
 
 void
@@ -950,6 +1715,16 @@ workq_service::wakeup(std::size_t count) noexcept
 	 * one workq_service_ptr, therefore the pointer can be safely
 	 * constructed as argument to the callback.
 	 */
+	if (auto idle = this->m_idle_hint.load(std::memory_order_acquire)) {
+		/*
+		 * Nobody sleeps: a busy thread picks up the work.
+		 * Pairs with the fence of a thread going idle.
+		 */
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (idle->load(std::memory_order_relaxed) == 0U)
+			return;
+	}
+
 	auto cb = atomic_load(&this->m_wakeup_cb);
 	if (count > threadpool_client_intf::WAKE_ALL)
 		count = threadpool_client_intf::WAKE_ALL;
@@ -962,11 +1737,58 @@ workq_service::wakeup(std::size_t count) noexcept
 }
 
 workq_ptr
-workq_service::new_workq() throw (std::bad_alloc)
+workq_service::new_workq() ILIAS_ASYNC_THROWS(std::bad_alloc)
 {
 	return workq_ptr(new workq(this));
 }
 
+workq_ptr
+workq_service::new_workq(unsigned int node) ILIAS_ASYNC_THROWS(std::bad_alloc, std::invalid_argument)
+{
+	return workq_ptr(new workq(this, false, node));
+}
+
+/*
+ * Acquire an anonymous workq.
+ *
+ * Anonymous workqs are shared between callers,
+ * so only TYPE_PARALLEL jobs should be created on them.
+ * Each thread uses its own slot in the pool, a new workq is only created
+ * when the workq in the slot has no jobs left.
+ */
+workq_ptr
+workq_service::anon_workq() ILIAS_ASYNC_THROWS(std::bad_alloc)
+{
+	auto& slot = this->m_anon[
+	    std::hash<std::thread::id>()(std::this_thread::get_id()) %
+	    ANON_WQS];
+	std::lock_guard<std::mutex> guard{ slot.mtx };
+
+	/*
+	 * A workq in the slot is valid until it removes itself,
+	 * which requires the slot lock.
+	 */
+	if (slot.wq && refcnt_acquire_iff_live(*slot.wq))
+		return workq_ptr(slot.wq, false);
+
+	workq_ptr wq{ new workq(this, true) };
+	slot.wq = wq.get();
+	return wq;
+}
+
+/* Remove a destroyed anonymous workq from the pool. */
+void
+workq_service::anon_remove(const workq& wq) noexcept
+{
+	for (auto& slot : this->m_anon) {
+		std::lock_guard<std::mutex> guard{ slot.mtx };
+		if (slot.wq == &wq) {
+			slot.wq = nullptr;
+			return;
+		}
+	}
+}
+
 bool
 workq_service::aid(unsigned int count) noexcept
 {
@@ -977,6 +1799,9 @@ workq_service::aid(unsigned int count) noexcept
 
 	unsigned int i;
 
+	/* Activate jobs with expired timers. */
+	this->m_timers->expire();
+
 	for (i = 0; i < count; ++i) {
 		/* Run co-runnables before workqs. */
 		if (!this->m_co_runq.empty()) {
@@ -985,10 +1810,13 @@ workq_service::aid(unsigned int count) noexcept
 			while (co.get() && i < count) {
 				/* Acquire lock and
 				 * publish intent to execute. */
-				wq_stack stack{ *co };
+				workq_detail::wq_run_lock lck{ *co };
 
-				if ((ran = co->co_run()))
-					++i;
+				if (lck.get_co()) {
+					wq_stack stack{ std::move(lck) };
+					if ((ran = co->co_run()))
+						++i;
+				}
 				++co;
 			}
 
@@ -1017,7 +1845,19 @@ workq_service::aid(unsigned int count) noexcept
 bool
 workq_service::empty() const noexcept
 {
-	return (this->m_wq_runq.empty() && this->m_co_runq.empty());
+	if (!this->m_wq_runq.empty() || !this->m_co_runq.empty())
+		return false;
+
+	for (unsigned int node = 0; node < this->m_nodes; ++node) {
+		if (!this->m_node_runqs[node].empty())
+			return false;
+	}
+
+	for (const auto& q : this->m_local_runqs) {
+		if (!q.m_runq.empty())
+			return false;
+	}
+	return true;
 }
 
 
@@ -1027,6 +1867,9 @@ namespace workq_detail {
 void
 wq_deleter::operator()(const workq_job* wqj) const noexcept
 {
+	/* Prevent the timer from activating the job during destruction. */
+	const_cast<workq_job*>(wqj)->cancel_timer();
+
 	wqj->get_workq()->m_runq.erase(
 	    wqj->get_workq()->m_runq.iterator_to(
 	    const_cast<workq_job&>(*wqj)));
@@ -1070,18 +1913,12 @@ wq_deleter::operator()(const workq_service* wqs) const noexcept
 	atomic_store(&const_cast<workq_service*>(wqs)->m_wakeup_cb, nullptr);
 
 	/*
-	 * Check if this wqs is being destroyed from within
-	 * its own worker thread, then perform special handling.
-	 *
-	 * Uses publish_wqs provided tls data.
+	 * Worker threads may still be running this wqs
+	 * (including the current thread): the last internal reference
+	 * performs the destruction.
 	 */
-	auto& tls = get_wq_tls();
-	if (tls.wqs == wqs) {
-		wqs->int_suicide.store(true, std::memory_order_release);
-		return;
-	}
-
-	delete wqs;
+	workq_intref<const workq_service> wqs_ptr{ wqs };
+	wqs->int_suicide.store(true, std::memory_order_release);
 }
 
 
@@ -1096,7 +1933,7 @@ private:
 
 public:
 	job_single(workq_ptr wq, std::function<void()> fn,
-	    unsigned int type = 0) throw (std::invalid_argument)
+	    unsigned int type = 0) ILIAS_ASYNC_THROWS(std::invalid_argument)
 	:	workq_job(std::move(wq), type),
 		m_fn(std::move(fn))
 	{
@@ -1123,12 +1960,298 @@ job_single::run() noexcept
 
 workq_job_ptr
 workq::new_job(unsigned int type, std::function<void()> fn)
-    throw (std::bad_alloc, std::invalid_argument)
+    ILIAS_ASYNC_THROWS(std::bad_alloc, std::invalid_argument)
 {
 	return new_workq_job<job_single>(workq_ptr(this), std::move(fn), type);
 }
 
 
+namespace {
+
+
+/*
+ * Storage recycling for inline jobs.
+ *
+ * Each thread caches up to CACHE_MAX blocks.
+ * Threads exchange blocks in batches through a shared depot,
+ * so storage freed by a worker thread can be reused by the thread
+ * that creates the jobs.
+ *
+ * Jobs of workqs placed on a numa node use blocks carved from memory
+ * on that node.  Each node has its own depot and each thread caches
+ * blocks of one node at a time, next to the blocks from the heap.
+ * Node memory is never released, it stays in the depot of its node.
+ * A header in front of each block records the node of the block.
+ */
+class inline_job_storage
+{
+public:
+	static const std::size_t SIZE = sizeof(workq_detail::inline_job);
+	static const unsigned int CACHE_MAX = 64;
+	static const unsigned int BATCH = 32;
+	static const std::size_t DEPOT_MAX = 1024;
+	/* Header size, keeps the job aligned. */
+	static const std::size_t HDR = alignof(std::max_align_t);
+	/* Number of blocks carved from each allocation of node memory. */
+	static const std::size_t CHUNK = 256;
+
+private:
+	struct block
+	{
+		block* next;
+	};
+
+	struct depot
+	{
+		std::mutex mtx;
+		block* head{ nullptr };
+		std::size_t n{ 0U };
+	};
+
+	struct cache
+	{
+		block* head{ nullptr };
+		unsigned int n{ 0U };
+	};
+
+	/* Heap blocks. */
+	cache m_heap;
+	/* Blocks of node m_node. */
+	cache m_node_cache;
+	unsigned int m_node{ numa::NO_NODE };
+
+	/* Node recorded in the header of a block. */
+	static unsigned int&
+	node_of(block* b) noexcept
+	{
+		return *reinterpret_cast<unsigned int*>(
+		    reinterpret_cast<char*>(b) - HDR);
+	}
+
+	/* Depot for blocks of node, or for heap blocks. */
+	static depot&
+	get_depot(unsigned int node) noexcept
+	{
+		static depot impl;
+		static const std::unique_ptr<depot[]> nodes{
+			new depot[numa::nodes()]
+		};
+
+		return (node == numa::NO_NODE ? impl : nodes[node]);
+	}
+
+	/* Release a block to the depot, with the depot locked. */
+	static void
+	to_depot(depot& d, block* b, unsigned int node) noexcept
+	{
+		if (node == numa::NO_NODE && d.n >= DEPOT_MAX) {
+			::operator delete(reinterpret_cast<char*>(b) - HDR);
+		} else {
+			b->next = d.head;
+			d.head = b;
+			++d.n;
+		}
+	}
+
+	/* Move up to count blocks from the cache to the depot. */
+	static void
+	flush(cache& c, unsigned int count, unsigned int node) noexcept
+	{
+		auto& d = get_depot(node);
+		std::lock_guard<std::mutex> guard{ d.mtx };
+		while (count-- > 0U && c.head) {
+			block* b = c.head;
+			c.head = b->next;
+			--c.n;
+			to_depot(d, b, node);
+		}
+	}
+
+	/* Move a batch of blocks from the depot to the cache. */
+	static void
+	refill(cache& c, unsigned int node) noexcept
+	{
+		auto& d = get_depot(node);
+		std::lock_guard<std::mutex> guard{ d.mtx };
+		for (unsigned int i = 0; i < BATCH && d.head; ++i) {
+			block* b = d.head;
+			d.head = b->next;
+			--d.n;
+
+			b->next = c.head;
+			c.head = b;
+			++c.n;
+		}
+	}
+
+	/* Carve a chunk of memory on node into blocks, for the depot. */
+	static void
+	grow(unsigned int node) ILIAS_ASYNC_THROWS(std::bad_alloc)
+	{
+		char* p = static_cast<char*>(
+		    numa::alloc_onnode(CHUNK * (HDR + SIZE), node));
+
+		auto& d = get_depot(node);
+		std::lock_guard<std::mutex> guard{ d.mtx };
+		for (std::size_t i = 0; i < CHUNK; ++i, p += HDR + SIZE) {
+			block* b = reinterpret_cast<block*>(p + HDR);
+			node_of(b) = node;
+			to_depot(d, b, node);
+		}
+	}
+
+	static void*
+	allocate(cache& c, unsigned int node) ILIAS_ASYNC_THROWS(std::bad_alloc)
+	{
+		if (!c.head)
+			refill(c, node);
+		if (!c.head && node != numa::NO_NODE) {
+			grow(node);
+			refill(c, node);
+		}
+		if (!c.head) {
+			block* b = reinterpret_cast<block*>(
+			    static_cast<char*>(::operator new(HDR + SIZE)) + HDR);
+			node_of(b) = numa::NO_NODE;
+			return b;
+		}
+
+		block* b = c.head;
+		c.head = b->next;
+		--c.n;
+		return b;
+	}
+
+	static void
+	deallocate(cache& c, block* b, unsigned int node) noexcept
+	{
+		if (c.n >= CACHE_MAX)
+			flush(c, BATCH, node);
+
+		b->next = c.head;
+		c.head = b;
+		++c.n;
+	}
+
+public:
+	inline_job_storage() = default;
+	inline_job_storage(const inline_job_storage&) = delete;
+	inline_job_storage& operator=(const inline_job_storage&) = delete;
+
+	~inline_job_storage() noexcept
+	{
+		flush(this->m_heap, this->m_heap.n, numa::NO_NODE);
+		flush(this->m_node_cache, this->m_node_cache.n, this->m_node);
+	}
+
+	void*
+	allocate(unsigned int node) ILIAS_ASYNC_THROWS(std::bad_alloc)
+	{
+		/* Without numa, node memory is no different from the heap. */
+		if (node == numa::NO_NODE || numa::nodes() == 1U)
+			return allocate(this->m_heap, numa::NO_NODE);
+
+		if (this->m_node != node) {
+			flush(this->m_node_cache, this->m_node_cache.n,
+			    this->m_node);
+			this->m_node = node;
+		}
+		return allocate(this->m_node_cache, node);
+	}
+
+	void
+	deallocate(void* p) noexcept
+	{
+		block* b = static_cast<block*>(p);
+		const unsigned int node = node_of(b);
+
+		if (node == numa::NO_NODE) {
+			deallocate(this->m_heap, b, node);
+		} else if (node == this->m_node) {
+			deallocate(this->m_node_cache, b, node);
+		} else {
+			auto& d = get_depot(node);
+			std::lock_guard<std::mutex> guard{ d.mtx };
+			to_depot(d, b, node);
+		}
+	}
+
+	static inline_job_storage&
+	get() noexcept
+	{
+#if HAS_THREAD_LOCAL
+		static thread_local inline_job_storage m_impl;
+		return m_impl;
+#else
+		static tls_cd<inline_job_storage> m_impl;
+		return *m_impl;
+#endif
+	}
+};
+
+const std::size_t inline_job_storage::SIZE;
+const unsigned int inline_job_storage::CACHE_MAX;
+const unsigned int inline_job_storage::BATCH;
+const std::size_t inline_job_storage::DEPOT_MAX;
+const std::size_t inline_job_storage::HDR;
+const std::size_t inline_job_storage::CHUNK;
+
+
+} /* namespace ilias::<unnamed> */
+
+
+workq_detail::inline_job::~inline_job() noexcept
+{
+	this->m_destroy(&this->m_fn);
+}
+
+void
+workq_detail::inline_job::run() noexcept
+{
+	this->m_invoke(&this->m_fn);
+}
+
+void*
+workq_detail::inline_job::operator new(std::size_t sz) ILIAS_ASYNC_THROWS(std::bad_alloc)
+{
+	assert(sz == inline_job_storage::SIZE);
+	return inline_job_storage::get().allocate(numa::NO_NODE);
+}
+
+void*
+workq_detail::inline_job::operator new(std::size_t sz, on_node n) ILIAS_ASYNC_THROWS(std::bad_alloc)
+{
+	assert(sz == inline_job_storage::SIZE);
+	return inline_job_storage::get().allocate(n.node);
+}
+
+void
+workq_detail::inline_job::operator delete(void* p) noexcept
+{
+	if (p)
+		inline_job_storage::get().deallocate(p);
+}
+
+void
+workq_detail::inline_job::operator delete(void* p, on_node) noexcept
+{
+	operator delete(p);
+}
+
+void
+workq::once_inline(workq_detail::inline_job* j) noexcept
+{
+	/*
+	 * The job has no external references:
+	 * it is destroyed when the last internal reference goes away,
+	 * which is after it has run.
+	 */
+	workq_detail::workq_intref<workq_job> ref{ j };
+	j->int_suicide.store(true, std::memory_order_release);
+	j->activate();
+}
+
+
 class ILIAS_ASYNC_LOCAL coroutine_job
 :	public workq_detail::co_runnable
 {
@@ -1140,7 +2263,7 @@ private:
 
 public:
 	coroutine_job(workq_ptr ptr, std::vector<std::function<void()> > fns,
-	    unsigned int type) throw (std::invalid_argument)
+	    unsigned int type) ILIAS_ASYNC_THROWS(std::invalid_argument)
 	:	workq_detail::co_runnable(std::move(ptr), type),
 		m_coroutines(std::move(fns))
 	{
@@ -1192,7 +2315,7 @@ coroutine_job::co_run() noexcept
 
 workq_job_ptr
 workq::new_job(unsigned int type, std::vector<std::function<void()> > fn)
-    throw (std::bad_alloc, std::invalid_argument)
+    ILIAS_ASYNC_THROWS(std::bad_alloc, std::invalid_argument)
 {
 	if (fn.empty())
 		throw std::invalid_argument("new_job: empty co-routine");
@@ -1233,7 +2356,7 @@ public:
 
 void
 workq::once(std::function<void()> fn)
-    throw (std::bad_alloc, std::invalid_argument)
+    ILIAS_ASYNC_THROWS(std::bad_alloc, std::invalid_argument)
 {
 	/* Create a job that will run once and then kill itself. */
 	auto j =
@@ -1250,7 +2373,7 @@ workq::once(std::function<void()> fn)
 
 void
 workq::once(std::vector<std::function<void()> > fns)
-    throw (std::bad_alloc, std::invalid_argument)
+    ILIAS_ASYNC_THROWS(std::bad_alloc, std::invalid_argument)
 {
 	/* Create a job that will run once and then kill itself. */
 	auto j = new_workq_job<job_once<coroutine_job> >(this,
@@ -1273,7 +2396,7 @@ workq::once(std::vector<std::function<void()> > fns)
  */
 workq_pop_state
 workq_switch(const workq_pop_state& dst)
-    throw (workq_deadlock, workq_stack_error)
+    ILIAS_ASYNC_THROWS(workq_deadlock, workq_stack_error)
 {
 	auto& tls = get_wq_tls();
 	wq_stack*const head = tls.head();
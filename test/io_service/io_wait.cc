@@ -0,0 +1,100 @@
+#include <ilias/io_service.h>
+#include <ilias/threadpool.h>
+#include <ilias/workq.h>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+
+const int COUNT = 1000;
+
+int
+main()
+{
+	int fds[2];
+	assert(pipe2(fds, O_NONBLOCK | O_CLOEXEC) == 0);
+
+	/* Waits completed by aid(), without a threadpool. */
+	{
+		ilias::io_service ios;
+		auto f = ios.wait(fds[0], ilias::io_service::READ);
+		assert(!ios.aid());
+		assert(f.wait_for(std::chrono::seconds(0)) ==
+		    std::future_status::timeout);
+
+		assert(write(fds[1], "x", 1) == 1);
+		assert(ios.aid());
+		assert(f.get() == ilias::io_service::READ);
+
+		/* The completed wait is no longer watched. */
+		assert(!ios.remove(fds[0]));
+		char c;
+		assert(read(fds[0], &c, 1) == 1);
+	}
+
+	/* remove() breaks the promise of a pending wait. */
+	{
+		ilias::io_service ios;
+		auto f = ios.wait(fds[0], ilias::io_service::READ);
+		assert(ios.remove(fds[0]));
+		assert(f.wait_for(std::chrono::seconds(0)) ==
+		    std::future_status::ready);
+
+		bool broken = false;
+		try {
+			f.get();
+		} catch (const std::future_error& e) {
+			broken = (e.code() == std::future_errc::broken_promise);
+		}
+		assert(broken);
+	}
+
+	/*
+	 * Jobs activated by a threadpool that also runs a workq_service.
+	 * Idle workers block in the io_service.
+	 */
+	{
+		ilias::threadpool tp;
+		ilias::tp_service_multiplexer mux;
+		ilias::io_service ios;
+		auto wqs = ilias::new_workq_service();
+		threadpool_attach(mux, tp);
+		threadpool_attach(ios, mux);
+		threadpool_attach(*wqs, mux);
+
+		std::atomic<int> received{ 0 };
+		auto job = wqs->new_workq()->new_job([&]() {
+			char buf[64];
+			ssize_t n;
+			while ((n = read(fds[0], buf, sizeof(buf))) > 0)
+				received += n;
+		    });
+		ios.add(fds[0], ilias::io_service::READ, job);
+
+		for (int i = 0; i < COUNT; ++i) {
+			assert(write(fds[1], "x", 1) == 1);
+			while (received != i + 1)
+				std::this_thread::yield();
+		}
+
+		/* Workq jobs still run while a worker waits for I/O. */
+		std::atomic<bool> ran{ false };
+		wqs->new_workq()->once([&ran]() { ran = true; });
+		while (!ran)
+			std::this_thread::yield();
+
+		/* Futures completed by the threadpool. */
+		auto f = ios.wait(fds[1], ilias::io_service::WRITE);
+		assert(f.get() == ilias::io_service::WRITE);
+
+		ios.remove(fds[0]);
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+
+	close(fds[0]);
+	close(fds[1]);
+	return 0;
+}
@@ -0,0 +1,73 @@
+#include "list_test.h"
+#include <thread>
+
+using counted_list = ilias::ll_smartptr_list<test_obj, void,
+    ilias::default_refcount_mgr<test_obj>, ilias::ll_size_counted>;
+
+const unsigned int COUNT = 10000;
+
+void
+test()
+{
+	counted_list lst;
+	if (lst.size() != 0)
+		std::abort();
+
+	lst.link_back(new_test_obj());
+	lst.link_front(new_test_obj());
+	lst.link(lst.begin(), new_test_obj());
+	lst.link(lst.end(), new_test_obj());
+	if (lst.size() != 4)
+		std::abort();
+
+	/* Linking next to an iterator counts. */
+	auto after = lst.link_after(lst.begin(), new_test_obj());
+	if (!after.second || after.first == lst.end() || lst.size() != 5)
+		std::abort();
+	auto before = lst.link_before(after.first, new_test_obj());
+	if (!before.second || before.first == lst.end() || lst.size() != 6)
+		std::abort();
+	const counted_list& clst = lst;
+	if (!lst.link_after(clst.begin(), new_test_obj()).second ||
+	    !lst.link_before(clst.end(), new_test_obj()).second ||
+	    lst.size() != 8)
+		std::abort();
+	if (lst.link_after(lst.begin(), before.first.get()).second ||
+	    lst.size() != 8)
+		std::abort();
+	for (unsigned int i = 0; i < 4; ++i)
+		lst.pop_back();
+	if (lst.size() != 4)
+		std::abort();
+
+	/* Linking an already linked element does not count. */
+	if (lst.link_back(lst.begin().get()) || lst.size() != 4)
+		std::abort();
+
+	lst.erase(lst.begin());
+	lst.pop_back();
+	if (lst.size() != 2)
+		std::abort();
+
+	lst.clear();
+	if (lst.size() != 0 || !lst.empty())
+		std::abort();
+
+	/* Concurrent producers and consumers. */
+	std::thread producer{ [&lst]() {
+		for (unsigned int i = 0; i < COUNT; ++i)
+			lst.link_back(new_test_obj());
+	    } };
+	unsigned int popped = 0;
+	while (popped < COUNT / 2) {
+		if (lst.pop_front())
+			++popped;
+	}
+	producer.join();
+
+	if (lst.size() != COUNT - popped)
+		std::abort();
+	lst.clear();
+	if (lst.size() != 0)
+		std::abort();
+}
@@ -0,0 +1,51 @@
+#include <ilias/ll_queue.h>
+#include <future>
+#include "test.h"
+
+using namespace ilias;
+
+using queue = ll_queue<int, no_intrusive_tag, ll_size_counted>;
+
+const int COUNT = 100000;
+
+void push_back(queue* q) {
+  for (int i = 0; i < COUNT; ++i)
+    q->push_back(i);
+}
+
+void pop_front(queue* q, int n) {
+  while (n > 0) {
+    if (q->pop_front()) --n;
+  }
+}
+
+int main() {
+  queue q;
+  test(q.size() == 0U, "empty queue has size() == 0");
+
+  q.push_back(1);
+  q.push_front(0);
+  q.emplace_back(2);
+  test(q.size() == 3U, "queue has 3 elements");
+  q.pop_front();
+  test(q.size() == 2U, "queue has 2 elements after pop");
+  q.pop_front();
+  q.pop_front();
+  test(q.size() == 0U, "queue has 0 elements after popping all");
+  test(!q.pop_front(), "pop from empty queue yields nothing");
+  test(q.size() == 0U, "failed pop does not change size");
+
+  /* 2 producers, 2 consumers. */
+  auto pop_1 = std::async(std::launch::async, &pop_front, &q, COUNT / 2);
+  auto pop_2 = std::async(std::launch::async, &pop_front, &q, COUNT / 2);
+  auto push_a = std::async(std::launch::async, &push_back, &q);
+  auto push_b = std::async(std::launch::async, &push_back, &q);
+  push_a.get();
+  push_b.get();
+  pop_1.get();
+  pop_2.get();
+  test(q.size() == static_cast<queue::size_type>(COUNT),
+       "size matches after concurrent push and pop");
+
+  return 0;
+}
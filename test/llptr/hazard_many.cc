@@ -0,0 +1,73 @@
+#include <ilias/hazard.h>
+#include <atomic>
+#include <cassert>
+#include <thread>
+#include <vector>
+
+/* More threads than fit in a single hazard segment. */
+const unsigned int THREADS = 200;
+
+struct alignas(2) owner_type {};
+
+using hazard_type = ilias::hazard<owner_type, int>;
+
+owner_type owner;
+int value;
+
+void
+run(unsigned int rounds)
+{
+	std::atomic<unsigned int> entered{ 0U };
+	std::atomic<unsigned int> granted{ 0U };
+	std::atomic<bool> go{ false };
+
+	for (unsigned int r = 0; r < rounds; ++r) {
+		entered = 0U;
+		granted = 0U;
+		go = false;
+
+		/* All threads hold a hazard at the same time. */
+		std::vector<std::thread> threads;
+		for (unsigned int i = 0; i < THREADS; ++i) {
+			threads.emplace_back([&]() {
+				hazard_type hz{ owner };
+				hz.do_hazard(value,
+				    [&]() {
+					++entered;
+					while (!go)
+						std::this_thread::yield();
+				    },
+				    [&]() {
+					++granted;
+				    });
+			    });
+		}
+		while (entered != THREADS)
+			std::this_thread::yield();
+
+		/* Grant hands a reference to each of them. */
+		std::size_t acquired = 0U, released = 0U;
+		hazard_type::grant(
+		    [&acquired](std::size_t n) { acquired += n; },
+		    [&released](std::size_t n) { released += n; },
+		    owner, value);
+		assert(acquired - released == THREADS);
+
+		go = true;
+		for (auto& t : threads)
+			t.join();
+		assert(granted == THREADS);
+
+		/* No hazards remain. */
+		hazard_type::wait_unused(owner, value);
+		assert(hazard_type::grant_n(owner, value, 1U) == 0U);
+	}
+}
+
+int
+main()
+{
+	/* Slots of exited threads are reused in the second round. */
+	run(2);
+	return 0;
+}
@@ -0,0 +1,100 @@
+#include <ilias/llptr.h>
+#include <atomic>
+#include <cassert>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+const unsigned int READERS = 3;
+const unsigned int STORES = 20000;
+
+std::atomic<unsigned int> live{ 0U };
+
+class test_class
+:	public ilias::refcount_base<test_class>
+{
+public:
+	static constexpr unsigned int MAGIC = 0x600dU;
+
+	unsigned int magic = MAGIC;
+
+	test_class() noexcept
+	{
+		++live;
+	}
+
+	~test_class() noexcept
+	{
+		magic = 0U;
+		--live;
+	}
+};
+
+using pointer = ilias::llptr<test_class,
+    ilias::default_refcount_mgr<test_class>, 2, ilias::epoch_reclaim>;
+using simple_ptr = ilias::refpointer<test_class>;
+using expect_type = std::tuple<simple_ptr, std::bitset<2>>;
+
+expect_type
+expect_value(simple_ptr ptr) noexcept
+{
+	return expect_type{ std::move(ptr), 0 };
+}
+
+int
+main()
+{
+	/* Single threaded: releases are deferred until synchronize. */
+	{
+		simple_ptr v1 = new test_class();
+		simple_ptr v2 = new test_class();
+		pointer p{ expect_value(v1) };
+
+		assert(p.load() == expect_value(v1));
+		assert(p.exchange(expect_value(v2)) == expect_value(v1));
+		assert(p.load() == expect_value(v2));
+
+		auto expect = expect_value(v1);
+		assert(!p.compare_exchange_strong(expect, expect_value(v1)));
+		assert(expect == expect_value(v2));
+		assert(p.compare_exchange_strong(expect, expect_value(v1)));
+		assert(p.load() == expect_value(v1));
+
+		v1 = nullptr;
+		v2 = nullptr;
+		std::get<0>(expect) = nullptr;
+		p.store(expect_value(nullptr));
+		ilias::epoch_synchronize();
+		assert(live == 0U);
+	}
+
+	/* Readers never observe a destroyed object. */
+	{
+		pointer p{ expect_value(new test_class()) };
+		std::atomic<bool> done{ false };
+
+		std::vector<std::thread> readers;
+		for (unsigned int i = 0; i < READERS; ++i) {
+			readers.emplace_back([&p, &done]() {
+				while (!done) {
+					auto v = p.load(std::memory_order_acquire);
+					assert(std::get<0>(v) != nullptr);
+					assert(std::get<0>(v)->magic ==
+					    test_class::MAGIC);
+				}
+			    });
+		}
+
+		for (unsigned int i = 0; i < STORES; ++i)
+			p.store(expect_value(new test_class()));
+		done = true;
+		for (auto& t : readers)
+			t.join();
+
+		p.store(expect_value(nullptr));
+		ilias::epoch_synchronize();
+		assert(live == 0U);
+	}
+
+	return 0;
+}
@@ -0,0 +1,128 @@
+#include <ilias/refcnt.h>
+#include <atomic>
+#include <cassert>
+#include <thread>
+#include <vector>
+
+const int COUNT = 100000;
+const int THREADS = 4;
+
+std::atomic<int> live{ 0 };
+
+class obj
+:	public ilias::biased_refcount_base<obj>
+{
+public:
+	obj() noexcept
+	{
+		++live;
+	}
+
+	~obj() noexcept
+	{
+		--live;
+	}
+};
+
+using obj_ptr = ilias::refpointer<obj>;
+
+int
+main()
+{
+	/* Local reference traffic while biased. */
+	{
+		obj_ptr p{ new obj() };
+		{
+			ilias::refcnt_bias_guard<obj> bias{ *p };
+			assert(bias);
+			assert(refcnt_is_solo(*p));
+
+			std::vector<obj_ptr> copies(COUNT, p);
+			assert(!refcnt_is_solo(*p));
+			copies.clear();
+			assert(refcnt_is_solo(*p));
+
+			/* Nested guards. */
+			ilias::refcnt_bias_guard<obj> nested{ *p };
+			assert(nested);
+		}
+		assert(refcnt_is_solo(*p));
+		p.reset();
+		assert(live == 0);
+	}
+
+	/* Last reference released while biased: deleted when bias ends. */
+	{
+		obj_ptr p{ new obj() };
+		const obj& o = *p;
+		{
+			ilias::refcnt_bias_guard<obj> bias{ o };
+			p.reset();
+			assert(refcnt_is_zero(o));
+			assert(live == 1);
+		}
+		assert(live == 0);
+	}
+
+	/*
+	 * Other threads release references acquired by the owner,
+	 * and acquire references that the owner releases.
+	 * Another thread cannot bias an object that is already biased.
+	 */
+	{
+		obj_ptr p{ new obj() };
+		std::vector<obj_ptr> handoff;
+		std::vector<std::thread> threads;
+		{
+			ilias::refcnt_bias_guard<obj> bias{ *p };
+			handoff.assign(THREADS * COUNT / 10, p);
+
+			for (int t = 0; t < THREADS; ++t) {
+				threads.emplace_back([&handoff, p, t]() {
+					ilias::refcnt_bias_guard<obj> other{ *p };
+					assert(!other);
+
+					const auto n = handoff.size() / THREADS;
+					for (auto i = t * n; i != (t + 1) * n; ++i)
+						handoff[i].reset();
+
+					std::vector<obj_ptr> mine(COUNT / 10, p);
+				    });
+			}
+			for (auto& t : threads)
+				t.join();
+			threads.clear();
+			assert(refcnt_is_solo(*p));
+			p.reset();
+			assert(live == 1);
+		}
+		assert(live == 0);
+	}
+
+	/* Concurrent traffic from owner and other threads. */
+	{
+		obj_ptr p{ new obj() };
+		std::vector<std::thread> threads;
+		for (int t = 0; t < THREADS; ++t) {
+			threads.emplace_back([p]() {
+				for (int i = 0; i < COUNT; ++i) {
+					obj_ptr q = p;
+					ilias::refcnt_bias_guard<obj> bias{ *q };
+					obj_ptr r = q;
+				}
+			    });
+		}
+		{
+			ilias::refcnt_bias_guard<obj> bias{ *p };
+			for (int i = 0; i < COUNT; ++i)
+				obj_ptr q = p;
+		}
+		for (auto& t : threads)
+			t.join();
+		assert(refcnt_is_solo(*p));
+		p.reset();
+		assert(live == 0);
+	}
+
+	return 0;
+}
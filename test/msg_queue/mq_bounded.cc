@@ -0,0 +1,115 @@
+#include <ilias/msg_queue.h>
+#include <ilias/mq_ptr.h>
+#include <ilias/threadpool.h>
+#include <ilias/workq.h>
+#include <ilias/wq_callback.h>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+const int COUNT = 10000;
+
+int
+main()
+{
+	/* try_enqueue fails on a full queue, dequeue frees up space. */
+	{
+		ilias::msg_queue<int> mq{ ilias::mq_capacity(2) };
+		assert(mq.capacity() == 2);
+		assert(mq.try_enqueue(1));
+		assert(mq.try_enqueue(2));
+		assert(!mq.try_enqueue(3));
+
+		int sum = 0;
+		mq.dequeue([&sum](int v) { sum += v; });
+		assert(sum == 1);
+		assert(mq.try_enqueue(3));
+		mq.dequeue([&sum](int v) { sum += v; }, 2);
+		assert(sum == 6 && mq.empty());
+	}
+
+	/* Waiting producers are admitted in FIFO order. */
+	{
+		ilias::msg_queue<int> mq{ ilias::mq_capacity(1) };
+		auto f0 = mq.enqueue_async(0);
+		auto f1 = mq.enqueue_async(1);
+		auto f2 = mq.enqueue_async(2);
+		assert(f0.wait_for(std::chrono::seconds(0)) ==
+		    ilias::future_status::ready);
+		assert(f1.wait_for(std::chrono::seconds(0)) ==
+		    ilias::future_status::timeout);
+
+		/* Waiting producers are not overtaken. */
+		assert(!mq.try_enqueue(3));
+
+		std::vector<int> order;
+		mq.dequeue([&order](int v) { order.push_back(v); });
+		assert(f1.wait_for(std::chrono::seconds(0)) ==
+		    ilias::future_status::ready);
+		assert(f2.wait_for(std::chrono::seconds(0)) ==
+		    ilias::future_status::timeout);
+		mq.dequeue([&order](int v) { order.push_back(v); }, 2);
+		assert(f2.wait_for(std::chrono::seconds(0)) ==
+		    ilias::future_status::ready);
+		mq.dequeue([&order](int v) { order.push_back(v); }, 2);
+		assert((order == std::vector<int>{ 0, 1, 2 }));
+	}
+
+	/* Destroying the queue breaks the promises of waiting producers. */
+	{
+		ilias::cb_future<void> f;
+		{
+			ilias::msg_queue<int> mq{ ilias::mq_capacity(1) };
+			mq.enqueue(0);
+			f = mq.enqueue_async(1);
+		}
+
+		bool broken = false;
+		try {
+			f.get();
+		} catch (const ilias::future_error& e) {
+			broken = (e.code() == ilias::future_errc::broken_promise);
+		}
+		assert(broken);
+	}
+
+	/* Producer and workq consumer, with backpressure. */
+	{
+		/* Declared before the threadpool, which must stop first. */
+		ilias::msg_queue<int> mq{ ilias::mq_capacity(16) };
+		std::atomic<long> sum{ 0 };
+
+		ilias::threadpool tp{ 2 };
+		auto wqs = ilias::new_workq_service();
+		threadpool_attach(*wqs, tp);
+
+		callback(mq, wqs->new_workq(), [&sum](ilias::msg_queue<int>& q) {
+			q.dequeue([&sum](int v) { sum += v; }, SIZE_MAX);
+		    });
+
+		for (int i = 0; i < COUNT; ++i)
+			mq.enqueue_async(i).get();
+		while (sum != long(COUNT) * (COUNT - 1) / 2)
+			std::this_thread::yield();
+		callback(mq, nullptr);
+	}
+
+	/* Bounded queue through mq_in_ptr/mq_out_ptr. */
+	{
+		auto in = ilias::new_mq_ptr<int>(ilias::mq_capacity(1));
+		ilias::mq_out_ptr<int> out = in;
+		assert(in.try_enqueue(1));
+		assert(!in.try_enqueue(2));
+		auto f = in.enqueue_async(2);
+
+		int sum = 0;
+		out.dequeue([&sum](int v) { sum += v; });
+		f.get();
+		out.dequeue([&sum](int v) { sum += v; });
+		assert(sum == 3 && out.empty());
+	}
+
+	return 0;
+}
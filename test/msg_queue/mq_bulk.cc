@@ -0,0 +1,113 @@
+#include <ilias/msg_queue.h>
+#include <ilias/mq_ptr.h>
+#include <cassert>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+const int COUNT = 10000;
+
+template<typename MQ>
+void
+test_bulk()
+{
+	MQ mq;
+	int fired = 0;
+	callback(mq, [&fired](typename MQ::callback_arg_type) { ++fired; });
+
+	/* Bulk enqueue fires the event once. */
+	std::vector<int> in(COUNT);
+	std::iota(in.begin(), in.end(), 0);
+	mq.enqueue_bulk(in);
+	assert(fired == 1);
+
+	/* Bulk dequeue into an output iterator. */
+	std::vector<int> out;
+	assert(mq.dequeue_bulk(std::back_inserter(out), 10) == 10U);
+	assert(out.size() == 10U);
+	for (int i = 0; i < 10; ++i)
+		assert(out[i] == i);
+
+	/* Batch dequeue hands out contiguous runs, in order. */
+	int expect = 10;
+	std::size_t batches = 0;
+	const std::size_t n = mq.dequeue_batch([&](int* b, int* e) {
+		assert(b != e);
+		for (int* i = b; i != e; ++i, ++expect)
+			assert(*i == expect);
+		++batches;
+	    });
+	assert(n == COUNT - 10U);
+	assert(expect == COUNT);
+	assert(batches < n);
+	assert(mq.empty());
+
+	/* Dequeueing from an empty queue yields nothing. */
+	assert(mq.dequeue_bulk(out.begin(), 10) == 0U);
+	assert(mq.dequeue_batch([](int*, int*) { assert(false); }) == 0U);
+}
+
+int
+main()
+{
+	test_bulk<ilias::msg_queue<int>>();
+	test_bulk<ilias::msg_queue<int, std::allocator<int>,
+	    ilias::mq_spsc_policy>>();
+	test_bulk<ilias::msg_queue<int, std::allocator<int>,
+	    ilias::mq_mpsc_policy>>();
+
+	/* A throwing batch functor still consumes the messages. */
+	{
+		ilias::msg_queue<std::shared_ptr<int>> mq;
+		auto p = std::make_shared<int>(7);
+		for (int i = 0; i < 3; ++i)
+			mq.enqueue(p);
+
+		bool caught = false;
+		try {
+			mq.dequeue_batch([](std::shared_ptr<int>*,
+			    std::shared_ptr<int>*) {
+				throw std::runtime_error("batch");
+			    });
+		} catch (const std::runtime_error&) {
+			caught = true;
+		}
+		assert(caught);
+		assert(mq.empty());
+		assert(p.use_count() == 1);
+	}
+
+	/* Bulk dequeue frees capacity on a bounded queue. */
+	{
+		ilias::msg_queue<int> mq{ ilias::mq_capacity(4) };
+		for (int i = 0; i < 4; ++i)
+			assert(mq.try_enqueue(i));
+		assert(!mq.try_enqueue(4));
+
+		int out[4];
+		assert(mq.dequeue_bulk(&out[0], 4) == 4U);
+		assert(mq.try_enqueue(4));
+	}
+
+	/* Via mq_ptr. */
+	{
+		auto in = ilias::new_mq_ptr<int>();
+		ilias::mq_out_ptr<int> out = in;
+
+		const int v[] = { 1, 2, 3 };
+		in.enqueue_bulk(v);
+		in.enqueue_bulk(std::begin(v), std::end(v));
+
+		int sum = 0;
+		out.dequeue_batch([&sum](int* b, int* e) {
+			sum = std::accumulate(b, e, sum);
+		    });
+		assert(sum == 12);
+		assert(out.empty());
+	}
+
+	return 0;
+}
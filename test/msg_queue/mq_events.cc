@@ -0,0 +1,80 @@
+#include <ilias/msg_queue.h>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+const int COUNT = 20000;
+const int THREADS = 3;
+
+using mq_type = ilias::msg_queue<int>;
+
+int
+main()
+{
+	/* A callback replacing itself: the new callback runs next. */
+	{
+		mq_type mq;
+		int first = 0, second = 0;
+
+		callback(mq, [&](mq_type& q) {
+			++first;
+			callback(q, [&second](mq_type& q) {
+				++second;
+				q.dequeue([](int) {}, SIZE_MAX);
+			    });
+		    });
+		mq.enqueue(1);
+		assert(first == 1);
+		assert(second == 1);
+		assert(mq.empty());
+	}
+
+	/* A callback clearing itself stays alive until it returns. */
+	{
+		mq_type mq;
+		auto token = std::make_shared<int>(42);
+		int calls = 0;
+
+		callback(mq, [&calls, token](mq_type& q) {
+			++calls;
+			callback(q, nullptr);
+			assert(*token == 42);
+			q.dequeue([](int) {}, SIZE_MAX);
+		    });
+		mq.enqueue(1);
+		mq.enqueue(2);
+		assert(calls == 1);
+		assert(token.use_count() == 1);
+		assert(!mq.empty());
+	}
+
+	/* Swapping callbacks while producers run does not lose wakeups. */
+	{
+		mq_type mq;
+		std::atomic<int> consumed{ 0 };
+		auto drain = [&consumed](mq_type& q) {
+			q.dequeue([&consumed](int) { ++consumed; }, SIZE_MAX);
+		    };
+
+		callback(mq, drain);
+		std::vector<std::thread> producers;
+		for (int t = 0; t < THREADS; ++t) {
+			producers.emplace_back([&mq]() {
+				for (int i = 0; i < COUNT; ++i)
+					mq.enqueue(i);
+			    });
+		}
+		for (int i = 0; i < 1000; ++i)
+			callback(mq, drain);
+		for (auto& t : producers)
+			t.join();
+
+		assert(consumed == THREADS * COUNT);
+		assert(mq.empty());
+	}
+
+	return 0;
+}
@@ -0,0 +1,122 @@
+#include <ilias/msg_queue.h>
+#include <ilias/mq_ptr.h>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+const int COUNT = 100000;
+const int THREADS = 4;
+
+template<typename Type>
+using spsc_queue =
+    ilias::msg_queue<Type, std::allocator<Type>, ilias::mq_spsc_policy>;
+template<typename Type>
+using mpsc_queue =
+    ilias::msg_queue<Type, std::allocator<Type>, ilias::mq_mpsc_policy>;
+
+int
+main()
+{
+	/* Messages come out in order, across multiple segments. */
+	{
+		spsc_queue<int> mq;
+		assert(mq.empty());
+		for (int i = 0; i < COUNT; ++i)
+			mq.enqueue(i);
+		assert(!mq.empty());
+
+		int expect = 0;
+		mq.dequeue([&expect](int v) {
+			assert(v == expect);
+			++expect;
+		    }, SIZE_MAX);
+		assert(expect == COUNT);
+		assert(mq.empty());
+	}
+
+	/* Remaining messages are destroyed with the queue. */
+	{
+		auto p = std::make_shared<int>(0);
+		{
+			spsc_queue<std::shared_ptr<int>> mq;
+			for (int i = 0; i < COUNT / 10; ++i)
+				mq.enqueue(p);
+			mq.dequeue([](std::shared_ptr<int>) {}, COUNT / 20);
+		}
+		assert(p.use_count() == 1);
+	}
+
+	/* Concurrent single producer and consumer, with events. */
+	{
+		spsc_queue<int> mq;
+		std::atomic<int> events{ 0 };
+		callback(mq, [&events](spsc_queue<int>&) { ++events; });
+
+		std::thread producer([&mq]() {
+			for (int i = 0; i < COUNT; ++i)
+				mq.enqueue(i);
+		    });
+
+		int expect = 0;
+		while (expect < COUNT) {
+			mq.dequeue([&expect](int v) {
+				assert(v == expect);
+				++expect;
+			    }, SIZE_MAX);
+		}
+		producer.join();
+		assert(events > 0);
+		callback(mq, nullptr);
+	}
+
+	/* Multiple producers: each producer's messages stay in order. */
+	{
+		mpsc_queue<std::uint64_t> mq;
+		std::vector<std::thread> producers;
+		for (int t = 0; t < THREADS; ++t) {
+			producers.emplace_back([&mq, t]() {
+				for (int i = 0; i < COUNT; ++i) {
+					mq.enqueue(std::uint64_t(t) << 32 |
+					    std::uint64_t(i));
+				}
+			    });
+		}
+
+		std::vector<int> next(THREADS, 0);
+		int total = 0;
+		while (total < THREADS * COUNT) {
+			mq.dequeue([&](std::uint64_t v) {
+				const int t = int(v >> 32);
+				const int i = int(v & 0xffffffffU);
+				assert(next[t] == i);
+				++next[t];
+				++total;
+			    }, SIZE_MAX);
+		}
+		for (auto& t : producers)
+			t.join();
+		assert(mq.empty());
+	}
+
+	/* Ring queues through mq_in_ptr/mq_out_ptr. */
+	{
+		using in_ptr = ilias::mq_in_ptr<int, std::allocator<int>,
+		    ilias::mq_mpsc_policy>;
+		using out_ptr = ilias::mq_out_ptr<int, std::allocator<int>,
+		    ilias::mq_mpsc_policy>;
+
+		in_ptr in = in_ptr::create();
+		out_ptr out = in;
+
+		for (int i = 0; i < 10; ++i)
+			in.enqueue(i);
+		int sum = 0;
+		out.dequeue([&sum](int v) { sum += v; }, SIZE_MAX);
+		assert(sum == 45 && out.empty());
+	}
+
+	return 0;
+}
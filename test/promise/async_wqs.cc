@@ -0,0 +1,31 @@
+#include <ilias/future.h>
+#include <ilias/threadpool.h>
+#include <ilias/workq.h>
+#include <cassert>
+#include <vector>
+
+const int COUNT = 1000;
+
+int
+main()
+{
+	ilias::threadpool tp{ 2 };
+	auto wqs = ilias::new_workq_service();
+	threadpool_attach(*wqs, tp);
+
+	/* While in use, the anonymous workq is shared. */
+	{
+		auto wq = wqs->anon_workq();
+		assert(wqs->anon_workq() == wq);
+	}
+
+	std::vector<ilias::cb_future<int>> futures;
+	for (int i = 0; i < COUNT; ++i)
+		futures.push_back(ilias::async(wqs, [](int v) { return v; }, i));
+
+	long sum = 0;
+	for (auto& f : futures)
+		sum += f.get();
+	assert(sum == long(COUNT) * (COUNT - 1) / 2);
+	return 0;
+}
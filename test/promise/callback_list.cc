@@ -0,0 +1,78 @@
+#include <ilias/future.h>
+#include <atomic>
+#include <cassert>
+#include <thread>
+#include <vector>
+
+const int THREADS = 4;
+const int COUNT = 1000;
+
+int
+main()
+{
+	/* Callbacks run in the order they were installed. */
+	{
+		ilias::cb_promise<int> p;
+		auto f = p.get_future().share();
+		std::vector<int> order;
+
+		for (int i = 0; i < 3; ++i) {
+			callback(f, [&order, i](ilias::shared_cb_future<int> v) {
+				assert(v.get() == 7);
+				order.push_back(i);
+			    });
+		}
+		p.set_value(7);
+		assert((order == std::vector<int>{ 0, 1, 2 }));
+
+		/* Callback on a ready future runs immediately. */
+		callback(f, [&order](ilias::shared_cb_future<int>) {
+			order.push_back(3);
+		    });
+		assert(order.size() == 4 && order.back() == 3);
+	}
+
+	/* Installing callbacks races with completion. */
+	{
+		ilias::cb_promise<int> p;
+		auto f = p.get_future().share();
+		std::atomic<int> count{ 0 };
+		std::vector<std::thread> threads;
+
+		for (int t = 0; t < THREADS; ++t) {
+			threads.emplace_back([f, &count]() {
+				for (int i = 0; i < COUNT; ++i) {
+					callback(f,
+					    [&count](ilias::shared_cb_future<int> v) {
+						assert(v.get() == 42);
+						++count;
+					    });
+				}
+			    });
+		}
+		p.set_value(42);
+		for (auto& t : threads)
+			t.join();
+		assert(count == THREADS * COUNT);
+	}
+
+	/* Multiple dependants on the same future. */
+	{
+		ilias::cb_promise<int> p;
+		auto f = p.get_future().share();
+		std::vector<ilias::cb_future<int>> deps;
+
+		for (int i = 0; i < 3; ++i) {
+			deps.push_back(ilias::async_lazy(
+			    [i](int v) {
+				return v + i;
+			    },
+			    f));
+		}
+		p.set_value(10);
+		for (int i = 0; i < 3; ++i)
+			assert(deps[i].get() == 10 + i);
+	}
+
+	return 0;
+}
@@ -0,0 +1,118 @@
+#include <ilias/coroutine.h>
+#include <ilias/future.h>
+#include <ilias/threadpool.h>
+#include <ilias/workq.h>
+#include <cassert>
+#include <stdexcept>
+#include <thread>
+
+const int COUNT = 1000;
+
+ilias::cb_future<int>
+add(ilias::cb_future<int> x, int y)
+{
+	co_return co_await std::move(x) + y;
+}
+
+ilias::cb_future<int>
+sum_shared(ilias::shared_cb_future<int> x, int n)
+{
+	int sum = 0;
+	for (int i = 0; i < n; ++i)
+		sum += co_await x;
+	co_return sum;
+}
+
+ilias::cb_future<void>
+rethrow(ilias::cb_future<int> x)
+{
+	try {
+		co_await std::move(x);
+	} catch (const std::runtime_error&) {
+		throw std::logic_error("rethrown");
+	}
+}
+
+ilias::cb_future<std::thread::id>
+hop(ilias::workq_ptr wq)
+{
+	co_await wq;
+	co_return std::this_thread::get_id();
+}
+
+ilias::cb_future<int>
+chain(int n)
+{
+	if (n == 0)
+		co_return 0;
+	co_return co_await chain(n - 1) + 1;
+}
+
+int
+main()
+{
+	/* Await a future that completes later. */
+	{
+		ilias::cb_promise<int> p;
+		auto f = add(p.get_future(), 1);
+		p.set_value(41);
+		assert(f.get() == 42);
+	}
+
+	/* Await a future that is already complete. */
+	{
+		ilias::cb_promise<int> p;
+		p.set_value(1);
+		assert(add(p.get_future(), 2).get() == 3);
+	}
+
+	/* Await the same shared future repeatedly. */
+	{
+		ilias::cb_promise<int> p;
+		auto f = sum_shared(p.get_future().share(), 3);
+		p.set_value(5);
+		assert(f.get() == 15);
+	}
+
+	/* Exceptions propagate through co_await. */
+	{
+		ilias::cb_promise<int> p;
+		auto f = rethrow(p.get_future());
+		p.set_exception(std::make_exception_ptr(
+		    std::runtime_error("fail")));
+
+		bool caught = false;
+		try {
+			f.get();
+		} catch (const std::logic_error&) {
+			caught = true;
+		}
+		assert(caught);
+	}
+
+	/* Nested coroutines. */
+	assert(chain(COUNT).get() == COUNT);
+
+	/* Hop onto a workq, run by aid(). */
+	{
+		auto wqs = ilias::new_workq_service();
+		auto f = hop(wqs->new_workq());
+		assert(f.wait_for(std::chrono::seconds(0)) ==
+		    ilias::future_status::timeout);
+		while (wqs->aid())
+			;
+		assert(f.get() == std::this_thread::get_id());
+	}
+
+	/* Hop onto a workq, run by a threadpool. */
+	{
+		ilias::threadpool tp{ 1 };
+		auto wqs = ilias::new_workq_service();
+		threadpool_attach(*wqs, tp);
+
+		auto f = hop(wqs->new_workq());
+		assert(f.get() != std::this_thread::get_id());
+	}
+
+	return 0;
+}
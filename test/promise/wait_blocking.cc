@@ -0,0 +1,24 @@
+#include <ilias/future.h>
+#include <chrono>
+#include <thread>
+
+int
+main()
+{
+	ilias::cb_promise<int> p;
+	ilias::cb_future<int> f = p.get_future();
+
+	/* Nothing will be assigned: wait must time out. */
+	assert(f.wait_for(std::chrono::milliseconds(20)) ==
+	    std::future_status::timeout);
+
+	/* Waiter parks, assignment must wake it up. */
+	std::thread t{ [&p]() {
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		p.set_value(42);
+	    } };
+	assert(f.get() == 42);
+	t.join();
+
+	return 0;
+}
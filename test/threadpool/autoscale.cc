@@ -0,0 +1,49 @@
+#include <ilias/threadpool.h>
+#include <ilias/workq.h>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <thread>
+
+const unsigned int JOBS = 4;
+
+int
+main()
+{
+	ilias::threadpool tp{ 1 };
+	auto wqs = ilias::new_workq_service();
+	threadpool_attach(*wqs, tp);
+
+	ilias::threadpool::autoscale_policy p;
+	p.min_threads = 1U;
+	p.max_threads = JOBS;
+	p.grow_after = std::chrono::milliseconds(1);
+	p.idle_timeout = std::chrono::milliseconds(50);
+	tp.set_autoscale(p);
+
+	/*
+	 * Each job blocks until all jobs are running,
+	 * which requires the pool to grow.
+	 */
+	std::atomic<unsigned int> running{ 0U };
+	for (unsigned int i = 0; i < JOBS; ++i) {
+		wqs->new_workq()->once([&running]() {
+			running.fetch_add(1U);
+			while (running < JOBS)
+				std::this_thread::yield();
+		    });
+	}
+	while (running < JOBS)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	assert(tp.get_nthreads() == JOBS);
+
+	/* Idle threads are retired. */
+	while (tp.get_current_nthreads() > 1U)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	assert(tp.get_nthreads() == 1U);
+
+	/* Manual mode. */
+	tp.set_nthreads(2);
+	assert(tp.get_nthreads() == 2U);
+	return 0;
+}
@@ -0,0 +1,136 @@
+#include <ilias/future.h>
+#include <ilias/threadpool.h>
+#include <ilias/workq.h>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <thread>
+
+const unsigned int NTHREADS = 2;
+const unsigned int UNSATURATED_ROUNDS = 20;
+
+/* Block until released, without giving the thread back to the pool. */
+void
+block(const std::atomic<bool>& released)
+{
+	while (!released.load())
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+/* Wait for flag, bounded so missing compensation fails the test. */
+void
+await(const std::atomic<bool>& flag)
+{
+	const auto deadline = std::chrono::steady_clock::now() +
+	    std::chrono::seconds(30);
+
+	while (!flag.load()) {
+		assert(std::chrono::steady_clock::now() < deadline);
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+int
+main()
+{
+	/* Outside the threadpool, a blocking section does nothing. */
+	{
+		ilias::blocking_section b;
+	}
+
+	ilias::threadpool tp{ NTHREADS };
+	auto wqs = ilias::new_workq_service();
+	threadpool_attach(*wqs, tp);
+
+	/*
+	 * While other workers are idle, the pool is not saturated:
+	 * a blocking section does not add threads.
+	 * A round may race with a worker that is briefly busy,
+	 * but not every round does.
+	 */
+	unsigned int grown = 0U;
+	for (unsigned int i = 0; i < UNSATURATED_ROUNDS; ++i) {
+		std::atomic<bool> done{ false };
+		wqs->new_workq()->once([&]() {
+			const auto before = tp.get_current_nthreads();
+			ilias::blocking_section b;
+			if (tp.get_current_nthreads() > before)
+				++grown;
+			done.store(true);
+		    });
+		await(done);
+	}
+	assert(grown < UNSATURATED_ROUNDS);
+
+	/*
+	 * Once the idle worker picks up work, the pool is saturated:
+	 * the blocked worker is compensated for,
+	 * so further work still runs.
+	 */
+	{
+		std::atomic<bool> entered{ false }, released{ false };
+		std::atomic<bool> ran{ false };
+		wqs->new_workq()->once([&]() {
+			ilias::blocking_section b;
+			entered.store(true);
+			block(released);
+		    });
+		await(entered);
+		wqs->new_workq()->once([&]() {
+			block(released);
+		    });
+		wqs->new_workq()->once([&]() {
+			ran.store(true);
+		    });
+		await(ran);
+		released.store(true);
+	}
+
+	/*
+	 * Occupy every thread with a blocking job;
+	 * the job that releases them can only run on an added thread.
+	 */
+	std::atomic<bool> released{ false };
+	std::atomic<unsigned int> blocked{ 0U };
+	auto job = wqs->new_workq()->new_job(
+	    ilias::workq_job::TYPE_ONCE | ilias::workq_job::TYPE_BLOCKING,
+	    [&]() {
+		blocked.fetch_add(1U);
+		block(released);
+	    });
+	job->activate();
+	auto f = ilias::async(wqs, ilias::launch::blocking, [&]() {
+		blocked.fetch_add(1U);
+		block(released);
+	    });
+	wqs->new_workq()->once([&]() {
+		{
+			ilias::blocking_section b;
+			blocked.fetch_add(1U);
+			block(released);
+		}
+		/* Leaving the section is not blocking. */
+		{
+			ilias::blocking_section b{ false };
+		}
+	    });
+
+	while (blocked < 3U)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	assert(tp.get_current_nthreads() > NTHREADS);
+
+	std::atomic<bool> ran{ false };
+	wqs->new_workq()->once([&]() {
+		ran.store(true);
+		released.store(true);
+	    });
+	f.get();
+	while (!ran)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+	/* The added threads retire. */
+	while (tp.get_current_nthreads() > NTHREADS)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	assert(tp.get_nthreads() == NTHREADS);
+	return 0;
+}
@@ -0,0 +1,55 @@
+#include <ilias/threadpool.h>
+#include <ilias/workq.h>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <thread>
+
+const unsigned int BURSTS = 2000;
+
+/* Run bursts of jobs, separated by short gaps. */
+void
+run_bursts(ilias::workq_service_ptr wqs)
+{
+	std::atomic<unsigned int> counter{ 0U };
+	auto wq = wqs->new_workq();
+
+	for (unsigned int i = 1; i <= BURSTS; ++i) {
+		wq->once([&counter]() { counter.fetch_add(1U); });
+		while (counter != i)
+			std::this_thread::yield();
+		std::this_thread::sleep_for(std::chrono::microseconds(5));
+	}
+}
+
+int
+main()
+{
+	ilias::threadpool tp{ 4 };
+	auto wqs = ilias::new_workq_service();
+	threadpool_attach(*wqs, tp);
+
+	/* Default policy spins. */
+	assert(tp.get_idle_policy().max_spin.count() > 0);
+	run_bursts(wqs);
+
+	/* Spinning workers must die when the pool shrinks. */
+	ilias::threadpool::idle_policy p;
+	p.max_spin = std::chrono::milliseconds(10);
+	p.max_spinners = 4U;
+	p.yield = false;
+	tp.set_idle_policy(p);
+	assert(tp.get_idle_policy().max_spin == p.max_spin);
+	assert(tp.get_idle_policy().max_spinners == 4U);
+	assert(!tp.get_idle_policy().yield);
+	run_bursts(wqs);
+	tp.set_nthreads(1);
+	run_bursts(wqs);
+	tp.set_nthreads(4);
+
+	/* No spinning: workers park immediately. */
+	p.max_spin = std::chrono::nanoseconds::zero();
+	tp.set_idle_policy(p);
+	run_bursts(wqs);
+	return 0;
+}
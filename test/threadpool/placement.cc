@@ -0,0 +1,100 @@
+#include <ilias/numa.h>
+#include <ilias/threadpool.h>
+#include <ilias/workq.h>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+const unsigned int JOBS = 100;
+
+/* Run jobs on a workq and wait for them to complete. */
+void
+run_jobs(const ilias::workq_ptr& wq)
+{
+	std::atomic<unsigned int> ran{ 0U };
+	std::atomic<bool> wrong_node{ false };
+	const auto node = wq->get_node();
+
+	auto job = wq->new_job([&]() {
+		ran.fetch_add(1U);
+	    });
+	for (unsigned int i = 0; i < JOBS; ++i) {
+		wq->once([&]() {
+			if (ilias::numa::current_node() >= ilias::numa::nodes())
+				wrong_node.store(true);
+			ran.fetch_add(1U);
+		    });
+	}
+	job->activate();
+
+	while (ran < JOBS + 1U)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	assert(!wrong_node);
+	assert(node == ilias::numa::NO_NODE || node < ilias::numa::nodes());
+}
+
+int
+main()
+{
+	using ilias::threadpool;
+
+	/* Topology. */
+	const auto& cpus = ilias::numa::cpus();
+	assert(!cpus.empty());
+	assert(std::is_sorted(cpus.begin(), cpus.end()));
+	assert(ilias::numa::nodes() >= 1U);
+	unsigned int n_cpus = 0;
+	for (unsigned int node = 0; node < ilias::numa::nodes(); ++node)
+		n_cpus += ilias::numa::node_cpus(node).size();
+	assert(n_cpus == cpus.size());
+
+	/* One thread per cpu, each pinned to its cpu. */
+	threadpool::placement_policy p;
+	p.pin = threadpool::placement_policy::PIN_CPU;
+	{
+		threadpool tp{ p };
+		assert(tp.get_nthreads() == cpus.size());
+		assert(tp.get_placement().cpus == cpus);
+
+		auto wqs = ilias::new_workq_service();
+		threadpool_attach(*wqs, tp);
+		run_jobs(wqs->new_workq());
+	}
+
+	/* Workers grouped by node; workqs placed on each node. */
+	p.pin = threadpool::placement_policy::PIN_NODE;
+	p.cpus = { cpus.front() };
+	{
+		threadpool tp{ 2, p };
+		assert(tp.get_nthreads() == 2U);
+
+		auto wqs = ilias::new_workq_service();
+		threadpool_attach(*wqs, tp);
+		for (unsigned int node = 0; node < ilias::numa::nodes(); ++node)
+			run_jobs(wqs->new_workq(node));
+		run_jobs(wqs->new_workq());
+
+		bool caught = false;
+		try {
+			wqs->new_workq(ilias::numa::nodes());
+		} catch (const std::invalid_argument&) {
+			caught = true;
+		}
+		assert(caught);
+	}
+
+	/* Cpus must be available to the process. */
+	p.pin = threadpool::placement_policy::PIN_CPUSET;
+	p.cpus = { cpus.back() + 1U };
+	bool caught = false;
+	try {
+		threadpool tp{ p };
+	} catch (const std::invalid_argument&) {
+		caught = true;
+	}
+	assert(caught);
+	return 0;
+}
@@ -0,0 +1,75 @@
+#include <ilias/threadpool.h>
+#include <ilias/workq.h>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <thread>
+
+const unsigned int NTHREADS = 4;
+const unsigned int ROUNDS = 2000;
+
+/* Wait for count to reach n; a lost wakeup shows up as a timeout. */
+void
+await(const std::atomic<unsigned int>& count, unsigned int n)
+{
+	const auto deadline = std::chrono::steady_clock::now() +
+	    std::chrono::seconds(30);
+
+	while (count.load() < n) {
+		assert(std::chrono::steady_clock::now() < deadline);
+		std::this_thread::yield();
+	}
+}
+
+int
+main()
+{
+	ilias::threadpool tp{ NTHREADS };
+	auto wqs = ilias::new_workq_service();
+	threadpool_attach(*wqs, tp);
+	auto wq = wqs->new_workq();
+
+	/* Ping-pong: each job is queued while the workers go idle. */
+	std::atomic<unsigned int> count{ 0U };
+	auto job = wq->new_job([&]() { count.fetch_add(1U); });
+	for (unsigned int i = 0; i < ROUNDS; ++i) {
+		job->activate();
+		await(count, i + 1U);
+		if (i % 100U == 0U) {
+			/* Let the workers fall asleep. */
+			std::this_thread::sleep_for(
+			    std::chrono::milliseconds(20));
+		}
+	}
+
+	/* Burst of jobs on a queued workq: no wakeup per job. */
+	count.store(0U);
+	for (unsigned int i = 0; i < ROUNDS; ++i)
+		wq->once([&]() { count.fetch_add(1U); });
+	await(count, ROUNDS);
+
+	/* Parallel jobs still reach every worker. */
+	std::atomic<unsigned int> running{ 0U };
+	std::atomic<bool> release{ false };
+	auto pjob = wq->new_job(ilias::workq_job::TYPE_PARALLEL |
+	    ilias::workq_job::TYPE_ONCE,
+	    [&]() {
+		running.fetch_add(1U);
+		while (!release.load())
+			std::this_thread::yield();
+	    });
+	pjob->activate();
+	await(running, 1U);
+	release.store(true);
+
+	/* Jobs activated from within a job. */
+	count.store(0U);
+	auto wq2 = wqs->new_workq();
+	for (unsigned int i = 0; i < ROUNDS / 10U; ++i) {
+		wq->once([&]() {
+			wq2->once([&]() { count.fetch_add(1U); });
+		    });
+	}
+	await(count, ROUNDS / 10U);
+	return 0;
+}
@@ -0,0 +1,176 @@
+#include <ilias/uring_service.h>
+#include <ilias/threadpool.h>
+#include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <memory>
+#include <system_error>
+#include <vector>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+const int COUNT = 32;
+
+/* Wait for the future, by aiding the service. */
+template<typename T>
+T
+aid_get(ilias::uring_service& us, ilias::cb_future<T>& f)
+{
+	while (f.wait_for(std::chrono::seconds(0)) !=
+	    std::future_status::ready)
+		us.aid();
+	return f.get();
+}
+
+int
+main()
+{
+	std::unique_ptr<ilias::uring_service> probe;
+	try {
+		probe.reset(new ilias::uring_service());
+	} catch (const std::system_error& e) {
+		/* Kernel without io_uring, or io_uring disabled. */
+		if (e.code().value() == ENOSYS || e.code().value() == EPERM)
+			return 0;
+		throw;
+	}
+	probe.reset();
+
+	/* Pipe I/O, completed by aid(). */
+	{
+		ilias::uring_service us;
+		int p[2];
+		assert(pipe2(p, O_CLOEXEC) == 0);
+
+		char buf[5];
+		auto r = us.read(p[0], buf, sizeof(buf));
+		auto w = us.write(p[1], "hello", 5);
+		assert(aid_get(us, w) == 5U);
+		assert(aid_get(us, r) == 5U);
+		assert(std::memcmp(buf, "hello", 5) == 0);
+
+		close(p[0]);
+		close(p[1]);
+	}
+
+	/* Errors complete the future with a system_error. */
+	{
+		ilias::uring_service us;
+		char c;
+		auto r = us.read(-1, &c, 1);
+		bool failed = false;
+		try {
+			aid_get(us, r);
+		} catch (const std::system_error& e) {
+			failed = (e.code().value() == EBADF);
+		}
+		assert(failed);
+	}
+
+	/*
+	 * File I/O through a threadpool:
+	 * a batch of writes, fsync, then reads into a registered buffer.
+	 */
+	{
+		ilias::threadpool tp;
+		ilias::uring_service us;
+		threadpool_attach(us, tp);
+
+		char path[] = "/tmp/ilias_uring_XXXXXX";
+		const int fd = mkstemp(path);
+		assert(fd != -1);
+		unlink(path);
+
+		std::vector<int> data(COUNT);
+		std::vector<ilias::cb_future<std::size_t>> writes;
+		for (int i = 0; i < COUNT; ++i) {
+			data[i] = i;
+			writes.push_back(us.write(fd, &data[i], sizeof(int),
+			    i * sizeof(int)));
+		}
+		for (auto& f : writes)
+			assert(f.get() == sizeof(int));
+		assert(us.fsync(fd).get() == 0U);
+
+		std::vector<int> buf(COUNT, -1);
+		struct iovec iov{ buf.data(), buf.size() * sizeof(int) };
+		us.register_buffers(&iov, 1);
+		assert(us.read_fixed(fd, buf.data(), iov.iov_len, 0, 0U).get() ==
+		    iov.iov_len);
+		assert(buf == data);
+
+		buf[0] = 42;
+		assert(us.write_fixed(fd, buf.data(), sizeof(int), 0, 0U).get() ==
+		    sizeof(int));
+		us.unregister_buffers();
+
+		int v;
+		assert(us.read(fd, &v, sizeof(v), 0U).get() == sizeof(v));
+		assert(v == 42);
+		close(fd);
+	}
+
+	/* Sockets through a threadpool: accept, send and recv. */
+	{
+		ilias::threadpool tp;
+		ilias::uring_service us;
+		threadpool_attach(us, tp);
+
+		const int lfd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		assert(lfd != -1);
+		struct sockaddr_un sa;
+		std::memset(&sa, 0, sizeof(sa));
+		sa.sun_family = AF_UNIX;
+		/* Abstract socket name. */
+		std::snprintf(sa.sun_path + 1, sizeof(sa.sun_path) - 1,
+		    "ilias_uring_%d", static_cast<int>(getpid()));
+		const auto salen = static_cast<socklen_t>(
+		    offsetof(struct sockaddr_un, sun_path) + 1 +
+		    std::strlen(sa.sun_path + 1));
+		assert(bind(lfd, reinterpret_cast<struct sockaddr*>(&sa),
+		    salen) == 0);
+		assert(listen(lfd, 1) == 0);
+
+		auto a = us.accept(lfd);
+		const int cfd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		assert(connect(cfd, reinterpret_cast<struct sockaddr*>(&sa),
+		    salen) == 0);
+		const int sfd = a.get();
+		assert(sfd >= 0);
+
+		char buf[4];
+		auto r = us.recv(sfd, buf, sizeof(buf), MSG_WAITALL);
+		assert(us.send(cfd, "ping", 4).get() == 4U);
+		assert(r.get() == 4U);
+		assert(std::memcmp(buf, "ping", 4) == 0);
+
+		/* Destruction cancels operations in flight. */
+		ilias::cb_future<std::size_t> pending;
+		{
+			ilias::uring_service us2;
+			pending = us2.recv(sfd, buf, sizeof(buf));
+			us2.aid();
+		}
+		bool cancelled = false;
+		try {
+			pending.get();
+		} catch (const std::system_error& e) {
+			cancelled = (e.code().value() == ECANCELED ||
+			    e.code().value() == EINTR);
+		}
+		assert(cancelled);
+
+		close(cfd);
+		close(sfd);
+		close(lfd);
+	}
+
+	return 0;
+}
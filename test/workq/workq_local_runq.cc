@@ -0,0 +1,81 @@
+#include <ilias/workq.h>
+#include <ilias/threadpool.h>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+const unsigned int COUNTER = 1000;
+const unsigned int FANOUT = 4;
+const unsigned int STEAL = 100;
+
+int
+main()
+{
+	std::atomic<unsigned int> counter{ 0U };
+	ilias::threadpool tp{ 4 };
+	{
+		auto wqs = ilias::new_workq_service(
+		    ilias::workq_service::WQS_LOCAL_RUNQ);
+
+		/*
+		 * Each job schedules FANOUT jobs from within the worker thread,
+		 * which end up on the local runq of that worker and
+		 * have to be stolen by the other workers.
+		 */
+		for (unsigned int i = 0; i < COUNTER; ++i) {
+			wqs->new_workq()->once([&counter, wqs]() {
+				for (unsigned int j = 0; j < FANOUT; ++j) {
+					wqs->new_workq()->once([&counter]() {
+						counter.fetch_add(1U);
+					    });
+				}
+			    });
+		}
+
+		threadpool_attach(*wqs, tp);
+	}
+
+	while (counter != COUNTER * FANOUT)
+		std::this_thread::yield();
+
+	assert(counter == COUNTER * FANOUT);
+
+	/*
+	 * A worker that stays busy doesn't run the jobs on its local runq:
+	 * the other workers steal them.
+	 */
+	{
+		ilias::threadpool steal_tp{ 4 };
+		auto wqs = ilias::new_workq_service(
+		    ilias::workq_service::WQS_LOCAL_RUNQ);
+		threadpool_attach(*wqs, steal_tp);
+
+		std::atomic<unsigned int> ran{ 0U }, stolen{ 0U };
+		std::atomic<bool> done{ false };
+		wqs->new_workq()->once([&ran, &stolen, &done, wqs]() {
+			const auto self = std::this_thread::get_id();
+			for (unsigned int j = 0; j < STEAL; ++j) {
+				wqs->new_workq()->once([&ran, &stolen, self]() {
+					if (std::this_thread::get_id() != self)
+						stolen.fetch_add(1U);
+					ran.fetch_add(1U);
+				    });
+			}
+
+			const auto deadline = std::chrono::steady_clock::now() +
+			    std::chrono::seconds(30);
+			while (ran != STEAL &&
+			    std::chrono::steady_clock::now() < deadline)
+				std::this_thread::yield();
+			done.store(true);
+		    });
+
+		while (!done)
+			std::this_thread::yield();
+		assert(ran == STEAL);
+		assert(stolen == STEAL);
+	}
+	return 0;
+}
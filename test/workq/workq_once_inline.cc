@@ -0,0 +1,71 @@
+#include <ilias/workq.h>
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <new>
+
+const unsigned int COUNTER = 1000;
+
+/* Count heap allocations. */
+std::atomic<unsigned int> allocations{ 0U };
+
+void*
+operator new(std::size_t sz)
+{
+	allocations.fetch_add(1U, std::memory_order_relaxed);
+	if (void* p = std::malloc(sz == 0 ? 1 : sz))
+		return p;
+	throw std::bad_alloc();
+}
+
+void
+operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void
+operator delete(void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+void
+plain_fn()
+{
+	/* Empty body. */
+}
+
+int
+main()
+{
+	unsigned int counter = 0;
+	auto wqs = ilias::new_workq_service();
+	auto wq = wqs->new_workq();
+
+	/* Populate the job freelist. */
+	for (unsigned int i = 0; i < COUNTER; ++i) {
+		wq->once([&counter]() { ++counter; });
+		wq->once(&plain_fn);
+		wqs->aid(2);
+	}
+	assert(counter == COUNTER);
+
+	/* Steady state: once() does not allocate. */
+	const auto before = allocations.load();
+	for (unsigned int i = 0; i < COUNTER; ++i) {
+		wq->once([&counter]() { ++counter; });
+		wq->once(&plain_fn);
+		wqs->aid(2);
+	}
+	assert(allocations.load() == before);
+	assert(counter == 2 * COUNTER);
+
+	/* Inline jobs can also be created as ordinary jobs. */
+	auto job = wq->new_job(ilias::workq_job::TYPE_PERSIST,
+	    [&counter]() { ++counter; });
+	job->activate();
+	wqs->aid();
+	assert(counter == 2 * COUNTER + 1);
+	return 0;
+}
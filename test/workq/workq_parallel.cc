@@ -0,0 +1,97 @@
+#include <ilias/parallel.h>
+#include <ilias/threadpool.h>
+#include <ilias/workq.h>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <functional>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+const unsigned int COUNT = 100000;
+
+void
+test(ilias::workq_service_ptr wqs)
+{
+	/* parallel_for visits each index exactly once. */
+	std::vector<std::atomic<unsigned int>> seen(COUNT);
+	ilias::parallel_for(wqs, 0U, COUNT, 16,
+	    [&seen](unsigned int i) {
+		seen[i].fetch_add(1U, std::memory_order_relaxed);
+	    }).get();
+	assert(std::all_of(seen.begin(), seen.end(),
+	    [](const std::atomic<unsigned int>& v) { return v == 1U; }));
+
+	/* parallel_reduce over iterators, with an order dependent combine. */
+	std::vector<unsigned int> v(COUNT);
+	for (unsigned int i = 0; i < COUNT; ++i)
+		v[i] = i;
+	auto sum = ilias::parallel_reduce(wqs, v.cbegin(), v.cend(), 64,
+	    0ULL,
+	    [](unsigned long long acc, std::vector<unsigned int>::const_iterator i) {
+		return acc + *i;
+	    },
+	    std::plus<unsigned long long>());
+	assert(sum.get() == 1ULL * COUNT * (COUNT - 1U) / 2U);
+	auto last = ilias::parallel_reduce(wqs, 0U, COUNT, 64, 0U,
+	    [](unsigned int, unsigned int i) { return i; },
+	    [](unsigned int, unsigned int rhs) { return rhs; });
+	assert(last.get() == COUNT - 1U);
+
+	/* Empty ranges complete immediately. */
+	ilias::parallel_for(wqs, 0, 0, 1, [](int) { assert(false); }).get();
+	assert(ilias::parallel_reduce(wqs, 0, 0, 1, 17,
+	    [](int acc, int) { return acc; },
+	    std::plus<int>()).get() == 17);
+
+	/* parallel_sort. */
+	std::mt19937 rnd;
+	for (auto& x : v)
+		x = rnd();
+	auto expect = v;
+	std::sort(expect.begin(), expect.end(), std::greater<unsigned int>());
+	ilias::parallel_sort(wqs, v.begin(), v.end(),
+	    std::greater<unsigned int>()).get();
+	assert(v == expect);
+
+	/* Exceptions propagate to the future. */
+	auto f = ilias::parallel_for(wqs, 0U, COUNT, 1,
+	    [](unsigned int i) {
+		if (i == COUNT / 2U)
+			throw std::runtime_error("failed");
+	    });
+	bool caught = false;
+	try {
+		f.get();
+	} catch (const std::runtime_error&) {
+		caught = true;
+	}
+	assert(caught);
+}
+
+int
+main()
+{
+	/* Without threadpool, the calling thread does all the work. */
+	test(ilias::new_workq_service());
+
+	ilias::threadpool tp{ 4 };
+	auto wqs = ilias::new_workq_service();
+	threadpool_attach(*wqs, tp);
+	for (int i = 0; i < 10; ++i)
+		test(wqs);
+
+	/* Co-routine jobs can run repeatedly. */
+	std::atomic<unsigned int> counter{ 0U };
+	std::vector<std::function<void()>> fns(100,
+	    [&counter]() { counter.fetch_add(1U); });
+	auto job = wqs->new_workq()->new_job(0, fns);
+	for (unsigned int i = 1; i <= 10; ++i) {
+		job->activate();
+		while (counter != 100U * i)
+			std::this_thread::yield();
+	}
+	return 0;
+}
@@ -0,0 +1,173 @@
+#include <ilias/future.h>
+#include <ilias/threadpool.h>
+#include <ilias/workq.h>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+const unsigned int NTHREADS = 2;
+const unsigned int SWITCHERS = 4;
+const unsigned int ROUNDS = 500;
+const unsigned int CONTENDERS = 16;
+
+/* Wait for flag, bounded so a lost handoff fails the test. */
+void
+await(const std::atomic<bool>& flag)
+{
+	const auto deadline = std::chrono::steady_clock::now() +
+	    std::chrono::seconds(30);
+
+	while (!flag.load()) {
+		assert(std::chrono::steady_clock::now() < deadline);
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+/*
+ * Shared by the jobs of a test.
+ * The jobs capture a pointer only, so they are stored inline
+ * and starting them never waits for them to finish.
+ */
+struct state
+{
+	ilias::workq_ptr wq;
+	std::mutex order_mtx;
+	std::vector<int> order;
+	std::atomic<bool> holding{ false }, release{ false };
+	std::atomic<bool> done{ false };
+
+	ilias::workq_job_ptr job;
+	unsigned int counter{ 0U };
+	std::atomic<unsigned int> finished{ 0U };
+
+	void
+	record(int v)
+	{
+		std::lock_guard<std::mutex> lck{ this->order_mtx };
+		this->order.push_back(v);
+	}
+};
+
+int
+main()
+{
+	ilias::threadpool tp{ NTHREADS };
+	auto wqs = ilias::new_workq_service();
+	threadpool_attach(*wqs, tp);
+	auto wq = wqs->new_workq();
+
+	/*
+	 * A thread waiting in workq_switch() takes the workq before
+	 * jobs that were queued while it waited.
+	 */
+	{
+		state st;
+		state* s = &st;
+		st.wq = wq;
+
+		wq->once([s]() {
+			s->holding.store(true);
+			await(s->release);
+			s->wq->once([s]() {
+				s->record(2);
+				s->done.store(true);
+			    });
+		    });
+		await(st.holding);
+
+		wqs->new_workq()->once([s]() {
+			auto prev = ilias::workq_switch(
+			    ilias::workq_pop_state(s->wq));
+			assert(ilias::workq::get_current() == s->wq);
+			s->record(1);
+			ilias::workq_switch(prev);
+		    });
+
+		/* Give the switcher time to queue up. */
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		st.release.store(true);
+		await(st.done);
+		assert(st.order.size() == 2 &&
+		    st.order[0] == 1 && st.order[1] == 2);
+	}
+
+	/* Switching threads exclude each other and the workq's jobs. */
+	{
+		state st;
+		state* s = &st;
+		st.wq = wq;
+		st.job = wq->new_job([s]() { ++s->counter; });
+
+		for (unsigned int i = 0; i < SWITCHERS; ++i) {
+			wqs->new_workq()->once([s]() {
+				for (unsigned int r = 0; r < ROUNDS; ++r) {
+					auto prev = ilias::workq_switch(
+					    ilias::workq_pop_state(s->wq));
+					++s->counter;
+					ilias::workq_switch(prev);
+					s->job->activate();
+				}
+				if (s->finished.fetch_add(1U) + 1U ==
+				    SWITCHERS)
+					s->done.store(true);
+			    });
+		}
+		await(st.done);
+
+		st.job->deactivate();
+		ilias::workq_switch_async(ilias::workq_pop_state(wq),
+		    [s]() {
+			assert(s->counter >= SWITCHERS * ROUNDS);
+		    }).get();
+	}
+
+	/*
+	 * Many threads contending on one switch:
+	 * every switch gets the workq, none of them is lost.
+	 */
+	{
+		state st;
+		state* s = &st;
+		st.wq = wq;
+
+		for (unsigned int i = 0; i < CONTENDERS; ++i) {
+			wqs->new_workq()->once([s]() {
+				for (unsigned int r = 0; r < ROUNDS; ++r) {
+					auto prev = ilias::workq_switch(
+					    ilias::workq_pop_state(s->wq));
+					++s->counter;
+					ilias::workq_switch(prev);
+				}
+				if (s->finished.fetch_add(1U) + 1U ==
+				    CONTENDERS)
+					s->done.store(true);
+			    });
+		}
+		await(st.done);
+		assert(st.counter == CONTENDERS * ROUNDS);
+	}
+
+	/* The asynchronous hop runs on the workq, with its lock. */
+	{
+		auto f = ilias::workq_switch_async(ilias::workq_pop_state(wq),
+		    [&wq](int v) {
+			assert(ilias::workq::get_current() == wq);
+			return v + 1;
+		    }, 41);
+		assert(f.get() == 42);
+
+		bool threw = false;
+		try {
+			ilias::workq_switch_async(ilias::workq_pop_state(),
+			    []() {});
+		} catch (const std::invalid_argument&) {
+			threw = true;
+		}
+		assert(threw);
+	}
+	return 0;
+}
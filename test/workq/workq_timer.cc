@@ -0,0 +1,57 @@
+#include <ilias/workq.h>
+#include <ilias/threadpool.h>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <thread>
+
+using clock_type = std::chrono::steady_clock;
+
+const unsigned int PERIODS = 5;
+
+int
+main()
+{
+	std::atomic<bool> fired{ false };
+	std::atomic<bool> cancelled_ran{ false };
+	std::atomic<unsigned int> periods{ 0U };
+	clock_type::time_point fired_at;
+
+	ilias::threadpool tp{ 2 };
+	auto wqs = ilias::new_workq_service();
+	threadpool_attach(*wqs, tp);
+	auto wq = wqs->new_workq();
+
+	/* One-shot delayed activation. */
+	auto oneshot = wq->new_job([&]() {
+		fired_at = clock_type::now();
+		fired.store(true);
+	    });
+	/* Periodic activation, deactivated after PERIODS runs. */
+	ilias::workq_job_ptr periodic;
+	periodic = wq->new_job(ilias::workq_job::TYPE_PERIODIC, [&]() {
+		if (periods.fetch_add(1U) + 1U == PERIODS)
+			periodic->deactivate();
+	    });
+	/* Cancelled activation. */
+	auto cancelled = wq->new_job([&]() {
+		cancelled_ran.store(true);
+	    });
+
+	const auto start = clock_type::now();
+	oneshot->activate_after(std::chrono::milliseconds(50));
+	periodic->activate_after(std::chrono::milliseconds(10));
+	cancelled->activate_after(std::chrono::milliseconds(20));
+	cancelled->deactivate();
+
+	while (!fired || periods < PERIODS)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+	assert(fired_at - start >= std::chrono::milliseconds(50));
+
+	/* Neither the periodic, nor the cancelled job may run again. */
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	assert(periods == PERIODS);
+	assert(!cancelled_ran);
+	return 0;
+}